@@ -7,38 +7,112 @@
 #define MAX_PACKAGES 100
 #define MAX_NAME_LENGTH 50
 #define MAX_VERSION_LENGTH 20
+#define PACKAGE_BLOCK_SIZE 4096
+#define PACKAGE_CACHE_DIR "/var/cache/packages/"
+#define PACKAGE_INSTALL_DIR "/opt/"
+#define MAX_PACKAGE_PATH (sizeof(PACKAGE_CACHE_DIR) + MAX_NAME_LENGTH)
+#define O_CREAT 0x40
+#define O_TRUNC 0x200
 
 typedef struct {
     char name[MAX_NAME_LENGTH];
     char version[MAX_VERSION_LENGTH];
     bool installed;
+    // Empreinte du contenu installé (package_file_checksum)
+    uint64_t checksum;
 } Package;
 
 static Package packages[MAX_PACKAGES];
 static int package_count = 0;
+// Blocs alignés sur les pages: tmpfs reconnaît et partage ceux qu'il contient déjà
+static uint8_t package_block[PACKAGE_BLOCK_SIZE];
+
+// Déclarations externes (lib/vfs.c, lib/xxhash.c)
+extern int vfs_open(const char* path, uint32_t flags);
+extern void vfs_close(int fd);
+extern int32_t vfs_read(int fd, void* buffer, uint32_t size);
+extern int32_t vfs_write(int fd, const void* buffer, uint32_t size);
+extern int vfs_reflink(const char* source, const char* target);
+extern uint64_t xxh64(const void* data, uint32_t length, uint64_t seed);
+
+int package_file_checksum(const char* path, uint64_t* checksum);
+int install_package_file(const char* source, const char* target);
 
 int init_package_manager() {
     package_count = 0;
     return 0;
 }
 
-int install_package(const char* name, const char* version) {
-    if (package_count >= MAX_PACKAGES) {
-        return -1; 
+// `dir` suivi du nom du paquet, tronqué à MAX_NAME_LENGTH - 1 caractères comme dans Package
+static void package_path(char* path, const char* dir, const char* name) {
+    size_t dir_length = strlen(dir);
+    size_t name_length = strlen(name);
+    if (name_length > MAX_NAME_LENGTH - 1) {
+        name_length = MAX_NAME_LENGTH - 1;
+    }
+    memcpy(path, dir, dir_length);
+    memcpy(path + dir_length, name, name_length);
+    path[dir_length + name_length] = '\0';
+}
+
+// Installer le contenu du paquet, déposé dans PACKAGE_CACHE_DIR, sous PACKAGE_INSTALL_DIR.
+// La copie est vérifiée par son empreinte avant que le paquet soit marqué installé.
+// Sans contenu dans le cache, ou si le système de fichiers cible ne peut pas créer le
+// fichier (ext4 ici), le paquet est seulement enregistré: empreinte 0.
+static int deploy_package(const char* name, uint64_t* checksum) {
+    char source[MAX_PACKAGE_PATH];
+    char target[MAX_PACKAGE_PATH];
+    package_path(source, PACKAGE_CACHE_DIR, name);
+    package_path(target, PACKAGE_INSTALL_DIR, name);
+    *checksum = 0;
+
+    uint64_t expected;
+    int result = package_file_checksum(source, &expected);
+    if (result == -1) {
+        return 0;
+    }
+    if (result < 0) {
+        return -3;
+    }
+
+    result = install_package_file(source, target);
+    if (result == -2) {
+        return 0;
+    }
+    if (result < 0 || package_file_checksum(target, checksum) < 0 || *checksum != expected) {
+        *checksum = 0;
+        return -3;
     }
+    return 0;
+}
+
+int install_package(const char* name, const char* version) {
+    uint64_t checksum;
 
     for (int i = 0; i < package_count; i++) {
         if (strcmp(packages[i].name, name) == 0) {
             if (packages[i].installed) {
                 return -2; 
             }
+            if (deploy_package(name, &checksum) < 0) {
+                return -3;
+            }
+            packages[i].checksum = checksum;
             packages[i].installed = true;
             return 0;
         }
     }
 
+    if (package_count >= MAX_PACKAGES) {
+        return -1; 
+    }
+    if (deploy_package(name, &checksum) < 0) {
+        return -3;
+    }
+
     strncpy(packages[package_count].name, name, MAX_NAME_LENGTH - 1);
     strncpy(packages[package_count].version, version, MAX_VERSION_LENGTH - 1);
+    packages[package_count].checksum = checksum;
     packages[package_count].installed = true;
     package_count++;
 
@@ -79,9 +153,72 @@ int update_package(const char* name, const char* new_version) {
             if (!packages[i].installed) {
                 return -1; 
             }
+            // La nouvelle version remplace le contenu installé
+            uint64_t checksum;
+            if (deploy_package(name, &checksum) < 0) {
+                return -3;
+            }
             strncpy(packages[i].version, new_version, MAX_VERSION_LENGTH - 1);
+            packages[i].checksum = checksum;
             return 0;
         }
     }
     return -2; 
-}
\ No newline at end of file
+}
+
+// Empreinte du contenu d'un fichier: xxh64 de chaque bloc, chaîné par la graine.
+// -1 si le fichier ne s'ouvre pas, -2 sur une erreur de lecture.
+int package_file_checksum(const char* path, uint64_t* checksum) {
+    int fd = vfs_open(path, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    uint64_t hash = 0;
+    int32_t done;
+    while ((done = vfs_read(fd, package_block, PACKAGE_BLOCK_SIZE)) > 0) {
+        hash = xxh64(package_block, done, hash);
+    }
+    vfs_close(fd);
+    if (done < 0) {
+        return -2;
+    }
+
+    *checksum = hash;
+    return 0;
+}
+
+// Installer un fichier d'un paquet. Dans un même montage qui le permet, la copie partage
+// les blocs de la source (reflink); sinon elle est recopiée bloc par bloc.
+// -1 si la source ne se lit pas, -2 si la cible ne peut pas être créée, -3 si l'écriture échoue.
+int install_package_file(const char* source, const char* target) {
+    if (vfs_reflink(source, target) == 0) {
+        return 0;
+    }
+
+    int in = vfs_open(source, 0);
+    if (in < 0) {
+        return -1;
+    }
+    int out = vfs_open(target, O_CREAT | O_TRUNC);
+    if (out < 0) {
+        vfs_close(in);
+        return -2;
+    }
+
+    int result = 0;
+    int32_t done;
+    while ((done = vfs_read(in, package_block, PACKAGE_BLOCK_SIZE)) > 0) {
+        if (vfs_write(out, package_block, done) != done) {
+            result = -3;
+            break;
+        }
+    }
+    if (done < 0) {
+        result = -1;
+    }
+
+    vfs_close(in);
+    vfs_close(out);
+    return result;
+}
@@ -1,41 +1,424 @@
-#include <stdio.h>
-#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
 #include <string.h>
-#include <time.h>
 
-#define MAX_FILES 1000
+// Système de fichiers en mémoire (installation au premier démarrage, données de type /tmp).
+// Arbre de dossiers: chaque dossier indexe ses enfants dans une table de hachage qui
+// double quand elle se remplit, donc la recherche d'un nom ne dépend pas du nombre
+// de fichiers. Le contenu des fichiers est stocké par pages de PAGE_SIZE octets.
+// Les pages sont comptées par référence: une page pleine dont le contenu existe déjà
+// (même hash xxh64, mêmes octets) est partagée au lieu d'être recopiée, et
+// reflink_entry() fait partager à une copie toutes les pages de l'original. Une page
+// partagée est dupliquée à sa première modification (copie sur écriture).
+// Monté à travers la couche VFS (lib/vfs.c) sous le type "tmpfs".
+
 #define MAX_FILENAME 256
 #define MAX_PATH 1024
+#define PAGE_SIZE 4096
+#define INITIAL_BUCKETS 8
+#define INITIAL_PAGE_BUCKETS 64
+#define O_CREAT 0x40
+#define O_TRUNC 0x200
+#define DIRENT_TYPE_FILE 1
+#define DIRENT_TYPE_DIRECTORY 2
+
+// Page de données, partagée par tous les fichiers qui y font référence
+typedef struct Page {
+    unsigned int refcount;
+    // Page présente dans l'index des contenus (hash valable)
+    int indexed;
+    uint64_t hash;
+    struct Page* hash_next;
+    char data[PAGE_SIZE];
+} Page;
 
+// Index des pages pleines par contenu, commun à tous les montages
 typedef struct {
-    char name[MAX_FILENAME];
-    char path[MAX_PATH];
+    Page** buckets;
+    size_t bucket_count;
+    size_t count;
+    // Pages évitées grâce au partage
+    size_t shared;
+} PageIndex;
+
+typedef struct FileEntry {
+    char* name;
     size_t size;
-    time_t created;
-    time_t modified;
+    // Dates en microsecondes depuis le démarrage (horloge du noyau)
+    uint64_t created;
+    uint64_t modified;
     int is_directory;
     int is_hidden;
     int is_system;
     char permissions[10];
     char owner[32];
     char group[32];
+
+    struct FileEntry* parent;
+    // Chaînage dans la table de hachage du dossier parent
+    struct FileEntry* hash_next;
+    unsigned int hash;
+    // Ordre de création, pour l'affichage
+    struct FileEntry* prev_sibling;
+    struct FileEntry* next_sibling;
+    // Fichiers ouverts et listages en cours: l'entrée ne peut pas être supprimée
+    unsigned int open_count;
+
+    // Dossier: enfants indexés par nom
+    struct FileEntry** buckets;
+    size_t bucket_count;
+    size_t child_count;
+    // Incrémenté à chaque suppression: les listages en cours reprennent par position
+    unsigned int generation;
+    struct FileEntry* first_child;
+    struct FileEntry* last_child;
+
+    // Fichier: pages de données, NULL pour une page jamais écrite (lue comme des zéros)
+    Page** pages;
+    size_t page_slots;
 } FileEntry;
 
 typedef struct {
-    FileEntry entries[MAX_FILES];
-    int count;
+    FileEntry* root;
+    size_t count;
     char mount_point[MAX_PATH];
     char fs_type[10]; // "NTFS" ou "ext4"
 } FileSystem;
 
-// Initialisation du système de fichiers
-FileSystem* init_filesystem(const char* mount_point, const char* fs_type) {
-    FileSystem* fs = (FileSystem*)malloc(sizeof(FileSystem));
+// Fichier ouvert à travers la couche VFS
+typedef struct {
+    FileEntry* entry;
+    size_t position;
+} OpenFile;
+
+// Listage en cours d'un dossier: `next` est valable tant que la génération n'a pas changé
+typedef struct {
+    FileEntry* dir;
+    FileEntry* next;
+    unsigned int position;
+    unsigned int generation;
+} DirStream;
+
+// Entrée d'un lot renvoyé par readdir (même format que lib/filesystem.c)
+typedef struct {
+    uint32_t inode;
+    uint16_t rec_len;
+    uint8_t type;
+    uint8_t name_len;
+    char name[];
+} dirent_t;
+
+// Tables d'opérations de la couche VFS (lib/vfs.c)
+typedef struct mapping mapping_t;
+
+typedef struct {
+    void* (*mount)(const char* path, const char* device);
+    void (*unmount)(void* mount);
+    bool (*sync)(void* mount);
+} vfs_super_operations_t;
+
+typedef struct {
+    void* (*open)(void* mount, const char* path, uint32_t flags);
+    void* (*opendir)(void* mount, const char* path);
+    int (*reflink)(void* mount, const char* source, const char* target);
+} vfs_inode_operations_t;
+
+typedef struct {
+    int32_t (*read)(void* file, void* buffer, uint32_t size);
+    int32_t (*write)(void* file, const void* buffer, uint32_t size);
+    int (*fsync)(void* file);
+    void (*release)(void* file);
+    mapping_t* (*mapping)(void* file);
+    uint32_t (*tell)(void* file);
+    void (*seek)(void* file, uint32_t position);
+    int32_t (*readdir)(void* dir, void* buffer, uint32_t size);
+    uint32_t (*telldir)(void* dir);
+    void (*seekdir)(void* dir, uint32_t position);
+    void (*closedir)(void* dir);
+} vfs_file_operations_t;
+
+static PageIndex page_index;
+
+// Déclarations externes (lib/memory.c, lib/vfs.c, lib/xxhash.c, lib/time.c, kernel/kernel.c)
+extern void* kmalloc(size_t size);
+extern void kfree(void* ptr);
+extern void* memchr(const void* data, int value, size_t length);
+extern uint64_t xxh64(const void* data, uint32_t length, uint64_t seed);
+extern bool vfs_register_filesystem(const char* name, const vfs_super_operations_t* super_ops,
+                                    const vfs_inode_operations_t* inode_ops, const vfs_file_operations_t* file_ops);
+extern uint64_t get_current_time();
+extern void print(const char* str);
+
+const char* basename(const char* path);
+const char* dirname(const char* path);
+int create_directory(FileSystem* fs, const char* path);
+
+// Hachage FNV-1a d'un nom de `length` octets
+static unsigned int hash_name(const char* name, size_t length) {
+    unsigned int hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)name[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static FileEntry* new_entry(const char* name, size_t length, int is_directory) {
+    FileEntry* entry = (FileEntry*)kmalloc(sizeof(FileEntry));
+    if (!entry) return NULL;
+    memset(entry, 0, sizeof(FileEntry));
+
+    entry->name = (char*)kmalloc(length + 1);
+    if (!entry->name) {
+        kfree(entry);
+        return NULL;
+    }
+    memcpy(entry->name, name, length);
+    entry->name[length] = '\0';
+    entry->hash = hash_name(name, length);
+
+    entry->created = get_current_time();
+    entry->modified = entry->created;
+    entry->is_directory = is_directory;
+    strcpy(entry->permissions, is_directory ? "rwxr-xr-x" : "rw-r--r--");
+    strcpy(entry->owner, "root");
+    strcpy(entry->group, "root");
+    return entry;
+}
+
+static void unindex_page(Page* page) {
+    Page** link = &page_index.buckets[page->hash & (page_index.bucket_count - 1)];
+    while (*link != page) link = &(*link)->hash_next;
+    *link = page->hash_next;
+    page->indexed = 0;
+    page_index.count--;
+}
+
+// Ranger une page pleine sous le hash de son contenu; sans place, elle reste simplement privée
+static void index_page(Page* page, uint64_t hash) {
+    if (page_index.count >= page_index.bucket_count) {
+        size_t bucket_count = page_index.bucket_count ? page_index.bucket_count * 2 : INITIAL_PAGE_BUCKETS;
+        Page** buckets = (Page**)kmalloc(bucket_count * sizeof(Page*));
+        if (!buckets) return;
+        memset(buckets, 0, bucket_count * sizeof(Page*));
+
+        for (size_t i = 0; i < page_index.bucket_count; i++) {
+            Page* current = page_index.buckets[i];
+            while (current) {
+                Page* next = current->hash_next;
+                size_t index = current->hash & (bucket_count - 1);
+                current->hash_next = buckets[index];
+                buckets[index] = current;
+                current = next;
+            }
+        }
+        kfree(page_index.buckets);
+        page_index.buckets = buckets;
+        page_index.bucket_count = bucket_count;
+    }
+
+    size_t index = hash & (page_index.bucket_count - 1);
+    page->hash = hash;
+    page->hash_next = page_index.buckets[index];
+    page_index.buckets[index] = page;
+    page->indexed = 1;
+    page_index.count++;
+}
+
+// Page indexée au contenu identique à `data`; le hash ne suffit pas, les octets sont comparés
+static Page* find_page(uint64_t hash, const void* data) {
+    if (!page_index.bucket_count) return NULL;
+
+    Page* page = page_index.buckets[hash & (page_index.bucket_count - 1)];
+    while (page) {
+        if (page->hash == hash && memcmp(page->data, data, PAGE_SIZE) == 0) return page;
+        page = page->hash_next;
+    }
+    return NULL;
+}
+
+static void put_page(Page* page) {
+    if (!page || --page->refcount) return;
+    if (page->indexed) unindex_page(page);
+    kfree(page);
+}
+
+// Page de `slot` prête à être modifiée: allouée si absente, dupliquée si partagée,
+// retirée de l'index puisque son contenu va changer
+static Page* writable_page(Page** slot) {
+    Page* page = *slot;
+    if (!page) {
+        page = (Page*)kmalloc(sizeof(Page));
+        if (!page) return NULL;
+        memset(page, 0, sizeof(Page));
+        page->refcount = 1;
+        *slot = page;
+        return page;
+    }
+    if (page->refcount > 1) {
+        Page* copy = (Page*)kmalloc(sizeof(Page));
+        if (!copy) return NULL;
+        memcpy(copy->data, page->data, PAGE_SIZE);
+        copy->refcount = 1;
+        copy->indexed = 0;
+        copy->hash_next = NULL;
+        page->refcount--;
+        *slot = copy;
+        return copy;
+    }
+    if (page->indexed) unindex_page(page);
+    return page;
+}
+
+static void free_entry(FileEntry* entry) {
+    for (size_t i = 0; i < entry->page_slots; i++) {
+        put_page(entry->pages[i]);
+    }
+    kfree(entry->pages);
+    kfree(entry->buckets);
+    kfree(entry->name);
+    kfree(entry);
+}
+
+// Libérer un sous-arbre; la descente suit first_child sans récursion
+static void free_tree(FileEntry* entry) {
+    FileEntry* stop = entry->parent;
+    while (entry != stop) {
+        if (entry->first_child) {
+            FileEntry* child = entry->first_child;
+            entry->first_child = child->next_sibling;
+            entry = child;
+            continue;
+        }
+        FileEntry* parent = entry->parent;
+        free_entry(entry);
+        entry = parent;
+    }
+}
+
+static FileEntry* find_child(FileEntry* dir, const char* name, size_t length) {
+    if (!dir->is_directory || !dir->bucket_count) return NULL;
+
+    unsigned int hash = hash_name(name, length);
+    FileEntry* child = dir->buckets[hash & (dir->bucket_count - 1)];
+    while (child) {
+        if (child->hash == hash && strncmp(child->name, name, length) == 0 && child->name[length] == '\0') {
+            return child;
+        }
+        child = child->hash_next;
+    }
+    return NULL;
+}
+
+// Doubler la table des enfants d'un dossier
+static int grow_buckets(FileEntry* dir) {
+    size_t bucket_count = dir->bucket_count ? dir->bucket_count * 2 : INITIAL_BUCKETS;
+    FileEntry** buckets = (FileEntry**)kmalloc(bucket_count * sizeof(FileEntry*));
+    if (!buckets) return -1;
+    memset(buckets, 0, bucket_count * sizeof(FileEntry*));
+
+    for (size_t i = 0; i < dir->bucket_count; i++) {
+        FileEntry* child = dir->buckets[i];
+        while (child) {
+            FileEntry* next = child->hash_next;
+            size_t index = child->hash & (bucket_count - 1);
+            child->hash_next = buckets[index];
+            buckets[index] = child;
+            child = next;
+        }
+    }
+
+    kfree(dir->buckets);
+    dir->buckets = buckets;
+    dir->bucket_count = bucket_count;
+    return 0;
+}
+
+static int add_child(FileEntry* dir, FileEntry* child) {
+    if (dir->child_count >= dir->bucket_count && grow_buckets(dir) < 0) return -1;
+
+    size_t index = child->hash & (dir->bucket_count - 1);
+    child->hash_next = dir->buckets[index];
+    dir->buckets[index] = child;
+
+    child->parent = dir;
+    child->prev_sibling = dir->last_child;
+    child->next_sibling = NULL;
+    if (dir->last_child) dir->last_child->next_sibling = child;
+    else dir->first_child = child;
+    dir->last_child = child;
+
+    dir->child_count++;
+    dir->modified = child->created;
+    return 0;
+}
+
+static void remove_child(FileEntry* dir, FileEntry* child) {
+    FileEntry** link = &dir->buckets[child->hash & (dir->bucket_count - 1)];
+    while (*link != child) link = &(*link)->hash_next;
+    *link = child->hash_next;
+
+    if (child->prev_sibling) child->prev_sibling->next_sibling = child->next_sibling;
+    else dir->first_child = child->next_sibling;
+    if (child->next_sibling) child->next_sibling->prev_sibling = child->prev_sibling;
+    else dir->last_child = child->prev_sibling;
+
+    dir->child_count--;
+    dir->generation++;
+    dir->modified = get_current_time();
+}
+
+// Suivre `path` depuis la racine, composant par composant.
+// Si `last` est fourni, s'arrêter au dossier parent et y renvoyer le dernier composant.
+static FileEntry* walk_path(FileSystem* fs, const char* path, const char** last, size_t* last_length) {
+    FileEntry* current = fs->root;
+    const char* component = path;
+
+    for (;;) {
+        while (*component == '/') component++;
+        const char* end = component;
+        while (*end && *end != '/') end++;
+        size_t length = end - component;
+
+        const char* rest = end;
+        while (*rest == '/') rest++;
+
+        if (last && *rest == '\0') {
+            *last = component;
+            *last_length = length;
+            return length ? current : NULL;
+        }
+        if (length == 0) return current;
+        if (length >= MAX_FILENAME) return NULL;
+
+        current = find_child(current, component, length);
+        if (!current) return NULL;
+        component = end;
+    }
+}
+
+// Système de fichiers vide: seulement la racine
+static FileSystem* alloc_filesystem(const char* mount_point, const char* fs_type) {
+    FileSystem* fs = (FileSystem*)kmalloc(sizeof(FileSystem));
     if (!fs) return NULL;
 
-    strncpy(fs->mount_point, mount_point, MAX_PATH);
-    strncpy(fs->fs_type, fs_type, 10);
+    strncpy(fs->mount_point, mount_point, MAX_PATH - 1);
+    fs->mount_point[MAX_PATH - 1] = '\0';
+    strncpy(fs->fs_type, fs_type, 9);
+    fs->fs_type[9] = '\0';
     fs->count = 0;
+    fs->root = new_entry("", 0, 1);
+    if (!fs->root) {
+        kfree(fs);
+        return NULL;
+    }
+    return fs;
+}
+
+// Initialisation du système de fichiers du premier démarrage
+FileSystem* create_filesystem(const char* mount_point, const char* fs_type) {
+    FileSystem* fs = alloc_filesystem(mount_point, fs_type);
+    if (!fs) return NULL;
 
     // Créer les dossiers système
     create_directory(fs, "/home");
@@ -50,71 +433,228 @@ FileSystem* init_filesystem(const char* mount_point, const char* fs_type) {
     return fs;
 }
 
-// Créer un fichier
-int create_file(FileSystem* fs, const char* path, const char* name) {
-    if (fs->count >= MAX_FILES) return -1;
+void destroy_filesystem(FileSystem* fs) {
+    if (!fs) return;
+    free_tree(fs->root);
+    kfree(fs);
+}
 
-    FileEntry* entry = &fs->entries[fs->count];
-    strncpy(entry->name, name, MAX_FILENAME);
-    strncpy(entry->path, path, MAX_PATH);
-    entry->size = 0;
-    entry->created = time(NULL);
-    entry->modified = entry->created;
-    entry->is_directory = 0;
-    entry->is_hidden = 0;
-    entry->is_system = 0;
-    strcpy(entry->permissions, "rw-r--r--");
-    strcpy(entry->owner, "root");
-    strcpy(entry->group, "root");
+// Trouver une entrée par son chemin complet
+FileEntry* find_entry(FileSystem* fs, const char* path) {
+    return walk_path(fs, path, NULL, NULL);
+}
+
+// Créer `name` dans `dir`; NULL si le nom est invalide ou existe déjà
+static FileEntry* create_entry(FileSystem* fs, FileEntry* dir, const char* name, size_t length, int is_directory) {
+    if (!dir || !dir->is_directory || length == 0 || length >= MAX_FILENAME) return NULL;
+    if (memchr(name, '/', length) || find_child(dir, name, length)) return NULL;
 
+    FileEntry* entry = new_entry(name, length, is_directory);
+    if (!entry) return NULL;
+    if (add_child(dir, entry) < 0) {
+        free_entry(entry);
+        return NULL;
+    }
     fs->count++;
-    return 0;
+    return entry;
+}
+
+// Créer un fichier
+int create_file(FileSystem* fs, const char* path, const char* name) {
+    FileEntry* entry = create_entry(fs, find_entry(fs, path), name, strlen(name), 0);
+    return entry ? 0 : -1;
 }
 
 // Créer un dossier
 int create_directory(FileSystem* fs, const char* path) {
-    if (fs->count >= MAX_FILES) return -1;
+    const char* name;
+    size_t length;
+    FileEntry* parent = walk_path(fs, path, &name, &length);
+    FileEntry* entry = create_entry(fs, parent, name, length, 1);
+    return entry ? 0 : -1;
+}
 
-    FileEntry* entry = &fs->entries[fs->count];
-    strncpy(entry->name, basename(path), MAX_FILENAME);
-    strncpy(entry->path, dirname(path), MAX_PATH);
-    entry->size = 0;
-    entry->created = time(NULL);
-    entry->modified = entry->created;
-    entry->is_directory = 1;
-    entry->is_hidden = 0;
-    entry->is_system = 0;
-    strcpy(entry->permissions, "rwxr-xr-x");
-    strcpy(entry->owner, "root");
-    strcpy(entry->group, "root");
+// Supprimer un fichier ou un dossier vide
+int remove_entry(FileSystem* fs, const char* path) {
+    FileEntry* entry = find_entry(fs, path);
+    if (!entry || entry == fs->root || entry->child_count || entry->open_count) return -1;
 
-    fs->count++;
+    remove_child(entry->parent, entry);
+    free_entry(entry);
+    fs->count--;
     return 0;
 }
 
-// Lister les fichiers d'un dossier
-void list_directory(FileSystem* fs, const char* path) {
-    printf("\nContenu de %s:\n", path);
-    printf("Permissions\tTaille\tPropriétaire\tGroupe\t\tModifié\t\tNom\n");
-    printf("----------------------------------------------------------------------\n");
-
-    for (int i = 0; i < fs->count; i++) {
-        if (strcmp(fs->entries[i].path, path) == 0) {
-            printf("%s\t", fs->entries[i].permissions);
-            printf("%zu\t", fs->entries[i].size);
-            printf("%s\t\t", fs->entries[i].owner);
-            printf("%s\t\t", fs->entries[i].group);
-            
-            char time_str[20];
-            strftime(time_str, 20, "%Y-%m-%d %H:%M", localtime(&fs->entries[i].modified));
-            printf("%s\t", time_str);
-            
-            if (fs->entries[i].is_directory) {
-                printf("\033[1;34m%s/\033[0m\n", fs->entries[i].name); // Bleu pour les dossiers
-            } else {
-                printf("%s\n", fs->entries[i].name);
+// Agrandir la table des pages pour contenir au moins `slots` pages
+static int reserve_pages(FileEntry* entry, size_t slots) {
+    if (slots <= entry->page_slots) return 0;
+
+    size_t page_slots = entry->page_slots ? entry->page_slots : 1;
+    while (page_slots < slots) page_slots *= 2;
+
+    Page** pages = (Page**)kmalloc(page_slots * sizeof(Page*));
+    if (!pages) return -1;
+    if (entry->page_slots) memcpy(pages, entry->pages, entry->page_slots * sizeof(Page*));
+    memset(pages + entry->page_slots, 0, (page_slots - entry->page_slots) * sizeof(Page*));
+    kfree(entry->pages);
+    entry->pages = pages;
+    entry->page_slots = page_slots;
+    return 0;
+}
+
+// Écrire dans un fichier à partir de `offset`; renvoie le nombre d'octets écrits.
+// Une page écrite en entier rejoint une page identique existante s'il y en a une.
+long write_entry(FileEntry* entry, size_t offset, const void* data, size_t size) {
+    if (!entry || entry->is_directory || !data) return -1;
+    if (size == 0) return 0;
+    if (reserve_pages(entry, (offset + size + PAGE_SIZE - 1) / PAGE_SIZE) < 0) return -1;
+
+    size_t written = 0;
+    while (written < size) {
+        size_t page = (offset + written) / PAGE_SIZE;
+        size_t page_offset = (offset + written) % PAGE_SIZE;
+        size_t chunk = PAGE_SIZE - page_offset;
+        if (chunk > size - written) chunk = size - written;
+
+        const char* source = (const char*)data + written;
+        if (chunk == PAGE_SIZE) {
+            uint64_t hash = xxh64(source, PAGE_SIZE, 0);
+            Page* same = find_page(hash, source);
+            if (same) {
+                if (same != entry->pages[page]) {
+                    same->refcount++;
+                    put_page(entry->pages[page]);
+                    entry->pages[page] = same;
+                    page_index.shared++;
+                }
+                written += chunk;
+                continue;
             }
+            Page* target = writable_page(&entry->pages[page]);
+            if (!target) break;
+            memcpy(target->data, source, PAGE_SIZE);
+            index_page(target, hash);
+        } else {
+            Page* target = writable_page(&entry->pages[page]);
+            if (!target) break;
+            memcpy(target->data + page_offset, source, chunk);
+        }
+        written += chunk;
+    }
+
+    if (offset + written > entry->size) entry->size = offset + written;
+    entry->modified = get_current_time();
+    return written ? (long)written : -1;
+}
+
+// Lire un fichier à partir de `offset`; renvoie le nombre d'octets lus (0 en fin de fichier)
+long read_entry(FileEntry* entry, size_t offset, void* data, size_t size) {
+    if (!entry || entry->is_directory || !data) return -1;
+    if (offset >= entry->size) return 0;
+    if (size > entry->size - offset) size = entry->size - offset;
+
+    size_t done = 0;
+    while (done < size) {
+        size_t page = (offset + done) / PAGE_SIZE;
+        size_t page_offset = (offset + done) % PAGE_SIZE;
+        size_t chunk = PAGE_SIZE - page_offset;
+        if (chunk > size - done) chunk = size - done;
+
+        // Un fichier agrandi par truncate_entry() n'a pas de page au-delà de page_slots: des zéros
+        if (page < entry->page_slots && entry->pages[page]) {
+            memcpy((char*)data + done, entry->pages[page]->data + page_offset, chunk);
+        } else {
+            memset((char*)data + done, 0, chunk);
         }
+        done += chunk;
+    }
+    return (long)done;
+}
+
+// Changer la taille d'un fichier; les pages au-delà sont rendues
+int truncate_entry(FileEntry* entry, size_t size) {
+    if (!entry || entry->is_directory) return -1;
+
+    size_t keep = (size + PAGE_SIZE - 1) / PAGE_SIZE;
+    for (size_t i = keep; i < entry->page_slots; i++) {
+        put_page(entry->pages[i]);
+        entry->pages[i] = NULL;
+    }
+    // Effacer la fin de la dernière page, pour qu'un agrandissement relise des zéros
+    if (size % PAGE_SIZE && keep <= entry->page_slots && entry->pages[keep - 1]) {
+        Page* last = writable_page(&entry->pages[keep - 1]);
+        if (!last) return -1;
+        memset(last->data + size % PAGE_SIZE, 0, PAGE_SIZE - size % PAGE_SIZE);
+    }
+
+    entry->size = size;
+    entry->modified = get_current_time();
+    return 0;
+}
+
+// Faire de `target` une copie de `source` qui partage toutes ses pages; elles ne sont
+// dupliquées qu'à la première modification de l'un ou l'autre fichier
+int reflink_entry(FileEntry* source, FileEntry* target) {
+    if (!source || !target || source->is_directory || target->is_directory) return -1;
+    if (source == target) return 0;
+
+    size_t pages = (source->size + PAGE_SIZE - 1) / PAGE_SIZE;
+    if (reserve_pages(target, pages) < 0) return -1;
+
+    // Un fichier agrandi par truncate_entry() peut avoir moins de pages que sa taille
+    for (size_t i = 0; i < target->page_slots; i++) {
+        Page* page = i < pages && i < source->page_slots ? source->pages[i] : NULL;
+        if (page) {
+            page->refcount++;
+            page_index.shared++;
+        }
+        put_page(target->pages[i]);
+        target->pages[i] = page;
+    }
+
+    target->size = source->size;
+    target->modified = get_current_time();
+    return 0;
+}
+
+// Nombre de pages de données partagées plutôt que recopiées depuis le démarrage
+size_t tmpfs_shared_pages() {
+    return page_index.shared;
+}
+
+static void print_size(size_t value) {
+    char text[12];
+    uint32_t length = sizeof(text) - 1;
+    text[length] = '\0';
+    do {
+        text[--length] = '0' + value % 10;
+        value /= 10;
+    } while (value);
+    print(text + length);
+}
+
+// Lister les fichiers d'un dossier sur la console
+void list_directory(FileSystem* fs, const char* path) {
+    FileEntry* dir = find_entry(fs, path);
+    if (!dir || !dir->is_directory) return;
+
+    print("\nContenu de ");
+    print(path);
+    print(":\n");
+    print("Permissions\tTaille\tPropriétaire\tGroupe\t\tNom\n");
+    print("----------------------------------------------------------------------\n");
+
+    for (FileEntry* entry = dir->first_child; entry; entry = entry->next_sibling) {
+        print(entry->permissions);
+        print("\t");
+        print_size(entry->size);
+        print("\t");
+        print(entry->owner);
+        print("\t\t");
+        print(entry->group);
+        print("\t\t");
+        print(entry->name);
+        print(entry->is_directory ? "/\n" : "\n");
     }
 }
 
@@ -131,4 +671,175 @@ const char* dirname(const char* path) {
     char* last_slash = strrchr(dir, '/');
     if (last_slash) *last_slash = '\0';
     return dir;
-} 
\ No newline at end of file
+}
+
+// Opérations VFS: un montage "tmpfs" est un FileSystem vide
+
+static void* tmpfs_mount(const char* path, const char* device) {
+    // Pas de périphérique: tout est en mémoire
+    (void)device;
+    return alloc_filesystem(path, "tmpfs");
+}
+
+static void tmpfs_unmount(void* mount) {
+    destroy_filesystem((FileSystem*)mount);
+}
+
+static void* tmpfs_open(void* mount, const char* path, uint32_t flags) {
+    FileSystem* fs = (FileSystem*)mount;
+    FileEntry* entry = find_entry(fs, path);
+    if (!entry && (flags & O_CREAT)) {
+        const char* name;
+        size_t length;
+        FileEntry* parent = walk_path(fs, path, &name, &length);
+        entry = create_entry(fs, parent, name, length, 0);
+    }
+    if (!entry || entry->is_directory) return NULL;
+    if (flags & O_TRUNC) truncate_entry(entry, 0);
+
+    OpenFile* file = (OpenFile*)kmalloc(sizeof(OpenFile));
+    if (!file) return NULL;
+    file->entry = entry;
+    file->position = 0;
+    entry->open_count++;
+    return file;
+}
+
+static void tmpfs_release(void* object) {
+    OpenFile* file = (OpenFile*)object;
+    file->entry->open_count--;
+    kfree(file);
+}
+
+static uint32_t tmpfs_tell(void* object) {
+    return (uint32_t)((OpenFile*)object)->position;
+}
+
+static void tmpfs_seek(void* object, uint32_t position) {
+    ((OpenFile*)object)->position = position;
+}
+
+static int32_t tmpfs_read(void* object, void* buffer, uint32_t size) {
+    OpenFile* file = (OpenFile*)object;
+    long done = read_entry(file->entry, file->position, buffer, size);
+    if (done > 0) file->position += done;
+    return (int32_t)done;
+}
+
+static int32_t tmpfs_write(void* object, const void* buffer, uint32_t size) {
+    OpenFile* file = (OpenFile*)object;
+    long done = write_entry(file->entry, file->position, buffer, size);
+    if (done > 0) file->position += done;
+    return (int32_t)done;
+}
+
+// Copie par partage des pages, dans un même montage; la cible est créée au besoin
+static int tmpfs_reflink(void* mount, const char* source, const char* target) {
+    FileSystem* fs = (FileSystem*)mount;
+    FileEntry* original = find_entry(fs, source);
+    if (!original || original->is_directory) return -1;
+
+    FileEntry* copy = find_entry(fs, target);
+    if (!copy) {
+        const char* name;
+        size_t length;
+        FileEntry* parent = walk_path(fs, target, &name, &length);
+        copy = create_entry(fs, parent, name, length, 0);
+        if (!copy) return -1;
+    }
+    return reflink_entry(original, copy);
+}
+
+static void* tmpfs_opendir(void* mount, const char* path) {
+    FileEntry* dir = find_entry((FileSystem*)mount, path);
+    if (!dir || !dir->is_directory) return NULL;
+
+    DirStream* stream = (DirStream*)kmalloc(sizeof(DirStream));
+    if (!stream) return NULL;
+    stream->dir = dir;
+    stream->next = dir->first_child;
+    stream->position = 0;
+    stream->generation = dir->generation;
+    dir->open_count++;
+    return stream;
+}
+
+static void tmpfs_closedir(void* object) {
+    DirStream* stream = (DirStream*)object;
+    stream->dir->open_count--;
+    kfree(stream);
+}
+
+// Remplir `buffer` d'entrées dirent_t; 0 à la fin du dossier, -1 si l'entrée suivante ne tient pas
+static int32_t tmpfs_readdir(void* object, void* buffer, uint32_t size) {
+    DirStream* stream = (DirStream*)object;
+
+    // Une suppression a pu libérer `next`: repartir du début et sauter `position` entrées
+    if (stream->generation != stream->dir->generation || (!stream->next && stream->position < stream->dir->child_count)) {
+        stream->next = stream->dir->first_child;
+        for (unsigned int i = 0; i < stream->position && stream->next; i++) {
+            stream->next = stream->next->next_sibling;
+        }
+        stream->generation = stream->dir->generation;
+    }
+
+    uint32_t filled = 0;
+    while (stream->next) {
+        FileEntry* entry = stream->next;
+        size_t name_len = strlen(entry->name);
+        uint32_t length = (sizeof(dirent_t) + name_len + 1 + 3) & ~3u;
+        if (filled + length > size) return filled ? (int32_t)filled : -1;
+
+        dirent_t* out = (dirent_t*)((char*)buffer + filled);
+        // Pas de numéros d'inode: l'adresse du noeud en tient lieu
+        out->inode = (uint32_t)(uintptr_t)entry;
+        out->rec_len = length;
+        out->type = entry->is_directory ? DIRENT_TYPE_DIRECTORY : DIRENT_TYPE_FILE;
+        out->name_len = name_len;
+        memcpy(out->name, entry->name, name_len + 1);
+        filled += length;
+
+        stream->next = entry->next_sibling;
+        stream->position++;
+    }
+    return (int32_t)filled;
+}
+
+static uint32_t tmpfs_telldir(void* object) {
+    return ((DirStream*)object)->position;
+}
+
+static void tmpfs_seekdir(void* object, uint32_t position) {
+    DirStream* stream = (DirStream*)object;
+    stream->position = position;
+    stream->next = NULL;
+    // Forcer le parcours depuis le début à la prochaine lecture
+    stream->generation = stream->dir->generation - 1;
+}
+
+static const vfs_super_operations_t tmpfs_super_operations = {
+    .mount = tmpfs_mount,
+    .unmount = tmpfs_unmount,
+};
+
+static const vfs_inode_operations_t tmpfs_inode_operations = {
+    .open = tmpfs_open,
+    .opendir = tmpfs_opendir,
+    .reflink = tmpfs_reflink,
+};
+
+static const vfs_file_operations_t tmpfs_file_operations = {
+    .read = tmpfs_read,
+    .write = tmpfs_write,
+    .release = tmpfs_release,
+    .tell = tmpfs_tell,
+    .seek = tmpfs_seek,
+    .readdir = tmpfs_readdir,
+    .telldir = tmpfs_telldir,
+    .seekdir = tmpfs_seekdir,
+    .closedir = tmpfs_closedir,
+};
+
+void init_tmpfs() {
+    vfs_register_filesystem("tmpfs", &tmpfs_super_operations, &tmpfs_inode_operations, &tmpfs_file_operations);
+}
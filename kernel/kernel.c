@@ -31,13 +31,32 @@ int cursor_y = 0;
 extern void init_core();
 extern void init_memory();
 extern void init_process_manager();
+extern void init_fd_table();
 extern void init_device_manager();
+extern void init_clock();
+extern void init_trace();
+extern void clock_idle();
+extern void init_pci();
+extern void pci_bind_drivers();
+extern void init_virtio_blk();
+extern void init_virtio_net();
+extern void init_framebuffer();
+extern void init_vfs();
 extern void init_filesystem();
+extern void init_file_system();
+extern void init_tmpfs();
+extern void init_xiwafs();
+extern bool vfs_mount(const char* path, const char* type, const char* device);
 extern void init_network_manager();
+extern void init_io_ring();
 extern void init_gui();
 extern void init_audio();
 extern void init_input();
 extern void init_time();
+extern void init_buffer_cache();
+extern void init_dcache();
+extern void init_mmap();
+extern bool mmap_handle_fault(uint32_t address, uint32_t error_code);
 
 // Fonction pour mettre à jour le curseur matériel
 void update_cursor() {
@@ -100,13 +119,33 @@ void kernel_main() {
     init_core();
     init_memory();
     init_process_manager();
+    init_fd_table();
     init_device_manager();
+    init_clock();
+    init_trace();
+    init_time();
+    init_buffer_cache();
+    init_dcache();
+    init_mmap();
+    init_pci();
+    init_virtio_blk();
+    init_virtio_net();
+    init_framebuffer();
+    pci_bind_drivers();
+    init_vfs();
     init_filesystem();
+    init_file_system();
+    init_tmpfs();
+    init_xiwafs();
+    vfs_mount("/", "ext4", "");
+    vfs_mount("/tmp", "tmpfs", "");
+    // Image xiwafs des ressources système, sur le deuxième disque s'il est présent
+    vfs_mount("/system", "xiwafs", "vdb");
     init_network_manager();
+    init_io_ring();
     init_gui();
     init_audio();
     init_input();
-    init_time();
 
     // Boucle principale du kernel
     while (1) {
@@ -119,8 +158,8 @@ void kernel_main() {
         // Gestion des processus
         schedule();
         
-        // Attente d'interruption
-        asm volatile("hlt");
+        // Dormir jusqu'à la prochaine échéance (pas de tick périodique)
+        clock_idle();
     }
 }
 
@@ -189,6 +228,11 @@ void handle_page_fault(uint32_t error_code) {
     uint32_t faulting_address;
     asm volatile("movl %%cr2, %0" : "=r" (faulting_address));
     
+    // Page d'un fichier projeté: remplie depuis le cache de pages, ou copiée à l'écriture
+    if (mmap_handle_fault(faulting_address, error_code)) {
+        return;
+    }
+
     // Vérifie si la faute est due à une page non présente
     if (!(error_code & 1)) {
         // Alloue une nouvelle page
@@ -0,0 +1,546 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+// Cache de blocs partagé par les systèmes de fichiers.
+// Un tampon est identifié par (périphérique, numéro de bloc). Chaque périphérique a une
+// taille de bloc courante: en changer (superbloc lu en 1 Kio puis blocs de 4 Kio au
+// montage) réécrit et oublie d'abord ses tampons, pour qu'un même octet du disque n'ait
+// jamais deux copies en cache. Le changement est refusé tant qu'un tampon est utilisé.
+// Recherche par table de hachage, éviction par l'algorithme de l'horloge (CLOCK),
+// et les tampons modifiés sont réécrits à l'éviction, sur demande ou périodiquement.
+// La lecture anticipée remplit le cache de façon asynchrone quand le pilote le permet.
+// Un tampon épinglé par le journal n'est jamais réécrit en place avant la validation.
+
+#define BCACHE_MAX_BUFFERS 1024
+#define BCACHE_HASH_SIZE 1024
+#define BCACHE_WRITEBACK_INTERVAL 5000000
+#define BCACHE_PREFETCH_MAX 128
+#define BCACHE_MAX_DEVICES 32
+
+#define BLOCK_IOCTL_SUBMIT_READS 0x4204
+#define BLOCK_IOCTL_POLL 0x4205
+
+#define READAHEAD_MIN_BYTES 4096
+#define READAHEAD_MAX_BYTES 131072
+
+typedef struct buffer {
+    uint32_t device;
+    uint32_t block;
+    uint32_t size;
+    uint8_t* data;
+    uint32_t refcount;
+    bool valid;
+    bool dirty;
+    bool referenced;
+    // Lecture anticipée en vol: terminée depuis l'IRQ du périphérique
+    volatile bool loading;
+    bool io_failed;
+    // Rattaché à une transaction du journal pas encore validée
+    uint32_t pinned;
+    struct buffer* hash_next;
+} buffer_t;
+
+typedef struct {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t writebacks;
+    uint64_t prefetches;
+    uint32_t buffers;
+    uint32_t dirty;
+} bcache_stats_t;
+
+typedef struct {
+    uint64_t offset;
+    void* buffer;
+    uint32_t size;
+    void (*complete)(void* context, bool success);
+    void* context;
+} block_request_t;
+
+typedef struct {
+    block_request_t* requests;
+    uint32_t count;
+} block_batch_t;
+
+// État de lecture anticipée d'un fichier ouvert (tout à zéro à l'ouverture)
+typedef struct {
+    uint32_t last_block;
+    uint32_t window;
+    uint32_t next;
+} readahead_t;
+
+// Points de traçage (lib/trace.c)
+typedef enum {
+    TRACE_VFS_OPEN,
+    TRACE_VFS_READ,
+    TRACE_VFS_WRITE,
+    TRACE_VFS_FSYNC,
+    TRACE_FS_PATH_WALK,
+    TRACE_FS_INODE_READ,
+    TRACE_FS_INDIRECT_READ,
+    TRACE_FS_DATA_READ,
+    TRACE_BLOCK_READ,
+    TRACE_BLOCK_WRITE,
+    TRACE_EVENT_COUNT
+} trace_event_t;
+
+// Taille de bloc en cache pour un périphérique
+typedef struct {
+    uint32_t device;
+    uint32_t block_size;
+} bcache_device_t;
+
+typedef struct {
+    buffer_t buffers[BCACHE_MAX_BUFFERS];
+    buffer_t* hash[BCACHE_HASH_SIZE];
+    bcache_device_t devices[BCACHE_MAX_DEVICES];
+    uint32_t device_count;
+    uint32_t buffer_count;
+    uint32_t clock_hand;
+    uint32_t dirty_count;
+    bcache_stats_t stats;
+} buffer_cache_t;
+
+static buffer_cache_t bcache;
+
+// Déclarations externes (lib/device_manager.c, lib/trace.c, lib/div64.c)
+extern void* find_device_by_id(uint32_t device_id);
+extern int ioctl_device(void* device, uint32_t request, void* arg);
+extern uint64_t trace_begin();
+extern void trace_end(trace_event_t event, uint32_t device, uint64_t start, uint32_t arg);
+extern uint64_t div64_u32(uint64_t dividend, uint32_t divisor, uint32_t* remainder);
+
+bool bcache_sync(uint32_t device);
+
+static uint32_t bcache_hash(uint32_t device, uint32_t block) {
+    uint32_t key = block * 0x9E3779B1 ^ device * 0x85EBCA77;
+    return (key ^ (key >> 16)) & (BCACHE_HASH_SIZE - 1);
+}
+
+static void hash_insert(buffer_t* buffer) {
+    uint32_t bucket = bcache_hash(buffer->device, buffer->block);
+    buffer->hash_next = bcache.hash[bucket];
+    bcache.hash[bucket] = buffer;
+}
+
+static void hash_remove(buffer_t* buffer) {
+    buffer_t** link = &bcache.hash[bcache_hash(buffer->device, buffer->block)];
+    while (*link && *link != buffer) {
+        link = &(*link)->hash_next;
+    }
+    if (*link) *link = buffer->hash_next;
+    buffer->hash_next = NULL;
+}
+
+static buffer_t* hash_lookup(uint32_t device, uint32_t block) {
+    buffer_t* buffer = bcache.hash[bcache_hash(device, block)];
+    while (buffer) {
+        if (buffer->device == device && buffer->block == block) {
+            return buffer;
+        }
+        buffer = buffer->hash_next;
+    }
+    return NULL;
+}
+
+static bool buffer_io(buffer_t* buffer, bool write) {
+    void* device = find_device_by_id(buffer->device);
+    if (!device) return false;
+
+    size_t offset = (size_t)buffer->block * buffer->size;
+    uint64_t start = trace_begin();
+    int result = write ? write_device(device, buffer->data, buffer->size, offset)
+                       : read_device(device, buffer->data, buffer->size, offset);
+    trace_end(write ? TRACE_BLOCK_WRITE : TRACE_BLOCK_READ, buffer->device, start, buffer->block);
+    return result == (int)buffer->size;
+}
+
+// Attendre la fin d'une lecture anticipée (l'IRQ peut être masquée: on interroge le pilote)
+static void wait_buffer(buffer_t* buffer) {
+    if (!buffer->loading) return;
+
+    void* device = find_device_by_id(buffer->device);
+    while (buffer->loading) {
+        if (!device || ioctl_device(device, BLOCK_IOCTL_POLL, NULL) < 0) {
+            // Rien ne terminera cette lecture: la refaire de façon synchrone
+            buffer->io_failed = true;
+            buffer->loading = false;
+            break;
+        }
+        asm volatile("pause");
+    }
+}
+
+static bool writeback_buffer(buffer_t* buffer) {
+    if (!buffer->dirty) return true;
+    if (buffer->pinned) return false;
+    if (!buffer_io(buffer, true)) return false;
+
+    buffer->dirty = false;
+    bcache.dirty_count--;
+    bcache.stats.writebacks++;
+    return true;
+}
+
+// Choisir un tampon à recycler: les tampons utilisés récemment ont une seconde chance
+static buffer_t* evict_buffer() {
+    if (bcache.buffer_count < BCACHE_MAX_BUFFERS) {
+        return &bcache.buffers[bcache.buffer_count++];
+    }
+
+    for (uint32_t scanned = 0; scanned < BCACHE_MAX_BUFFERS * 2; scanned++) {
+        buffer_t* buffer = &bcache.buffers[bcache.clock_hand];
+        bcache.clock_hand = (bcache.clock_hand + 1) % BCACHE_MAX_BUFFERS;
+
+        if (buffer->refcount > 0 || buffer->loading) continue;
+        if (buffer->referenced) {
+            buffer->referenced = false;
+            continue;
+        }
+        if (!writeback_buffer(buffer)) continue;
+
+        if (buffer->valid) {
+            hash_remove(buffer);
+            bcache.stats.evictions++;
+        }
+        buffer->valid = false;
+        return buffer;
+    }
+    return NULL;
+}
+
+// Passer `device` à des blocs de `size` octets: ses tampons sont réécrits puis oubliés.
+// Échoue si l'un d'eux est encore référencé, en lecture ou épinglé par le journal.
+static bool set_block_size(uint32_t device, uint32_t size) {
+    bcache_device_t* entry = NULL;
+    for (uint32_t i = 0; i < bcache.device_count; i++) {
+        if (bcache.devices[i].device == device) {
+            entry = &bcache.devices[i];
+            break;
+        }
+    }
+    if (entry && entry->block_size == size) return true;
+    if (!entry) {
+        if (bcache.device_count >= BCACHE_MAX_DEVICES) return false;
+        entry = &bcache.devices[bcache.device_count++];
+        entry->device = device;
+        entry->block_size = size;
+        return true;
+    }
+
+    for (uint32_t i = 0; i < bcache.buffer_count; i++) {
+        buffer_t* buffer = &bcache.buffers[i];
+        if (buffer->valid && buffer->device == device &&
+            (buffer->refcount > 0 || buffer->loading || buffer->pinned)) {
+            return false;
+        }
+    }
+    if (!bcache_sync(device)) return false;
+
+    for (uint32_t i = 0; i < bcache.buffer_count; i++) {
+        buffer_t* buffer = &bcache.buffers[i];
+        if (buffer->valid && buffer->device == device) {
+            hash_remove(buffer);
+            buffer->valid = false;
+        }
+    }
+    entry->block_size = size;
+    return true;
+}
+
+// Obtenir le tampon d'un bloc sans le lire (pour l'écraser entièrement)
+buffer_t* bcache_get(uint32_t device, uint32_t block, uint32_t size) {
+    if (!set_block_size(device, size)) return NULL;
+
+    buffer_t* buffer = hash_lookup(device, block);
+    if (buffer) {
+        buffer->refcount++;
+        buffer->referenced = true;
+        // Le contenu va être écrasé: ne pas laisser une lecture en vol l'écraser à son tour
+        wait_buffer(buffer);
+        buffer->io_failed = false;
+        return buffer;
+    }
+
+    buffer = evict_buffer();
+    if (!buffer) return NULL;
+
+    if (!buffer->data || buffer->size != size) {
+        kfree(buffer->data);
+        buffer->data = (uint8_t*)kmalloc(size);
+        if (!buffer->data) {
+            buffer->size = 0;
+            return NULL;
+        }
+    }
+
+    buffer->device = device;
+    buffer->block = block;
+    buffer->size = size;
+    buffer->refcount = 1;
+    buffer->referenced = true;
+    buffer->dirty = false;
+    buffer->valid = true;
+    buffer->loading = false;
+    buffer->io_failed = false;
+    buffer->pinned = 0;
+    hash_insert(buffer);
+    return buffer;
+}
+
+// Lire un bloc à travers le cache; le tampon renvoyé doit être rendu par bcache_release
+buffer_t* bcache_read(uint32_t device, uint32_t block, uint32_t size) {
+    if (!set_block_size(device, size)) return NULL;
+
+    buffer_t* buffer = hash_lookup(device, block);
+    if (buffer) {
+        bcache.stats.hits++;
+        buffer->refcount++;
+        buffer->referenced = true;
+        wait_buffer(buffer);
+        if (buffer->io_failed) {
+            if (!buffer_io(buffer, false)) {
+                buffer->refcount--;
+                return NULL;
+            }
+            buffer->io_failed = false;
+        }
+        return buffer;
+    }
+
+    bcache.stats.misses++;
+    buffer = bcache_get(device, block, size);
+    if (!buffer) return NULL;
+
+    if (!buffer_io(buffer, false)) {
+        hash_remove(buffer);
+        buffer->valid = false;
+        buffer->refcount = 0;
+        return NULL;
+    }
+    return buffer;
+}
+
+void bcache_release(buffer_t* buffer) {
+    if (buffer && buffer->refcount > 0) {
+        buffer->refcount--;
+    }
+}
+
+void bcache_mark_dirty(buffer_t* buffer) {
+    if (buffer && !buffer->dirty) {
+        buffer->dirty = true;
+        bcache.dirty_count++;
+    }
+}
+
+// Journal: garder le tampon en mémoire et hors de la réécriture jusqu'à bcache_unpin().
+// Un contenu encore sale (validé par une transaction précédente) est d'abord écrit en place.
+bool bcache_pin(buffer_t* buffer) {
+    if (!buffer->pinned && !writeback_buffer(buffer)) return false;
+    buffer->refcount++;
+    buffer->pinned++;
+    return true;
+}
+
+// Transaction validée: le tampon peut rejoindre sa place sur le disque
+void bcache_unpin(buffer_t* buffer) {
+    if (buffer->pinned == 0) return;
+    buffer->pinned--;
+    bcache_mark_dirty(buffer);
+    bcache_release(buffer);
+}
+
+// Écriture immédiate (métadonnées critiques)
+bool bcache_write(buffer_t* buffer) {
+    bcache_mark_dirty(buffer);
+    return writeback_buffer(buffer);
+}
+
+// Copier une plage d'octets quelconque à travers le cache (superblocs, tables)
+bool bcache_read_bytes(uint32_t device, uint32_t block_size, uint64_t offset, void* out, uint32_t size) {
+    uint8_t* dest = (uint8_t*)out;
+    while (size > 0) {
+        uint32_t within;
+        uint32_t block = (uint32_t)div64_u32(offset, block_size, &within);
+        uint32_t chunk = block_size - within;
+        if (chunk > size) chunk = size;
+
+        buffer_t* buffer = bcache_read(device, block, block_size);
+        if (!buffer) return false;
+        memcpy(dest, buffer->data + within, chunk);
+        bcache_release(buffer);
+
+        dest += chunk;
+        offset += chunk;
+        size -= chunk;
+    }
+    return true;
+}
+
+static void prefetch_complete(void* context, bool success) {
+    buffer_t* buffer = (buffer_t*)context;
+    buffer->io_failed = !success;
+    buffer->loading = false;
+}
+
+// Repli synchrone: une seule lecture pour toute la série de blocs absents du cache
+static uint32_t prefetch_sync(void* dev, uint32_t device, uint32_t block, uint32_t count, uint32_t size) {
+    uint32_t run = 0;
+    while (run < count && !hash_lookup(device, block + run)) {
+        run++;
+    }
+    if (run == 0) return 0;
+
+    uint8_t* bounce = (uint8_t*)kmalloc(run * size);
+    if (!bounce) return 0;
+
+    uint32_t filled = 0;
+    if (read_device(dev, bounce, run * size, (size_t)block * size) == (int)(run * size)) {
+        for (; filled < run; filled++) {
+            buffer_t* buffer = bcache_get(device, block + filled, size);
+            if (!buffer) break;
+            memcpy(buffer->data, bounce + filled * size, size);
+            bcache_release(buffer);
+        }
+    }
+
+    kfree(bounce);
+    return filled;
+}
+
+// Précharger `count` blocs à partir de `block` sans attendre la fin des lectures.
+// Les blocs déjà en cache sont sautés; renvoie le nombre de lectures lancées.
+uint32_t bcache_prefetch(uint32_t device, uint32_t block, uint32_t count, uint32_t size) {
+    void* dev = find_device_by_id(device);
+    if (!dev || !set_block_size(device, size)) return 0;
+    if (count > BCACHE_PREFETCH_MAX) count = BCACHE_PREFETCH_MAX;
+
+    block_request_t requests[BCACHE_PREFETCH_MAX];
+    buffer_t* buffers[BCACHE_PREFETCH_MAX];
+    uint32_t pending = 0;
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (hash_lookup(device, block + i)) continue;
+
+        buffer_t* buffer = bcache_get(device, block + i, size);
+        if (!buffer) break;
+
+        buffer->loading = true;
+        buffers[pending] = buffer;
+        requests[pending].offset = (uint64_t)(block + i) * size;
+        requests[pending].buffer = buffer->data;
+        requests[pending].size = size;
+        requests[pending].complete = prefetch_complete;
+        requests[pending].context = buffer;
+        pending++;
+    }
+    if (pending == 0) return 0;
+
+    block_batch_t batch = { requests, pending };
+    int queued = ioctl_device(dev, BLOCK_IOCTL_SUBMIT_READS, &batch);
+    if (queued < 0) queued = 0;
+
+    // Les requêtes refusées repassent par le repli synchrone
+    uint32_t first_refused = pending;
+    for (uint32_t i = 0; i < pending; i++) {
+        if (i >= (uint32_t)queued) {
+            buffers[i]->loading = false;
+            hash_remove(buffers[i]);
+            buffers[i]->valid = false;
+            if (first_refused == pending) first_refused = i;
+        }
+        bcache_release(buffers[i]);
+    }
+
+    uint32_t issued = queued;
+    if (first_refused < pending) {
+        uint32_t start = (uint32_t)div64_u32(requests[first_refused].offset, size, NULL);
+        issued += prefetch_sync(dev, device, start, block + count - start, size);
+    }
+
+    bcache.stats.prefetches += issued;
+    return issued;
+}
+
+// Détection de l'accès séquentiel et taille de la fenêtre (doublée à chaque lot, de 4 à 128 Kio).
+// Le lot suivant part dès que la moitié du précédent est consommée, pour garder le disque occupé.
+// Renvoie le nombre de blocs à précharger à partir de *start (0 = aucun).
+uint32_t readahead_update(readahead_t* ra, uint32_t block, uint32_t block_size, uint32_t block_count, uint32_t* start) {
+    uint32_t min_window = READAHEAD_MIN_BYTES / block_size;
+    uint32_t max_window = READAHEAD_MAX_BYTES / block_size;
+    if (min_window == 0) min_window = 1;
+    if (max_window < min_window) max_window = min_window;
+
+    bool sequential = block == ra->last_block || block == ra->last_block + 1;
+    ra->last_block = block;
+    if (!sequential) {
+        // Accès aléatoire: pas de préchargement, la fenêtre repartira du minimum
+        ra->window = 0;
+        ra->next = block + 1;
+        return 0;
+    }
+
+    if (ra->next < block + 1) ra->next = block + 1;
+    if (ra->window == 0) {
+        ra->window = min_window;
+    } else {
+        if (ra->next - block - 1 > ra->window / 2) return 0;
+        ra->window *= 2;
+        if (ra->window > max_window) ra->window = max_window;
+    }
+
+    if (ra->next >= block_count) return 0;
+    uint32_t count = ra->window;
+    if (count > block_count - ra->next) count = block_count - ra->next;
+
+    *start = ra->next;
+    ra->next += count;
+    return count;
+}
+
+// Réécrire les tampons modifiés d'un périphérique (0 = tous)
+bool bcache_sync(uint32_t device) {
+    bool success = true;
+    for (uint32_t i = 0; i < bcache.buffer_count && bcache.dirty_count > 0; i++) {
+        buffer_t* buffer = &bcache.buffers[i];
+        if (buffer->valid && buffer->dirty && !buffer->pinned && (device == 0 || buffer->device == device)) {
+            success &= writeback_buffer(buffer);
+        }
+    }
+    return success;
+}
+
+// Oublier les blocs d'un périphérique (démontage, changement de média)
+void bcache_invalidate(uint32_t device) {
+    bcache_sync(device);
+    for (uint32_t i = 0; i < bcache.buffer_count; i++) {
+        buffer_t* buffer = &bcache.buffers[i];
+        if (buffer->device == device) wait_buffer(buffer);
+        if (buffer->valid && buffer->device == device && buffer->refcount == 0) {
+            hash_remove(buffer);
+            buffer->valid = false;
+        }
+    }
+}
+
+void bcache_get_stats(bcache_stats_t* stats) {
+    if (!stats) return;
+    memcpy(stats, &bcache.stats, sizeof(bcache_stats_t));
+    stats->buffers = bcache.buffer_count;
+    stats->dirty = bcache.dirty_count;
+}
+
+static void bcache_writeback(void* data) {
+    (void)data;
+    if (bcache.dirty_count > 0) {
+        bcache_sync(0);
+    }
+}
+
+void init_buffer_cache() {
+    memset(&bcache, 0, sizeof(buffer_cache_t));
+    create_callback("bcache-writeback", BCACHE_WRITEBACK_INTERVAL, bcache_writeback, NULL);
+}
\ No newline at end of file
@@ -0,0 +1,154 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+// Somme de contrôle Internet (RFC 1071): somme en complément à 1 des mots de 16 bits.
+// Les sommes partielles sont en ordre mémoire natif, sur 32 bits: elles se calculent
+// morceau par morceau, se combinent (checksum_block_add), puis checksum_fold() donne
+// la valeur à ranger telle quelle dans l'en-tête. Comme 2^16 vaut 1 en complément à 1,
+// les données sont lues par mots de 32 bits accumulés sur 64 bits: les retenues sont
+// rattrapées une seule fois à la fin, au lieu d'une addition par mot de 16 bits.
+
+static inline uint32_t read32(const uint8_t* p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline uint16_t read16(const uint8_t* p) {
+    uint16_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline uint32_t fold64(uint64_t sum) {
+    sum = (sum & 0xFFFFFFFF) + (sum >> 32);
+    sum = (sum & 0xFFFFFFFF) + (sum >> 32);
+    return (uint32_t)sum;
+}
+
+static inline uint16_t swap16(uint16_t value) {
+    return (uint16_t)((value << 8) | (value >> 8));
+}
+
+// Ajouter `length` octets à la somme partielle `sum`, comptés depuis une position paire
+// (un morceau à position impaire passe par checksum_block_add)
+uint32_t checksum_partial(const void* data, uint32_t length, uint32_t sum) {
+    const uint8_t* p = (const uint8_t*)data;
+    uint64_t acc = sum;
+
+    while (length >= 16) {
+        acc += read32(p);
+        acc += read32(p + 4);
+        acc += read32(p + 8);
+        acc += read32(p + 12);
+        p += 16;
+        length -= 16;
+    }
+    while (length >= 4) {
+        acc += read32(p);
+        p += 4;
+        length -= 4;
+    }
+    if (length >= 2) {
+        acc += read16(p);
+        p += 2;
+        length -= 2;
+    }
+    // Octet final: poids faible d'un mot complété par un zéro
+    if (length) {
+        acc += *p;
+    }
+    return fold64(acc);
+}
+
+// Copier `length` octets en calculant leur somme au passage: les données ne sont lues qu'une fois
+uint32_t checksum_copy(void* dest, const void* source, uint32_t length, uint32_t sum) {
+    const uint8_t* src = (const uint8_t*)source;
+    uint8_t* dst = (uint8_t*)dest;
+    uint64_t acc = sum;
+
+    while (length >= 16) {
+        uint32_t a = read32(src);
+        uint32_t b = read32(src + 4);
+        uint32_t c = read32(src + 8);
+        uint32_t d = read32(src + 12);
+        memcpy(dst, &a, 4);
+        memcpy(dst + 4, &b, 4);
+        memcpy(dst + 8, &c, 4);
+        memcpy(dst + 12, &d, 4);
+        acc += a;
+        acc += b;
+        acc += c;
+        acc += d;
+        src += 16;
+        dst += 16;
+        length -= 16;
+    }
+    while (length >= 4) {
+        uint32_t a = read32(src);
+        memcpy(dst, &a, 4);
+        acc += a;
+        src += 4;
+        dst += 4;
+        length -= 4;
+    }
+    if (length >= 2) {
+        uint16_t a = read16(src);
+        memcpy(dst, &a, 2);
+        acc += a;
+        src += 2;
+        dst += 2;
+        length -= 2;
+    }
+    if (length) {
+        *dst = *src;
+        acc += *src;
+    }
+    return fold64(acc);
+}
+
+// Ajouter la somme d'un morceau placé à `offset` octets du début: à une position impaire
+// ses octets occupent l'autre moitié des mots de 16 bits
+uint32_t checksum_block_add(uint32_t sum, uint32_t block_sum, uint32_t offset) {
+    if (offset & 1) {
+        block_sum = (block_sum >> 8) | (block_sum << 24);
+    }
+    sum += block_sum;
+    return sum + (sum < block_sum);
+}
+
+// Pseudo-en-tête TCP/UDP: adresses telles qu'elles sont rangées dans l'en-tête IP,
+// protocole et longueur comptés en ordre réseau
+uint32_t checksum_pseudo_header(uint32_t source_ip, uint32_t dest_ip, uint8_t protocol, uint16_t length, uint32_t sum) {
+    uint64_t acc = sum;
+    acc += source_ip;
+    acc += dest_ip;
+    acc += swap16(protocol);
+    acc += swap16(length);
+    return fold64(acc);
+}
+
+// Replier une somme partielle sur 16 bits et la complémenter
+uint16_t checksum_fold(uint32_t sum) {
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    return (uint16_t)~sum;
+}
+
+// Mise à jour incrémentale (RFC 1624, équation 3) quand un champ de 16 bits passe de
+// `old_value` à `new_value`: HC' = ~(~HC + ~m + m'), sans relire le reste de l'en-tête
+uint16_t checksum_update16(uint16_t check, uint16_t old_value, uint16_t new_value) {
+    uint32_t sum = (uint16_t)~check;
+    sum += (uint16_t)~old_value;
+    sum += new_value;
+    return checksum_fold(sum);
+}
+
+// Même mise à jour pour un champ de 32 bits (adresse IP, numéro de séquence)
+uint16_t checksum_update32(uint16_t check, uint32_t old_value, uint32_t new_value) {
+    uint64_t sum = (uint16_t)~check;
+    sum += ~old_value;
+    sum += new_value;
+    return checksum_fold(fold64(sum));
+}
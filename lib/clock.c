@@ -0,0 +1,152 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+// Source de temps (TSC) et événement d'horloge one-shot (PIT canal 0).
+// La conversion cycles -> µs se fait par multiplication et décalage précalculés:
+//   us = base_us + ((cycles - base_cycles) * mult) >> shift
+// La base est réajustée avant que le produit ne déborde 64 bits.
+
+#define PIT_FREQUENCY 1193182
+#define PIT_CHANNEL0 0x40
+#define PIT_CHANNEL2 0x42
+#define PIT_COMMAND 0x43
+#define PIT_GATE 0x61
+#define PIT_MAX_COUNT 0xFFFF
+#define PIT_MODE_ONESHOT 0x30
+#define PIT_MODE_ONESHOT_CH2 0xB0
+
+#define CLOCK_SHIFT 32
+#define CLOCK_CALIBRATION_MS 10
+#define CLOCK_IRQ 0
+#define CLOCK_MIN_DELTA_US 20
+
+typedef struct {
+    uint64_t frequency;
+    uint32_t mult;
+    uint32_t shift;
+    uint64_t base_cycles;
+    uint64_t base_us;
+    uint64_t max_delta;
+    uint64_t max_delta_us;
+    // Conversion µs -> comptes PIT, même principe
+    uint32_t pit_mult;
+    uint32_t pit_max_us;
+    bool oneshot_armed;
+    uint32_t wakeups;
+} clock_t;
+
+static clock_t clock;
+
+// Déclarations externes (lib/time.c, lib/div64.c)
+extern uint64_t time_next_deadline();
+extern uint64_t div64_u32(uint64_t dividend, uint32_t divisor, uint32_t* remainder);
+extern uint64_t div64_u64(uint64_t dividend, uint64_t divisor);
+
+static inline uint64_t rdtsc() {
+    uint32_t low, high;
+    asm volatile("rdtsc" : "=a"(low), "=d"(high));
+    return ((uint64_t)high << 32) | low;
+}
+
+// Mesurer la fréquence du TSC contre le canal 2 du PIT (indépendant des IRQ)
+static uint64_t calibrate_tsc() {
+    uint32_t count = PIT_FREQUENCY * CLOCK_CALIBRATION_MS / 1000;
+
+    // Porte du canal 2 active, haut-parleur coupé
+    outb(PIT_GATE, (inb(PIT_GATE) & ~0x02) | 0x01);
+    outb(PIT_COMMAND, PIT_MODE_ONESHOT_CH2);
+    outb(PIT_CHANNEL2, count & 0xFF);
+    outb(PIT_CHANNEL2, count >> 8);
+
+    uint64_t start = rdtsc();
+    // Le bit 5 passe à 1 quand le compteur atteint zéro
+    while (!(inb(PIT_GATE) & 0x20)) {
+        asm volatile("pause");
+    }
+    uint64_t end = rdtsc();
+
+    return div64_u32((end - start) * PIT_FREQUENCY, count, NULL);
+}
+
+uint64_t get_ticks() {
+    return rdtsc();
+}
+
+uint64_t get_frequency() {
+    return clock.frequency;
+}
+
+// Temps écoulé depuis init_clock(), en µs, sans division
+uint64_t clock_read_us() {
+    uint64_t delta = rdtsc() - clock.base_cycles;
+
+    while (delta > clock.max_delta) {
+        clock.base_cycles += clock.max_delta;
+        clock.base_us += clock.max_delta_us;
+        delta -= clock.max_delta;
+    }
+
+    return clock.base_us + ((delta * clock.mult) >> clock.shift);
+}
+
+static void clock_event_handler(void* data) {
+    (void)data;
+    clock.oneshot_armed = false;
+    clock.wakeups++;
+}
+
+// Armer le canal 0 en mode 0: une seule interruption au bout de `delta_us`.
+// Au-delà de ~55 ms on programme le maximum et on recalcule au réveil.
+void clock_program_oneshot(uint64_t delta_us) {
+    if (delta_us < CLOCK_MIN_DELTA_US) delta_us = CLOCK_MIN_DELTA_US;
+    if (delta_us > clock.pit_max_us) delta_us = clock.pit_max_us;
+
+    uint32_t count = (uint32_t)((delta_us * clock.pit_mult) >> CLOCK_SHIFT);
+    if (count == 0) count = 1;
+    if (count > PIT_MAX_COUNT) count = PIT_MAX_COUNT;
+
+    outb(PIT_COMMAND, PIT_MODE_ONESHOT);
+    outb(PIT_CHANNEL0, count & 0xFF);
+    outb(PIT_CHANNEL0, count >> 8);
+    clock.oneshot_armed = true;
+}
+
+// Dormir jusqu'à la prochaine échéance de la roue ou la prochaine IRQ
+void clock_idle() {
+    uint32_t flags = irq_save();
+
+    uint64_t now = clock_read_us();
+    uint64_t deadline = time_next_deadline();
+    if (deadline <= now) {
+        irq_restore(flags);
+        return;
+    }
+
+    clock_program_oneshot(deadline - now);
+
+    // sti ne prend effet qu'après l'instruction suivante: pas de réveil perdu
+    asm volatile("sti; hlt");
+    irq_restore(flags);
+}
+
+uint32_t clock_wakeups() {
+    return clock.wakeups;
+}
+
+void init_clock() {
+    memset(&clock, 0, sizeof(clock_t));
+
+    clock.frequency = calibrate_tsc();
+    clock.shift = CLOCK_SHIFT;
+    clock.mult = (uint32_t)div64_u64(1000000ull << CLOCK_SHIFT, clock.frequency ? clock.frequency : 1);
+    clock.max_delta = div64_u32(0xFFFFFFFFFFFFFFFFull, clock.mult ? clock.mult : 1, NULL);
+    clock.max_delta_us = (clock.max_delta * clock.mult) >> clock.shift;
+    clock.base_cycles = rdtsc();
+    clock.base_us = 0;
+
+    clock.pit_mult = (uint32_t)(((uint64_t)PIT_FREQUENCY << CLOCK_SHIFT) / 1000000);
+    clock.pit_max_us = (uint32_t)((uint64_t)PIT_MAX_COUNT * 1000000 / PIT_FREQUENCY);
+
+    register_irq_handler(CLOCK_IRQ, clock_event_handler, NULL);
+}
\ No newline at end of file
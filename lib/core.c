@@ -93,4 +93,15 @@ void reboot() {
 void panic(const char* msg) {
     disable_interrupts();
     while (1) halt();
-} 
\ No newline at end of file
+} 
+
+// Sauvegarder EFLAGS et masquer les interruptions (sections critiques courtes)
+uint32_t irq_save() {
+    uint32_t flags;
+    asm volatile("pushfl; popl %0; cli" : "=r"(flags) : : "memory");
+    return flags;
+}
+
+void irq_restore(uint32_t flags) {
+    asm volatile("pushl %0; popfl" : : "r"(flags) : "memory", "cc");
+}
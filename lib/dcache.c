@@ -0,0 +1,212 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+// Cache des entrées de répertoire: (périphérique, inode parent, nom) -> inode.
+// Une entrée d'inode 0 est négative: le nom est connu pour ne pas exister.
+// Les entrées sont recyclées dans l'ordre LRU; les noms trop longs ne sont pas mis en cache.
+
+#define DCACHE_MAX_ENTRIES 1024
+#define DCACHE_HASH_SIZE 512
+#define DCACHE_NAME_LENGTH 48
+#define DCACHE_NONE 0xFFFF
+
+typedef struct {
+    uint32_t device;
+    uint32_t parent;
+    uint32_t inode;
+    uint32_t hash;
+    uint8_t name_len;
+    char name[DCACHE_NAME_LENGTH];
+    uint16_t hash_next;
+    uint16_t lru_prev;
+    uint16_t lru_next;
+    bool used;
+} dentry_t;
+
+typedef struct {
+    uint64_t hits;
+    uint64_t negative_hits;
+    uint64_t misses;
+    uint32_t entries;
+} dcache_stats_t;
+
+typedef struct {
+    dentry_t entries[DCACHE_MAX_ENTRIES];
+    uint16_t hash[DCACHE_HASH_SIZE];
+    // Tête = plus récemment utilisée, queue = prochaine victime
+    uint16_t lru_head;
+    uint16_t lru_tail;
+    uint16_t free_head;
+    dcache_stats_t stats;
+} dcache_t;
+
+static dcache_t dcache;
+
+// FNV-1a sur le nom, mélangé avec le parent et le périphérique
+static uint32_t dcache_hash(uint32_t device, uint32_t parent, const char* name, uint32_t name_len) {
+    uint32_t hash = 2166136261u ^ parent ^ (device << 24);
+    for (uint32_t i = 0; i < name_len; i++) {
+        hash ^= (uint8_t)name[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static void lru_unlink(uint16_t index) {
+    dentry_t* entry = &dcache.entries[index];
+    if (entry->lru_prev != DCACHE_NONE) dcache.entries[entry->lru_prev].lru_next = entry->lru_next;
+    else dcache.lru_head = entry->lru_next;
+    if (entry->lru_next != DCACHE_NONE) dcache.entries[entry->lru_next].lru_prev = entry->lru_prev;
+    else dcache.lru_tail = entry->lru_prev;
+}
+
+static void lru_push_front(uint16_t index) {
+    dentry_t* entry = &dcache.entries[index];
+    entry->lru_prev = DCACHE_NONE;
+    entry->lru_next = dcache.lru_head;
+    if (dcache.lru_head != DCACHE_NONE) dcache.entries[dcache.lru_head].lru_prev = index;
+    else dcache.lru_tail = index;
+    dcache.lru_head = index;
+}
+
+static uint16_t* hash_link(uint16_t index) {
+    dentry_t* entry = &dcache.entries[index];
+    uint16_t* link = &dcache.hash[entry->hash & (DCACHE_HASH_SIZE - 1)];
+    while (*link != DCACHE_NONE && *link != index) {
+        link = &dcache.entries[*link].hash_next;
+    }
+    return link;
+}
+
+static void release_entry(uint16_t index) {
+    dentry_t* entry = &dcache.entries[index];
+    uint16_t* link = hash_link(index);
+    if (*link == index) *link = entry->hash_next;
+    lru_unlink(index);
+
+    entry->used = false;
+    entry->hash_next = dcache.free_head;
+    dcache.free_head = index;
+    dcache.stats.entries--;
+}
+
+static uint16_t find_entry(uint32_t device, uint32_t parent, const char* name, uint32_t name_len) {
+    uint32_t hash = dcache_hash(device, parent, name, name_len);
+    uint16_t index = dcache.hash[hash & (DCACHE_HASH_SIZE - 1)];
+    while (index != DCACHE_NONE) {
+        dentry_t* entry = &dcache.entries[index];
+        if (entry->hash == hash && entry->device == device && entry->parent == parent &&
+            entry->name_len == name_len && memcmp(entry->name, name, name_len) == 0) {
+            return index;
+        }
+        index = entry->hash_next;
+    }
+    return DCACHE_NONE;
+}
+
+// Renvoie true si le nom est en cache; *inode vaut alors 0 pour une entrée négative
+bool dcache_lookup(uint32_t device, uint32_t parent, const char* name, uint32_t* inode) {
+    uint32_t name_len = strlen(name);
+    if (name_len >= DCACHE_NAME_LENGTH) return false;
+
+    uint16_t index = find_entry(device, parent, name, name_len);
+    if (index == DCACHE_NONE) {
+        dcache.stats.misses++;
+        return false;
+    }
+
+    lru_unlink(index);
+    lru_push_front(index);
+
+    *inode = dcache.entries[index].inode;
+    if (*inode) dcache.stats.hits++;
+    else dcache.stats.negative_hits++;
+    return true;
+}
+
+// Ajouter ou remplacer une entrée (inode 0 = entrée négative)
+void dcache_add(uint32_t device, uint32_t parent, const char* name, uint32_t inode) {
+    uint32_t name_len = strlen(name);
+    if (name_len >= DCACHE_NAME_LENGTH) return;
+
+    uint16_t index = find_entry(device, parent, name, name_len);
+    if (index != DCACHE_NONE) {
+        dcache.entries[index].inode = inode;
+        lru_unlink(index);
+        lru_push_front(index);
+        return;
+    }
+
+    if (dcache.free_head == DCACHE_NONE) {
+        release_entry(dcache.lru_tail);
+    }
+    index = dcache.free_head;
+    dentry_t* entry = &dcache.entries[index];
+    dcache.free_head = entry->hash_next;
+
+    entry->device = device;
+    entry->parent = parent;
+    entry->inode = inode;
+    entry->hash = dcache_hash(device, parent, name, name_len);
+    entry->name_len = name_len;
+    memcpy(entry->name, name, name_len);
+    entry->name[name_len] = '\0';
+    entry->used = true;
+
+    uint16_t* bucket = &dcache.hash[entry->hash & (DCACHE_HASH_SIZE - 1)];
+    entry->hash_next = *bucket;
+    *bucket = index;
+    lru_push_front(index);
+    dcache.stats.entries++;
+}
+
+// Oublier un nom (suppression, renommage: ancien et nouveau nom)
+void dcache_remove(uint32_t device, uint32_t parent, const char* name) {
+    uint32_t name_len = strlen(name);
+    if (name_len >= DCACHE_NAME_LENGTH) return;
+
+    uint16_t index = find_entry(device, parent, name, name_len);
+    if (index != DCACHE_NONE) {
+        release_entry(index);
+    }
+}
+
+// Oublier tout le contenu d'un répertoire (répertoire supprimé ou réécrit)
+void dcache_invalidate_directory(uint32_t device, uint32_t parent) {
+    for (uint16_t i = 0; i < DCACHE_MAX_ENTRIES; i++) {
+        dentry_t* entry = &dcache.entries[i];
+        if (entry->used && entry->device == device && entry->parent == parent) {
+            release_entry(i);
+        }
+    }
+}
+
+// Oublier toutes les entrées d'un périphérique (démontage)
+void dcache_invalidate(uint32_t device) {
+    for (uint16_t i = 0; i < DCACHE_MAX_ENTRIES; i++) {
+        dentry_t* entry = &dcache.entries[i];
+        if (entry->used && entry->device == device) {
+            release_entry(i);
+        }
+    }
+}
+
+void dcache_get_stats(dcache_stats_t* stats) {
+    if (stats) {
+        memcpy(stats, &dcache.stats, sizeof(dcache_stats_t));
+    }
+}
+
+void init_dcache() {
+    memset(&dcache, 0, sizeof(dcache_t));
+    memset(dcache.hash, 0xFF, sizeof(dcache.hash));
+    dcache.lru_head = DCACHE_NONE;
+    dcache.lru_tail = DCACHE_NONE;
+
+    // Toutes les entrées dans la liste libre, chaînées par hash_next
+    for (uint16_t i = 0; i < DCACHE_MAX_ENTRIES; i++) {
+        dcache.entries[i].hash_next = i + 1 < DCACHE_MAX_ENTRIES ? i + 1 : DCACHE_NONE;
+    }
+    dcache.free_head = 0;
+}
\ No newline at end of file
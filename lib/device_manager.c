@@ -6,6 +6,9 @@
 #define MAX_DRIVERS 32
 #define MAX_IRQ_HANDLERS 16
 #define MAX_DMA_CHANNELS 8
+#define DEVICE_TYPE_COUNT 6
+#define DEVICE_HASH_SIZE 64
+#define DEVICE_SLOT_NONE 0xFFFF
 
 typedef enum {
     DEVICE_TYPE_CHAR,
@@ -50,20 +53,103 @@ typedef struct {
     void* data;
 } irq_handler_t;
 
+// Les emplacements de devices[] sont stables: un device_t* reste valide jusqu'à
+// unregister_device. Les index sont chaînés par identifiant (hachage) et par type.
 typedef struct {
     device_t devices[MAX_DEVICES];
+    bool device_used[MAX_DEVICES];
     uint32_t device_count;
+    uint16_t id_buckets[DEVICE_HASH_SIZE];
+    uint16_t id_next[MAX_DEVICES];
+    uint16_t type_head[DEVICE_TYPE_COUNT];
+    uint16_t type_prev[MAX_DEVICES];
+    uint16_t type_next[MAX_DEVICES];
     driver_t drivers[MAX_DRIVERS];
     uint32_t driver_count;
     irq_handler_t irq_handlers[MAX_IRQ_HANDLERS];
     uint32_t irq_handler_count;
     bool dma_channels[MAX_DMA_CHANNELS];
+    uint32_t next_device_id;
 } device_manager_t;
 
 device_manager_t device_manager;
 
 void init_device_manager() {
     memset(&device_manager, 0, sizeof(device_manager_t));
+    device_manager.next_device_id = 1;
+
+    for (uint32_t i = 0; i < DEVICE_HASH_SIZE; i++) {
+        device_manager.id_buckets[i] = DEVICE_SLOT_NONE;
+    }
+    for (uint32_t i = 0; i < DEVICE_TYPE_COUNT; i++) {
+        device_manager.type_head[i] = DEVICE_SLOT_NONE;
+    }
+}
+
+static uint32_t device_hash(uint32_t device_id) {
+    return device_id & (DEVICE_HASH_SIZE - 1);
+}
+
+static uint16_t find_device_slot(uint32_t device_id) {
+    uint16_t slot = device_manager.id_buckets[device_hash(device_id)];
+    while (slot != DEVICE_SLOT_NONE && device_manager.devices[slot].id != device_id) {
+        slot = device_manager.id_next[slot];
+    }
+    return slot;
+}
+
+static void link_device(uint16_t slot) {
+    device_t* device = &device_manager.devices[slot];
+    uint32_t bucket = device_hash(device->id);
+    device_manager.id_next[slot] = device_manager.id_buckets[bucket];
+    device_manager.id_buckets[bucket] = slot;
+
+    // Ajout en queue pour que find_device_by_type renvoie le premier enregistré
+    device_manager.type_next[slot] = DEVICE_SLOT_NONE;
+    device_manager.type_prev[slot] = DEVICE_SLOT_NONE;
+    if (device->type >= DEVICE_TYPE_COUNT) return;
+
+    uint16_t head = device_manager.type_head[device->type];
+    if (head == DEVICE_SLOT_NONE) {
+        device_manager.type_head[device->type] = slot;
+        device_manager.type_prev[slot] = slot;
+        return;
+    }
+    // type_prev de la tête pointe sur la queue de la liste
+    uint16_t tail = device_manager.type_prev[head];
+    device_manager.type_next[tail] = slot;
+    device_manager.type_prev[slot] = tail;
+    device_manager.type_prev[head] = slot;
+}
+
+static void unlink_device(uint16_t slot) {
+    device_t* device = &device_manager.devices[slot];
+    uint16_t* link = &device_manager.id_buckets[device_hash(device->id)];
+    while (*link != slot) {
+        link = &device_manager.id_next[*link];
+    }
+    *link = device_manager.id_next[slot];
+
+    if (device->type >= DEVICE_TYPE_COUNT) return;
+
+    uint16_t head = device_manager.type_head[device->type];
+    uint16_t next = device_manager.type_next[slot];
+    uint16_t prev = device_manager.type_prev[slot];
+    if (slot == head) {
+        device_manager.type_head[device->type] = next;
+        if (next != DEVICE_SLOT_NONE) device_manager.type_prev[next] = prev;
+    } else {
+        device_manager.type_next[prev] = next;
+        if (next != DEVICE_SLOT_NONE) {
+            device_manager.type_prev[next] = prev;
+        } else {
+            device_manager.type_prev[head] = prev;
+        }
+    }
+}
+
+uint32_t allocate_device_id() {
+    return device_manager.next_device_id++;
 }
 
 bool register_driver(const driver_t* driver) {
@@ -93,9 +179,9 @@ bool register_device(device_t* device) {
         return false;
     }
 
-    // Trouver le pilote correspondant
-    driver_t* driver = NULL;
-    for (uint32_t i = 0; i < device_manager.driver_count; i++) {
+    // Trouver le pilote correspondant, sauf si l'appelant l'a déjà choisi
+    driver_t* driver = (driver_t*)device->driver;
+    for (uint32_t i = 0; !driver && i < device_manager.driver_count; i++) {
         if (device_manager.drivers[i].type == device->type) {
             driver = &device_manager.drivers[i];
             break;
@@ -114,54 +200,75 @@ bool register_device(device_t* device) {
         return false;
     }
 
-    memcpy(&device_manager.devices[device_manager.device_count++], device, sizeof(device_t));
+    uint16_t slot = 0;
+    while (device_manager.device_used[slot]) {
+        slot++;
+    }
+
+    if (device->id == 0) {
+        device->id = allocate_device_id();
+    }
+
+    memcpy(&device_manager.devices[slot], device, sizeof(device_t));
+    device_manager.device_used[slot] = true;
+    device_manager.device_count++;
+    link_device(slot);
     return true;
 }
 
 bool unregister_device(uint32_t device_id) {
-    for (uint32_t i = 0; i < device_manager.device_count; i++) {
-        if (device_manager.devices[i].id == device_id) {
-            device_t* device = &device_manager.devices[i];
-            driver_t* driver = (driver_t*)device->driver;
-
-            // Désinitialiser le périphérique
-            if (driver && driver->deinit) {
-                driver->deinit(device);
-            }
-
-            // Libérer le canal DMA
-            if (device->dma_channel < MAX_DMA_CHANNELS) {
-                device_manager.dma_channels[device->dma_channel] = false;
-            }
-
-            memmove(&device_manager.devices[i],
-                    &device_manager.devices[i + 1],
-                    (device_manager.device_count - i - 1) * sizeof(device_t));
-            device_manager.device_count--;
-            return true;
-        }
+    uint16_t slot = find_device_slot(device_id);
+    if (slot == DEVICE_SLOT_NONE) {
+        return false;
     }
-    return false;
+
+    device_t* device = &device_manager.devices[slot];
+    driver_t* driver = (driver_t*)device->driver;
+
+    // Désinitialiser le périphérique
+    if (driver && driver->deinit) {
+        driver->deinit(device);
+    }
+
+    // Libérer le canal DMA
+    if (device->dma_channel < MAX_DMA_CHANNELS) {
+        device_manager.dma_channels[device->dma_channel] = false;
+    }
+
+    unlink_device(slot);
+    device_manager.device_used[slot] = false;
+    device_manager.device_count--;
+    return true;
 }
 
 device_t* find_device_by_id(uint32_t device_id) {
-    for (uint32_t i = 0; i < device_manager.device_count; i++) {
-        if (device_manager.devices[i].id == device_id) {
-            return &device_manager.devices[i];
-        }
-    }
-    return NULL;
+    uint16_t slot = find_device_slot(device_id);
+    return slot == DEVICE_SLOT_NONE ? NULL : &device_manager.devices[slot];
 }
 
 device_t* find_device_by_type(device_type_t type) {
-    for (uint32_t i = 0; i < device_manager.device_count; i++) {
-        if (device_manager.devices[i].type == type) {
+    if (type >= DEVICE_TYPE_COUNT) return NULL;
+    uint16_t slot = device_manager.type_head[type];
+    return slot == DEVICE_SLOT_NONE ? NULL : &device_manager.devices[slot];
+}
+
+// Recherche par nom ("vda", "eth0"...): réservée aux chemins lents comme le montage
+device_t* find_device_by_name(const char* name) {
+    for (uint32_t i = 0; i < MAX_DEVICES; i++) {
+        if (device_manager.device_used[i] && strcmp(device_manager.devices[i].name, name) == 0) {
             return &device_manager.devices[i];
         }
     }
     return NULL;
 }
 
+// Périphérique suivant du même type, à partir de find_device_by_type
+device_t* next_device_of_type(device_t* device) {
+    uint16_t slot = device - device_manager.devices;
+    uint16_t next = device_manager.type_next[slot];
+    return next == DEVICE_SLOT_NONE ? NULL : &device_manager.devices[next];
+}
+
 bool init_device(device_t* device) {
     if (!device || !device->driver) {
         return false;
@@ -245,34 +352,45 @@ bool register_irq_handler(uint32_t irq, void (*handler)(void*), void* data) {
     return true;
 }
 
-bool unregister_irq_handler(uint32_t irq) {
+// Une ligne PCI INTx peut être partagée: retirer seulement ce gestionnaire, et ne masquer
+// l'IRQ dans le PIC que lorsque plus aucun ne l'utilise
+bool unregister_irq_handler(uint32_t irq, void (*handler)(void*), void* data) {
+    bool removed = false;
+    bool shared = false;
     for (uint32_t i = 0; i < device_manager.irq_handler_count; i++) {
-        if (device_manager.irq_handlers[i].irq == irq) {
-            // Désactiver l'IRQ dans le PIC
-            if (irq < 8) {
-                outb(0x21, inb(0x21) | (1 << irq));
-            } else {
-                outb(0xA1, inb(0xA1) | (1 << (irq - 8)));
-            }
-
+        irq_handler_t* irq_handler = &device_manager.irq_handlers[i];
+        if (irq_handler->irq != irq) {
+            continue;
+        }
+        if (!removed && irq_handler->handler == handler && irq_handler->data == data) {
             memmove(&device_manager.irq_handlers[i],
                     &device_manager.irq_handlers[i + 1],
                     (device_manager.irq_handler_count - i - 1) * sizeof(irq_handler_t));
             device_manager.irq_handler_count--;
-            return true;
+            removed = true;
+            i--;
+            continue;
         }
+        shared = true;
     }
-    return false;
+
+    // Désactiver l'IRQ dans le PIC
+    if (removed && !shared) {
+        if (irq < 8) {
+            outb(0x21, inb(0x21) | (1 << irq));
+        } else {
+            outb(0xA1, inb(0xA1) | (1 << (irq - 8)));
+        }
+    }
+    return removed;
 }
 
+// Appeler tous les gestionnaires de la ligne: chacun vérifie si son périphérique a interrompu
 void handle_irq(uint32_t irq) {
     for (uint32_t i = 0; i < device_manager.irq_handler_count; i++) {
-        if (device_manager.irq_handlers[i].irq == irq) {
-            irq_handler_t* handler = &device_manager.irq_handlers[i];
-            if (handler->handler) {
-                handler->handler(handler->data);
-            }
-            break;
+        irq_handler_t* handler = &device_manager.irq_handlers[i];
+        if (handler->irq == irq && handler->handler) {
+            handler->handler(handler->data);
         }
     }
 
@@ -322,54 +440,3 @@ device_t* get_network_device() {
 device_t* get_sound_device() {
     return find_device_by_type(DEVICE_TYPE_SOUND);
 }
-
-// Gestionnaire de ressources pour les périphériques
-
-typedef struct {
-    uint32_t start;
-    uint32_t end;
-    uint32_t type;
-    bool is_used;
-} resource_t;
-
-#define MAX_RESOURCES 32
-#define RESOURCE_TYPE_IO 1
-#define RESOURCE_TYPE_MEMORY 2
-#define RESOURCE_TYPE_IRQ 3
-#define RESOURCE_TYPE_DMA 4
-
-resource_t resources[MAX_RESOURCES];
-uint32_t resource_count = 0;
-
-void register_resource(uint32_t start, uint32_t end, uint32_t type) {
-    if (resource_count >= MAX_RESOURCES) return;
-
-    resources[resource_count].start = start;
-    resources[resource_count].end = end;
-    resources[resource_count].type = type;
-    resources[resource_count].is_used = false;
-    resource_count++;
-}
-
-bool allocate_resource(uint32_t type, uint32_t size, uint32_t* start) {
-    for (uint32_t i = 0; i < resource_count; i++) {
-        if (resources[i].type == type && !resources[i].is_used) {
-            uint32_t available_size = resources[i].end - resources[i].start;
-            if (available_size >= size) {
-                resources[i].is_used = true;
-                *start = resources[i].start;
-                return true;
-            }
-        }
-    }
-    return false;
-}
-
-void free_resource(uint32_t start) {
-    for (uint32_t i = 0; i < resource_count; i++) {
-        if (resources[i].start == start) {
-            resources[i].is_used = false;
-            break;
-        }
-    }
-} 
\ No newline at end of file
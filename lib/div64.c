@@ -0,0 +1,50 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+// Division 64 bits sans libgcc: sur i386, `/` et `%` sur uint64_t appellent __udivdi3 et
+// __umoddi3, absents du noyau (lié sans libgcc). divl divise 64 bits par 32 bits tant
+// que le quotient tient sur 32 bits: on divise d'abord la moitié haute, comme do_div.
+
+// Quotient de `dividend` / `divisor`; le reste est rangé dans `remainder` s'il est fourni
+uint64_t div64_u32(uint64_t dividend, uint32_t divisor, uint32_t* remainder) {
+    uint32_t high = (uint32_t)(dividend >> 32);
+    uint32_t low = (uint32_t)dividend;
+    uint32_t quotient_high = 0;
+
+    // Après cette étape high < divisor: le quotient de divl ne déborde pas
+    if (high >= divisor) {
+        quotient_high = high / divisor;
+        high %= divisor;
+    }
+
+    uint32_t quotient_low;
+    uint32_t rest;
+    asm("divl %4" : "=a"(quotient_low), "=d"(rest) : "a"(low), "d"(high), "rm"(divisor));
+
+    if (remainder) *remainder = rest;
+    return ((uint64_t)quotient_high << 32) | quotient_low;
+}
+
+// Diviseur sur 64 bits (initialisation, conversions rares): le diviseur normalisé sur 32 bits
+// donne une estimation du quotient exacte à 1 près, corrigée ensuite (Hacker's Delight, 9-5)
+uint64_t div64_u64(uint64_t dividend, uint64_t divisor) {
+    uint32_t divisor_high = (uint32_t)(divisor >> 32);
+    if (!divisor_high) return div64_u32(dividend, (uint32_t)divisor, NULL);
+
+    uint32_t shift = __builtin_clz(divisor_high);
+    uint32_t normalized = (uint32_t)((divisor << shift) >> 32);
+    uint64_t quotient = div64_u32(dividend >> 1, normalized, NULL);
+
+    quotient = (quotient << shift) >> 31;
+    if (quotient) quotient--;
+    if (dividend - quotient * divisor >= divisor) quotient++;
+    return quotient;
+}
+
+// Reste de `dividend` / `divisor` pour un diviseur sur 32 bits
+uint32_t mod64_u32(uint64_t dividend, uint32_t divisor) {
+    uint32_t remainder;
+    div64_u32(dividend, divisor, &remainder);
+    return remainder;
+}
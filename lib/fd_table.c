@@ -0,0 +1,164 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+// Table des descripteurs de fichiers d'un processus: fd -> objet ouvert.
+// Un descripteur garde son numéro jusqu'à sa fermeture, et l'ouverture reçoit toujours
+// le plus petit numéro libre. Les mots pleins du bitmap sont eux-mêmes résumés dans un
+// second bitmap: la recherche saute 1024 descripteurs occupés par mot lu.
+// La table double de taille à la demande, jusqu'à FD_TABLE_MAX descripteurs.
+
+#define FD_TABLE_INITIAL 64
+#define FD_TABLE_MAX 65536
+
+typedef struct {
+    void** entries;
+    // Bit à 1: descripteur occupé
+    uint32_t* used;
+    // Bit à 1: mot de `used` entièrement occupé
+    uint32_t* full;
+    uint32_t capacity;
+    uint32_t count;
+} fd_table_t;
+
+static fd_table_t kernel_fd_table;
+
+static void free_arrays(fd_table_t* table) {
+    kfree(table->entries);
+    kfree(table->used);
+    kfree(table->full);
+    table->entries = NULL;
+    table->used = NULL;
+    table->full = NULL;
+    table->capacity = 0;
+}
+
+// Agrandir la table à `capacity` descripteurs (multiple de 32), en gardant les descripteurs ouverts
+static bool grow_table(fd_table_t* table, uint32_t capacity) {
+    uint32_t words = (capacity + 31) / 32;
+    uint32_t summary_words = (words + 31) / 32;
+
+    void** entries = (void**)kmalloc(capacity * sizeof(void*));
+    uint32_t* used = (uint32_t*)kmalloc(words * sizeof(uint32_t));
+    uint32_t* full = (uint32_t*)kmalloc(summary_words * sizeof(uint32_t));
+    if (!entries || !used || !full) {
+        kfree(entries);
+        kfree(used);
+        kfree(full);
+        return false;
+    }
+
+    memset(entries, 0, capacity * sizeof(void*));
+    memset(used, 0, words * sizeof(uint32_t));
+    memset(full, 0, summary_words * sizeof(uint32_t));
+    if (table->capacity) {
+        memcpy(entries, table->entries, table->capacity * sizeof(void*));
+        memcpy(used, table->used, (table->capacity + 31) / 32 * sizeof(uint32_t));
+        memcpy(full, table->full, ((table->capacity + 31) / 32 + 31) / 32 * sizeof(uint32_t));
+    }
+
+    free_arrays(table);
+    table->entries = entries;
+    table->used = used;
+    table->full = full;
+    table->capacity = capacity;
+    return true;
+}
+
+fd_table_t* fd_table_create() {
+    fd_table_t* table = (fd_table_t*)kmalloc(sizeof(fd_table_t));
+    if (!table) return NULL;
+    memset(table, 0, sizeof(fd_table_t));
+
+    if (!grow_table(table, FD_TABLE_INITIAL)) {
+        kfree(table);
+        return NULL;
+    }
+    return table;
+}
+
+// Fermer les descripteurs restants avec `close_object`, puis libérer la table
+void fd_table_destroy(fd_table_t* table, void (*close_object)(void* object)) {
+    if (!table) return;
+
+    for (uint32_t fd = 0; fd < table->capacity && table->count > 0; fd++) {
+        if (table->entries[fd]) {
+            void* object = table->entries[fd];
+            table->entries[fd] = NULL;
+            table->count--;
+            if (close_object) close_object(object);
+        }
+    }
+
+    free_arrays(table);
+    if (table != &kernel_fd_table) kfree(table);
+}
+
+// Plus petit descripteur libre, -1 si la table est pleine à sa taille actuelle
+static int find_free_fd(fd_table_t* table) {
+    uint32_t words = (table->capacity + 31) / 32;
+    uint32_t summary_words = (words + 31) / 32;
+
+    for (uint32_t i = 0; i < summary_words; i++) {
+        uint32_t not_full = ~table->full[i];
+        if (!not_full) continue;
+
+        uint32_t word = i * 32 + __builtin_ctz(not_full);
+        if (word >= words) return -1;
+        uint32_t fd = word * 32 + __builtin_ctz(~table->used[word]);
+        return fd < table->capacity ? (int)fd : -1;
+    }
+    return -1;
+}
+
+// Associer `object` au plus petit descripteur libre; -1 si la limite est atteinte
+int fd_alloc(fd_table_t* table, void* object) {
+    if (!table || !object) return -1;
+
+    int fd = find_free_fd(table);
+    if (fd < 0) {
+        if (table->capacity >= FD_TABLE_MAX) return -1;
+        uint32_t capacity = table->capacity ? table->capacity * 2 : FD_TABLE_INITIAL;
+        if (capacity > FD_TABLE_MAX) capacity = FD_TABLE_MAX;
+        if (!grow_table(table, capacity)) return -1;
+        fd = find_free_fd(table);
+        if (fd < 0) return -1;
+    }
+
+    uint32_t word = fd / 32;
+    table->used[word] |= 1u << (fd % 32);
+    if (table->used[word] == 0xFFFFFFFF) {
+        table->full[word / 32] |= 1u << (word % 32);
+    }
+    table->entries[fd] = object;
+    table->count++;
+    return fd;
+}
+
+void* fd_get(fd_table_t* table, int fd) {
+    if (!table || fd < 0 || (uint32_t)fd >= table->capacity) return NULL;
+    return table->entries[fd];
+}
+
+// Libérer le descripteur; renvoie l'objet qui y était associé (NULL si fd n'était pas ouvert)
+void* fd_release(fd_table_t* table, int fd) {
+    void* object = fd_get(table, fd);
+    if (!object) return NULL;
+
+    uint32_t word = fd / 32;
+    table->used[word] &= ~(1u << (fd % 32));
+    table->full[word / 32] &= ~(1u << (word % 32));
+    table->entries[fd] = NULL;
+    table->count--;
+    return object;
+}
+
+// Table du noyau: utilisée hors de tout processus (initialisation, tâches du noyau)
+fd_table_t* get_kernel_fd_table() {
+    return &kernel_fd_table;
+}
+
+void init_fd_table() {
+    memset(&kernel_fd_table, 0, sizeof(fd_table_t));
+    grow_table(&kernel_fd_table, FD_TABLE_INITIAL);
+}
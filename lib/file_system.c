@@ -9,6 +9,15 @@
 #define INODE_SIZE 256
 #define MAX_BLOCKS_PER_INODE 12
 #define MAX_INDIRECT_BLOCKS 1024
+#define MAX_MOUNT_POINTS 16
+#define DELALLOC_MAX_BLOCKS 1024
+#define DELALLOC_HASH_SIZE 256
+#define DELALLOC_FLUSH_INTERVAL 5000000
+#define JOURNAL_INODE 8
+#define JOURNAL_MAX_EXTENTS 16
+#define JOURNAL_OPERATION_CREDITS 16
+#define EXT2_S_IFMT 0xF000
+#define EXT2_S_IFDIR 0x4000
 
 typedef struct {
     uint32_t mode;
@@ -84,42 +93,180 @@ typedef struct {
 } group_descriptor_t;
 
 typedef struct {
-    int fd;
+    uint32_t last_block;
+    uint32_t window;
+    uint32_t next;
+} readahead_t;
+
+typedef struct {
+    // Montage du fichier: ses lectures et écritures vont sur ce périphérique
+    struct mount_point* mount;
     uint32_t inode;
     uint32_t position;
     uint32_t flags;
+    readahead_t readahead;
+    // Dernière série de blocs contigus: évite de relire le bloc d'indirection à chaque bloc
+    uint32_t map_logical;
+    uint32_t map_physical;
+    uint32_t map_count;
 } file_handle_t;
 
-typedef struct {
+// Bloc écrit mais pas encore placé sur le disque (allocation différée)
+typedef struct delayed_block {
+    uint32_t inode;
+    uint32_t logical;
+    uint8_t* data;
+    struct delayed_block* next;
+} delayed_block_t;
+
+typedef struct mount_point {
     char path[MAX_PATH_LENGTH];
     uint32_t device;
     uint32_t flags;
+    bool mounted;
     superblock_t* superblock;
     group_descriptor_t* group_descriptors;
+    uint32_t group_count;
     inode_t* inodes;
-    uint32_t* block_bitmap;
     uint32_t* inode_bitmap;
+    delayed_block_t* delayed[DELALLOC_HASH_SIZE];
+    uint32_t delayed_count;
+    // Journal des métadonnées (lib/journal.c), NULL si le système de fichiers n'en a pas
+    void* journal;
 } mount_point_t;
 
 typedef struct {
     mount_point_t* mount_points;
     uint32_t mount_point_count;
-    file_handle_t* file_handles;
-    uint32_t file_handle_count;
 } file_system_t;
 
+typedef struct {
+    uint32_t id;
+    char name[32];
+} device_t;
+
+// Fichier projetable (lib/mmap.c); ce système de fichiers n'en fournit pas
+typedef struct mapping mapping_t;
+
+// Tables d'opérations de la couche VFS (lib/vfs.c)
+typedef struct {
+    void* (*mount)(const char* path, const char* device);
+    void (*unmount)(void* mount);
+    bool (*sync)(void* mount);
+} vfs_super_operations_t;
+
+typedef struct {
+    void* (*open)(void* mount, const char* path, uint32_t flags);
+    void* (*opendir)(void* mount, const char* path);
+    int (*reflink)(void* mount, const char* source, const char* target);
+} vfs_inode_operations_t;
+
+typedef struct {
+    int32_t (*read)(void* file, void* buffer, uint32_t size);
+    int32_t (*write)(void* file, const void* buffer, uint32_t size);
+    int (*fsync)(void* file);
+    void (*release)(void* file);
+    mapping_t* (*mapping)(void* file);
+    uint32_t (*tell)(void* file);
+    void (*seek)(void* file, uint32_t position);
+    int32_t (*readdir)(void* dir, void* buffer, uint32_t size);
+    uint32_t (*telldir)(void* dir);
+    void (*seekdir)(void* dir, uint32_t position);
+    void (*closedir)(void* dir);
+} vfs_file_operations_t;
+
+typedef struct buffer {
+    uint32_t device;
+    uint32_t block;
+    uint32_t size;
+    uint8_t* data;
+} buffer_t;
+
+typedef struct {
+    uint32_t logical;
+    uint32_t physical;
+    uint32_t length;
+} journal_extent_t;
+
 file_system_t file_system;
 
+// Déclarations externes (lib/buffer_cache.c)
+extern buffer_t* bcache_read(uint32_t device, uint32_t block, uint32_t size);
+extern buffer_t* bcache_get(uint32_t device, uint32_t block, uint32_t size);
+extern void bcache_release(buffer_t* buffer);
+extern void bcache_mark_dirty(buffer_t* buffer);
+extern bool bcache_read_bytes(uint32_t device, uint32_t block_size, uint64_t offset, void* out, uint32_t size);
+extern void bcache_invalidate(uint32_t device);
+extern uint32_t bcache_prefetch(uint32_t device, uint32_t block, uint32_t count, uint32_t size);
+extern uint32_t readahead_update(readahead_t* ra, uint32_t block, uint32_t block_size, uint32_t block_count, uint32_t* start);
+
+// Déclarations externes (lib/dcache.c)
+extern bool dcache_lookup(uint32_t device, uint32_t parent, const char* name, uint32_t* inode);
+extern void dcache_add(uint32_t device, uint32_t parent, const char* name, uint32_t inode);
+extern void dcache_invalidate(uint32_t device);
+extern void dcache_invalidate_directory(uint32_t device, uint32_t parent);
+
+// Déclarations externes (lib/journal.c)
+extern void* journal_open(uint32_t device, uint32_t block_size, const journal_extent_t* extents, uint32_t extent_count,
+                          bool* failed);
+extern void journal_close(void* journal);
+extern void journal_start(void* journal, uint32_t credits);
+extern void journal_stop(void* journal);
+extern bool journal_access(void* journal, buffer_t* buffer);
+extern bool journal_commit(void* journal);
+extern bool bcache_sync(uint32_t device);
+
+// Déclarations externes (lib/device_manager.c, lib/vfs.c)
+extern device_t* find_device_by_name(const char* name);
+extern device_t* get_disk_device();
+extern bool vfs_register_filesystem(const char* name, const vfs_super_operations_t* super_ops,
+                                    const vfs_inode_operations_t* inode_ops, const vfs_file_operations_t* file_ops);
+
+uint32_t find_inode_by_path(mount_point_t* mount, const char* path);
+uint32_t get_block_run(mount_point_t* mount, inode_t* inode, uint32_t block_index, uint32_t* run);
+uint32_t get_block_number(mount_point_t* mount, inode_t* inode, uint32_t block_index);
+bool set_block_number(mount_point_t* mount, inode_t* inode, uint32_t block_index, uint32_t block_number);
+uint32_t allocate_block(mount_point_t* mount);
+uint32_t allocate_blocks(mount_point_t* mount, uint32_t goal, uint32_t wanted, uint32_t* count);
+void free_block(mount_point_t* mount, uint32_t block_number);
+static delayed_block_t* find_delayed(mount_point_t* mount, uint32_t inode, uint32_t logical);
+static uint8_t* delayed_block_data(mount_point_t* mount, uint32_t inode, uint32_t logical);
+static bool flush_delayed(mount_point_t* mount, uint32_t inode);
+static void* load_journal(mount_point_t* mount, bool* failed);
+
+static void delalloc_flush(void* data);
+static const vfs_super_operations_t ext2_super_operations;
+static const vfs_inode_operations_t ext2_inode_operations;
+static const vfs_file_operations_t ext2_file_operations;
+
 void init_file_system() {
     memset(&file_system, 0, sizeof(file_system_t));
+    file_system.mount_points = (mount_point_t*)kmalloc(MAX_MOUNT_POINTS * sizeof(mount_point_t));
+    if (file_system.mount_points) {
+        memset(file_system.mount_points, 0, MAX_MOUNT_POINTS * sizeof(mount_point_t));
+    }
+    create_callback("delalloc-flush", DELALLOC_FLUSH_INTERVAL, delalloc_flush, NULL);
+    vfs_register_filesystem("ext2", &ext2_super_operations, &ext2_inode_operations, &ext2_file_operations);
 }
 
-bool mount_file_system(const char* path, uint32_t device) {
-    if (file_system.mount_point_count >= 16) {
-        return false;
+static mount_point_t* mount_device(const char* path, uint32_t device) {
+    if (!file_system.mount_points) {
+        return NULL;
     }
 
-    mount_point_t* mount = &file_system.mount_points[file_system.mount_point_count++];
+    // Les descripteurs ouverts pointent sur leur mount_point_t: on réutilise un emplacement libre
+    mount_point_t* mount = NULL;
+    for (uint32_t i = 0; i < MAX_MOUNT_POINTS; i++) {
+        if (!file_system.mount_points[i].mounted) {
+            mount = &file_system.mount_points[i];
+            break;
+        }
+    }
+    if (!mount) {
+        return NULL;
+    }
+
+    memset(mount, 0, sizeof(mount_point_t));
     strncpy(mount->path, path, sizeof(mount->path) - 1);
     mount->device = device;
     mount->flags = 0;
@@ -127,49 +274,37 @@ bool mount_file_system(const char* path, uint32_t device) {
     // Lire le superblock
     mount->superblock = (superblock_t*)kmalloc(sizeof(superblock_t));
     if (!mount->superblock) {
-        file_system.mount_point_count--;
-        return false;
+        return NULL;
     }
 
     // Lire le superblock depuis le périphérique
-    device_t* dev = find_device_by_id(device);
-    if (!dev) {
-        kfree(mount->superblock);
-        file_system.mount_point_count--;
-        return false;
-    }
-
-    if (read_device(dev, mount->superblock, sizeof(superblock_t), 1024) != sizeof(superblock_t)) {
+    if (!bcache_read_bytes(device, BLOCK_SIZE, 1024, mount->superblock, sizeof(superblock_t))) {
         kfree(mount->superblock);
-        file_system.mount_point_count--;
-        return false;
+        return NULL;
     }
 
     // Vérifier la signature magique
     if (mount->superblock->magic != 0xEF53) {
         kfree(mount->superblock);
-        file_system.mount_point_count--;
-        return false;
+        return NULL;
     }
 
     // Allouer les descripteurs de groupe
     uint32_t group_count = (mount->superblock->block_count + mount->superblock->blocks_per_group - 1) /
                           mount->superblock->blocks_per_group;
+    mount->group_count = group_count;
     mount->group_descriptors = (group_descriptor_t*)kmalloc(sizeof(group_descriptor_t) * group_count);
     if (!mount->group_descriptors) {
         kfree(mount->superblock);
-        file_system.mount_point_count--;
-        return false;
+        return NULL;
     }
 
     // Lire les descripteurs de groupe
-    if (read_device(dev, mount->group_descriptors,
-                   sizeof(group_descriptor_t) * group_count,
-                   1024 + sizeof(superblock_t)) != sizeof(group_descriptor_t) * group_count) {
+    if (!bcache_read_bytes(device, BLOCK_SIZE, 1024 + sizeof(superblock_t),
+                           mount->group_descriptors, sizeof(group_descriptor_t) * group_count)) {
         kfree(mount->group_descriptors);
         kfree(mount->superblock);
-        file_system.mount_point_count--;
-        return false;
+        return NULL;
     }
 
     // Allouer les inodes
@@ -177,112 +312,223 @@ bool mount_file_system(const char* path, uint32_t device) {
     if (!mount->inodes) {
         kfree(mount->group_descriptors);
         kfree(mount->superblock);
-        file_system.mount_point_count--;
-        return false;
+        return NULL;
     }
 
-    // Allouer les bitmaps
-    uint32_t block_bitmap_size = (mount->superblock->block_count + 31) / 32;
+    // Le bitmap des blocs reste sur le disque, un bloc par groupe, lu à travers le cache
     uint32_t inode_bitmap_size = (mount->superblock->inode_count + 31) / 32;
-    mount->block_bitmap = (uint32_t*)kmalloc(block_bitmap_size * sizeof(uint32_t));
     mount->inode_bitmap = (uint32_t*)kmalloc(inode_bitmap_size * sizeof(uint32_t));
-    if (!mount->block_bitmap || !mount->inode_bitmap) {
+    if (!mount->inode_bitmap) {
         kfree(mount->inodes);
         kfree(mount->group_descriptors);
         kfree(mount->superblock);
-        file_system.mount_point_count--;
-        return false;
+        return NULL;
     }
 
-    return true;
-}
-
-void unmount_file_system(const char* path) {
-    for (uint32_t i = 0; i < file_system.mount_point_count; i++) {
-        if (strcmp(file_system.mount_points[i].path, path) == 0) {
-            mount_point_t* mount = &file_system.mount_points[i];
+    // Le journal rejoue les transactions interrompues: relire ce qu'elles ont pu modifier
+    // Un journal illisible ou non rejoué fait échouer le montage: écrire par-dessus le perdrait
+    bool journal_failed;
+    mount->journal = load_journal(mount, &journal_failed);
+    if (journal_failed) {
+        kfree(mount->inode_bitmap);
+        kfree(mount->inodes);
+        kfree(mount->group_descriptors);
+        kfree(mount->superblock);
+        return NULL;
+    }
+    if (mount->journal) {
+        bcache_read_bytes(device, BLOCK_SIZE, 1024, mount->superblock, sizeof(superblock_t));
+        bcache_read_bytes(device, BLOCK_SIZE, 1024 + sizeof(superblock_t),
+                          mount->group_descriptors, sizeof(group_descriptor_t) * group_count);
+    }
 
-            // Libérer les ressources
-            kfree(mount->inode_bitmap);
-            kfree(mount->block_bitmap);
-            kfree(mount->inodes);
-            kfree(mount->group_descriptors);
-            kfree(mount->superblock);
+    mount->mounted = true;
+    file_system.mount_point_count++;
+    return mount;
+}
 
-            // Supprimer le point de montage
-            memmove(&file_system.mount_points[i],
-                    &file_system.mount_points[i + 1],
-                    (file_system.mount_point_count - i - 1) * sizeof(mount_point_t));
-            file_system.mount_point_count--;
-            break;
-        }
+// Sans nom de périphérique, le disque principal; un nom inconnu est une erreur
+static void* ext2_mount(const char* path, const char* device) {
+    device_t* dev = device[0] ? find_device_by_name(device) : get_disk_device();
+    if (!dev) {
+        return NULL;
     }
+    return mount_device(path, dev->id);
 }
 
-int open_file(const char* path, uint32_t flags) {
-    if (file_system.file_handle_count >= 256) {
-        return -1;
+// Ouvrir le journal porté par l'inode réservé 8, comme sur ext3/ext4.
+// Sans bloc, ou sans superblock jbd2 au début, le montage se fait sans journal.
+// *failed signale un journal présent mais impossible à lire ou à rejouer.
+static void* load_journal(mount_point_t* mount, bool* failed) {
+    *failed = false;
+    if (mount->superblock->inodes_per_group < JOURNAL_INODE) {
+        return NULL;
     }
 
-    // Trouver le point de montage
-    mount_point_t* mount = NULL;
-    for (uint32_t i = 0; i < file_system.mount_point_count; i++) {
-        if (strncmp(path, file_system.mount_points[i].path,
-                   strlen(file_system.mount_points[i].path)) == 0) {
-            mount = &file_system.mount_points[i];
-            break;
-        }
+    inode_t inode;
+    uint64_t offset = (uint64_t)mount->group_descriptors[0].inode_table * BLOCK_SIZE + (JOURNAL_INODE - 1) * INODE_SIZE;
+    if (!bcache_read_bytes(mount->device, BLOCK_SIZE, offset, &inode, sizeof(inode_t))) {
+        *failed = true;
+        return NULL;
     }
 
-    if (!mount) {
-        return -1;
+    // Décrire le journal par séries de blocs contigus
+    journal_extent_t extents[JOURNAL_MAX_EXTENTS];
+    uint32_t extent_count = 0;
+    uint32_t length = inode.size / BLOCK_SIZE;
+    for (uint32_t logical = 0; logical < length;) {
+        uint32_t run;
+        uint32_t physical = get_block_run(mount, &inode, logical, &run);
+        if (!physical) {
+            *failed = true;
+            return NULL;
+        }
+        if (run > length - logical) {
+            run = length - logical;
+        }
+
+        journal_extent_t* last = extent_count ? &extents[extent_count - 1] : NULL;
+        if (last && last->physical + last->length == physical) {
+            last->length += run;
+        } else if (extent_count < JOURNAL_MAX_EXTENTS) {
+            extents[extent_count].logical = logical;
+            extents[extent_count].physical = physical;
+            extents[extent_count].length = run;
+            extent_count++;
+        } else {
+            *failed = true;
+            return NULL;
+        }
+        logical += run;
     }
 
+    return journal_open(mount->device, BLOCK_SIZE, extents, extent_count, failed);
+}
+
+static void ext2_unmount(void* private) {
+    mount_point_t* mount = (mount_point_t*)private;
+
+    // Placer les blocs en attente, puis reporter le journal, avant de tout oublier
+    flush_delayed(mount, 0);
+    journal_close(mount->journal);
+
+    // Libérer les ressources
+    dcache_invalidate(mount->device);
+    bcache_invalidate(mount->device);
+    kfree(mount->inode_bitmap);
+    kfree(mount->inodes);
+    kfree(mount->group_descriptors);
+    kfree(mount->superblock);
+
+    // L'emplacement reste en place pour les pointeurs existants, il est juste libéré
+    mount->mounted = false;
+    file_system.mount_point_count--;
+}
+
+static void* ext2_open(void* private, const char* relative, uint32_t flags) {
+    mount_point_t* mount = (mount_point_t*)private;
+
     // Trouver l'inode
-    uint32_t inode = find_inode_by_path(mount, path + strlen(mount->path));
+    uint32_t inode = find_inode_by_path(mount, relative);
     if (!inode) {
-        return -1;
+        return NULL;
     }
 
     // Créer un nouveau descripteur de fichier
-    file_handle_t* handle = &file_system.file_handles[file_system.file_handle_count++];
-    handle->fd = file_system.file_handle_count;
+    file_handle_t* handle = (file_handle_t*)kmalloc(sizeof(file_handle_t));
+    if (!handle) {
+        return NULL;
+    }
+    memset(handle, 0, sizeof(file_handle_t));
+    handle->mount = mount;
     handle->inode = inode;
     handle->position = 0;
     handle->flags = flags;
-
-    return handle->fd;
+    return handle;
 }
 
-void close_file(int fd) {
-    if (fd <= 0 || fd > file_system.file_handle_count) {
-        return;
+static void ext2_release(void* object) {
+    file_handle_t* handle = (file_handle_t*)object;
+    if (handle->mount->mounted) {
+        flush_delayed(handle->mount, handle->inode);
     }
+    kfree(handle);
+}
 
-    // Supprimer le descripteur de fichier
-    memmove(&file_system.file_handles[fd - 1],
-            &file_system.file_handles[fd],
-            (file_system.file_handle_count - fd) * sizeof(file_handle_t));
-    file_system.file_handle_count--;
+static uint32_t ext2_tell(void* object) {
+    return ((file_handle_t*)object)->position;
 }
 
-int read_file(int fd, void* buffer, size_t size) {
-    if (fd <= 0 || fd > file_system.file_handle_count || !buffer) {
+static void ext2_seek(void* object, uint32_t position) {
+    ((file_handle_t*)object)->position = position;
+}
+
+// Rendre durables les écritures d'un fichier: allocation des blocs en attente,
+// puis validation du journal (qui écrit d'abord les données, mode ordonné)
+static int ext2_fsync(void* object) {
+    file_handle_t* handle = (file_handle_t*)object;
+    mount_point_t* mount = handle->mount;
+    if (!mount->mounted) {
         return -1;
     }
 
-    file_handle_t* handle = &file_system.file_handles[fd - 1];
-    mount_point_t* mount = NULL;
+    bool success = flush_delayed(mount, handle->inode);
+    if (mount->journal) {
+        success &= journal_commit(mount->journal);
+    } else {
+        success &= bcache_sync(mount->device);
+    }
+    return success ? 0 : -1;
+}
 
-    // Trouver le point de montage
-    for (uint32_t i = 0; i < file_system.mount_point_count; i++) {
-        if (file_system.mount_points[i].inodes[handle->inode - 1].block[0]) {
-            mount = &file_system.mount_points[i];
-            break;
+// Bloc physique d'un bloc logique, à travers la série mémorisée dans le descripteur
+static uint32_t map_handle_block(mount_point_t* mount, file_handle_t* handle, inode_t* inode, uint32_t index) {
+    if (index >= handle->map_logical && index - handle->map_logical < handle->map_count) {
+        return handle->map_physical + (index - handle->map_logical);
+    }
+
+    uint32_t run;
+    uint32_t block_number = get_block_run(mount, inode, index, &run);
+    if (block_number) {
+        handle->map_logical = index;
+        handle->map_physical = block_number;
+        handle->map_count = run;
+    }
+    return block_number;
+}
+
+// Lancer la lecture anticipée des blocs logiques [start, start + count), par séries contiguës
+static void readahead_handle(mount_point_t* mount, file_handle_t* handle, inode_t* inode,
+                             uint32_t start, uint32_t count) {
+    uint32_t run_start = 0, run_length = 0;
+
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t block_number = map_handle_block(mount, handle, inode, start + i);
+        if (block_number && run_length && block_number == run_start + run_length) {
+            run_length++;
+            continue;
         }
+
+        if (run_length) {
+            bcache_prefetch(mount->device, run_start, run_length, BLOCK_SIZE);
+        }
+        run_start = block_number;
+        run_length = block_number ? 1 : 0;
     }
 
-    if (!mount) {
+    if (run_length) {
+        bcache_prefetch(mount->device, run_start, run_length, BLOCK_SIZE);
+    }
+}
+
+static int32_t ext2_read(void* object, void* buffer, uint32_t size) {
+    file_handle_t* handle = (file_handle_t*)object;
+    if (!handle || !buffer) {
+        return -1;
+    }
+
+    mount_point_t* mount = handle->mount;
+    if (!mount->mounted) {
         return -1;
     }
 
@@ -293,26 +539,36 @@ int read_file(int fd, void* buffer, size_t size) {
 
     size_t bytes_to_read = min(size, inode->size - handle->position);
     size_t bytes_read = 0;
+    uint32_t block_count = (inode->size + BLOCK_SIZE - 1) / BLOCK_SIZE;
 
     while (bytes_read < bytes_to_read) {
         uint32_t block_index = handle->position / BLOCK_SIZE;
         uint32_t block_offset = handle->position % BLOCK_SIZE;
-        uint32_t block_number = get_block_number(mount, inode, block_index);
 
-        if (!block_number) {
-            break;
+        uint32_t readahead_start;
+        uint32_t readahead_count = readahead_update(&handle->readahead, block_index, BLOCK_SIZE,
+                                                    block_count, &readahead_start);
+        if (readahead_count) {
+            readahead_handle(mount, handle, inode, readahead_start, readahead_count);
         }
 
         size_t bytes_in_block = min(bytes_to_read - bytes_read, BLOCK_SIZE - block_offset);
-        device_t* dev = find_device_by_id(mount->device);
-        if (!dev) {
-            break;
-        }
+        delayed_block_t* delayed = find_delayed(mount, handle->inode, block_index);
+        uint32_t block_number = delayed ? 0 : map_handle_block(mount, handle, inode, block_index);
+
+        if (delayed) {
+            memcpy((uint8_t*)buffer + bytes_read, delayed->data + block_offset, bytes_in_block);
+        } else if (block_number) {
+            buffer_t* block = bcache_read(mount->device, block_number, BLOCK_SIZE);
+            if (!block) {
+                break;
+            }
 
-        if (read_device(dev, (uint8_t*)buffer + bytes_read,
-                       bytes_in_block,
-                       block_number * BLOCK_SIZE + block_offset) != bytes_in_block) {
-            break;
+            memcpy((uint8_t*)buffer + bytes_read, block->data + block_offset, bytes_in_block);
+            bcache_release(block);
+        } else {
+            // Trou dans le fichier
+            memset((uint8_t*)buffer + bytes_read, 0, bytes_in_block);
         }
 
         bytes_read += bytes_in_block;
@@ -322,23 +578,14 @@ int read_file(int fd, void* buffer, size_t size) {
     return bytes_read;
 }
 
-int write_file(int fd, const void* buffer, size_t size) {
-    if (fd <= 0 || fd > file_system.file_handle_count || !buffer) {
+static int32_t ext2_write(void* object, const void* buffer, uint32_t size) {
+    file_handle_t* handle = (file_handle_t*)object;
+    if (!handle || !buffer) {
         return -1;
     }
 
-    file_handle_t* handle = &file_system.file_handles[fd - 1];
-    mount_point_t* mount = NULL;
-
-    // Trouver le point de montage
-    for (uint32_t i = 0; i < file_system.mount_point_count; i++) {
-        if (file_system.mount_points[i].inodes[handle->inode - 1].block[0]) {
-            mount = &file_system.mount_points[i];
-            break;
-        }
-    }
-
-    if (!mount) {
+    mount_point_t* mount = handle->mount;
+    if (!mount->mounted) {
         return -1;
     }
 
@@ -349,30 +596,27 @@ int write_file(int fd, const void* buffer, size_t size) {
         uint32_t block_index = handle->position / BLOCK_SIZE;
         uint32_t block_offset = handle->position % BLOCK_SIZE;
         uint32_t block_number = get_block_number(mount, inode, block_index);
+        size_t bytes_in_block = min(size - bytes_written, BLOCK_SIZE - block_offset);
 
         if (!block_number) {
-            // Allouer un nouveau bloc
-            block_number = allocate_block(mount);
-            if (!block_number) {
+            // Allocation différée: le bloc ne reçoit sa place sur le disque qu'à la réécriture
+            uint8_t* data = delayed_block_data(mount, handle->inode, block_index);
+            if (!data) {
                 break;
             }
-
-            if (!set_block_number(mount, inode, block_index, block_number)) {
-                free_block(mount, block_number);
+            memcpy(data + block_offset, (uint8_t*)buffer + bytes_written, bytes_in_block);
+        } else {
+            // Un bloc entièrement réécrit n'a pas besoin d'être lu au préalable
+            buffer_t* block = bytes_in_block == BLOCK_SIZE ?
+                              bcache_get(mount->device, block_number, BLOCK_SIZE) :
+                              bcache_read(mount->device, block_number, BLOCK_SIZE);
+            if (!block) {
                 break;
             }
-        }
-
-        size_t bytes_in_block = min(size - bytes_written, BLOCK_SIZE - block_offset);
-        device_t* dev = find_device_by_id(mount->device);
-        if (!dev) {
-            break;
-        }
 
-        if (write_device(dev, (uint8_t*)buffer + bytes_written,
-                        bytes_in_block,
-                        block_number * BLOCK_SIZE + block_offset) != bytes_in_block) {
-            break;
+            memcpy(block->data + block_offset, (uint8_t*)buffer + bytes_written, bytes_in_block);
+            bcache_mark_dirty(block);
+            bcache_release(block);
         }
 
         bytes_written += bytes_in_block;
@@ -383,6 +627,10 @@ int write_file(int fd, const void* buffer, size_t size) {
         }
     }
 
+    // Un répertoire réécrit a pu perdre ou gagner des noms: oublier ceux du cache
+    if (bytes_written > 0 && (inode->mode & EXT2_S_IFMT) == EXT2_S_IFDIR) {
+        dcache_invalidate_directory(mount->device, handle->inode);
+    }
     return bytes_written;
 }
 
@@ -396,38 +644,37 @@ uint32_t find_inode_by_path(mount_point_t* mount, const char* path) {
     char* token = strtok(path_copy, "/");
 
     while (token) {
+        uint32_t cached_inode;
+        if (dcache_lookup(mount->device, current_inode, token, &cached_inode)) {
+            if (!cached_inode) {
+                kfree(path_copy);
+                return 0;
+            }
+            current_inode = cached_inode;
+            token = strtok(NULL, "/");
+            continue;
+        }
+
         bool found = false;
+        uint32_t parent_inode = current_inode;
         inode_t* inode = &mount->inodes[current_inode - 1];
 
-        // Lire le répertoire
-        uint8_t* buffer = (uint8_t*)kmalloc(BLOCK_SIZE);
-        if (!buffer) {
-            kfree(path_copy);
-            return 0;
-        }
-
+        // Lire le répertoire à travers le cache de blocs
         for (uint32_t i = 0; i < MAX_BLOCKS_PER_INODE; i++) {
             if (!inode->block[i]) {
                 continue;
             }
 
-            device_t* dev = find_device_by_id(mount->device);
-            if (!dev) {
-                kfree(buffer);
+            buffer_t* block = bcache_read(mount->device, inode->block[i], BLOCK_SIZE);
+            if (!block) {
                 kfree(path_copy);
                 return 0;
             }
 
-            if (read_device(dev, buffer, BLOCK_SIZE,
-                           inode->block[i] * BLOCK_SIZE) != BLOCK_SIZE) {
-                kfree(buffer);
-                kfree(path_copy);
-                return 0;
-            }
-
-            directory_entry_t* entry = (directory_entry_t*)buffer;
-            while ((uint8_t*)entry < buffer + BLOCK_SIZE) {
-                if (entry->inode && strncmp(entry->name, token, entry->name_len) == 0) {
+            directory_entry_t* entry = (directory_entry_t*)block->data;
+            while ((uint8_t*)entry < block->data + BLOCK_SIZE && entry->rec_len) {
+                if (entry->inode && entry->name_len == strlen(token) &&
+                    strncmp(entry->name, token, entry->name_len) == 0) {
                     current_inode = entry->inode;
                     found = true;
                     break;
@@ -435,12 +682,13 @@ uint32_t find_inode_by_path(mount_point_t* mount, const char* path) {
                 entry = (directory_entry_t*)((uint8_t*)entry + entry->rec_len);
             }
 
+            bcache_release(block);
             if (found) {
                 break;
             }
         }
 
-        kfree(buffer);
+        dcache_add(mount->device, parent_inode, token, found ? current_inode : 0);
         if (!found) {
             kfree(path_copy);
             return 0;
@@ -453,38 +701,49 @@ uint32_t find_inode_by_path(mount_point_t* mount, const char* path) {
     return current_inode;
 }
 
-uint32_t get_block_number(mount_point_t* mount, inode_t* inode, uint32_t block_index) {
+// Longueur de la série de numéros consécutifs à partir de blocks[index]
+static uint32_t count_block_run(const uint32_t* blocks, uint32_t index, uint32_t limit) {
+    uint32_t run = 1;
+    while (index + run < limit && blocks[index + run] == blocks[index] + run) {
+        run++;
+    }
+    return run;
+}
+
+// Comme get_block_number, et *run reçoit le nombre de blocs physiquement contigus qui suivent
+uint32_t get_block_run(mount_point_t* mount, inode_t* inode, uint32_t block_index, uint32_t* run) {
+    *run = 1;
     if (block_index < MAX_BLOCKS_PER_INODE) {
+        if (inode->block[block_index]) {
+            *run = count_block_run(inode->block, block_index, MAX_BLOCKS_PER_INODE);
+        }
         return inode->block[block_index];
     }
 
     block_index -= MAX_BLOCKS_PER_INODE;
-    if (block_index < MAX_INDIRECT_BLOCKS) {
-        uint32_t* indirect_blocks = (uint32_t*)kmalloc(BLOCK_SIZE);
-        if (!indirect_blocks) {
+    if (block_index < MAX_INDIRECT_BLOCKS && inode->block[12]) {
+        buffer_t* indirect = bcache_read(mount->device, inode->block[12], BLOCK_SIZE);
+        if (!indirect) {
             return 0;
         }
 
-        device_t* dev = find_device_by_id(mount->device);
-        if (!dev) {
-            kfree(indirect_blocks);
-            return 0;
+        uint32_t* entries = (uint32_t*)indirect->data;
+        uint32_t block_number = entries[block_index];
+        if (block_number) {
+            *run = count_block_run(entries, block_index, MAX_INDIRECT_BLOCKS);
         }
-
-        if (read_device(dev, indirect_blocks, BLOCK_SIZE,
-                       inode->block[12] * BLOCK_SIZE) != BLOCK_SIZE) {
-            kfree(indirect_blocks);
-            return 0;
-        }
-
-        uint32_t block_number = indirect_blocks[block_index];
-        kfree(indirect_blocks);
+        bcache_release(indirect);
         return block_number;
     }
 
     return 0;
 }
 
+uint32_t get_block_number(mount_point_t* mount, inode_t* inode, uint32_t block_index) {
+    uint32_t run;
+    return get_block_run(mount, inode, block_index, &run);
+}
+
 bool set_block_number(mount_point_t* mount, inode_t* inode, uint32_t block_index, uint32_t block_number) {
     if (block_index < MAX_BLOCKS_PER_INODE) {
         inode->block[block_index] = block_number;
@@ -492,95 +751,444 @@ bool set_block_number(mount_point_t* mount, inode_t* inode, uint32_t block_index
     }
 
     block_index -= MAX_BLOCKS_PER_INODE;
-    if (block_index < MAX_INDIRECT_BLOCKS) {
-        if (!inode->block[12]) {
-            inode->block[12] = allocate_block(mount);
-            if (!inode->block[12]) {
-                return false;
-            }
-        }
+    if (block_index >= MAX_INDIRECT_BLOCKS) {
+        return false;
+    }
+
+    journal_start(mount->journal, 4);
+    buffer_t* indirect;
+    bool fresh = false;
+    if (!inode->block[12]) {
+        inode->block[12] = allocate_block(mount);
+        // Nouveau bloc d'indirection: partir d'un bloc vide plutôt que de le lire
+        indirect = inode->block[12] ? bcache_get(mount->device, inode->block[12], BLOCK_SIZE) : NULL;
+        fresh = true;
+    } else {
+        indirect = bcache_read(mount->device, inode->block[12], BLOCK_SIZE);
+    }
 
-        uint32_t* indirect_blocks = (uint32_t*)kmalloc(BLOCK_SIZE);
-        if (!indirect_blocks) {
-            return false;
+    if (!indirect) {
+        journal_stop(mount->journal);
+        return false;
+    }
+
+    bool journaled = journal_access(mount->journal, indirect);
+    if (fresh) {
+        memset(indirect->data, 0, BLOCK_SIZE);
+    }
+    ((uint32_t*)indirect->data)[block_index] = block_number;
+    if (!journaled) {
+        bcache_mark_dirty(indirect);
+    }
+    bcache_release(indirect);
+    journal_stop(mount->journal);
+    return true;
+}
+
+// Recopier une structure de métadonnées (superblock, descripteurs) dans ses blocs en cache.
+// Avec un journal, chaque bloc est rattaché à la transaction en cours avant d'être modifié.
+static void write_metadata(mount_point_t* mount, uint32_t offset, const void* data, uint32_t size) {
+    const uint8_t* source = (const uint8_t*)data;
+    while (size > 0) {
+        uint32_t within = offset % BLOCK_SIZE;
+        uint32_t chunk = min(size, BLOCK_SIZE - within);
+
+        buffer_t* block = bcache_read(mount->device, offset / BLOCK_SIZE, BLOCK_SIZE);
+        if (!block) {
+            return;
         }
+        bool journaled = journal_access(mount->journal, block);
+        memcpy(block->data + within, source, chunk);
+        if (!journaled) {
+            bcache_mark_dirty(block);
+        }
+        bcache_release(block);
+
+        source += chunk;
+        offset += chunk;
+        size -= chunk;
+    }
+}
+
+static void write_group_descriptor(mount_point_t* mount, uint32_t group) {
+    write_metadata(mount, 1024 + sizeof(superblock_t) + group * sizeof(group_descriptor_t),
+                   &mount->group_descriptors[group], sizeof(group_descriptor_t));
+}
 
-        device_t* dev = find_device_by_id(mount->device);
-        if (!dev) {
-            kfree(indirect_blocks);
-            return false;
+static void write_superblock(mount_point_t* mount) {
+    write_metadata(mount, 1024, mount->superblock, sizeof(superblock_t));
+}
+
+// Nombre de blocs du groupe (le dernier peut être incomplet), borné par un bloc de bitmap
+static uint32_t group_block_count(mount_point_t* mount, uint32_t group) {
+    uint32_t per_group = min(mount->superblock->blocks_per_group, BLOCK_SIZE * 8);
+    uint32_t first = group * mount->superblock->blocks_per_group;
+    if (first >= mount->superblock->block_count) {
+        return 0;
+    }
+    return min(per_group, mount->superblock->block_count - first);
+}
+
+// Premier bit libre dans [from, limit), en sautant les mots pleins; limit si aucun
+static uint32_t find_free_bit(const uint32_t* bitmap, uint32_t from, uint32_t limit) {
+    uint32_t bit = from;
+    while (bit < limit) {
+        if ((bit % 32) == 0 && bitmap[bit / 32] == 0xFFFFFFFF) {
+            bit += 32;
+            continue;
+        }
+        if (!(bitmap[bit / 32] & (1u << (bit % 32)))) {
+            return bit;
         }
+        bit++;
+    }
+    return limit;
+}
 
-        if (read_device(dev, indirect_blocks, BLOCK_SIZE,
-                       inode->block[12] * BLOCK_SIZE) != BLOCK_SIZE) {
-            kfree(indirect_blocks);
-            return false;
+// Allouer jusqu'à `wanted` blocs contigus, au plus près de `goal`.
+// Seuls les groupes dont le compteur indique des blocs libres sont parcourus,
+// et seul le bloc de bitmap du groupe choisi est modifié (en cache).
+// Renvoie le premier bloc et, dans *count, le nombre de blocs obtenus.
+uint32_t allocate_blocks(mount_point_t* mount, uint32_t goal, uint32_t wanted, uint32_t* count) {
+    superblock_t* superblock = mount->superblock;
+    *count = 0;
+    if (wanted == 0 || superblock->free_blocks == 0 || mount->group_count == 0) {
+        return 0;
+    }
+
+    journal_start(mount->journal, 3);
+    uint32_t relative = goal > superblock->first_data_block ? goal - superblock->first_data_block : 0;
+    uint32_t goal_group = (relative / superblock->blocks_per_group) % mount->group_count;
+    uint32_t goal_bit = relative % superblock->blocks_per_group;
+
+    for (uint32_t n = 0; n < mount->group_count; n++) {
+        uint32_t group = (goal_group + n) % mount->group_count;
+        group_descriptor_t* descriptor = &mount->group_descriptors[group];
+        if (descriptor->free_blocks_count == 0) {
+            continue;
         }
 
-        indirect_blocks[block_index] = block_number;
+        uint32_t limit = group_block_count(mount, group);
+        buffer_t* bitmap_block = bcache_read(mount->device, descriptor->block_bitmap, BLOCK_SIZE);
+        if (!bitmap_block) {
+            continue;
+        }
+        uint32_t* bitmap = (uint32_t*)bitmap_block->data;
+
+        // Dans le groupe visé, chercher d'abord après le but, puis depuis le début
+        uint32_t start = n == 0 && goal_bit < limit ? goal_bit : 0;
+        uint32_t bit = find_free_bit(bitmap, start, limit);
+        if (bit == limit && start > 0) {
+            bit = find_free_bit(bitmap, 0, start);
+            if (bit == start) bit = limit;
+        }
+        if (bit == limit) {
+            bcache_release(bitmap_block);
+            continue;
+        }
 
-        if (write_device(dev, indirect_blocks, BLOCK_SIZE,
-                        inode->block[12] * BLOCK_SIZE) != BLOCK_SIZE) {
-            kfree(indirect_blocks);
-            return false;
+        bool journaled = journal_access(mount->journal, bitmap_block);
+        uint32_t run = 0;
+        while (run < wanted && run < descriptor->free_blocks_count && bit + run < limit &&
+               !(bitmap[(bit + run) / 32] & (1u << ((bit + run) % 32)))) {
+            bitmap[(bit + run) / 32] |= 1u << ((bit + run) % 32);
+            run++;
+        }
+        if (!journaled) {
+            bcache_mark_dirty(bitmap_block);
         }
+        bcache_release(bitmap_block);
 
-        kfree(indirect_blocks);
-        return true;
+        descriptor->free_blocks_count -= run;
+        superblock->free_blocks -= run;
+        write_group_descriptor(mount, group);
+        write_superblock(mount);
+        journal_stop(mount->journal);
+
+        *count = run;
+        return superblock->first_data_block + group * superblock->blocks_per_group + bit;
     }
 
-    return false;
+    journal_stop(mount->journal);
+    return 0;
 }
 
 uint32_t allocate_block(mount_point_t* mount) {
-    for (uint32_t i = 0; i < mount->superblock->block_count; i++) {
-        uint32_t word_index = i / 32;
-        uint32_t bit_index = i % 32;
+    uint32_t count;
+    return allocate_blocks(mount, mount->superblock->first_data_block, 1, &count);
+}
 
-        if (!(mount->block_bitmap[word_index] & (1 << bit_index))) {
-            mount->block_bitmap[word_index] |= (1 << bit_index);
-            mount->superblock->free_blocks--;
+void free_block(mount_point_t* mount, uint32_t block_number) {
+    superblock_t* superblock = mount->superblock;
+    if (block_number < superblock->first_data_block ||
+        block_number >= superblock->first_data_block + superblock->block_count) {
+        return;
+    }
 
-            // Écrire le bitmap mis à jour
-            device_t* dev = find_device_by_id(mount->device);
-            if (!dev) {
-                return 0;
+    uint32_t index = block_number - superblock->first_data_block;
+    uint32_t group = index / superblock->blocks_per_group;
+    uint32_t bit = index % superblock->blocks_per_group;
+    if (group >= mount->group_count) {
+        return;
+    }
+
+    buffer_t* bitmap_block = bcache_read(mount->device, mount->group_descriptors[group].block_bitmap, BLOCK_SIZE);
+    if (!bitmap_block) {
+        return;
+    }
+
+    uint32_t* bitmap = (uint32_t*)bitmap_block->data;
+    if (bitmap[bit / 32] & (1u << (bit % 32))) {
+        journal_start(mount->journal, 3);
+        bool journaled = journal_access(mount->journal, bitmap_block);
+        bitmap[bit / 32] &= ~(1u << (bit % 32));
+        if (!journaled) {
+            bcache_mark_dirty(bitmap_block);
+        }
+
+        mount->group_descriptors[group].free_blocks_count++;
+        superblock->free_blocks++;
+        write_group_descriptor(mount, group);
+        write_superblock(mount);
+        journal_stop(mount->journal);
+    }
+    bcache_release(bitmap_block);
+}
+
+static uint32_t delayed_hash(uint32_t inode, uint32_t logical) {
+    return (inode * 0x9E3779B1 ^ logical) % DELALLOC_HASH_SIZE;
+}
+
+static delayed_block_t* find_delayed(mount_point_t* mount, uint32_t inode, uint32_t logical) {
+    if (mount->delayed_count == 0) {
+        return NULL;
+    }
+
+    delayed_block_t* delayed = mount->delayed[delayed_hash(inode, logical)];
+    while (delayed) {
+        if (delayed->inode == inode && delayed->logical == logical) {
+            return delayed;
+        }
+        delayed = delayed->next;
+    }
+    return NULL;
+}
+
+// Contenu en mémoire d'un bloc pas encore alloué. Chaque bloc en attente est
+// réservé sur le compteur de blocs libres: la place manque dès l'écriture, pas à la réécriture.
+static uint8_t* delayed_block_data(mount_point_t* mount, uint32_t inode, uint32_t logical) {
+    delayed_block_t* delayed = find_delayed(mount, inode, logical);
+    if (delayed) {
+        return delayed->data;
+    }
+
+    if (mount->delayed_count >= DELALLOC_MAX_BLOCKS) {
+        flush_delayed(mount, 0);
+    }
+    if (mount->delayed_count >= DELALLOC_MAX_BLOCKS ||
+        mount->delayed_count >= mount->superblock->free_blocks) {
+        return NULL;
+    }
+
+    delayed = (delayed_block_t*)kmalloc(sizeof(delayed_block_t));
+    if (!delayed) {
+        return NULL;
+    }
+    delayed->data = (uint8_t*)kmalloc(BLOCK_SIZE);
+    if (!delayed->data) {
+        kfree(delayed);
+        return NULL;
+    }
+    memset(delayed->data, 0, BLOCK_SIZE);
+
+    uint32_t bucket = delayed_hash(inode, logical);
+    delayed->inode = inode;
+    delayed->logical = logical;
+    delayed->next = mount->delayed[bucket];
+    mount->delayed[bucket] = delayed;
+    mount->delayed_count++;
+    return delayed->data;
+}
+
+static void unlink_delayed(mount_point_t* mount, delayed_block_t* delayed) {
+    delayed_block_t** link = &mount->delayed[delayed_hash(delayed->inode, delayed->logical)];
+    while (*link && *link != delayed) {
+        link = &(*link)->next;
+    }
+    if (*link) {
+        *link = delayed->next;
+        mount->delayed_count--;
+    }
+}
+
+static bool delayed_before(const delayed_block_t* a, const delayed_block_t* b) {
+    return a->inode < b->inode || (a->inode == b->inode && a->logical < b->logical);
+}
+
+// Placer sur le disque les blocs en attente d'un inode (0 = tous).
+// Les blocs logiques consécutifs reçoivent des blocs physiques contigus, alloués
+// en une fois près du bloc précédent du fichier ou, à défaut, dans le groupe de l'inode.
+static bool flush_delayed(mount_point_t* mount, uint32_t inode) {
+    if (mount->delayed_count == 0) {
+        return true;
+    }
+
+    delayed_block_t** pending = (delayed_block_t**)kmalloc(mount->delayed_count * sizeof(delayed_block_t*));
+    if (!pending) {
+        return false;
+    }
+
+    uint32_t count = 0;
+    for (uint32_t bucket = 0; bucket < DELALLOC_HASH_SIZE; bucket++) {
+        for (delayed_block_t* delayed = mount->delayed[bucket]; delayed; delayed = delayed->next) {
+            if (inode == 0 || delayed->inode == inode) {
+                pending[count++] = delayed;
             }
+        }
+    }
 
-            if (write_device(dev, mount->block_bitmap,
-                           (mount->superblock->block_count + 31) / 32 * sizeof(uint32_t),
-                           mount->group_descriptors[0].block_bitmap * BLOCK_SIZE) !=
-                (mount->superblock->block_count + 31) / 32 * sizeof(uint32_t)) {
-                return 0;
+    // Toutes les allocations de ce passage entrent dans la même transaction
+    journal_start(mount->journal, JOURNAL_OPERATION_CREDITS);
+
+    // Tri par (inode, bloc logique) pour retrouver les séries
+    for (uint32_t gap = count / 2; gap > 0; gap /= 2) {
+        for (uint32_t i = gap; i < count; i++) {
+            delayed_block_t* current = pending[i];
+            uint32_t j = i;
+            while (j >= gap && delayed_before(current, pending[j - gap])) {
+                pending[j] = pending[j - gap];
+                j -= gap;
             }
+            pending[j] = current;
+        }
+    }
+
+    bool success = true;
+    uint32_t i = 0;
+    while (i < count) {
+        delayed_block_t* first = pending[i];
+        inode_t* node = &mount->inodes[first->inode - 1];
+
+        uint32_t run = 1;
+        while (i + run < count && pending[i + run]->inode == first->inode &&
+               pending[i + run]->logical == first->logical + run) {
+            run++;
+        }
 
-            return i + mount->superblock->first_data_block;
+        // But: juste après le bloc logique précédent, sinon le début du groupe de l'inode
+        uint32_t goal = first->logical > 0 ? get_block_number(mount, node, first->logical - 1) : 0;
+        if (goal) {
+            goal++;
+        } else {
+            uint32_t group = (first->inode - 1) / mount->superblock->inodes_per_group;
+            goal = mount->superblock->first_data_block + group * mount->superblock->blocks_per_group;
         }
+
+        // Le bloc d'indirection est placé juste devant les données qu'il décrit
+        if (first->logical + run > MAX_BLOCKS_PER_INODE && !node->block[12]) {
+            uint32_t got;
+            uint32_t indirect = allocate_blocks(mount, goal, 1, &got);
+            if (!indirect) {
+                success = false;
+                break;
+            }
+            buffer_t* block = bcache_get(mount->device, indirect, BLOCK_SIZE);
+            if (block) {
+                bool journaled = journal_access(mount->journal, block);
+                memset(block->data, 0, BLOCK_SIZE);
+                if (!journaled) {
+                    bcache_mark_dirty(block);
+                }
+                bcache_release(block);
+            }
+            node->block[12] = indirect;
+            goal = indirect + 1;
+        }
+
+        uint32_t got;
+        uint32_t physical = allocate_blocks(mount, goal, run, &got);
+        if (!physical) {
+            success = false;
+            break;
+        }
+
+        for (uint32_t k = 0; k < got; k++) {
+            delayed_block_t* delayed = pending[i + k];
+            buffer_t* block = bcache_get(mount->device, physical + k, BLOCK_SIZE);
+            if (!block || !set_block_number(mount, node, delayed->logical, physical + k)) {
+                if (block) bcache_release(block);
+                for (uint32_t unused = k; unused < got; unused++) {
+                    free_block(mount, physical + unused);
+                }
+                success = false;
+                break;
+            }
+
+            memcpy(block->data, delayed->data, BLOCK_SIZE);
+            bcache_mark_dirty(block);
+            bcache_release(block);
+
+            unlink_delayed(mount, delayed);
+            kfree(delayed->data);
+            kfree(delayed);
+        }
+        if (!success) {
+            break;
+        }
+
+        // Une série incomplète se poursuit ailleurs au tour suivant
+        i += got;
     }
 
-    return 0;
+    journal_stop(mount->journal);
+    kfree(pending);
+    return success;
 }
 
-void free_block(mount_point_t* mount, uint32_t block_number) {
-    if (block_number < mount->superblock->first_data_block ||
-        block_number >= mount->superblock->first_data_block + mount->superblock->block_count) {
+// Périodiquement: placer les blocs en attente puis valider la transaction qui les décrit
+static void delalloc_flush(void* data) {
+    (void)data;
+    if (!file_system.mount_points) {
         return;
     }
 
-    uint32_t index = block_number - mount->superblock->first_data_block;
-    uint32_t word_index = index / 32;
-    uint32_t bit_index = index % 32;
-
-    mount->block_bitmap[word_index] &= ~(1 << bit_index);
-    mount->superblock->free_blocks++;
+    for (uint32_t i = 0; i < MAX_MOUNT_POINTS; i++) {
+        mount_point_t* mount = &file_system.mount_points[i];
+        if (!mount->mounted) {
+            continue;
+        }
+        flush_delayed(mount, 0);
+        journal_commit(mount->journal);
+    }
+}
 
-    // Écrire le bitmap mis à jour
-    device_t* dev = find_device_by_id(mount->device);
-    if (!dev) {
-        return;
+// Placer les blocs en attente puis valider le journal (ou réécrire le cache de blocs)
+static bool ext2_sync(void* private) {
+    mount_point_t* mount = (mount_point_t*)private;
+    bool success = flush_delayed(mount, 0);
+    if (mount->journal) {
+        success &= journal_commit(mount->journal);
+    } else {
+        success &= bcache_sync(mount->device);
     }
+    return success;
+}
 
-    write_device(dev, mount->block_bitmap,
-                (mount->superblock->block_count + 31) / 32 * sizeof(uint32_t),
-                mount->group_descriptors[0].block_bitmap * BLOCK_SIZE);
-} 
\ No newline at end of file
+static const vfs_super_operations_t ext2_super_operations = {
+    .mount = ext2_mount,
+    .unmount = ext2_unmount,
+    .sync = ext2_sync,
+};
+
+static const vfs_inode_operations_t ext2_inode_operations = {
+    .open = ext2_open,
+};
+
+static const vfs_file_operations_t ext2_file_operations = {
+    .read = ext2_read,
+    .write = ext2_write,
+    .fsync = ext2_fsync,
+    .release = ext2_release,
+    .tell = ext2_tell,
+    .seek = ext2_seek,
+};
@@ -3,11 +3,33 @@
 #include <string.h>
 
 #define MAX_FILES 1024
-#define MAX_DIRS 256
 #define MAX_MOUNTS 16
 #define BLOCK_SIZE 4096
 #define MAX_FILENAME 256
 #define MAX_PATH 1024
+#define EXT4_SUPER_MAGIC 0xEF53
+#define EXT4_EXTENT_MAGIC 0xF30A
+#define EXT4_INDEX_FL 0x1000
+#define EXT4_EXTENTS_FL 0x80000
+#define EXT4_FEATURE_COMPAT_DIR_INDEX 0x0020
+#define EXT4_FEATURE_INCOMPAT_64BIT 0x0080
+#define EXT4_FLAGS_UNSIGNED_HASH 0x0002
+#define EXT4_MAX_EXTENT_DEPTH 5
+#define EXT4_EXTENT_INIT_MAX_LEN 32768
+#define DX_HASH_LEGACY 0
+#define DX_HASH_HALF_MD4 1
+#define DX_HASH_TEA 2
+#define DX_HASH_UNSIGNED_DELTA 3
+#define DX_MAX_LEVELS 3
+#define INODE_CACHE_SIZE 1024
+#define INODE_HASH_SIZE 256
+#define INODE_WRITEBACK_INTERVAL 5000000
+#define PAGE_SIZE 4096
+#define EXT4_S_IFMT 0xF000
+#define EXT4_S_IFDIR 0x4000
+#define O_CREAT 0x40
+#define O_TRUNC 0x200
+#define DIR_READAHEAD_BLOCKS 8
 
 typedef struct {
     uint32_t inode;
@@ -38,18 +60,27 @@ typedef struct {
     uint8_t osd2[12];
 } ext4_inode_t;
 
+// Disposition sur disque: le superblock commence à l'octet 1024 du périphérique
 typedef struct {
     uint32_t inodes_count;
     uint32_t blocks_count;
+    uint32_t r_blocks_count;
     uint32_t free_blocks_count;
     uint32_t free_inodes_count;
     uint32_t first_data_block;
     uint32_t log_block_size;
+    uint32_t log_cluster_size;
     uint32_t blocks_per_group;
+    uint32_t clusters_per_group;
     uint32_t inodes_per_group;
-    uint32_t magic;
+    uint32_t mtime;
+    uint32_t wtime;
+    uint16_t mnt_count;
+    uint16_t max_mnt_count;
+    uint16_t magic;
     uint16_t state;
     uint16_t errors;
+    uint16_t minor_rev_level;
     uint32_t lastcheck;
     uint32_t checkinterval;
     uint32_t creator_os;
@@ -81,6 +112,12 @@ typedef struct {
     uint32_t first_meta_bg;
     uint32_t mkfs_time;
     uint32_t jnl_blocks[17];
+    uint32_t blocks_count_hi;
+    uint32_t r_blocks_count_hi;
+    uint32_t free_blocks_count_hi;
+    uint16_t min_extra_isize;
+    uint16_t want_extra_isize;
+    uint32_t flags;
 } ext4_superblock_t;
 
 typedef struct {
@@ -94,638 +131,1313 @@ typedef struct {
     uint8_t reserved[12];
 } ext4_group_desc_t;
 
+// Arbre d'extents: l'en-tête et jusqu'à 4 entrées tiennent dans inode->block
 typedef struct {
-    uint32_t inode;
-    uint32_t position;
-    uint32_t size;
-    uint32_t flags;
-    ext4_inode_t inode_data;
-} file_t;
+    uint16_t magic;
+    uint16_t entries;
+    uint16_t max;
+    uint16_t depth;
+    uint32_t generation;
+} ext4_extent_header_t;
 
 typedef struct {
-    uint32_t inode;
-    char name[MAX_FILENAME];
-    file_t* files;
-    uint32_t file_count;
-} directory_t;
+    uint32_t block;
+    uint32_t leaf_lo;
+    uint16_t leaf_hi;
+    uint16_t unused;
+} ext4_extent_idx_t;
+
+typedef struct {
+    uint32_t block;
+    uint16_t len;
+    uint16_t start_hi;
+    uint32_t start_lo;
+} ext4_extent_t;
+
+// Index HTree: le bloc 0 du répertoire commence par "." et "..", suivis de dx_root_info
+typedef struct {
+    uint32_t reserved_zero;
+    uint8_t hash_version;
+    uint8_t info_length;
+    uint8_t indirect_levels;
+    uint8_t unused_flags;
+} dx_root_info_t;
+
+// La première entrée contient (limit, count) à la place du hachage
+typedef struct {
+    uint32_t hash;
+    uint32_t block;
+} dx_entry_t;
 
 typedef struct {
     char path[MAX_PATH];
     char device[MAX_FILENAME];
+    uint32_t device_id;
     ext4_superblock_t superblock;
     ext4_group_desc_t* group_descriptors;
     uint32_t block_size;
     uint32_t inode_size;
+    uint32_t desc_size;
+    uint8_t hash_version;
     uint32_t blocks_per_group;
     uint32_t inodes_per_group;
     uint32_t group_count;
     bool mounted;
 } mount_t;
 
+// Fichier projetable (lib/mmap.c): identité de l'inode dans le cache de pages
+typedef struct mapping mapping_t;
+
+typedef struct {
+    int32_t (*read_page)(mapping_t* mapping, uint32_t index, void* page);
+    int32_t (*write_page)(mapping_t* mapping, uint32_t index, const void* page);
+    void (*put)(mapping_t* mapping);
+} mapping_operations_t;
+
+struct mapping {
+    const mapping_operations_t* ops;
+    uint32_t page_count;
+};
+
+// Inode en mémoire, partagé par tous les fichiers ouverts qui le désignent
+typedef struct cached_inode {
+    // En premier: un mapping_t* du cache de pages est aussi l'adresse de l'inode
+    mapping_t mapping;
+    mount_t* mount;
+    uint32_t ino;
+    uint32_t refcount;
+    bool dirty;
+    ext4_inode_t data;
+    struct cached_inode* hash_next;
+    // Liste LRU des inodes non référencés
+    struct cached_inode* lru_prev;
+    struct cached_inode* lru_next;
+} cached_inode_t;
+
+typedef struct {
+    cached_inode_t inodes[INODE_CACHE_SIZE];
+    cached_inode_t* hash[INODE_HASH_SIZE];
+    cached_inode_t* lru_head;
+    cached_inode_t* lru_tail;
+    cached_inode_t* free_list;
+    uint32_t used_count;
+} inode_cache_t;
+
+typedef struct {
+    uint32_t last_block;
+    uint32_t window;
+    uint32_t next;
+} readahead_t;
+
+typedef struct {
+    uint32_t inode;
+    uint32_t position;
+    uint32_t flags;
+    cached_inode_t* cached;
+    mount_t* mount;
+    readahead_t readahead;
+    // Dernière série de blocs contigus trouvée: évite de relire les blocs d'indirection
+    uint32_t map_logical;
+    uint32_t map_physical;
+    uint32_t map_count;
+} file_t;
+
+// Lecture d'un répertoire par lots, sans matérialiser ses entrées
+typedef struct {
+    cached_inode_t* cached;
+    mount_t* mount;
+    // Position en octets dans le répertoire; 0 = début
+    uint32_t position;
+} dir_stream_t;
+
+// Entrée d'un lot renvoyé par ext4_readdir(): les entrées se suivent, alignées sur 4 octets
+typedef struct {
+    uint32_t inode;
+    // Taille totale de l'entrée dans le lot
+    uint16_t rec_len;
+    // Type ext4 (0 si le système de fichiers ne l'enregistre pas)
+    uint8_t type;
+    uint8_t name_len;
+    // Nom terminé par '\0'
+    char name[];
+} dirent_t;
+
 typedef struct {
     file_t files[MAX_FILES];
+    // Bit à 1: entrée de files[] ouverte. Une entrée ne bouge pas tant qu'elle est ouverte
+    uint32_t file_used[MAX_FILES / 32];
     uint32_t file_count;
-    directory_t directories[MAX_DIRS];
-    uint32_t directory_count;
     mount_t mounts[MAX_MOUNTS];
     uint32_t mount_count;
 } filesystem_t;
 
+typedef struct {
+    uint32_t id;
+    char name[32];
+} device_t;
+
+typedef struct buffer {
+    uint32_t device;
+    uint32_t block;
+    uint32_t size;
+    uint8_t* data;
+} buffer_t;
+
 static filesystem_t filesystem;
+static inode_cache_t inode_cache;
+
+// Déclarations externes (lib/device_manager.c, lib/buffer_cache.c)
+extern device_t* find_device_by_name(const char* name);
+extern device_t* get_disk_device();
+extern buffer_t* bcache_read(uint32_t device, uint32_t block, uint32_t size);
+extern void bcache_release(buffer_t* buffer);
+extern void bcache_mark_dirty(buffer_t* buffer);
+extern bool bcache_read_bytes(uint32_t device, uint32_t block_size, uint64_t offset, void* out, uint32_t size);
+extern void bcache_invalidate(uint32_t device);
+extern uint32_t bcache_prefetch(uint32_t device, uint32_t block, uint32_t count, uint32_t size);
+extern uint32_t readahead_update(readahead_t* ra, uint32_t block, uint32_t block_size, uint32_t block_count, uint32_t* start);
+
+// Déclarations externes (lib/dcache.c)
+extern bool dcache_lookup(uint32_t device, uint32_t parent, const char* name, uint32_t* inode);
+extern void dcache_add(uint32_t device, uint32_t parent, const char* name, uint32_t inode);
+extern void dcache_invalidate(uint32_t device);
+extern void dcache_invalidate_directory(uint32_t device, uint32_t parent);
+
+// Points de traçage (lib/trace.c)
+typedef enum {
+    TRACE_VFS_OPEN,
+    TRACE_VFS_READ,
+    TRACE_VFS_WRITE,
+    TRACE_VFS_FSYNC,
+    TRACE_FS_PATH_WALK,
+    TRACE_FS_INODE_READ,
+    TRACE_FS_INDIRECT_READ,
+    TRACE_FS_DATA_READ,
+    TRACE_BLOCK_READ,
+    TRACE_BLOCK_WRITE,
+    TRACE_EVENT_COUNT
+} trace_event_t;
+
+// Tables d'opérations de la couche VFS (lib/vfs.c)
+typedef struct {
+    void* (*mount)(const char* path, const char* device);
+    void (*unmount)(void* mount);
+    bool (*sync)(void* mount);
+} vfs_super_operations_t;
+
+typedef struct {
+    void* (*open)(void* mount, const char* path, uint32_t flags);
+    void* (*opendir)(void* mount, const char* path);
+    int (*reflink)(void* mount, const char* source, const char* target);
+} vfs_inode_operations_t;
+
+typedef struct {
+    int32_t (*read)(void* file, void* buffer, uint32_t size);
+    int32_t (*write)(void* file, const void* buffer, uint32_t size);
+    int (*fsync)(void* file);
+    void (*release)(void* file);
+    mapping_t* (*mapping)(void* file);
+    uint32_t (*tell)(void* file);
+    void (*seek)(void* file, uint32_t position);
+    int32_t (*readdir)(void* dir, void* buffer, uint32_t size);
+    uint32_t (*telldir)(void* dir);
+    void (*seekdir)(void* dir, uint32_t position);
+    void (*closedir)(void* dir);
+} vfs_file_operations_t;
+
+// Déclarations externes (lib/mmap.c, lib/vfs.c, lib/trace.c)
+extern void page_cache_write(mapping_t* mapping, uint32_t offset, const void* data, uint32_t size);
+extern bool page_cache_invalidate(mapping_t* mapping);
+extern bool bcache_sync(uint32_t device);
+extern bool vfs_register_filesystem(const char* name, const vfs_super_operations_t* super_ops,
+                                    const vfs_inode_operations_t* inode_ops, const vfs_file_operations_t* file_ops);
+extern uint64_t trace_begin();
+extern void trace_end(trace_event_t event, uint32_t device, uint64_t start, uint32_t arg);
+
+static void inode_writeback(void* data);
+static const vfs_super_operations_t ext4_super_operations;
+static const vfs_inode_operations_t ext4_inode_operations;
+static const vfs_file_operations_t ext4_file_operations;
+static const mapping_operations_t ext4_mapping_operations;
 
 void init_filesystem() {
     memset(&filesystem, 0, sizeof(filesystem_t));
+    memset(&inode_cache, 0, sizeof(inode_cache_t));
+    vfs_register_filesystem("ext4", &ext4_super_operations, &ext4_inode_operations, &ext4_file_operations);
+    create_callback("inode-writeback", INODE_WRITEBACK_INTERVAL, inode_writeback, NULL);
 }
 
-bool mount_filesystem(const char* path, const char* device) {
-    if (filesystem.mount_count >= MAX_MOUNTS) return false;
+static void* ext4_mount(const char* path, const char* device) {
+    // Les inodes en cache et les fichiers ouverts pointent sur leur mount_t: on réutilise un emplacement libre
+    mount_t* mount = NULL;
+    for (uint32_t i = 0; i < MAX_MOUNTS; i++) {
+        if (!filesystem.mounts[i].mounted) {
+            mount = &filesystem.mounts[i];
+            break;
+        }
+    }
+    if (!mount) return NULL;
+
+    // Sans nom de périphérique, le disque principal; un nom inconnu est une erreur
+    device_t* dev = (device && device[0]) ? find_device_by_name(device) : get_disk_device();
+    if (!dev) return NULL;
 
-    mount_t* mount = &filesystem.mounts[filesystem.mount_count++];
+    memset(mount, 0, sizeof(mount_t));
     strncpy(mount->path, path, sizeof(mount->path) - 1);
     strncpy(mount->device, device, sizeof(mount->device) - 1);
+    mount->device_id = dev->id;
 
-    uint8_t* superblock_data = (uint8_t*)kmalloc(BLOCK_SIZE);
-    if (!superblock_data) return false;
-
-    if (read_device(0, superblock_data, BLOCK_SIZE) != BLOCK_SIZE) {
-        kfree(superblock_data);
-        return false;
+    // Le superblock est toujours à l'octet 1024, quelle que soit la taille de bloc
+    if (!bcache_read_bytes(mount->device_id, 1024, 1024, &mount->superblock, sizeof(ext4_superblock_t))) {
+        return NULL;
     }
 
-    memcpy(&mount->superblock, superblock_data, sizeof(ext4_superblock_t));
-    kfree(superblock_data);
-
-    if (mount->superblock.magic != 0xEF53) return false;
+    if (mount->superblock.magic != EXT4_SUPER_MAGIC) return NULL;
 
     mount->block_size = 1024 << mount->superblock.log_block_size;
-    mount->inode_size = mount->superblock.inode_size;
+    mount->inode_size = mount->superblock.rev_level ? mount->superblock.inode_size : 128;
+    mount->desc_size = sizeof(ext4_group_desc_t);
+    if ((mount->superblock.feature_incompat & EXT4_FEATURE_INCOMPAT_64BIT) &&
+        mount->superblock.desc_size > sizeof(ext4_group_desc_t)) {
+        mount->desc_size = mount->superblock.desc_size;
+    }
+    mount->hash_version = mount->superblock.def_hash_version;
+    if (mount->superblock.flags & EXT4_FLAGS_UNSIGNED_HASH) {
+        mount->hash_version += DX_HASH_UNSIGNED_DELTA;
+    }
     mount->blocks_per_group = mount->superblock.blocks_per_group;
     mount->inodes_per_group = mount->superblock.inodes_per_group;
     mount->group_count = (mount->superblock.blocks_count + mount->blocks_per_group - 1) / mount->blocks_per_group;
 
     mount->group_descriptors = (ext4_group_desc_t*)kmalloc(mount->group_count * sizeof(ext4_group_desc_t));
-    if (!mount->group_descriptors) return false;
+    if (!mount->group_descriptors) return NULL;
 
-    uint32_t group_desc_block = mount->superblock.first_data_block + 1;
-    uint32_t group_desc_size = mount->group_count * sizeof(ext4_group_desc_t);
-    uint32_t group_desc_blocks = (group_desc_size + mount->block_size - 1) / mount->block_size;
-
-    for (uint32_t i = 0; i < group_desc_blocks; i++) {
-        uint8_t* block_data = (uint8_t*)kmalloc(mount->block_size);
-        if (!block_data) {
+    // Avec la fonction 64bit les descripteurs font desc_size octets; seuls les 32 premiers sont gardés
+    uint64_t group_desc_offset = (uint64_t)(mount->superblock.first_data_block + 1) * mount->block_size;
+    for (uint32_t group = 0; group < mount->group_count; group++) {
+        if (!bcache_read_bytes(mount->device_id, mount->block_size, group_desc_offset + group * mount->desc_size,
+                               &mount->group_descriptors[group], sizeof(ext4_group_desc_t))) {
             kfree(mount->group_descriptors);
-            return false;
+            return NULL;
         }
+    }
 
-        if (read_device(0, block_data, mount->block_size) != mount->block_size) {
-            kfree(block_data);
-            kfree(mount->group_descriptors);
-            return false;
-        }
+    mount->mounted = true;
+    filesystem.mount_count++;
+    return mount;
+}
 
-        memcpy((uint8_t*)mount->group_descriptors + i * mount->block_size,
-               block_data,
-               i == group_desc_blocks - 1 ? group_desc_size % mount->block_size : mount->block_size);
+static void invalidate_inodes(mount_t* mount);
 
-        kfree(block_data);
-    }
+static void ext4_unmount(void* private) {
+    mount_t* mount = (mount_t*)private;
+    invalidate_inodes(mount);
+    dcache_invalidate(mount->device_id);
+    bcache_invalidate(mount->device_id);
+    kfree(mount->group_descriptors);
+    mount->mounted = false;
+    filesystem.mount_count--;
+}
 
-    mount->mounted = true;
+// Localiser un inode dans la table d'inodes de son groupe
+static buffer_t* read_inode_block(mount_t* mount, uint32_t ino, uint32_t* offset) {
+    uint32_t group = (ino - 1) / mount->inodes_per_group;
+    uint32_t index = (ino - 1) % mount->inodes_per_group;
+    if (group >= mount->group_count) return NULL;
+
+    uint32_t block = mount->group_descriptors[group].inode_table + (index * mount->inode_size) / mount->block_size;
+    *offset = (index * mount->inode_size) % mount->block_size;
+    return bcache_read(mount->device_id, block, mount->block_size);
+}
+
+static bool read_inode(mount_t* mount, uint32_t ino, ext4_inode_t* inode) {
+    uint64_t start = trace_begin();
+    uint32_t offset;
+    buffer_t* buffer = read_inode_block(mount, ino, &offset);
+    if (!buffer) return false;
+
+    memcpy(inode, buffer->data + offset, sizeof(ext4_inode_t));
+    bcache_release(buffer);
+    trace_end(TRACE_FS_INODE_READ, mount->device_id, start, ino);
     return true;
 }
 
-void unmount_filesystem(const char* path) {
-    for (uint32_t i = 0; i < filesystem.mount_count; i++) {
-        if (strcmp(filesystem.mounts[i].path, path) == 0) {
-            mount_t* mount = &filesystem.mounts[i];
-            kfree(mount->group_descriptors);
-            mount->mounted = false;
-            filesystem.mounts[i] = filesystem.mounts[--filesystem.mount_count];
-            break;
-        }
+static bool write_inode(mount_t* mount, uint32_t ino, const ext4_inode_t* inode) {
+    uint32_t offset;
+    buffer_t* buffer = read_inode_block(mount, ino, &offset);
+    if (!buffer) return false;
+
+    memcpy(buffer->data + offset, inode, sizeof(ext4_inode_t));
+    bcache_mark_dirty(buffer);
+    bcache_release(buffer);
+    return true;
+}
+
+static uint32_t inode_hash(mount_t* mount, uint32_t ino) {
+    uint32_t key = ino * 0x9E3779B1 ^ mount->device_id;
+    return (key ^ (key >> 16)) & (INODE_HASH_SIZE - 1);
+}
+
+static void inode_lru_remove(cached_inode_t* inode) {
+    if (inode->lru_prev) inode->lru_prev->lru_next = inode->lru_next;
+    else inode_cache.lru_head = inode->lru_next;
+    if (inode->lru_next) inode->lru_next->lru_prev = inode->lru_prev;
+    else inode_cache.lru_tail = inode->lru_prev;
+    inode->lru_prev = inode->lru_next = NULL;
+}
+
+static void inode_lru_push(cached_inode_t* inode) {
+    inode->lru_prev = NULL;
+    inode->lru_next = inode_cache.lru_head;
+    if (inode_cache.lru_head) inode_cache.lru_head->lru_prev = inode;
+    else inode_cache.lru_tail = inode;
+    inode_cache.lru_head = inode;
+}
+
+static void inode_hash_remove(cached_inode_t* inode) {
+    cached_inode_t** link = &inode_cache.hash[inode_hash(inode->mount, inode->ino)];
+    while (*link && *link != inode) {
+        link = &(*link)->hash_next;
     }
+    if (*link) *link = inode->hash_next;
+    inode->hash_next = NULL;
 }
 
-file_t* open_file(const char* path) {
-    if (filesystem.file_count >= MAX_FILES) return NULL;
+// Réécriture paresseuse: l'inode modifié est recopié dans son bloc (lui-même en cache)
+static bool flush_inode(cached_inode_t* inode) {
+    if (!inode->dirty) return true;
+    if (!write_inode(inode->mount, inode->ino, &inode->data)) return false;
+    inode->dirty = false;
+    return true;
+}
 
-    char mount_path[MAX_PATH];
-    char relative_path[MAX_PATH];
-    mount_t* mount = NULL;
+// Obtenir l'inode en mémoire, en le lisant au besoin; à rendre par iput()
+static cached_inode_t* iget(mount_t* mount, uint32_t ino) {
+    cached_inode_t* inode = inode_cache.hash[inode_hash(mount, ino)];
+    while (inode) {
+        if (inode->mount == mount && inode->ino == ino) {
+            if (inode->refcount++ == 0) inode_lru_remove(inode);
+            return inode;
+        }
+        inode = inode->hash_next;
+    }
 
-    for (uint32_t i = 0; i < filesystem.mount_count; i++) {
-        if (strncmp(path, filesystem.mounts[i].path, strlen(filesystem.mounts[i].path)) == 0) {
-            mount = &filesystem.mounts[i];
-            strncpy(mount_path, mount->path, sizeof(mount_path) - 1);
-            strncpy(relative_path, path + strlen(mount->path), sizeof(relative_path) - 1);
-            break;
+    ext4_inode_t data;
+    if (!read_inode(mount, ino, &data)) return NULL;
+
+    if (inode_cache.free_list) {
+        inode = inode_cache.free_list;
+        inode_cache.free_list = inode->hash_next;
+    } else if (inode_cache.used_count < INODE_CACHE_SIZE) {
+        inode = &inode_cache.inodes[inode_cache.used_count++];
+    } else {
+        // Recycler l'inode non référencé le plus ancien. Ses pages en cache sont indexées par
+        // l'adresse de l'inode: elles sont réécrites et oubliées avant qu'un autre fichier la reprenne.
+        inode = inode_cache.lru_tail;
+        while (inode && (!page_cache_invalidate(&inode->mapping) || !flush_inode(inode))) {
+            inode = inode->lru_prev;
         }
+        if (!inode) return NULL;
+        inode_lru_remove(inode);
+        inode_hash_remove(inode);
     }
 
-    if (!mount || !mount->mounted) return NULL;
+    inode->mount = mount;
+    inode->ino = ino;
+    inode->refcount = 1;
+    inode->dirty = false;
+    memcpy(&inode->data, &data, sizeof(ext4_inode_t));
 
-    char* component = strtok(relative_path, "/");
-    uint32_t current_inode = 2;
+    uint32_t bucket = inode_hash(mount, ino);
+    inode->hash_next = inode_cache.hash[bucket];
+    inode_cache.hash[bucket] = inode;
+    return inode;
+}
 
-    while (component) {
-        bool found = false;
-        uint32_t group = (current_inode - 1) / mount->inodes_per_group;
-        uint32_t index = (current_inode - 1) % mount->inodes_per_group;
-        uint32_t block = mount->group_descriptors[group].inode_table + (index * mount->inode_size) / mount->block_size;
-        uint32_t offset = (index * mount->inode_size) % mount->block_size;
+// Le dernier iput() laisse l'inode en cache, en tête de la liste LRU
+static void iput(cached_inode_t* inode) {
+    if (!inode || inode->refcount == 0) return;
+    if (--inode->refcount == 0) inode_lru_push(inode);
+}
 
-        uint8_t* block_data = (uint8_t*)kmalloc(mount->block_size);
-        if (!block_data) return NULL;
+static void mark_inode_dirty(cached_inode_t* inode) {
+    inode->dirty = true;
+}
 
-        if (read_device(0, block_data, mount->block_size) != mount->block_size) {
-            kfree(block_data);
-            return NULL;
+// Réécrire les inodes modifiés (NULL = tous les montages)
+static void sync_inodes(mount_t* mount) {
+    for (uint32_t i = 0; i < inode_cache.used_count; i++) {
+        cached_inode_t* inode = &inode_cache.inodes[i];
+        if (inode->dirty && inode->mount && (!mount || inode->mount == mount)) {
+            flush_inode(inode);
         }
+    }
+}
 
-        ext4_inode_t* inode = (ext4_inode_t*)(block_data + offset);
-        uint32_t block_count = (inode->size + mount->block_size - 1) / mount->block_size;
-
-        for (uint32_t i = 0; i < block_count; i++) {
-            uint32_t block_number;
-            if (i < 12) {
-                block_number = inode->block[i];
-            } else if (i < 12 + mount->block_size / 4) {
-                uint32_t* indirect_block = (uint32_t*)kmalloc(mount->block_size);
-                if (!indirect_block) {
-                    kfree(block_data);
-                    return NULL;
-                }
-
-                if (read_device(0, indirect_block, mount->block_size) != mount->block_size) {
-                    kfree(indirect_block);
-                    kfree(block_data);
-                    return NULL;
-                }
-
-                block_number = indirect_block[i - 12];
-                kfree(indirect_block);
-            } else {
-                kfree(block_data);
-                return NULL;
-            }
+// Démontage: réécrire puis oublier les inodes du montage.
+// Un inode encore référencé sort seulement de la table: un nouveau montage ne le retrouvera pas.
+static void invalidate_inodes(mount_t* mount) {
+    for (uint32_t i = 0; i < inode_cache.used_count; i++) {
+        cached_inode_t* inode = &inode_cache.inodes[i];
+        if (inode->mount != mount) continue;
+
+        bool pages_dropped = page_cache_invalidate(&inode->mapping);
+        flush_inode(inode);
+        inode->dirty = false;
+        inode_hash_remove(inode);
+        // Pages encore référencées: l'inode reste hors de la liste libre, le recyclage LRU réessaiera
+        if (inode->refcount > 0 || !pages_dropped) continue;
+
+        inode_lru_remove(inode);
+        inode->mount = NULL;
+        inode->hash_next = inode_cache.free_list;
+        inode_cache.free_list = inode;
+    }
+}
 
-            uint8_t* dir_block = (uint8_t*)kmalloc(mount->block_size);
-            if (!dir_block) {
-                kfree(block_data);
-                return NULL;
-            }
+static void inode_writeback(void* data) {
+    (void)data;
+    sync_inodes(NULL);
+}
 
-            if (read_device(0, dir_block, mount->block_size) != mount->block_size) {
-                kfree(dir_block);
-                kfree(block_data);
-                return NULL;
+// Suivre l'arbre d'extents jusqu'à la feuille qui couvre `index` (recherche dichotomique à chaque niveau).
+// *run reçoit le nombre de blocs contigus à partir de `index` dans le même extent.
+static uint32_t extent_map_block(mount_t* mount, const ext4_inode_t* inode, uint32_t index, uint32_t* run) {
+    const ext4_extent_header_t* header = (const ext4_extent_header_t*)inode->block;
+    buffer_t* buffer = NULL;
+    uint32_t block = 0;
+
+    for (uint32_t level = 0; level <= EXT4_MAX_EXTENT_DEPTH; level++) {
+        if (header->magic != EXT4_EXTENT_MAGIC || header->entries == 0) break;
+
+        // Dernière entrée dont le premier bloc logique est <= index
+        uint32_t low = 1, high = header->entries;
+        const uint32_t* first = (const uint32_t*)(header + 1);
+        uint32_t stride = header->depth ? sizeof(ext4_extent_idx_t) : sizeof(ext4_extent_t);
+        while (low < high) {
+            uint32_t middle = (low + high) / 2;
+            if (*(const uint32_t*)((const uint8_t*)first + middle * stride) <= index) low = middle + 1;
+            else high = middle;
+        }
+        const uint8_t* entry = (const uint8_t*)first + (low - 1) * stride;
+
+        if (header->depth == 0) {
+            const ext4_extent_t* extent = (const ext4_extent_t*)entry;
+            uint32_t length = extent->len;
+            // Un extent non initialisé se lit comme un trou
+            if (length > EXT4_EXTENT_INIT_MAX_LEN) break;
+            if (index >= extent->block && index - extent->block < length && !extent->start_hi) {
+                block = extent->start_lo + (index - extent->block);
+                *run = length - (index - extent->block);
             }
+            break;
+        }
 
-            ext4_dir_entry_t* entry = (ext4_dir_entry_t*)dir_block;
-            while ((uint8_t*)entry < dir_block + mount->block_size) {
-                if (entry->inode && entry->name_len == strlen(component) &&
-                    strncmp(entry->name, component, entry->name_len) == 0) {
-                    current_inode = entry->inode;
-                    found = true;
-                    break;
-                }
-                entry = (ext4_dir_entry_t*)((uint8_t*)entry + entry->rec_len);
-            }
+        const ext4_extent_idx_t* idx = (const ext4_extent_idx_t*)entry;
+        if (idx->leaf_hi || idx->block > index) break;
 
-            kfree(dir_block);
-            if (found) break;
-        }
+        uint64_t start = trace_begin();
+        buffer_t* next = bcache_read(mount->device_id, idx->leaf_lo, mount->block_size);
+        trace_end(TRACE_FS_INDIRECT_READ, mount->device_id, start, idx->leaf_lo);
+        if (buffer) bcache_release(buffer);
+        buffer = next;
+        if (!buffer) return 0;
+        header = (const ext4_extent_header_t*)buffer->data;
+    }
 
-        kfree(block_data);
-        if (!found) return NULL;
+    if (buffer) bcache_release(buffer);
+    return block;
+}
 
-        component = strtok(NULL, "/");
+// Longueur de la série de numéros consécutifs à partir de entries[index]
+static uint32_t count_run(const uint32_t* entries, uint32_t index, uint32_t limit) {
+    uint32_t run = 1;
+    while (index + run < limit && entries[index + run] == entries[index] + run) {
+        run++;
     }
+    return run;
+}
 
-    file_t* file = &filesystem.files[filesystem.file_count++];
-    file->inode = current_inode;
-    file->position = 0;
-    file->size = 0;
-    file->flags = 0;
+static uint32_t read_block_entry(mount_t* mount, uint32_t block, uint32_t index, uint32_t* run) {
+    if (!block) return 0;
+
+    uint64_t start = trace_begin();
+    buffer_t* buffer = bcache_read(mount->device_id, block, mount->block_size);
+    trace_end(TRACE_FS_INDIRECT_READ, mount->device_id, start, block);
+    if (!buffer) return 0;
+    uint32_t* entries = (uint32_t*)buffer->data;
+    uint32_t entry = entries[index];
+    if (entry && run) *run = count_run(entries, index, mount->block_size / 4);
+    bcache_release(buffer);
+    return entry;
+}
 
-    uint32_t group = (current_inode - 1) / mount->inodes_per_group;
-    uint32_t index = (current_inode - 1) % mount->inodes_per_group;
-    uint32_t block = mount->group_descriptors[group].inode_table + (index * mount->inode_size) / mount->block_size;
-    uint32_t offset = (index * mount->inode_size) % mount->block_size;
+// Numéro physique du bloc logique `index`: extents, ou blocs directs et simple/double/triple indirection.
+// *run reçoit le nombre de blocs physiquement contigus qui suivent dans le même nœud.
+static uint32_t map_inode_run(mount_t* mount, const ext4_inode_t* inode, uint32_t index, uint32_t* run) {
+    *run = 1;
+    if (inode->flags & EXT4_EXTENTS_FL) return extent_map_block(mount, inode, index, run);
 
-    uint8_t* block_data = (uint8_t*)kmalloc(mount->block_size);
-    if (!block_data) return NULL;
+    if (index < 12) {
+        if (inode->block[index]) *run = count_run(inode->block, index, 12);
+        return inode->block[index];
+    }
 
-    if (read_device(0, block_data, mount->block_size) != mount->block_size) {
-        kfree(block_data);
-        return NULL;
+    uint32_t per_block = mount->block_size / 4;
+    index -= 12;
+    if (index < per_block) return read_block_entry(mount, inode->block[12], index, run);
+
+    index -= per_block;
+    if (index < per_block * per_block) {
+        uint32_t indirect = read_block_entry(mount, inode->block[13], index / per_block, NULL);
+        return read_block_entry(mount, indirect, index % per_block, run);
     }
 
-    memcpy(&file->inode_data, block_data + offset, sizeof(ext4_inode_t));
-    file->size = file->inode_data.size;
+    index -= per_block * per_block;
+    uint32_t double_indirect = read_block_entry(mount, inode->block[14], index / (per_block * per_block), NULL);
+    uint32_t indirect = read_block_entry(mount, double_indirect, (index / per_block) % per_block, NULL);
+    return read_block_entry(mount, indirect, index % per_block, run);
+}
 
-    kfree(block_data);
-    return file;
+static uint32_t get_inode_block(mount_t* mount, const ext4_inode_t* inode, uint32_t index) {
+    uint32_t run;
+    return map_inode_run(mount, inode, index, &run);
 }
 
-void close_file(file_t* file) {
-    if (!file) return;
-    for (uint32_t i = 0; i < filesystem.file_count; i++) {
-        if (&filesystem.files[i] == file) {
-            filesystem.files[i] = filesystem.files[--filesystem.file_count];
+// Chercher `name` dans un bloc de répertoire; renvoie le numéro d'inode ou 0
+static uint32_t find_in_block(mount_t* mount, uint32_t block, const char* name, uint32_t name_len) {
+    buffer_t* buffer = bcache_read(mount->device_id, block, mount->block_size);
+    if (!buffer) return 0;
+
+    uint32_t ino = 0;
+    uint8_t* end = buffer->data + mount->block_size;
+    ext4_dir_entry_t* entry = (ext4_dir_entry_t*)buffer->data;
+    while ((uint8_t*)entry < end && entry->rec_len) {
+        if (entry->inode && entry->name_len == name_len &&
+            strncmp(entry->name, name, name_len) == 0) {
+            ino = entry->inode;
             break;
         }
+        entry = (ext4_dir_entry_t*)((uint8_t*)entry + entry->rec_len);
     }
+
+    bcache_release(buffer);
+    return ino;
 }
 
-int32_t read_file(file_t* file, void* buffer, uint32_t size) {
-    if (!file || !buffer || !size) return -1;
+// Fonctions de hachage des noms de l'index HTree (mêmes valeurs que ext3/ext4)
+static uint32_t dx_hack_hash(const char* name, uint32_t len, bool is_unsigned) {
+    uint32_t hash, hash0 = 0x12A3FE2D, hash1 = 0x37ABE8F9;
+    for (uint32_t i = 0; i < len; i++) {
+        int c = is_unsigned ? (int)(uint8_t)name[i] : (int)(int8_t)name[i];
+        hash = hash1 + (hash0 ^ (uint32_t)(c * 7152373));
+        if (hash & 0x80000000) hash -= 0x7FFFFFFF;
+        hash1 = hash0;
+        hash0 = hash;
+    }
+    return hash0 << 1;
+}
 
-    mount_t* mount = NULL;
-    for (uint32_t i = 0; i < filesystem.mount_count; i++) {
-        if (filesystem.mounts[i].mounted) {
-            mount = &filesystem.mounts[i];
-            break;
+static void str2hashbuf(const char* msg, uint32_t len, uint32_t* buf, int num, bool is_unsigned) {
+    uint32_t pad = len | (len << 8);
+    pad |= pad << 16;
+
+    uint32_t val = pad;
+    if (len > (uint32_t)num * 4) len = num * 4;
+    for (uint32_t i = 0; i < len; i++) {
+        int c = is_unsigned ? (int)(uint8_t)msg[i] : (int)(int8_t)msg[i];
+        val = (uint32_t)c + (val << 8);
+        if ((i % 4) == 3) {
+            *buf++ = val;
+            val = pad;
+            num--;
         }
     }
+    if (--num >= 0) *buf++ = val;
+    while (--num >= 0) *buf++ = pad;
+}
 
-    if (!mount) return -1;
+static inline uint32_t rol32(uint32_t value, uint32_t shift) {
+    return (value << shift) | (value >> (32 - shift));
+}
 
-    uint32_t bytes_read = 0;
-    while (bytes_read < size && file->position < file->size) {
-        uint32_t block_index = file->position / mount->block_size;
-        uint32_t block_offset = file->position % mount->block_size;
-        uint32_t bytes_to_read = mount->block_size - block_offset;
-        if (bytes_to_read > size - bytes_read) bytes_to_read = size - bytes_read;
-        if (bytes_to_read > file->size - file->position) bytes_to_read = file->size - file->position;
-
-        uint32_t block_number;
-        if (block_index < 12) {
-            block_number = file->inode_data.block[block_index];
-        } else if (block_index < 12 + mount->block_size / 4) {
-            uint32_t* indirect_block = (uint32_t*)kmalloc(mount->block_size);
-            if (!indirect_block) return bytes_read;
-
-            if (read_device(0, indirect_block, mount->block_size) != mount->block_size) {
-                kfree(indirect_block);
-                return bytes_read;
+#define MD4_F(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
+#define MD4_G(x, y, z) (((x) & (y)) + (((x) ^ (y)) & (z)))
+#define MD4_H(x, y, z) ((x) ^ (y) ^ (z))
+#define MD4_ROUND(f, a, b, c, d, x, s) (a += f(b, c, d) + (x), a = rol32(a, s))
+#define MD4_K2 013240474631u
+#define MD4_K3 015666365641u
+
+static void half_md4_transform(uint32_t buf[4], const uint32_t in[8]) {
+    uint32_t a = buf[0], b = buf[1], c = buf[2], d = buf[3];
+
+    MD4_ROUND(MD4_F, a, b, c, d, in[0], 3);
+    MD4_ROUND(MD4_F, d, a, b, c, in[1], 7);
+    MD4_ROUND(MD4_F, c, d, a, b, in[2], 11);
+    MD4_ROUND(MD4_F, b, c, d, a, in[3], 19);
+    MD4_ROUND(MD4_F, a, b, c, d, in[4], 3);
+    MD4_ROUND(MD4_F, d, a, b, c, in[5], 7);
+    MD4_ROUND(MD4_F, c, d, a, b, in[6], 11);
+    MD4_ROUND(MD4_F, b, c, d, a, in[7], 19);
+
+    MD4_ROUND(MD4_G, a, b, c, d, in[1] + MD4_K2, 3);
+    MD4_ROUND(MD4_G, d, a, b, c, in[3] + MD4_K2, 5);
+    MD4_ROUND(MD4_G, c, d, a, b, in[5] + MD4_K2, 9);
+    MD4_ROUND(MD4_G, b, c, d, a, in[7] + MD4_K2, 13);
+    MD4_ROUND(MD4_G, a, b, c, d, in[0] + MD4_K2, 3);
+    MD4_ROUND(MD4_G, d, a, b, c, in[2] + MD4_K2, 5);
+    MD4_ROUND(MD4_G, c, d, a, b, in[4] + MD4_K2, 9);
+    MD4_ROUND(MD4_G, b, c, d, a, in[6] + MD4_K2, 13);
+
+    MD4_ROUND(MD4_H, a, b, c, d, in[3] + MD4_K3, 3);
+    MD4_ROUND(MD4_H, d, a, b, c, in[7] + MD4_K3, 9);
+    MD4_ROUND(MD4_H, c, d, a, b, in[2] + MD4_K3, 11);
+    MD4_ROUND(MD4_H, b, c, d, a, in[6] + MD4_K3, 15);
+    MD4_ROUND(MD4_H, a, b, c, d, in[1] + MD4_K3, 3);
+    MD4_ROUND(MD4_H, d, a, b, c, in[5] + MD4_K3, 9);
+    MD4_ROUND(MD4_H, c, d, a, b, in[0] + MD4_K3, 11);
+    MD4_ROUND(MD4_H, b, c, d, a, in[4] + MD4_K3, 15);
+
+    buf[0] += a;
+    buf[1] += b;
+    buf[2] += c;
+    buf[3] += d;
+}
+
+static void tea_transform(uint32_t buf[4], const uint32_t in[4]) {
+    uint32_t sum = 0;
+    uint32_t b0 = buf[0], b1 = buf[1];
+    for (int n = 0; n < 16; n++) {
+        sum += 0x9E3779B9;
+        b0 += ((b1 << 4) + in[0]) ^ (b1 + sum) ^ ((b1 >> 5) + in[1]);
+        b1 += ((b0 << 4) + in[2]) ^ (b0 + sum) ^ ((b0 >> 5) + in[3]);
+    }
+    buf[0] += b0;
+    buf[1] += b1;
+}
+
+static uint32_t dx_hash(mount_t* mount, const char* name, uint32_t len) {
+    uint32_t buf[4] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476 };
+    const uint32_t* seed = mount->superblock.hash_seed;
+    if (seed[0] || seed[1] || seed[2] || seed[3]) {
+        memcpy(buf, seed, sizeof(buf));
+    }
+
+    uint8_t version = mount->hash_version;
+    bool is_unsigned = version >= DX_HASH_UNSIGNED_DELTA;
+    if (is_unsigned) version -= DX_HASH_UNSIGNED_DELTA;
+
+    uint32_t hash;
+    uint32_t in[8];
+    switch (version) {
+        case DX_HASH_HALF_MD4:
+            for (int32_t remaining = len; remaining > 0; remaining -= 32, name += 32) {
+                str2hashbuf(name, remaining, in, 8, is_unsigned);
+                half_md4_transform(buf, in);
+            }
+            hash = buf[1];
+            break;
+        case DX_HASH_TEA:
+            for (int32_t remaining = len; remaining > 0; remaining -= 16, name += 16) {
+                str2hashbuf(name, remaining, in, 4, is_unsigned);
+                tea_transform(buf, in);
             }
+            hash = buf[0];
+            break;
+        default:
+            hash = dx_hack_hash(name, len, is_unsigned);
+            break;
+    }
 
-            block_number = indirect_block[block_index - 12];
-            kfree(indirect_block);
-        } else {
-            return bytes_read;
+    hash &= ~1u;
+    if (hash == 0xFFFFFFFE) hash = 0xFFFFFFFC;
+    return hash;
+}
+
+// Dernière entrée d'index dont le hachage est <= hash
+static dx_entry_t* dx_search(dx_entry_t* entries, uint32_t count, uint32_t hash) {
+    uint32_t low = 1, high = count;
+    while (low < high) {
+        uint32_t middle = (low + high) / 2;
+        if (entries[middle].hash <= hash) low = middle + 1;
+        else high = middle;
+    }
+    return &entries[low - 1];
+}
+
+// Recherche par l'index HTree: un bloc par niveau, puis la feuille (et ses suites en cas de collision).
+// Renvoie false si l'index est inutilisable, pour repasser en recherche linéaire.
+static bool dx_find(mount_t* mount, const ext4_inode_t* dir, const char* name, uint32_t name_len, uint32_t* ino) {
+    uint32_t root_block = get_inode_block(mount, dir, 0);
+    if (!root_block) return false;
+
+    buffer_t* buffer = bcache_read(mount->device_id, root_block, mount->block_size);
+    if (!buffer) return false;
+
+    dx_root_info_t* info = (dx_root_info_t*)(buffer->data + 24);
+    if (info->reserved_zero || info->indirect_levels >= DX_MAX_LEVELS || info->info_length != 8) {
+        bcache_release(buffer);
+        return false;
+    }
+
+    uint32_t hash = dx_hash(mount, name, name_len);
+    uint32_t levels = info->indirect_levels;
+    dx_entry_t* entries = (dx_entry_t*)(buffer->data + 24 + info->info_length);
+
+    for (;;) {
+        uint16_t limit = entries[0].hash & 0xFFFF;
+        uint16_t count = entries[0].hash >> 16;
+        if (count == 0 || count > limit) {
+            bcache_release(buffer);
+            return false;
         }
 
-        uint8_t* block_data = (uint8_t*)kmalloc(mount->block_size);
-        if (!block_data) return bytes_read;
+        dx_entry_t* at = dx_search(entries, count, hash);
+        uint32_t logical = at->block & 0x0FFFFFFF;
 
-        if (read_device(0, block_data, mount->block_size) != mount->block_size) {
-            kfree(block_data);
-            return bytes_read;
+        if (levels == 0) {
+            // Les noms de même hachage peuvent déborder sur le bloc suivant (bit 0 du hachage)
+            *ino = 0;
+            for (;;) {
+                uint32_t leaf = get_inode_block(mount, dir, logical);
+                if (leaf) *ino = find_in_block(mount, leaf, name, name_len);
+                if (*ino) break;
+
+                at++;
+                if (at >= entries + count || (at->hash & ~1u) != hash || !(at->hash & 1)) break;
+                logical = at->block & 0x0FFFFFFF;
+            }
+            bcache_release(buffer);
+            return true;
         }
 
-        memcpy((uint8_t*)buffer + bytes_read, block_data + block_offset, bytes_to_read);
-        kfree(block_data);
+        uint32_t node = get_inode_block(mount, dir, logical);
+        bcache_release(buffer);
+        if (!node) return false;
 
-        bytes_read += bytes_to_read;
-        file->position += bytes_to_read;
+        buffer = bcache_read(mount->device_id, node, mount->block_size);
+        if (!buffer) return false;
+        // Un nœud interne commence par une entrée vide couvrant tout le bloc
+        entries = (dx_entry_t*)(buffer->data + 8);
+        levels--;
+    }
+}
+
+// Chercher `name` dans un répertoire; renvoie le numéro d'inode ou 0
+static uint32_t find_in_directory(mount_t* mount, const ext4_inode_t* dir, const char* name) {
+    uint32_t name_len = strlen(name);
+    uint32_t ino;
+
+    if ((dir->flags & EXT4_INDEX_FL) &&
+        (mount->superblock.feature_compat & EXT4_FEATURE_COMPAT_DIR_INDEX) &&
+        dx_find(mount, dir, name, name_len, &ino)) {
+        return ino;
     }
 
-    return bytes_read;
+    uint32_t block_count = (dir->size + mount->block_size - 1) / mount->block_size;
+    for (uint32_t i = 0; i < block_count; i++) {
+        uint32_t block = get_inode_block(mount, dir, i);
+        if (!block) continue;
+
+        ino = find_in_block(mount, block, name, name_len);
+        if (ino) return ino;
+    }
+    return 0;
 }
 
-int32_t write_file(file_t* file, const void* buffer, uint32_t size) {
-    if (!file || !buffer || !size) return -1;
+// Résoudre un chemin relatif au point de montage, depuis la racine (inode 2)
+static uint32_t lookup_path(mount_t* mount, const char* relative) {
+    char path[MAX_PATH];
+    strncpy(path, relative, sizeof(path) - 1);
+    path[sizeof(path) - 1] = '\0';
 
-    mount_t* mount = NULL;
-    for (uint32_t i = 0; i < filesystem.mount_count; i++) {
-        if (filesystem.mounts[i].mounted) {
-            mount = &filesystem.mounts[i];
-            break;
+    uint32_t current_inode = 2;
+    char* component = strtok(path, "/");
+    while (component) {
+        uint32_t next_inode;
+
+        // Le cache de dentries évite de relire l'inode et les blocs du répertoire
+        if (!dcache_lookup(mount->device_id, current_inode, component, &next_inode)) {
+            cached_inode_t* dir = iget(mount, current_inode);
+            if (!dir) return 0;
+
+            next_inode = find_in_directory(mount, &dir->data, component);
+            iput(dir);
+            dcache_add(mount->device_id, current_inode, component, next_inode);
         }
+
+        current_inode = next_inode;
+        if (!current_inode) return 0;
+
+        component = strtok(NULL, "/");
     }
+    return current_inode;
+}
 
-    if (!mount) return -1;
+// Plus petite entrée libre de files[], -1 si toutes sont ouvertes
+static int find_free_file() {
+    for (uint32_t i = 0; i < MAX_FILES / 32; i++) {
+        if (filesystem.file_used[i] != 0xFFFFFFFF) {
+            return i * 32 + __builtin_ctz(~filesystem.file_used[i]);
+        }
+    }
+    return -1;
+}
 
-    uint32_t bytes_written = 0;
-    while (bytes_written < size) {
-        uint32_t block_index = file->position / mount->block_size;
-        uint32_t block_offset = file->position % mount->block_size;
-        uint32_t bytes_to_write = mount->block_size - block_offset;
-        if (bytes_to_write > size - bytes_written) bytes_to_write = size - bytes_written;
+static void* ext4_open(void* private, const char* relative, uint32_t flags) {
+    mount_t* mount = (mount_t*)private;
+    // Ni création ni troncature: seuls les fichiers existants s'ouvrent, tels quels
+    if (flags & (O_CREAT | O_TRUNC)) return NULL;
+    int slot = find_free_file();
+    if (slot < 0) return NULL;
+
+    uint64_t start = trace_begin();
+    uint32_t ino = lookup_path(mount, relative);
+    trace_end(TRACE_FS_PATH_WALK, mount->device_id, start, ino);
+    if (!ino) return NULL;
+
+    cached_inode_t* cached = iget(mount, ino);
+    if (!cached) return NULL;
+
+    filesystem.file_used[slot / 32] |= 1u << (slot % 32);
+    filesystem.file_count++;
+    file_t* file = &filesystem.files[slot];
+    memset(file, 0, sizeof(file_t));
+    file->inode = ino;
+    file->cached = cached;
+    file->mount = mount;
+    return file;
+}
 
-        uint32_t block_number;
-        if (block_index < 12) {
-            if (file->inode_data.block[block_index] == 0) {
-                uint32_t group = (file->inode - 1) / mount->inodes_per_group;
-                uint32_t* block_bitmap = (uint32_t*)kmalloc(mount->block_size);
-                if (!block_bitmap) return bytes_written;
+static void ext4_release(void* object) {
+    file_t* file = (file_t*)object;
+    if (file < filesystem.files || file >= filesystem.files + MAX_FILES) return;
 
-                if (read_device(0, block_bitmap, mount->block_size) != mount->block_size) {
-                    kfree(block_bitmap);
-                    return bytes_written;
-                }
+    uint32_t slot = file - filesystem.files;
+    if (!(filesystem.file_used[slot / 32] & (1u << (slot % 32)))) return;
 
-                for (uint32_t i = 0; i < mount->block_size * 8; i++) {
-                    if (!(block_bitmap[i / 32] & (1 << (i % 32)))) {
-                        block_bitmap[i / 32] |= 1 << (i % 32);
-                        file->inode_data.block[block_index] = mount->group_descriptors[group].block_bitmap * mount->block_size + i;
-                        break;
-                    }
-                }
+    iput(file->cached);
+    memset(file, 0, sizeof(file_t));
+    filesystem.file_used[slot / 32] &= ~(1u << (slot % 32));
+    filesystem.file_count--;
+}
 
-                if (write_device(0, block_bitmap, mount->block_size) != mount->block_size) {
-                    kfree(block_bitmap);
-                    return bytes_written;
-                }
+static uint32_t ext4_tell(void* object) {
+    return ((file_t*)object)->position;
+}
 
-                kfree(block_bitmap);
-            }
-            block_number = file->inode_data.block[block_index];
-        } else if (block_index < 12 + mount->block_size / 4) {
-            uint32_t* indirect_block = (uint32_t*)kmalloc(mount->block_size);
-            if (!indirect_block) return bytes_written;
-
-            if (read_device(0, indirect_block, mount->block_size) != mount->block_size) {
-                kfree(indirect_block);
-                return bytes_written;
-            }
+static void ext4_seek(void* object, uint32_t position) {
+    ((file_t*)object)->position = position;
+}
 
-            if (indirect_block[block_index - 12] == 0) {
-                uint32_t group = (file->inode - 1) / mount->inodes_per_group;
-                uint32_t* block_bitmap = (uint32_t*)kmalloc(mount->block_size);
-                if (!block_bitmap) {
-                    kfree(indirect_block);
-                    return bytes_written;
-                }
+// Bloc physique d'un bloc logique du fichier, à travers la série mémorisée dans file_t
+static uint32_t map_file_block(file_t* file, uint32_t index) {
+    if (index >= file->map_logical && index - file->map_logical < file->map_count) {
+        return file->map_physical + (index - file->map_logical);
+    }
 
-                if (read_device(0, block_bitmap, mount->block_size) != mount->block_size) {
-                    kfree(block_bitmap);
-                    kfree(indirect_block);
-                    return bytes_written;
-                }
+    uint32_t run;
+    uint32_t block = map_inode_run(file->mount, &file->cached->data, index, &run);
+    if (block) {
+        file->map_logical = index;
+        file->map_physical = block;
+        file->map_count = run;
+    }
+    return block;
+}
 
-                for (uint32_t i = 0; i < mount->block_size * 8; i++) {
-                    if (!(block_bitmap[i / 32] & (1 << (i % 32)))) {
-                        block_bitmap[i / 32] |= 1 << (i % 32);
-                        indirect_block[block_index - 12] = mount->group_descriptors[group].block_bitmap * mount->block_size + i;
-                        break;
-                    }
-                }
+// Lancer la lecture anticipée des blocs logiques [start, start + count), par séries contiguës sur le disque
+static void readahead_file(file_t* file, uint32_t start, uint32_t count) {
+    mount_t* mount = file->mount;
+    uint32_t run_start = 0, run_length = 0;
 
-                if (write_device(0, block_bitmap, mount->block_size) != mount->block_size) {
-                    kfree(block_bitmap);
-                    kfree(indirect_block);
-                    return bytes_written;
-                }
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t block = map_file_block(file, start + i);
+        if (block && run_length && block == run_start + run_length) {
+            run_length++;
+            continue;
+        }
 
-                kfree(block_bitmap);
-            }
-            block_number = indirect_block[block_index - 12];
+        if (run_length) bcache_prefetch(mount->device_id, run_start, run_length, mount->block_size);
+        run_start = block;
+        run_length = block ? 1 : 0;
+    }
 
-            if (write_device(0, indirect_block, mount->block_size) != mount->block_size) {
-                kfree(indirect_block);
-                return bytes_written;
-            }
+    if (run_length) bcache_prefetch(mount->device_id, run_start, run_length, mount->block_size);
+}
+
+static int32_t ext4_read(void* object, void* buffer, uint32_t size) {
+    file_t* file = (file_t*)object;
+    if (!file || !buffer || !size) return -1;
 
-            kfree(indirect_block);
+    mount_t* mount = file->mount;
+    if (!mount || !mount->mounted) return -1;
+
+    // La taille vient de l'inode partagé: visible immédiatement par tous les lecteurs
+    ext4_inode_t* inode = &file->cached->data;
+    uint32_t block_count = (inode->size + mount->block_size - 1) / mount->block_size;
+    uint32_t bytes_read = 0;
+    while (bytes_read < size && file->position < inode->size) {
+        uint32_t block_index = file->position / mount->block_size;
+        uint32_t block_offset = file->position % mount->block_size;
+        uint32_t bytes_to_read = mount->block_size - block_offset;
+        if (bytes_to_read > size - bytes_read) bytes_to_read = size - bytes_read;
+        if (bytes_to_read > inode->size - file->position) bytes_to_read = inode->size - file->position;
+
+        uint32_t readahead_start;
+        uint32_t readahead_count = readahead_update(&file->readahead, block_index, mount->block_size,
+                                                    block_count, &readahead_start);
+        if (readahead_count) readahead_file(file, readahead_start, readahead_count);
+
+        uint32_t block_number = map_file_block(file, block_index);
+        if (block_number) {
+            uint64_t start = trace_begin();
+            buffer_t* block = bcache_read(mount->device_id, block_number, mount->block_size);
+            trace_end(TRACE_FS_DATA_READ, mount->device_id, start, block_number);
+            if (!block) return bytes_read;
+            memcpy((uint8_t*)buffer + bytes_read, block->data + block_offset, bytes_to_read);
+            bcache_release(block);
         } else {
-            return bytes_written;
+            // Trou dans le fichier
+            memset((uint8_t*)buffer + bytes_read, 0, bytes_to_read);
         }
 
-        uint8_t* block_data = (uint8_t*)kmalloc(mount->block_size);
-        if (!block_data) return bytes_written;
+        bytes_read += bytes_to_read;
+        file->position += bytes_to_read;
+    }
 
-        if (read_device(0, block_data, mount->block_size) != mount->block_size) {
-            kfree(block_data);
-            return bytes_written;
-        }
+    return bytes_read;
+}
 
-        memcpy(block_data + block_offset, (uint8_t*)buffer + bytes_written, bytes_to_write);
+// Réécrire le descripteur d'un groupe après modification de ses compteurs
+static void write_group_descriptor(mount_t* mount, uint32_t group) {
+    // La table suit le bloc du superbloc: position relative à son début, sans division 64 bits
+    uint32_t offset = group * mount->desc_size;
+    uint32_t block = mount->superblock.first_data_block + 1 + offset / mount->block_size;
+    buffer_t* buffer = bcache_read(mount->device_id, block, mount->block_size);
+    if (!buffer) return;
+
+    memcpy(buffer->data + offset % mount->block_size, &mount->group_descriptors[group], sizeof(ext4_group_desc_t));
+    bcache_mark_dirty(buffer);
+    bcache_release(buffer);
+}
 
-        if (write_device(0, block_data, mount->block_size) != mount->block_size) {
-            kfree(block_data);
-            return bytes_written;
-        }
+// Allouer un bloc libre, en commençant par le groupe de l'inode
+static uint32_t allocate_data_block(mount_t* mount, uint32_t ino) {
+    uint32_t goal = (ino - 1) / mount->inodes_per_group;
 
-        kfree(block_data);
+    for (uint32_t n = 0; n < mount->group_count; n++) {
+        uint32_t group = (goal + n) % mount->group_count;
+        if (mount->group_descriptors[group].free_blocks_count == 0) continue;
 
-        bytes_written += bytes_to_write;
-        file->position += bytes_to_write;
-        if (file->position > file->size) {
-            file->size = file->position;
-            file->inode_data.size = file->size;
+        buffer_t* bitmap = bcache_read(mount->device_id, mount->group_descriptors[group].block_bitmap, mount->block_size);
+        if (!bitmap) continue;
+
+        uint32_t* words = (uint32_t*)bitmap->data;
+        for (uint32_t i = 0; i < mount->blocks_per_group; i++) {
+            if (!(words[i / 32] & (1u << (i % 32)))) {
+                words[i / 32] |= 1u << (i % 32);
+                bcache_mark_dirty(bitmap);
+                bcache_release(bitmap);
+
+                mount->group_descriptors[group].free_blocks_count--;
+                mount->superblock.free_blocks_count--;
+                write_group_descriptor(mount, group);
+                return mount->superblock.first_data_block + group * mount->blocks_per_group + i;
+            }
         }
+        bcache_release(bitmap);
     }
-
-    return bytes_written;
+    return 0;
 }
 
-directory_t* open_directory(const char* path) {
-    if (filesystem.directory_count >= MAX_DIRS) return NULL;
+// Numéro physique du bloc logique `index`, alloué s'il n'existe pas encore
+static uint32_t map_inode_block(mount_t* mount, file_t* file, uint32_t index) {
+    ext4_inode_t* inode = &file->cached->data;
 
-    char mount_path[MAX_PATH];
-    char relative_path[MAX_PATH];
-    mount_t* mount = NULL;
+    // Les fichiers à extents ne sont accessibles en écriture que sur leurs blocs déjà alloués
+    if (inode->flags & EXT4_EXTENTS_FL) return get_inode_block(mount, inode, index);
 
-    for (uint32_t i = 0; i < filesystem.mount_count; i++) {
-        if (strncmp(path, filesystem.mounts[i].path, strlen(filesystem.mounts[i].path)) == 0) {
-            mount = &filesystem.mounts[i];
-            strncpy(mount_path, mount->path, sizeof(mount_path) - 1);
-            strncpy(relative_path, path + strlen(mount->path), sizeof(relative_path) - 1);
-            break;
+    if (index < 12) {
+        if (!inode->block[index]) {
+            inode->block[index] = allocate_data_block(mount, file->inode);
         }
+        return inode->block[index];
     }
 
-    if (!mount || !mount->mounted) return NULL;
-
-    char* component = strtok(relative_path, "/");
-    uint32_t current_inode = 2;
+    index -= 12;
+    if (index >= mount->block_size / 4) return 0;
 
-    while (component) {
-        bool found = false;
-        uint32_t group = (current_inode - 1) / mount->inodes_per_group;
-        uint32_t index = (current_inode - 1) % mount->inodes_per_group;
-        uint32_t block = mount->group_descriptors[group].inode_table + (index * mount->inode_size) / mount->block_size;
-        uint32_t offset = (index * mount->inode_size) % mount->block_size;
+    if (!inode->block[12]) {
+        uint32_t indirect = allocate_data_block(mount, file->inode);
+        if (!indirect) return 0;
 
-        uint8_t* block_data = (uint8_t*)kmalloc(mount->block_size);
-        if (!block_data) return NULL;
+        buffer_t* buffer = bcache_read(mount->device_id, indirect, mount->block_size);
+        if (!buffer) return 0;
+        memset(buffer->data, 0, mount->block_size);
+        bcache_mark_dirty(buffer);
+        bcache_release(buffer);
+        inode->block[12] = indirect;
+    }
 
-        if (read_device(0, block_data, mount->block_size) != mount->block_size) {
-            kfree(block_data);
-            return NULL;
-        }
+    buffer_t* buffer = bcache_read(mount->device_id, inode->block[12], mount->block_size);
+    if (!buffer) return 0;
 
-        ext4_inode_t* inode = (ext4_inode_t*)(block_data + offset);
-        uint32_t block_count = (inode->size + mount->block_size - 1) / mount->block_size;
-
-        for (uint32_t i = 0; i < block_count; i++) {
-            uint32_t block_number;
-            if (i < 12) {
-                block_number = inode->block[i];
-            } else if (i < 12 + mount->block_size / 4) {
-                uint32_t* indirect_block = (uint32_t*)kmalloc(mount->block_size);
-                if (!indirect_block) {
-                    kfree(block_data);
-                    return NULL;
-                }
+    uint32_t* entries = (uint32_t*)buffer->data;
+    if (!entries[index]) {
+        entries[index] = allocate_data_block(mount, file->inode);
+        bcache_mark_dirty(buffer);
+    }
+    uint32_t block = entries[index];
+    bcache_release(buffer);
+    return block;
+}
 
-                if (read_device(0, indirect_block, mount->block_size) != mount->block_size) {
-                    kfree(indirect_block);
-                    kfree(block_data);
-                    return NULL;
-                }
+static int32_t write_blocks(file_t* file, const void* buffer, uint32_t size) {
+    mount_t* mount = file->mount;
+    if (!mount || !mount->mounted) return -1;
 
-                block_number = indirect_block[i - 12];
-                kfree(indirect_block);
-            } else {
-                kfree(block_data);
-                return NULL;
-            }
+    uint32_t bytes_written = 0;
+    while (bytes_written < size) {
+        uint32_t block_index = file->position / mount->block_size;
+        uint32_t block_offset = file->position % mount->block_size;
+        uint32_t bytes_to_write = mount->block_size - block_offset;
+        if (bytes_to_write > size - bytes_written) bytes_to_write = size - bytes_written;
 
-            uint8_t* dir_block = (uint8_t*)kmalloc(mount->block_size);
-            if (!dir_block) {
-                kfree(block_data);
-                return NULL;
-            }
+        uint32_t block_number = map_inode_block(mount, file, block_index);
+        if (!block_number) break;
 
-            if (read_device(0, dir_block, mount->block_size) != mount->block_size) {
-                kfree(dir_block);
-                kfree(block_data);
-                return NULL;
-            }
+        buffer_t* block = bcache_read(mount->device_id, block_number, mount->block_size);
+        if (!block) break;
 
-            ext4_dir_entry_t* entry = (ext4_dir_entry_t*)dir_block;
-            while ((uint8_t*)entry < dir_block + mount->block_size) {
-                if (entry->inode && entry->name_len == strlen(component) &&
-                    strncmp(entry->name, component, entry->name_len) == 0) {
-                    current_inode = entry->inode;
-                    found = true;
-                    break;
-                }
-                entry = (ext4_dir_entry_t*)((uint8_t*)entry + entry->rec_len);
-            }
+        memcpy(block->data + block_offset, (uint8_t*)buffer + bytes_written, bytes_to_write);
+        bcache_mark_dirty(block);
+        bcache_release(block);
 
-            kfree(dir_block);
-            if (found) break;
+        bytes_written += bytes_to_write;
+        file->position += bytes_to_write;
+        if (file->position > file->cached->data.size) {
+            file->cached->data.size = file->position;
         }
+    }
 
-        kfree(block_data);
-        if (!found) return NULL;
-
-        component = strtok(NULL, "/");
+    // Taille et blocs sont réécrits plus tard, par inode_writeback() ou à l'éviction
+    if (bytes_written > 0) mark_inode_dirty(file->cached);
+    // Un répertoire réécrit a pu perdre ou gagner des noms: oublier ceux du cache
+    if (bytes_written > 0 && (file->cached->data.mode & EXT4_S_IFMT) == EXT4_S_IFDIR) {
+        dcache_invalidate_directory(mount->device_id, file->inode);
     }
+    return bytes_written;
+}
 
-    directory_t* dir = &filesystem.directories[filesystem.directory_count++];
-    dir->inode = current_inode;
-    strncpy(dir->name, path, sizeof(dir->name) - 1);
-    dir->files = (file_t*)kmalloc(MAX_FILES * sizeof(file_t));
-    dir->file_count = 0;
+static int32_t ext4_write(void* object, const void* buffer, uint32_t size) {
+    file_t* file = (file_t*)object;
+    if (!file || !buffer || !size) return -1;
 
-    uint32_t group = (current_inode - 1) / mount->inodes_per_group;
-    uint32_t index = (current_inode - 1) % mount->inodes_per_group;
-    uint32_t block = mount->group_descriptors[group].inode_table + (index * mount->inode_size) / mount->block_size;
-    uint32_t offset = (index * mount->inode_size) % mount->block_size;
+    uint32_t position = file->position;
+    int32_t written = write_blocks(file, buffer, size);
+    // Les projections de ce fichier voient l'écriture immédiatement
+    if (written > 0) page_cache_write(&file->cached->mapping, position, buffer, written);
+    return written;
+}
+
+// Inode puis blocs du fichier sur le disque
+static int ext4_fsync(void* object) {
+    file_t* file = (file_t*)object;
+    if (!file->mount->mounted) return -1;
+    if (file->cached->dirty && !flush_inode(file->cached)) return -1;
+    return bcache_sync(file->mount->device_id) ? 0 : -1;
+}
+
+static bool ext4_sync(void* private) {
+    mount_t* mount = (mount_t*)private;
+    sync_inodes(mount);
+    return bcache_sync(mount->device_id);
+}
+
+// Accès par pages pour lib/mmap.c: une projection garde sa propre référence sur l'inode
+static mapping_t* ext4_mapping(void* object) {
+    file_t* file = (file_t*)object;
+    if (!file || !file->cached || !file->mount || !file->mount->mounted) return NULL;
+    file->cached->refcount++;
+    file->cached->mapping.ops = &ext4_mapping_operations;
+    return &file->cached->mapping;
+}
+
+static void ext4_mapping_put(mapping_t* mapping) {
+    iput((cached_inode_t*)mapping);
+}
+
+// Lire une page du fichier; renvoie le nombre d'octets valides (0 au-delà de la fin)
+static int32_t ext4_read_page(mapping_t* page_mapping, uint32_t index, void* page) {
+    cached_inode_t* mapping = (cached_inode_t*)page_mapping;
+    file_t file;
+    memset(&file, 0, sizeof(file_t));
+    file.inode = mapping->ino;
+    file.cached = mapping;
+    file.mount = mapping->mount;
+    file.position = index * PAGE_SIZE;
+    if (file.position >= mapping->data.size) return 0;
+    return ext4_read(&file, page, PAGE_SIZE);
+}
 
-    uint8_t* block_data = (uint8_t*)kmalloc(mount->block_size);
-    if (!block_data) return NULL;
+// Réécrire une page sans agrandir le fichier: la fin de la dernière page n'est pas recopiée
+static int32_t ext4_write_page(mapping_t* page_mapping, uint32_t index, const void* page) {
+    cached_inode_t* mapping = (cached_inode_t*)page_mapping;
+    uint32_t position = index * PAGE_SIZE;
+    if (position >= mapping->data.size) return 0;
+
+    uint32_t length = mapping->data.size - position;
+    if (length > PAGE_SIZE) length = PAGE_SIZE;
+
+    file_t file;
+    memset(&file, 0, sizeof(file_t));
+    file.inode = mapping->ino;
+    file.cached = mapping;
+    file.mount = mapping->mount;
+    file.position = position;
+    return write_blocks(&file, page, length);
+}
+
+static void* ext4_opendir(void* private, const char* relative) {
+    mount_t* mount = (mount_t*)private;
+    uint32_t ino = lookup_path(mount, relative);
+    if (!ino) return NULL;
 
-    if (read_device(0, block_data, mount->block_size) != mount->block_size) {
-        kfree(block_data);
+    cached_inode_t* cached = iget(mount, ino);
+    if (!cached) return NULL;
+    if ((cached->data.mode & EXT4_S_IFMT) != EXT4_S_IFDIR) {
+        iput(cached);
         return NULL;
     }
 
-    ext4_inode_t* inode = (ext4_inode_t*)(block_data + offset);
-    uint32_t block_count = (inode->size + mount->block_size - 1) / mount->block_size;
+    dir_stream_t* stream = (dir_stream_t*)kmalloc(sizeof(dir_stream_t));
+    if (!stream) {
+        iput(cached);
+        return NULL;
+    }
+    stream->cached = cached;
+    stream->mount = mount;
+    stream->position = 0;
+    return stream;
+}
 
-    for (uint32_t i = 0; i < block_count; i++) {
-        uint32_t block_number;
-        if (i < 12) {
-            block_number = inode->block[i];
-        } else if (i < 12 + mount->block_size / 4) {
-            uint32_t* indirect_block = (uint32_t*)kmalloc(mount->block_size);
-            if (!indirect_block) {
-                kfree(block_data);
-                return NULL;
-            }
+static void ext4_closedir(void* object) {
+    dir_stream_t* stream = (dir_stream_t*)object;
+    if (!stream) return;
+    iput(stream->cached);
+    kfree(stream);
+}
 
-            if (read_device(0, indirect_block, mount->block_size) != mount->block_size) {
-                kfree(indirect_block);
-                kfree(block_data);
-                return NULL;
-            }
+// Position à passer à ext4_seekdir() pour reprendre la lecture plus tard
+static uint32_t ext4_telldir(void* object) {
+    dir_stream_t* stream = (dir_stream_t*)object;
+    return stream ? stream->position : 0;
+}
 
-            block_number = indirect_block[i - 12];
-            kfree(indirect_block);
-        } else {
-            kfree(block_data);
-            return NULL;
-        }
+static void ext4_seekdir(void* object, uint32_t position) {
+    dir_stream_t* stream = (dir_stream_t*)object;
+    if (stream) stream->position = position;
+}
 
-        uint8_t* dir_block = (uint8_t*)kmalloc(mount->block_size);
-        if (!dir_block) {
-            kfree(block_data);
-            return NULL;
+// Remplir `buffer` d'entrées dirent_t à partir de la position courante.
+// Renvoie le nombre d'octets écrits, 0 à la fin du répertoire, -1 si `size` ne
+// suffit pas pour l'entrée suivante ou en cas d'erreur de lecture.
+static int32_t ext4_readdir(void* object, void* buffer, uint32_t size) {
+    dir_stream_t* stream = (dir_stream_t*)object;
+    if (!stream || !buffer) return -1;
+
+    mount_t* mount = stream->mount;
+    const ext4_inode_t* inode = &stream->cached->data;
+    uint32_t block_size = mount->block_size;
+    uint32_t filled = 0;
+
+    while (stream->position < inode->size) {
+        uint32_t block_index = stream->position / block_size;
+        uint32_t block_start = block_index * block_size;
+        uint32_t offset = stream->position - block_start;
+
+        uint32_t run;
+        uint32_t block_number = map_inode_run(mount, inode, block_index, &run);
+        if (!block_number) {
+            // Trou dans le répertoire
+            stream->position = block_start + block_size;
+            continue;
         }
-
-        if (read_device(0, dir_block, mount->block_size) != mount->block_size) {
-            kfree(dir_block);
-            kfree(block_data);
-            return NULL;
+        if (offset == 0 && run > 1) {
+            bcache_prefetch(mount->device_id, block_number + 1,
+                            run - 1 < DIR_READAHEAD_BLOCKS ? run - 1 : DIR_READAHEAD_BLOCKS, block_size);
         }
 
-        ext4_dir_entry_t* entry = (ext4_dir_entry_t*)dir_block;
-        while ((uint8_t*)entry < dir_block + mount->block_size) {
-            if (entry->inode && entry->name_len > 0) {
-                file_t* file = &dir->files[dir->file_count++];
-                file->inode = entry->inode;
-                file->position = 0;
-                file->size = 0;
-                file->flags = 0;
-
-                uint32_t file_group = (entry->inode - 1) / mount->inodes_per_group;
-                uint32_t file_index = (entry->inode - 1) % mount->inodes_per_group;
-                uint32_t file_block = mount->group_descriptors[file_group].inode_table + (file_index * mount->inode_size) / mount->block_size;
-                uint32_t file_offset = (file_index * mount->inode_size) % mount->block_size;
-
-                uint8_t* file_block_data = (uint8_t*)kmalloc(mount->block_size);
-                if (!file_block_data) {
-                    kfree(dir_block);
-                    kfree(block_data);
-                    return NULL;
-                }
+        buffer_t* block = bcache_read(mount->device_id, block_number, block_size);
+        if (!block) return filled ? (int32_t)filled : -1;
+
+        // Parcourir le bloc depuis son début: une position obsolète (bloc modifié
+        // depuis) reprend à la première entrée qui la suit
+        uint32_t entry_offset = 0;
+        while (entry_offset + 8 <= block_size) {
+            ext4_dir_entry_t* entry = (ext4_dir_entry_t*)(block->data + entry_offset);
+            if (entry->rec_len < 8 || entry->rec_len % 4 || entry_offset + entry->rec_len > block_size ||
+                entry->name_len > entry->rec_len - 8) {
+                // Bloc corrompu: passer au suivant
+                entry_offset = block_size;
+                break;
+            }
 
-                if (read_device(0, file_block_data, mount->block_size) != mount->block_size) {
-                    kfree(file_block_data);
-                    kfree(dir_block);
-                    kfree(block_data);
-                    return NULL;
+            if (entry_offset >= offset && entry->inode && entry->name_len) {
+                uint32_t length = (sizeof(dirent_t) + entry->name_len + 1 + 3) & ~3u;
+                if (filled + length > size) {
+                    bcache_release(block);
+                    stream->position = block_start + entry_offset;
+                    return filled ? (int32_t)filled : -1;
                 }
 
-                memcpy(&file->inode_data, file_block_data + file_offset, sizeof(ext4_inode_t));
-                file->size = file->inode_data.size;
-
-                kfree(file_block_data);
+                dirent_t* out = (dirent_t*)((uint8_t*)buffer + filled);
+                out->inode = entry->inode;
+                out->rec_len = length;
+                out->type = entry->file_type;
+                out->name_len = entry->name_len;
+                memcpy(out->name, entry->name, entry->name_len);
+                out->name[entry->name_len] = '\0';
+                filled += length;
             }
-            entry = (ext4_dir_entry_t*)((uint8_t*)entry + entry->rec_len);
+            entry_offset += entry->rec_len;
         }
 
-        kfree(dir_block);
+        bcache_release(block);
+        stream->position = block_start + block_size;
     }
 
-    kfree(block_data);
-    return dir;
+    return filled;
 }
 
-void close_directory(directory_t* dir) {
-    if (!dir) return;
-    for (uint32_t i = 0; i < filesystem.directory_count; i++) {
-        if (&filesystem.directories[i] == dir) {
-            kfree(dir->files);
-            filesystem.directories[i] = filesystem.directories[--filesystem.directory_count];
-            break;
-        }
-    }
-} 
\ No newline at end of file
+static const vfs_super_operations_t ext4_super_operations = {
+    .mount = ext4_mount,
+    .unmount = ext4_unmount,
+    .sync = ext4_sync,
+};
+
+static const vfs_inode_operations_t ext4_inode_operations = {
+    .open = ext4_open,
+    .opendir = ext4_opendir,
+};
+
+static const vfs_file_operations_t ext4_file_operations = {
+    .read = ext4_read,
+    .write = ext4_write,
+    .fsync = ext4_fsync,
+    .release = ext4_release,
+    .mapping = ext4_mapping,
+    .tell = ext4_tell,
+    .seek = ext4_seek,
+    .readdir = ext4_readdir,
+    .telldir = ext4_telldir,
+    .seekdir = ext4_seekdir,
+    .closedir = ext4_closedir,
+};
+
+static const mapping_operations_t ext4_mapping_operations = {
+    .read_page = ext4_read_page,
+    .write_page = ext4_write_page,
+    .put = ext4_mapping_put,
+};
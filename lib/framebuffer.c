@@ -0,0 +1,236 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define FRAMEBUFFER_WIDTH 1024
+#define FRAMEBUFFER_HEIGHT 768
+#define FRAMEBUFFER_BPP 32
+
+#define PCI_CLASS_DISPLAY 0x03
+#define PCI_SUBCLASS_VGA 0x00
+
+// Interface VBE "dispi" des cartes Bochs/QEMU (stdvga)
+#define VBE_DISPI_INDEX 0x01CE
+#define VBE_DISPI_DATA 0x01CF
+#define VBE_DISPI_INDEX_ID 0x0
+#define VBE_DISPI_INDEX_XRES 0x1
+#define VBE_DISPI_INDEX_YRES 0x2
+#define VBE_DISPI_INDEX_BPP 0x3
+#define VBE_DISPI_INDEX_ENABLE 0x4
+#define VBE_DISPI_ID_MIN 0xB0C0
+#define VBE_DISPI_ID_MAX 0xB0CF
+#define VBE_DISPI_ENABLED 0x01
+#define VBE_DISPI_LFB_ENABLED 0x40
+
+#define DISPLAY_IOCTL_GET_FRAMEBUFFER 0x4401
+#define DISPLAY_IOCTL_GET_MODE 0x4402
+
+typedef enum {
+    DEVICE_TYPE_CHAR,
+    DEVICE_TYPE_BLOCK,
+    DEVICE_TYPE_NETWORK,
+    DEVICE_TYPE_DISPLAY,
+    DEVICE_TYPE_SOUND,
+    DEVICE_TYPE_INPUT
+} device_type_t;
+
+typedef enum {
+    DEVICE_STATE_READY,
+    DEVICE_STATE_BUSY,
+    DEVICE_STATE_ERROR,
+    DEVICE_STATE_OFFLINE
+} device_state_t;
+
+typedef struct {
+    uint32_t id;
+    char name[32];
+    device_type_t type;
+    device_state_t state;
+    void* driver;
+    void* data;
+    uint32_t irq;
+    uint8_t dma_channel;
+} device_t;
+
+typedef struct {
+    char name[32];
+    device_type_t type;
+    bool (*init)(device_t* device);
+    void (*deinit)(device_t* device);
+    int (*read)(device_t* device, void* buffer, size_t size, size_t offset);
+    int (*write)(device_t* device, const void* buffer, size_t size, size_t offset);
+    int (*ioctl)(device_t* device, uint32_t request, void* arg);
+} driver_t;
+
+typedef struct pci_device pci_device_t;
+
+typedef struct {
+    uint32_t width;
+    uint32_t height;
+    uint32_t bpp;
+    uint32_t pitch;
+} display_mode_t;
+
+typedef struct {
+    uint8_t* base;
+    uint32_t size;
+    // BAR projeté, à rendre au retrait du pilote
+    pci_device_t* pci;
+    uint32_t bar;
+    display_mode_t mode;
+} framebuffer_t;
+
+// Déclarations externes (lib/pci.c)
+extern uint32_t pci_bar_size(pci_device_t* dev, uint32_t bar);
+extern bool pci_bar_is_io(pci_device_t* dev, uint32_t bar);
+extern bool pci_bar_is_prefetchable(pci_device_t* dev, uint32_t bar);
+extern void* pci_map_bar(pci_device_t* dev, uint32_t bar);
+extern void pci_unmap_bar(pci_device_t* dev, uint32_t bar);
+
+static bool framebuffer_init(device_t* device);
+static void framebuffer_deinit(device_t* device);
+static int framebuffer_read(device_t* device, void* buffer, size_t size, size_t offset);
+static int framebuffer_write(device_t* device, const void* buffer, size_t size, size_t offset);
+static int framebuffer_ioctl(device_t* device, uint32_t request, void* arg);
+
+static const driver_t framebuffer_driver = {
+    "framebuffer",
+    DEVICE_TYPE_DISPLAY,
+    framebuffer_init,
+    framebuffer_deinit,
+    framebuffer_read,
+    framebuffer_write,
+    framebuffer_ioctl
+};
+
+static inline void outw(uint16_t port, uint16_t value) {
+    asm volatile("outw %0, %1" : : "a"(value), "Nd"(port));
+}
+
+static inline uint16_t inw(uint16_t port) {
+    uint16_t value;
+    asm volatile("inw %1, %0" : "=a"(value) : "Nd"(port));
+    return value;
+}
+
+static uint16_t vbe_read(uint16_t index) {
+    outw(VBE_DISPI_INDEX, index);
+    return inw(VBE_DISPI_DATA);
+}
+
+static void vbe_write(uint16_t index, uint16_t value) {
+    outw(VBE_DISPI_INDEX, index);
+    outw(VBE_DISPI_DATA, value);
+}
+
+// Passer en mode linéaire si la carte expose l'interface dispi
+static bool vbe_set_mode(uint32_t width, uint32_t height, uint32_t bpp) {
+    uint16_t id = vbe_read(VBE_DISPI_INDEX_ID);
+    if (id < VBE_DISPI_ID_MIN || id > VBE_DISPI_ID_MAX) return false;
+
+    vbe_write(VBE_DISPI_INDEX_ENABLE, 0);
+    vbe_write(VBE_DISPI_INDEX_XRES, width);
+    vbe_write(VBE_DISPI_INDEX_YRES, height);
+    vbe_write(VBE_DISPI_INDEX_BPP, bpp);
+    vbe_write(VBE_DISPI_INDEX_ENABLE, VBE_DISPI_ENABLED | VBE_DISPI_LFB_ENABLED);
+    return true;
+}
+
+static bool framebuffer_init(device_t* device) {
+    pci_device_t* pci = (pci_device_t*)device->data;
+    if (!pci) return false;
+
+    // La mémoire vidéo est le premier BAR mémoire préchargeable (BAR0 sur stdvga)
+    uint32_t bar = 0;
+    while (bar < 6 && (pci_bar_is_io(pci, bar) || !pci_bar_is_prefetchable(pci, bar))) {
+        bar++;
+    }
+    if (bar == 6) return false;
+
+    framebuffer_t* fb = (framebuffer_t*)kmalloc(sizeof(framebuffer_t));
+    if (!fb) return false;
+    memset(fb, 0, sizeof(framebuffer_t));
+
+    fb->mode.width = FRAMEBUFFER_WIDTH;
+    fb->mode.height = FRAMEBUFFER_HEIGHT;
+    fb->mode.bpp = FRAMEBUFFER_BPP;
+    fb->mode.pitch = FRAMEBUFFER_WIDTH * (FRAMEBUFFER_BPP / 8);
+
+    uint32_t needed = fb->mode.pitch * fb->mode.height;
+    if (pci_bar_size(pci, bar) < needed) {
+        kfree(fb);
+        return false;
+    }
+
+    pci_enable_device(pci);
+
+    // Projection en write-combining: les écritures séquentielles sont regroupées en rafales
+    fb->base = (uint8_t*)pci_map_bar(pci, bar);
+    if (!fb->base) {
+        kfree(fb);
+        return false;
+    }
+    if (!vbe_set_mode(fb->mode.width, fb->mode.height, fb->mode.bpp)) {
+        pci_unmap_bar(pci, bar);
+        kfree(fb);
+        return false;
+    }
+    fb->size = needed;
+    fb->pci = pci;
+    fb->bar = bar;
+
+    strcpy(device->name, "fb0");
+    device->data = fb;
+    return true;
+}
+
+static void framebuffer_deinit(device_t* device) {
+    framebuffer_t* fb = (framebuffer_t*)device->data;
+    if (!fb) return;
+
+    vbe_write(VBE_DISPI_INDEX_ENABLE, 0);
+    pci_unmap_bar(fb->pci, fb->bar);
+    kfree(fb);
+    device->data = NULL;
+}
+
+// Relire la mémoire vidéo est lent (non cachée): réservé au débogage
+static int framebuffer_read(device_t* device, void* buffer, size_t size, size_t offset) {
+    framebuffer_t* fb = (framebuffer_t*)device->data;
+    if (!fb || offset >= fb->size) return -1;
+
+    if (size > fb->size - offset) size = fb->size - offset;
+    memcpy(buffer, fb->base + offset, size);
+    return size;
+}
+
+static int framebuffer_write(device_t* device, const void* buffer, size_t size, size_t offset) {
+    framebuffer_t* fb = (framebuffer_t*)device->data;
+    if (!fb || offset >= fb->size) return -1;
+
+    if (size > fb->size - offset) size = fb->size - offset;
+    memcpy(fb->base + offset, buffer, size);
+    return size;
+}
+
+static int framebuffer_ioctl(device_t* device, uint32_t request, void* arg) {
+    framebuffer_t* fb = (framebuffer_t*)device->data;
+    if (!fb || !arg) return -1;
+
+    switch (request) {
+        case DISPLAY_IOCTL_GET_FRAMEBUFFER:
+            *(void**)arg = fb->base;
+            return 0;
+        case DISPLAY_IOCTL_GET_MODE:
+            memcpy(arg, &fb->mode, sizeof(display_mode_t));
+            return 0;
+        default:
+            return -1;
+    }
+}
+
+// Pilote générique des contrôleurs VGA, lié par classe PCI
+void init_framebuffer() {
+    register_driver(&framebuffer_driver);
+    pci_register_class_driver(PCI_CLASS_DISPLAY, PCI_SUBCLASS_VGA, &framebuffer_driver);
+}
\ No newline at end of file
@@ -50,6 +50,9 @@ typedef struct {
 
 typedef struct {
     uint32_t* framebuffer;
+    // Dernière image envoyée à la mémoire vidéo, pour n'y recopier que les lignes modifiées
+    uint32_t* presented;
+    bool presented_valid;
     window_t windows[MAX_WINDOWS];
     uint32_t window_count;
     animation_t animations[MAX_ANIMATIONS];
@@ -62,9 +65,14 @@ typedef struct {
 
 static gui_t gui;
 
+// Déclarations externes (lib/device_manager.c)
+extern void* get_display_device();
+extern int write_device(void* device, const void* buffer, size_t size, size_t offset);
+
 void init_gui() {
     memset(&gui, 0, sizeof(gui_t));
     gui.framebuffer = (uint32_t*)kmalloc(SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(uint32_t));
+    gui.presented = (uint32_t*)kmalloc(SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(uint32_t));
 }
 
 void draw_pixel(uint32_t x, uint32_t y, uint32_t color) {
@@ -332,9 +340,43 @@ void handle_keyboard_event(uint32_t key) {
     }
 }
 
+// Une ligne est abîmée si elle diffère de ce qui est déjà affiché
+static bool row_damaged(uint32_t y) {
+    if (!gui.presented || !gui.presented_valid) return true;
+    uint32_t offset = y * SCREEN_WIDTH;
+    return memcmp(gui.framebuffer + offset, gui.presented + offset, SCREEN_WIDTH * sizeof(uint32_t)) != 0;
+}
+
+// Copier vers la mémoire vidéo (projetée en write-combining) les seules lignes modifiées
+// depuis l'image précédente, par plages contiguës: la comparaison se fait en RAM cachée,
+// l'écriture en mémoire vidéo reste le coût dominant d'une image.
+static void present_damaged_rows() {
+    void* display = get_display_device();
+    if (!display) return;
+
+    const uint32_t row_bytes = SCREEN_WIDTH * sizeof(uint32_t);
+    uint32_t y = 0;
+    while (y < SCREEN_HEIGHT) {
+        if (!row_damaged(y)) {
+            y++;
+            continue;
+        }
+        uint32_t first = y;
+        while (y < SCREEN_HEIGHT && row_damaged(y)) y++;
+
+        uint32_t offset = first * row_bytes;
+        uint32_t size = (y - first) * row_bytes;
+        write_device(display, (uint8_t*)gui.framebuffer + offset, size, offset);
+        if (gui.presented) memcpy((uint8_t*)gui.presented + offset, (uint8_t*)gui.framebuffer + offset, size);
+    }
+    gui.presented_valid = gui.presented != NULL;
+}
+
 void render() {
     memset(gui.framebuffer, 0, SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(uint32_t));
     update_animations();
     update_windows();
     draw_windows();
+
+    present_damaged_rows();
 } 
\ No newline at end of file
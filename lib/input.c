@@ -245,6 +245,8 @@ void get_touch_point(uint32_t index, uint32_t* id, uint32_t* x, uint32_t* y, flo
     }
 }
 
+extern uint64_t get_current_time_ms();
+
 uint32_t get_timestamp() {
-    return (uint32_t)(get_ticks() * 1000 / get_frequency());
+    return (uint32_t)get_current_time_ms();
 } 
\ No newline at end of file
@@ -0,0 +1,299 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+// Anneaux d'E/S asynchrones: une file de soumission (SQ) et une file de complétion (CQ)
+// partagées en mémoire avec l'application. L'application remplit des entrées puis les
+// soumet toutes d'un seul appel; chaque opération produit une complétion qui porte
+// l'étiquette `user_data` de sa soumission. Une réception sans données reste en attente
+// et se termine plus tard, au fil des appels ou du rappel périodique: une boucle
+// d'événements pilote ainsi de nombreux sockets depuis un seul thread.
+
+#define IO_RING_MAX_ENTRIES 4096
+#define IO_RING_POLL_INTERVAL 10000
+
+#define IO_OP_NOP 0
+#define IO_OP_READ 1
+#define IO_OP_WRITE 2
+#define IO_OP_FSYNC 3
+#define IO_OP_SEND 4
+#define IO_OP_RECV 5
+#define IO_OP_SENDFILE 6
+#define IO_OP_READ_DEVICE 7
+#define IO_OP_WRITE_DEVICE 8
+
+// Complétion d'une opération restée en attente
+#define IO_CQE_F_DEFERRED 0x1
+
+typedef struct {
+    uint8_t opcode;
+    uint8_t flags;
+    uint16_t reserved;
+    // Descripteur de fichier, identifiant de socket ou de périphérique selon l'opération
+    int32_t fd;
+    // Socket destinataire de IO_OP_SENDFILE
+    uint32_t socket_id;
+    void* buffer;
+    uint32_t length;
+    // Position dans le fichier (sendfile) ou sur le périphérique
+    uint32_t offset;
+    uint64_t user_data;
+} io_sqe_t;
+
+typedef struct {
+    uint64_t user_data;
+    // Octets transférés, ou -1 en cas d'erreur
+    int32_t result;
+    uint32_t flags;
+} io_cqe_t;
+
+typedef struct io_ring {
+    // L'application écrit sqes[sq_tail & sq_mask] et avance sq_tail; le noyau avance sq_head
+    io_sqe_t* sqes;
+    uint32_t sq_head;
+    uint32_t sq_tail;
+    uint32_t sq_mask;
+    uint32_t sq_entries;
+    // Le noyau écrit cqes[cq_tail & cq_mask] et avance cq_tail; l'application avance cq_head
+    io_cqe_t* cqes;
+    uint32_t cq_head;
+    uint32_t cq_tail;
+    uint32_t cq_mask;
+    uint32_t cq_entries;
+    // Réceptions en attente de données. Chacune a sa place réservée dans la CQ, qui ne
+    // peut donc jamais déborder.
+    io_sqe_t* pending;
+    uint32_t pending_count;
+    struct io_ring* next;
+} io_ring_t;
+
+typedef struct device device_t;
+
+static io_ring_t* io_rings = NULL;
+
+// Déclarations externes (lib/vfs.c, net/network_manager.c, lib/device_manager.c, lib/process.c)
+extern int32_t vfs_read(int fd, void* buffer, uint32_t size);
+extern int32_t vfs_write(int fd, const void* buffer, uint32_t size);
+extern int vfs_fsync(int fd);
+extern bool send_data(uint32_t socket_id, const uint8_t* data, uint16_t length);
+extern bool receive_data(uint32_t socket_id, uint8_t* data, uint16_t* length);
+extern int32_t sendfile(int fd, uint32_t socket_id, uint32_t* offset, uint32_t count);
+extern device_t* find_device_by_id(uint32_t device_id);
+extern int read_device(device_t* device, void* buffer, size_t size, size_t offset);
+extern int write_device(device_t* device, const void* buffer, size_t size, size_t offset);
+extern void schedule();
+extern uint32_t irq_save();
+extern void irq_restore(uint32_t flags);
+
+io_ring_t* io_ring_create(uint32_t entries) {
+    if (entries == 0 || entries > IO_RING_MAX_ENTRIES) return NULL;
+
+    // Tailles en puissances de deux: les index libres tournent avec un simple masque
+    uint32_t size = 1;
+    while (size < entries) size <<= 1;
+
+    io_ring_t* ring = (io_ring_t*)kmalloc(sizeof(io_ring_t));
+    if (!ring) return NULL;
+    memset(ring, 0, sizeof(io_ring_t));
+
+    ring->sq_entries = size;
+    ring->sq_mask = size - 1;
+    ring->cq_entries = size * 2;
+    ring->cq_mask = size * 2 - 1;
+    ring->sqes = (io_sqe_t*)kmalloc(size * sizeof(io_sqe_t));
+    ring->cqes = (io_cqe_t*)kmalloc(size * 2 * sizeof(io_cqe_t));
+    ring->pending = (io_sqe_t*)kmalloc(size * 2 * sizeof(io_sqe_t));
+    if (!ring->sqes || !ring->cqes || !ring->pending) {
+        kfree(ring->sqes);
+        kfree(ring->cqes);
+        kfree(ring->pending);
+        kfree(ring);
+        return NULL;
+    }
+    memset(ring->sqes, 0, size * sizeof(io_sqe_t));
+    memset(ring->cqes, 0, size * 2 * sizeof(io_cqe_t));
+
+    uint32_t flags = irq_save();
+    ring->next = io_rings;
+    io_rings = ring;
+    irq_restore(flags);
+    return ring;
+}
+
+// Les réceptions encore en attente sont abandonnées sans complétion
+void io_ring_destroy(io_ring_t* ring) {
+    if (!ring) return;
+
+    uint32_t flags = irq_save();
+    io_ring_t** link = &io_rings;
+    while (*link && *link != ring) link = &(*link)->next;
+    if (*link) *link = ring->next;
+    irq_restore(flags);
+
+    kfree(ring->sqes);
+    kfree(ring->cqes);
+    kfree(ring->pending);
+    kfree(ring);
+}
+
+// Prochaine entrée libre de la SQ, à remplir avant io_ring_submit(); NULL si la file est pleine
+io_sqe_t* io_ring_get_sqe(io_ring_t* ring) {
+    uint32_t head = __atomic_load_n(&ring->sq_head, __ATOMIC_ACQUIRE);
+    if (ring->sq_tail - head >= ring->sq_entries) return NULL;
+
+    io_sqe_t* sqe = &ring->sqes[ring->sq_tail & ring->sq_mask];
+    memset(sqe, 0, sizeof(io_sqe_t));
+    __atomic_store_n(&ring->sq_tail, ring->sq_tail + 1, __ATOMIC_RELEASE);
+    return sqe;
+}
+
+static void post_completion(io_ring_t* ring, uint64_t user_data, int32_t result, uint32_t flags) {
+    io_cqe_t* cqe = &ring->cqes[ring->cq_tail & ring->cq_mask];
+    cqe->user_data = user_data;
+    cqe->result = result;
+    cqe->flags = flags;
+    __atomic_store_n(&ring->cq_tail, ring->cq_tail + 1, __ATOMIC_RELEASE);
+}
+
+// Tenter une réception; false s'il n'y a pas encore de données
+static bool try_receive(io_sqe_t* sqe, int32_t* result) {
+    uint16_t length = sqe->length > 0xFFFF ? 0xFFFF : (uint16_t)sqe->length;
+    if (!receive_data((uint32_t)sqe->fd, (uint8_t*)sqe->buffer, &length)) {
+        *result = -1;
+        return true;
+    }
+    if (length == 0 && sqe->length > 0) return false;
+    *result = length;
+    return true;
+}
+
+// Exécuter une opération; false si elle doit attendre (réception sans données)
+static bool execute_sqe(io_sqe_t* sqe, int32_t* result) {
+    device_t* device;
+
+    switch (sqe->opcode) {
+        case IO_OP_NOP:
+            *result = 0;
+            return true;
+        case IO_OP_READ:
+            *result = vfs_read(sqe->fd, sqe->buffer, sqe->length);
+            return true;
+        case IO_OP_WRITE:
+            *result = vfs_write(sqe->fd, sqe->buffer, sqe->length);
+            return true;
+        case IO_OP_FSYNC:
+            *result = vfs_fsync(sqe->fd);
+            return true;
+        case IO_OP_SEND:
+            if (sqe->length > 0xFFFF) {
+                *result = -1;
+                return true;
+            }
+            *result = send_data((uint32_t)sqe->fd, (const uint8_t*)sqe->buffer, (uint16_t)sqe->length)
+                      ? (int32_t)sqe->length : -1;
+            return true;
+        case IO_OP_RECV:
+            return try_receive(sqe, result);
+        case IO_OP_SENDFILE:
+            *result = sendfile(sqe->fd, sqe->socket_id, &sqe->offset, sqe->length);
+            return true;
+        case IO_OP_READ_DEVICE:
+            device = find_device_by_id((uint32_t)sqe->fd);
+            *result = device ? read_device(device, sqe->buffer, sqe->length, sqe->offset) : -1;
+            return true;
+        case IO_OP_WRITE_DEVICE:
+            device = find_device_by_id((uint32_t)sqe->fd);
+            *result = device ? write_device(device, sqe->buffer, sqe->length, sqe->offset) : -1;
+            return true;
+        default:
+            *result = -1;
+            return true;
+    }
+}
+
+// Relancer les réceptions en attente; renvoie le nombre de complétions produites.
+// Aussi appelé par le rappel périodique, d'où les interruptions masquées.
+static uint32_t io_ring_poll(io_ring_t* ring) {
+    uint32_t flags = irq_save();
+    uint32_t completed = 0;
+    uint32_t i = 0;
+    while (i < ring->pending_count) {
+        int32_t result;
+        if (!execute_sqe(&ring->pending[i], &result)) {
+            i++;
+            continue;
+        }
+        post_completion(ring, ring->pending[i].user_data, result, IO_CQE_F_DEFERRED);
+        ring->pending[i] = ring->pending[--ring->pending_count];
+        completed++;
+    }
+    irq_restore(flags);
+    return completed;
+}
+
+// Consommer toutes les entrées soumises. Les opérations sur fichiers et périphériques se
+// terminent pendant l'appel; une réception sans données part en attente. S'arrête quand la
+// CQ n'a plus de place réservable. Renvoie le nombre d'entrées consommées.
+int32_t io_ring_submit(io_ring_t* ring) {
+    if (!ring) return -1;
+
+    io_ring_poll(ring);
+
+    uint32_t submitted = 0;
+    uint32_t tail = __atomic_load_n(&ring->sq_tail, __ATOMIC_ACQUIRE);
+    while (ring->sq_head != tail) {
+        uint32_t cq_used = ring->cq_tail - __atomic_load_n(&ring->cq_head, __ATOMIC_ACQUIRE);
+        if (cq_used + ring->pending_count >= ring->cq_entries) break;
+
+        io_sqe_t* sqe = &ring->sqes[ring->sq_head & ring->sq_mask];
+        int32_t result;
+        if (execute_sqe(sqe, &result)) {
+            uint32_t flags = irq_save();
+            post_completion(ring, sqe->user_data, result, 0);
+            irq_restore(flags);
+        } else {
+            uint32_t flags = irq_save();
+            ring->pending[ring->pending_count++] = *sqe;
+            irq_restore(flags);
+        }
+        __atomic_store_n(&ring->sq_head, ring->sq_head + 1, __ATOMIC_RELEASE);
+        submitted++;
+    }
+    return submitted;
+}
+
+// Prochaine complétion, NULL si aucune; à acquitter par io_ring_cqe_seen()
+io_cqe_t* io_ring_peek_cqe(io_ring_t* ring) {
+    uint32_t tail = __atomic_load_n(&ring->cq_tail, __ATOMIC_ACQUIRE);
+    if (ring->cq_head == tail) return NULL;
+    return &ring->cqes[ring->cq_head & ring->cq_mask];
+}
+
+void io_ring_cqe_seen(io_ring_t* ring) {
+    __atomic_store_n(&ring->cq_head, ring->cq_head + 1, __ATOMIC_RELEASE);
+}
+
+// Soumettre puis attendre qu'au moins `min_complete` complétions soient disponibles.
+// Rend la main aux autres threads tant que des réceptions attendent leurs données.
+int32_t io_ring_wait(io_ring_t* ring, uint32_t min_complete) {
+    int32_t submitted = io_ring_submit(ring);
+    if (submitted < 0) return -1;
+
+    while (ring->cq_tail - ring->cq_head < min_complete) {
+        if (ring->pending_count == 0) break;
+        if (io_ring_poll(ring) == 0) schedule();
+    }
+    return submitted;
+}
+
+static void io_ring_poll_all(void* data) {
+    (void)data;
+    for (io_ring_t* ring = io_rings; ring; ring = ring->next) {
+        if (ring->pending_count > 0) io_ring_poll(ring);
+    }
+}
+
+void init_io_ring() {
+    io_rings = NULL;
+    create_callback("io-ring-poll", IO_RING_POLL_INTERVAL, io_ring_poll_all, NULL);
+}
@@ -0,0 +1,560 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+// Journal des métadonnées, au format jbd2 (journal ext3/ext4, sans sommes de contrôle).
+// Les blocs modifiés sont rattachés à la transaction en cours (journal_access) et épinglés
+// dans le cache; la validation les recopie à la suite dans le journal (descripteur, copies,
+// bloc de commit), puis les rend au cache qui les réécrit à leur place.
+// Au montage, les transactions validées mais pas encore reportées sont rejouées.
+
+#define JBD2_MAGIC 0xC03B3998
+#define JBD2_DESCRIPTOR_BLOCK 1
+#define JBD2_COMMIT_BLOCK 2
+#define JBD2_SUPERBLOCK_V1 3
+#define JBD2_SUPERBLOCK_V2 4
+#define JBD2_REVOKE_BLOCK 5
+
+#define JBD2_FLAG_ESCAPE 0x1
+#define JBD2_FLAG_SAME_UUID 0x2
+#define JBD2_FLAG_LAST_TAG 0x8
+
+#define JBD2_FEATURE_INCOMPAT_REVOKE 0x1
+#define JBD2_FEATURE_INCOMPAT_64BIT 0x2
+#define JBD2_FEATURE_INCOMPAT_ASYNC_COMMIT 0x4
+#define JBD2_FEATURE_INCOMPAT_CSUM_V2 0x8
+#define JBD2_FEATURE_INCOMPAT_CSUM_V3 0x10
+#define JBD2_FEATURE_COMPAT_CHECKSUM 0x1
+
+#define JOURNAL_MAX_EXTENTS 16
+#define JOURNAL_MAX_BUFFERS 512
+#define JOURNAL_WRITE_BATCH 16
+#define JOURNAL_MAX_REVOKES 1024
+
+// En-tête commun à tous les blocs du journal (grand-boutiste)
+typedef struct {
+    uint32_t magic;
+    uint32_t blocktype;
+    uint32_t sequence;
+} journal_header_t;
+
+typedef struct {
+    journal_header_t header;
+    uint32_t blocksize;
+    uint32_t maxlen;
+    uint32_t first;
+    uint32_t sequence;
+    uint32_t start;
+    uint32_t errno_value;
+    uint32_t feature_compat;
+    uint32_t feature_incompat;
+    uint32_t feature_ro_compat;
+    uint8_t uuid[16];
+} journal_superblock_t;
+
+// Place du journal sur le disque: blocs du journal [logical, logical + length)
+typedef struct {
+    uint32_t logical;
+    uint32_t physical;
+    uint32_t length;
+} journal_extent_t;
+
+typedef struct buffer {
+    uint32_t device;
+    uint32_t block;
+    uint32_t size;
+    uint8_t* data;
+} buffer_t;
+
+typedef struct {
+    uint64_t commits;
+    uint64_t blocks_logged;
+    uint64_t checkpoints;
+    uint64_t replayed;
+    uint32_t running;
+} journal_stats_t;
+
+typedef struct {
+    uint32_t block;
+    uint32_t sequence;
+} journal_revoke_t;
+
+typedef struct {
+    uint32_t device;
+    uint32_t block_size;
+    journal_extent_t extents[JOURNAL_MAX_EXTENTS];
+    uint32_t extent_count;
+    uint32_t first;
+    uint32_t last;
+    uint32_t tag_size;
+    uint32_t tags_per_descriptor;
+    uint32_t max_buffers;
+    uint8_t uuid[16];
+
+    // Journal circulaire: [tail, head) contient les transactions validées non reportées (tail = 0: vide)
+    uint32_t head;
+    uint32_t tail;
+    uint32_t tail_sequence;
+    uint32_t sequence;
+
+    // Transaction en cours
+    buffer_t* buffers[JOURNAL_MAX_BUFFERS];
+    uint32_t buffer_count;
+    uint32_t handles;
+
+    // Écritures du journal regroupées en une seule requête par série de blocs
+    uint8_t* batch;
+    uint32_t batch_start;
+    uint32_t batch_count;
+    journal_stats_t stats;
+} journal_t;
+
+// Déclarations externes (lib/device_manager.c, lib/buffer_cache.c)
+extern void* find_device_by_id(uint32_t device_id);
+extern int read_device(void* device, void* buffer, size_t size, size_t offset);
+extern int write_device(void* device, const void* buffer, size_t size, size_t offset);
+extern buffer_t* bcache_get(uint32_t device, uint32_t block, uint32_t size);
+extern void bcache_release(buffer_t* buffer);
+extern void bcache_mark_dirty(buffer_t* buffer);
+extern bool bcache_sync(uint32_t device);
+extern bool bcache_pin(buffer_t* buffer);
+extern void bcache_unpin(buffer_t* buffer);
+
+bool journal_commit(journal_t* journal);
+
+static uint32_t be32(uint32_t value) {
+    return (value >> 24) | ((value >> 8) & 0xFF00) | ((value << 8) & 0xFF0000) | (value << 24);
+}
+
+static uint16_t be16(uint16_t value) {
+    return (uint16_t)((value >> 8) | (value << 8));
+}
+
+// Bloc du disque qui contient le bloc `position` du journal
+static uint32_t journal_bmap(journal_t* journal, uint32_t position, uint32_t* run) {
+    for (uint32_t i = 0; i < journal->extent_count; i++) {
+        journal_extent_t* extent = &journal->extents[i];
+        if (position >= extent->logical && position - extent->logical < extent->length) {
+            if (run) *run = extent->length - (position - extent->logical);
+            return extent->physical + (position - extent->logical);
+        }
+    }
+    return 0;
+}
+
+static bool journal_io(journal_t* journal, uint32_t position, void* data, uint32_t count, bool write) {
+    void* device = find_device_by_id(journal->device);
+    if (!device) return false;
+
+    uint8_t* bytes = (uint8_t*)data;
+    while (count > 0) {
+        uint32_t run;
+        uint32_t block = journal_bmap(journal, position, &run);
+        if (!block) return false;
+        if (run > count) run = count;
+
+        size_t size = run * journal->block_size;
+        size_t offset = (size_t)block * journal->block_size;
+        int result = write ? write_device(device, bytes, size, offset) : read_device(device, bytes, size, offset);
+        if (result != (int)size) return false;
+
+        bytes += size;
+        position += run;
+        count -= run;
+    }
+    return true;
+}
+
+static uint32_t journal_next(journal_t* journal, uint32_t position) {
+    return position + 1 >= journal->last ? journal->first : position + 1;
+}
+
+static uint32_t journal_free_blocks(journal_t* journal) {
+    uint32_t size = journal->last - journal->first;
+    if (!journal->tail) return size - 1;
+    uint32_t used = journal->head >= journal->tail ? journal->head - journal->tail
+                                                   : size - (journal->tail - journal->head);
+    return size - used - 1;
+}
+
+static bool flush_batch(journal_t* journal) {
+    if (journal->batch_count == 0) return true;
+    bool success = journal_io(journal, journal->batch_start, journal->batch, journal->batch_count, true);
+    journal->batch_count = 0;
+    return success;
+}
+
+// Ajouter un bloc à la suite du journal
+static bool journal_append(journal_t* journal, const void* data) {
+    if (journal->batch_count == JOURNAL_WRITE_BATCH ||
+        (journal->batch_count > 0 && journal->head == journal->first)) {
+        if (!flush_batch(journal)) return false;
+    }
+    if (journal->batch_count == 0) journal->batch_start = journal->head;
+
+    memcpy(journal->batch + journal->batch_count * journal->block_size, data, journal->block_size);
+    journal->batch_count++;
+    journal->head = journal_next(journal, journal->head);
+    return true;
+}
+
+static bool write_journal_superblock(journal_t* journal) {
+    uint8_t* block = (uint8_t*)kmalloc(journal->block_size);
+    if (!block) return false;
+
+    bool success = journal_io(journal, 0, block, 1, false);
+    if (success) {
+        journal_superblock_t* sb = (journal_superblock_t*)block;
+        sb->sequence = be32(journal->tail ? journal->tail_sequence : journal->sequence);
+        sb->start = be32(journal->tail);
+        success = journal_io(journal, 0, block, 1, true);
+    }
+    kfree(block);
+    return success;
+}
+
+// Reporter les transactions validées à leur place, puis vider le journal.
+// Les tampons de la transaction en cours ne sont jamais sales (voir journal_access): la
+// synchronisation du cache ne réécrit que du contenu déjà validé.
+bool journal_checkpoint(journal_t* journal) {
+    if (!journal->tail) return true;
+    if (!bcache_sync(journal->device)) return false;
+
+    journal->tail = 0;
+    journal->head = journal->first;
+    journal->stats.checkpoints++;
+    return write_journal_superblock(journal);
+}
+
+// Ouvrir une opération qui modifiera au plus `credits` blocs de métadonnées.
+// Une transaction n'est validée qu'entre deux opérations: chacune y entre tout entière.
+void journal_start(journal_t* journal, uint32_t credits) {
+    if (!journal) return;
+    if (journal->handles == 0 && journal->buffer_count + credits > journal->max_buffers) {
+        journal_commit(journal);
+    }
+    journal->handles++;
+}
+
+void journal_stop(journal_t* journal) {
+    if (journal && journal->handles > 0) journal->handles--;
+}
+
+// À appeler avant de modifier un bloc de métadonnées. Renvoie false si le bloc ne peut pas
+// être journalisé: l'appelant le marque alors sale lui-même, comme sans journal.
+bool journal_access(journal_t* journal, buffer_t* buffer) {
+    if (!journal || !buffer || buffer->size != journal->block_size) return false;
+
+    for (uint32_t i = 0; i < journal->buffer_count; i++) {
+        if (journal->buffers[i] == buffer) return true;
+    }
+    if (journal->buffer_count >= JOURNAL_MAX_BUFFERS) return false;
+
+    // Contenu validé par une transaction précédente mais pas encore reporté: bcache_pin()
+    // l'écrit maintenant, avant que la transaction en cours ne le modifie
+    if (!bcache_pin(buffer)) return false;
+    journal->buffers[journal->buffer_count++] = buffer;
+    journal->stats.running = journal->buffer_count;
+    return true;
+}
+
+// Valider la transaction en cours: descripteurs et copies des blocs, puis bloc de commit
+bool journal_commit(journal_t* journal) {
+    if (!journal || journal->buffer_count == 0 || journal->handles > 0) return true;
+
+    uint32_t count = journal->buffer_count;
+    uint32_t descriptors = (count + journal->tags_per_descriptor - 1) / journal->tags_per_descriptor;
+    if (descriptors + count + 1 > journal_free_blocks(journal) && !journal_checkpoint(journal)) {
+        return false;
+    }
+
+    // Mode ordonné: les données atteignent le disque avant les métadonnées qui les désignent
+    bcache_sync(journal->device);
+
+    uint8_t* descriptor = (uint8_t*)kmalloc(journal->block_size * 2);
+    if (!descriptor) return false;
+    uint8_t* escaped = descriptor + journal->block_size;
+
+    uint32_t start = journal->head;
+    bool success = true;
+    for (uint32_t first = 0; first < count && success; first += journal->tags_per_descriptor) {
+        uint32_t batch = count - first;
+        if (batch > journal->tags_per_descriptor) batch = journal->tags_per_descriptor;
+
+        memset(descriptor, 0, journal->block_size);
+        journal_header_t* header = (journal_header_t*)descriptor;
+        header->magic = be32(JBD2_MAGIC);
+        header->blocktype = be32(JBD2_DESCRIPTOR_BLOCK);
+        header->sequence = be32(journal->sequence);
+
+        uint8_t* tag = descriptor + sizeof(journal_header_t);
+        for (uint32_t i = 0; i < batch; i++) {
+            buffer_t* buffer = journal->buffers[first + i];
+            uint16_t flags = i > 0 ? JBD2_FLAG_SAME_UUID : 0;
+            if (i == batch - 1) flags |= JBD2_FLAG_LAST_TAG;
+            if (be32(*(uint32_t*)buffer->data) == JBD2_MAGIC) flags |= JBD2_FLAG_ESCAPE;
+
+            *(uint32_t*)tag = be32(buffer->block);
+            *(uint16_t*)(tag + 6) = be16(flags);
+            tag += journal->tag_size;
+            if (i == 0) {
+                memcpy(tag, journal->uuid, 16);
+                tag += 16;
+            }
+        }
+        success = journal_append(journal, descriptor);
+
+        for (uint32_t i = 0; i < batch && success; i++) {
+            buffer_t* buffer = journal->buffers[first + i];
+            const uint8_t* data = buffer->data;
+            // Un bloc qui commence par le nombre magique serait pris pour un bloc du journal
+            if (be32(*(uint32_t*)data) == JBD2_MAGIC) {
+                memcpy(escaped, data, journal->block_size);
+                *(uint32_t*)escaped = 0;
+                data = escaped;
+            }
+            success = journal_append(journal, data);
+        }
+    }
+
+    // Le bloc de commit n'est écrit qu'une fois tous les autres sur le disque
+    if (success) success = flush_batch(journal);
+    if (success) {
+        memset(descriptor, 0, journal->block_size);
+        journal_header_t* header = (journal_header_t*)descriptor;
+        header->magic = be32(JBD2_MAGIC);
+        header->blocktype = be32(JBD2_COMMIT_BLOCK);
+        header->sequence = be32(journal->sequence);
+        success = journal_append(journal, descriptor) && flush_batch(journal);
+    }
+    kfree(descriptor);
+
+    if (!success) {
+        // Transaction non validée: rien n'a été reporté, on reprendra au même endroit
+        journal->head = start;
+        journal->batch_count = 0;
+        return false;
+    }
+
+    // Premier bloc du journal non vide: le superblock doit le désigner avant tout report
+    if (!journal->tail) {
+        journal->tail = start;
+        journal->tail_sequence = journal->sequence;
+        write_journal_superblock(journal);
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        bcache_unpin(journal->buffers[i]);
+    }
+    journal->buffer_count = 0;
+    journal->sequence++;
+    journal->stats.commits++;
+    journal->stats.blocks_logged += count;
+    journal->stats.running = 0;
+    return true;
+}
+
+static uint32_t block_type(const uint8_t* block) {
+    const journal_header_t* header = (const journal_header_t*)block;
+    return be32(header->magic) == JBD2_MAGIC ? be32(header->blocktype) : 0;
+}
+
+static bool is_revoked(journal_revoke_t* revokes, uint32_t count, uint32_t block, uint32_t sequence) {
+    for (uint32_t i = 0; i < count; i++) {
+        if (revokes[i].block == block && (int32_t)(revokes[i].sequence - sequence) >= 0) return true;
+    }
+    return false;
+}
+
+// Parcourir les transactions complètes à partir de la queue.
+// replay = false: relever les révocations et la fin du journal; true: recopier les blocs.
+static bool journal_pass(journal_t* journal, bool replay, uint32_t* end_sequence,
+                         journal_revoke_t* revokes, uint32_t* revoke_count) {
+    uint8_t* block = (uint8_t*)kmalloc(journal->block_size * 2);
+    if (!block) return false;
+    uint8_t* data = block + journal->block_size;
+
+    uint32_t position = journal->tail;
+    uint32_t sequence = journal->tail_sequence;
+    while (!replay || sequence != *end_sequence) {
+        // Une transaction n'est prise en compte que si son bloc de commit est présent
+        uint32_t scan = position;
+        uint32_t type;
+        while (true) {
+            if (!journal_io(journal, scan, block, 1, false)) break;
+            type = block_type(block);
+            if (type == 0 || be32(((journal_header_t*)block)->sequence) != sequence) {
+                type = 0;
+                break;
+            }
+            if (type == JBD2_COMMIT_BLOCK) break;
+
+            scan = journal_next(journal, scan);
+            if (type == JBD2_DESCRIPTOR_BLOCK) {
+                uint8_t* tag = block + sizeof(journal_header_t);
+                while (tag + journal->tag_size <= block + journal->block_size) {
+                    uint16_t flags = be16(*(uint16_t*)(tag + 6));
+                    uint32_t target = be32(*(uint32_t*)tag);
+                    if (replay) {
+                        if (!is_revoked(revokes, *revoke_count, target, sequence) &&
+                            journal_io(journal, scan, data, 1, false)) {
+                            if (flags & JBD2_FLAG_ESCAPE) *(uint32_t*)data = be32(JBD2_MAGIC);
+                            buffer_t* buffer = bcache_get(journal->device, target, journal->block_size);
+                            if (buffer) {
+                                memcpy(buffer->data, data, journal->block_size);
+                                bcache_mark_dirty(buffer);
+                                bcache_release(buffer);
+                                journal->stats.replayed++;
+                            }
+                        }
+                    }
+                    scan = journal_next(journal, scan);
+                    tag += journal->tag_size;
+                    if (!(flags & JBD2_FLAG_SAME_UUID)) tag += 16;
+                    if (flags & JBD2_FLAG_LAST_TAG) break;
+                }
+            } else if (type == JBD2_REVOKE_BLOCK && !replay) {
+                uint32_t size = be32(*(uint32_t*)(block + sizeof(journal_header_t)));
+                uint32_t record = journal->tag_size == 12 ? 8 : 4;
+                if (size > journal->block_size) size = journal->block_size;
+                for (uint32_t offset = sizeof(journal_header_t) + 4; offset + record <= size; offset += record) {
+                    uint32_t target = be32(*(uint32_t*)(block + offset + record - 4));
+                    if (*revoke_count < JOURNAL_MAX_REVOKES) {
+                        revokes[*revoke_count].block = target;
+                        revokes[(*revoke_count)++].sequence = sequence;
+                    }
+                }
+            } else if (type != JBD2_REVOKE_BLOCK) {
+                type = 0;
+                break;
+            }
+        }
+        if (type != JBD2_COMMIT_BLOCK) break;
+
+        position = journal_next(journal, scan);
+        sequence++;
+    }
+
+    if (!replay) *end_sequence = sequence;
+    journal->head = position;
+    journal->sequence = sequence;
+    kfree(block);
+    return true;
+}
+
+// Rejouer les transactions validées que le démontage précédent n'a pas reportées
+static bool journal_recover(journal_t* journal) {
+    journal_revoke_t* revokes = (journal_revoke_t*)kmalloc(JOURNAL_MAX_REVOKES * sizeof(journal_revoke_t));
+    if (!revokes) return false;
+
+    uint32_t revoke_count = 0;
+    uint32_t end_sequence;
+    bool success = journal_pass(journal, false, &end_sequence, revokes, &revoke_count) &&
+                   journal_pass(journal, true, &end_sequence, revokes, &revoke_count);
+    kfree(revokes);
+
+    // Les blocs rejoués doivent être sur le disque avant d'effacer le journal
+    if (success) success = bcache_sync(journal->device);
+    if (success) {
+        journal->tail = 0;
+        journal->head = journal->first;
+        success = write_journal_superblock(journal);
+    }
+    return success;
+}
+
+// Ouvrir le journal décrit par `extents` (blocs du périphérique), et le rejouer s'il le faut.
+// NULL sans journal utilisable. *failed indique alors si le journal peut contenir des
+// transactions non rejouées (lecture ou rejeu en échec, format non pris en charge mais non
+// vide): le montage doit échouer plutôt qu'écrire par-dessus.
+journal_t* journal_open(uint32_t device, uint32_t block_size, const journal_extent_t* extents, uint32_t extent_count,
+                        bool* failed) {
+    *failed = false;
+    if (extent_count == 0) return NULL;
+    *failed = true;
+    if (extent_count > JOURNAL_MAX_EXTENTS) return NULL;
+
+    journal_t* journal = (journal_t*)kmalloc(sizeof(journal_t));
+    if (!journal) return NULL;
+    memset(journal, 0, sizeof(journal_t));
+    journal->device = device;
+    journal->block_size = block_size;
+    memcpy(journal->extents, extents, extent_count * sizeof(journal_extent_t));
+    journal->extent_count = extent_count;
+
+    journal->batch = (uint8_t*)kmalloc(JOURNAL_WRITE_BATCH * block_size);
+    if (!journal->batch || !journal_io(journal, 0, journal->batch, 1, false)) {
+        kfree(journal->batch);
+        kfree(journal);
+        return NULL;
+    }
+
+    journal_superblock_t* sb = (journal_superblock_t*)journal->batch;
+    uint32_t type = be32(sb->header.blocktype);
+    uint32_t incompat = type == JBD2_SUPERBLOCK_V2 ? be32(sb->feature_incompat) : 0;
+    uint32_t compat = type == JBD2_SUPERBLOCK_V2 ? be32(sb->feature_compat) : 0;
+    bool is_journal = be32(sb->header.magic) == JBD2_MAGIC &&
+                      (type == JBD2_SUPERBLOCK_V1 || type == JBD2_SUPERBLOCK_V2);
+    bool supported = is_journal &&
+                     be32(sb->blocksize) == block_size &&
+                     !(incompat & ~(JBD2_FEATURE_INCOMPAT_REVOKE | JBD2_FEATURE_INCOMPAT_64BIT)) &&
+                     !(compat & JBD2_FEATURE_COMPAT_CHECKSUM);
+    if (!supported) {
+        // Sans superblock jbd2, ou journal vide: montage sans journal
+        *failed = is_journal && sb->start != 0;
+        kfree(journal->batch);
+        kfree(journal);
+        return NULL;
+    }
+
+    journal->first = be32(sb->first);
+    journal->last = be32(sb->maxlen);
+    journal->tail = be32(sb->start);
+    journal->sequence = journal->tail_sequence = be32(sb->sequence);
+    memcpy(journal->uuid, sb->uuid, 16);
+    journal->tag_size = (incompat & JBD2_FEATURE_INCOMPAT_64BIT) ? 12 : 8;
+    journal->tags_per_descriptor = (block_size - sizeof(journal_header_t) - 16) / journal->tag_size;
+
+    if (journal->first == 0 || journal->last <= journal->first + 4) {
+        *failed = journal->tail != 0;
+        kfree(journal->batch);
+        kfree(journal);
+        return NULL;
+    }
+
+    // Une transaction doit tenir dans le journal, descripteurs et bloc de commit compris.
+    // La moitié de la table reste disponible aux opérations imbriquées.
+    uint32_t capacity = journal->last - journal->first - 2;
+    journal->max_buffers = capacity * journal->tags_per_descriptor / (journal->tags_per_descriptor + 1) - 1;
+    if (journal->max_buffers > JOURNAL_MAX_BUFFERS / 2) journal->max_buffers = JOURNAL_MAX_BUFFERS / 2;
+
+    journal->head = journal->first;
+    if (journal->tail && !journal_recover(journal)) {
+        kfree(journal->batch);
+        kfree(journal);
+        return NULL;
+    }
+    *failed = false;
+    return journal;
+}
+
+// Démontage: valider, reporter, et laisser un journal vide
+void journal_close(journal_t* journal) {
+    if (!journal) return;
+    journal->handles = 0;
+    journal_commit(journal);
+    journal_checkpoint(journal);
+
+    // Une transaction qui n'a pas pu être validée est rendue au cache telle quelle
+    for (uint32_t i = 0; i < journal->buffer_count; i++) {
+        bcache_unpin(journal->buffers[i]);
+    }
+    kfree(journal->batch);
+    kfree(journal);
+}
+
+void journal_get_stats(journal_t* journal, journal_stats_t* stats) {
+    if (journal && stats) {
+        memcpy(stats, &journal->stats, sizeof(journal_stats_t));
+    }
+}
@@ -6,12 +6,27 @@
 #define PAGE_PRESENT 0x1
 #define PAGE_WRITE 0x2
 #define PAGE_USER 0x4
+#define PAGE_WRITE_THROUGH 0x8
+#define PAGE_CACHE_DISABLE 0x10
 #define PAGE_SIZE_4MB 0x80
 #define PAGE_DIRECTORY_ENTRIES 1024
 #define PAGE_TABLE_ENTRIES 1024
 #define KERNEL_BASE 0xC0000000
 #define USER_BASE 0x40000000
 
+// Fenêtre virtuelle réservée aux projections de périphériques (ioremap)
+#define IOREMAP_BASE 0xF0000000
+#define IOREMAP_END 0xFF800000
+#define RESOURCE_TYPE_VIRTUAL 5
+
+#define MSR_IA32_PAT 0x277
+#define CPUID_FEATURE_PAT (1 << 16)
+#define PAT_TYPE_UC 0x00
+#define PAT_TYPE_WC 0x01
+#define PAT_TYPE_WT 0x04
+#define PAT_TYPE_WB 0x06
+#define PAT_TYPE_UC_MINUS 0x07
+
 typedef uint32_t page_directory_t[PAGE_DIRECTORY_ENTRIES];
 typedef uint32_t page_table_t[PAGE_TABLE_ENTRIES];
 
@@ -24,6 +39,8 @@ typedef struct {
 
 static address_space_t kernel_space;
 static address_space_t* current_space = &kernel_space;
+static bool pat_enabled = false;
+static bool ioremap_ready = false;
 
 void init_memory() {
     kernel_space.directory = (page_directory_t*)kmalloc_aligned(sizeof(page_directory_t), PAGE_SIZE);
@@ -170,4 +187,114 @@ void vfree(void* ptr) {
     uint32_t physical_addr = current_space->tables[directory_index][table_index] & ~0xFFF;
     kfree((void*)physical_addr);
     unmap_page(current_space, virtual_addr);
-} 
\ No newline at end of file
+}
+
+// Espace d'adressage actif (gestionnaire de faute de page, lib/mmap.c)
+address_space_t* get_current_space() {
+    return current_space;
+}
+
+// Traduire une adresse virtuelle noyau en adresse physique (pour le DMA)
+uint32_t virt_to_phys(const void* ptr) {
+    uint32_t addr = (uint32_t)ptr;
+    uint32_t page = addr / PAGE_SIZE;
+    uint32_t table = page / PAGE_TABLE_ENTRIES;
+    uint32_t entry = page % PAGE_TABLE_ENTRIES;
+    if (!current_space->tables[table]) return 0;
+    uint32_t pte = (*current_space->tables[table])[entry];
+    if (!(pte & PAGE_PRESENT)) return 0;
+    return (pte & ~0xFFF) | (addr & 0xFFF);
+}
+
+static inline void cpuid(uint32_t leaf, uint32_t* eax, uint32_t* ebx, uint32_t* ecx, uint32_t* edx) {
+    asm volatile("cpuid" : "=a"(*eax), "=b"(*ebx), "=c"(*ecx), "=d"(*edx) : "a"(leaf), "c"(0));
+}
+
+static inline void write_msr(uint32_t msr, uint64_t value) {
+    asm volatile("wrmsr" : : "c"(msr), "a"((uint32_t)value), "d"((uint32_t)(value >> 32)));
+}
+
+static inline void invalidate_page(uint32_t virtual_addr) {
+    asm volatile("invlpg (%0)" : : "r"(virtual_addr) : "memory");
+}
+
+// Reprogrammer l'entrée PAT 1 (PWT seul) en write-combining.
+// Les autres entrées gardent leur valeur par défaut: WB, WT, UC-, UC.
+static void init_pat() {
+    uint32_t eax, ebx, ecx, edx;
+    cpuid(1, &eax, &ebx, &ecx, &edx);
+    if (!(edx & CPUID_FEATURE_PAT)) return;
+
+    uint64_t pat = (uint64_t)PAT_TYPE_WB |
+                   ((uint64_t)PAT_TYPE_WC << 8) |
+                   ((uint64_t)PAT_TYPE_UC_MINUS << 16) |
+                   ((uint64_t)PAT_TYPE_UC << 24) |
+                   ((uint64_t)PAT_TYPE_WB << 32) |
+                   ((uint64_t)PAT_TYPE_WT << 40) |
+                   ((uint64_t)PAT_TYPE_UC_MINUS << 48) |
+                   ((uint64_t)PAT_TYPE_UC << 56);
+    write_msr(MSR_IA32_PAT, pat);
+    pat_enabled = true;
+}
+
+static bool set_kernel_pte(uint32_t virtual_addr, uint32_t pte) {
+    uint32_t table = virtual_addr >> 22;
+    uint32_t entry = (virtual_addr >> 12) & 0x3FF;
+
+    if (!kernel_space.tables[table]) {
+        page_table_t* new_table = (page_table_t*)kmalloc_aligned(sizeof(page_table_t), PAGE_SIZE);
+        if (!new_table) return false;
+        memset(new_table, 0, sizeof(page_table_t));
+        kernel_space.tables[table] = new_table;
+        (*kernel_space.directory)[table] = virt_to_phys(new_table) | PAGE_PRESENT | PAGE_WRITE;
+    }
+
+    (*kernel_space.tables[table])[entry] = pte;
+    invalidate_page(virtual_addr);
+    return true;
+}
+
+// Projeter une plage physique de périphérique dans le noyau.
+// write_combining: framebuffers et BAR préchargeables; sinon non-cachable (registres).
+void* ioremap(uint32_t physical_addr, uint32_t size, bool write_combining) {
+    if (size == 0) return NULL;
+
+    if (!ioremap_ready) {
+        init_pat();
+        register_resource(IOREMAP_BASE, IOREMAP_END, RESOURCE_TYPE_VIRTUAL);
+        ioremap_ready = true;
+    }
+
+    uint32_t offset = physical_addr & 0xFFF;
+    uint32_t base = physical_addr & ~0xFFF;
+    uint32_t length = (size + offset + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+
+    uint32_t virtual_addr;
+    if (!allocate_resource_aligned(RESOURCE_TYPE_VIRTUAL, length, PAGE_SIZE, &virtual_addr)) return NULL;
+
+    // Sans PAT, PWT seul donnerait du write-through: retomber sur UC
+    uint32_t cache_flags = (write_combining && pat_enabled) ? PAGE_WRITE_THROUGH
+                                                             : PAGE_CACHE_DISABLE | PAGE_WRITE_THROUGH;
+
+    for (uint32_t i = 0; i < length; i += PAGE_SIZE) {
+        if (!set_kernel_pte(virtual_addr + i, (base + i) | PAGE_PRESENT | PAGE_WRITE | cache_flags)) {
+            for (uint32_t j = 0; j < i; j += PAGE_SIZE) {
+                set_kernel_pte(virtual_addr + j, 0);
+            }
+            free_resource_type(RESOURCE_TYPE_VIRTUAL, virtual_addr);
+            return NULL;
+        }
+    }
+
+    return (void*)(virtual_addr + offset);
+}
+
+void iounmap(void* ptr) {
+    uint32_t start, size;
+    if (!find_resource(RESOURCE_TYPE_VIRTUAL, (uint32_t)ptr, &start, &size)) return;
+
+    for (uint32_t i = 0; i < size; i += PAGE_SIZE) {
+        set_kernel_pte(start + i, 0);
+    }
+    free_resource_type(RESOURCE_TYPE_VIRTUAL, start);
+}
\ No newline at end of file
@@ -0,0 +1,593 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+// Projection de fichiers en mémoire (mmap_file).
+// Une zone réserve une plage virtuelle d'un espace d'adressage; les pages sont remplies
+// à la faute depuis le cache de pages, indexé par (fichier projetable, numéro de page).
+// MAP_SHARED: toutes les zones voient la même page physique, et les écritures (bit Dirty
+// de la PTE) sont réécrites dans le fichier par msync_file(), munmap_file() ou périodiquement.
+// MAP_PRIVATE: la page du cache est projetée en lecture seule, et copiée à la première écriture.
+
+#define PAGE_SIZE 4096
+#define PAGE_PRESENT 0x1
+#define PAGE_WRITE 0x2
+#define PAGE_USER 0x4
+#define PAGE_DIRTY 0x40
+#define PAGE_DIRECTORY_ENTRIES 1024
+#define PAGE_TABLE_ENTRIES 1024
+
+// Bits libres des PTE: page appartenant à une zone projetée, copie privée d'une page
+#define PTE_MMAP_AREA 0x200
+#define PTE_MMAP_PRIVATE 0x400
+
+// Code d'erreur de la faute de page
+#define PAGE_FAULT_PRESENT 0x1
+#define PAGE_FAULT_WRITE 0x2
+
+#define PROT_READ 0x1
+#define PROT_WRITE 0x2
+#define MAP_SHARED 0x1
+#define MAP_PRIVATE 0x2
+
+// Fenêtre des projections, au-dessus des allocations de vmalloc()
+#define MMAP_BASE 0x80000000
+#define MMAP_END 0xC0000000
+#define MMAP_MAX_AREAS 128
+#define PAGE_CACHE_MAX_PAGES 4096
+#define PAGE_CACHE_HASH_SIZE 1024
+#define MMAP_WRITEBACK_INTERVAL 5000000
+
+typedef uint32_t page_directory_t[PAGE_DIRECTORY_ENTRIES];
+typedef uint32_t page_table_t[PAGE_TABLE_ENTRIES];
+
+typedef struct {
+    page_directory_t* directory;
+    page_table_t* tables[PAGE_DIRECTORY_ENTRIES];
+    uint32_t free_pages[PAGE_DIRECTORY_ENTRIES];
+    uint32_t free_page_count;
+} address_space_t;
+
+// Fichier projetable: chaque système de fichiers en place un dans son inode en mémoire
+// et fournit la lecture et l'écriture d'une page (lib/vfs.c)
+typedef struct mapping mapping_t;
+
+typedef struct {
+    // Renvoie le nombre d'octets valides de la page (0 au-delà de la fin du fichier)
+    int32_t (*read_page)(mapping_t* mapping, uint32_t index, void* page);
+    int32_t (*write_page)(mapping_t* mapping, uint32_t index, const void* page);
+    // Rendre la référence prise par vfs_get_mapping()
+    void (*put)(mapping_t* mapping);
+} mapping_operations_t;
+
+struct mapping {
+    const mapping_operations_t* ops;
+    // Pages du fichier dans le cache: l'inode ne peut être recyclé qu'après page_cache_invalidate()
+    uint32_t page_count;
+};
+
+typedef struct page {
+    mapping_t* mapping;
+    uint32_t index;
+    uint8_t* data;
+    // Octets valides: la page qui contient la fin du fichier est complétée par des zéros
+    uint32_t length;
+    // PTE qui projettent la page et envois réseau en cours: elle ne peut pas être recyclée
+    // tant qu'il est non nul
+    uint32_t refcount;
+    bool dirty;
+    // Plus aucune zone ne projette le fichier: libérée par le dernier page_put()
+    bool orphan;
+    struct page* hash_next;
+} page_t;
+
+typedef struct {
+    address_space_t* space;
+    uint32_t start;
+    uint32_t length;
+    mapping_t* mapping;
+    uint32_t offset;
+    uint32_t prot;
+    uint32_t flags;
+    // MAP_PRIVATE inscriptible: adresse noyau de la copie privée de chaque page (NULL sinon);
+    // la PTE ne donne que l'adresse physique
+    uint8_t** copies;
+    bool used;
+} mmap_area_t;
+
+typedef struct {
+    uint64_t faults;
+    uint64_t cache_hits;
+    uint64_t copies;
+    uint64_t writebacks;
+    uint32_t pages;
+    uint32_t areas;
+} mmap_stats_t;
+
+typedef struct {
+    page_t pages[PAGE_CACHE_MAX_PAGES];
+    page_t* hash[PAGE_CACHE_HASH_SIZE];
+    page_t* free_list;
+    uint32_t page_count;
+    uint32_t clock_hand;
+    mmap_area_t areas[MMAP_MAX_AREAS];
+    mmap_stats_t stats;
+} mmap_manager_t;
+
+static mmap_manager_t mmap_manager;
+
+// Déclarations externes (lib/memory.c, lib/vfs.c)
+extern address_space_t* get_current_space();
+extern uint32_t virt_to_phys(const void* ptr);
+extern bool map_page(address_space_t* space, uint32_t virtual_addr, uint32_t physical_addr, uint32_t flags);
+extern bool unmap_page(address_space_t* space, uint32_t virtual_addr);
+extern mapping_t* vfs_get_mapping(int fd);
+
+static inline void invalidate_page(uint32_t virtual_addr) {
+    asm volatile("invlpg (%0)" : : "r"(virtual_addr) : "memory");
+}
+
+static uint32_t* get_pte(address_space_t* space, uint32_t virtual_addr) {
+    uint32_t page = virtual_addr / PAGE_SIZE;
+    page_table_t* table = space->tables[page / PAGE_TABLE_ENTRIES];
+    if (!table) return NULL;
+    return &(*table)[page % PAGE_TABLE_ENTRIES];
+}
+
+static uint32_t page_hash(mapping_t* mapping, uint32_t index) {
+    uint32_t key = (uint32_t)mapping ^ (index * 0x9E3779B1);
+    return (key ^ (key >> 16)) & (PAGE_CACHE_HASH_SIZE - 1);
+}
+
+static page_t* find_page(mapping_t* mapping, uint32_t index) {
+    page_t* page = mmap_manager.hash[page_hash(mapping, index)];
+    while (page) {
+        if (page->mapping == mapping && page->index == index) return page;
+        page = page->hash_next;
+    }
+    return NULL;
+}
+
+static void page_hash_remove(page_t* page) {
+    page_t** link = &mmap_manager.hash[page_hash(page->mapping, page->index)];
+    while (*link && *link != page) {
+        link = &(*link)->hash_next;
+    }
+    if (*link) *link = page->hash_next;
+    page->hash_next = NULL;
+}
+
+static bool writeback_page(page_t* page) {
+    if (!page->dirty) return true;
+    if (page->mapping->ops->write_page(page->mapping, page->index, page->data) < 0) return false;
+    page->dirty = false;
+    mmap_manager.stats.writebacks++;
+    return true;
+}
+
+static void release_page(page_t* page) {
+    page_hash_remove(page);
+    page->mapping->page_count--;
+    kfree(page->data);
+    page->data = NULL;
+    page->mapping = NULL;
+    page->orphan = false;
+    page->hash_next = mmap_manager.free_list;
+    mmap_manager.free_list = page;
+    mmap_manager.stats.pages--;
+}
+
+// Trouver un descripteur libre; à défaut, recycler une page que plus aucune PTE ne projette
+static page_t* alloc_page_slot() {
+    if (mmap_manager.free_list) {
+        page_t* page = mmap_manager.free_list;
+        mmap_manager.free_list = page->hash_next;
+        return page;
+    }
+    if (mmap_manager.page_count < PAGE_CACHE_MAX_PAGES) {
+        return &mmap_manager.pages[mmap_manager.page_count++];
+    }
+
+    for (uint32_t n = 0; n < PAGE_CACHE_MAX_PAGES; n++) {
+        page_t* page = &mmap_manager.pages[mmap_manager.clock_hand];
+        mmap_manager.clock_hand = (mmap_manager.clock_hand + 1) % PAGE_CACHE_MAX_PAGES;
+        if (page->mapping && page->refcount == 0 && writeback_page(page)) {
+            release_page(page);
+            mmap_manager.free_list = page->hash_next;
+            return page;
+        }
+    }
+    return NULL;
+}
+
+// Obtenir la page `index` du fichier, lue au besoin; à rendre par page_put()
+static page_t* page_get(mapping_t* mapping, uint32_t index) {
+    page_t* page = find_page(mapping, index);
+    if (page) {
+        mmap_manager.stats.cache_hits++;
+        page->refcount++;
+        page->orphan = false;
+        return page;
+    }
+
+    page = alloc_page_slot();
+    if (!page) return NULL;
+
+    page->data = (uint8_t*)kmalloc_aligned(PAGE_SIZE, PAGE_SIZE);
+    if (!page->data) {
+        page->hash_next = mmap_manager.free_list;
+        mmap_manager.free_list = page;
+        return NULL;
+    }
+
+    // Au-delà de la fin du fichier, la page est complétée par des zéros
+    int32_t length = mapping->ops->read_page(mapping, index, page->data);
+    if (length < 0) {
+        kfree(page->data);
+        page->data = NULL;
+        page->hash_next = mmap_manager.free_list;
+        mmap_manager.free_list = page;
+        return NULL;
+    }
+    if (length < PAGE_SIZE) memset(page->data + length, 0, PAGE_SIZE - length);
+
+    page->mapping = mapping;
+    page->index = index;
+    page->length = length;
+    page->refcount = 1;
+    page->dirty = false;
+    page->orphan = false;
+
+    uint32_t bucket = page_hash(mapping, index);
+    page->hash_next = mmap_manager.hash[bucket];
+    mmap_manager.hash[bucket] = page;
+    mapping->page_count++;
+    mmap_manager.stats.pages++;
+    return page;
+}
+
+static void page_put(page_t* page) {
+    if (!page || page->refcount == 0) return;
+    if (--page->refcount == 0 && page->orphan) {
+        writeback_page(page);
+        release_page(page);
+    }
+}
+
+static mmap_area_t* find_area(address_space_t* space, uint32_t address) {
+    for (uint32_t i = 0; i < MMAP_MAX_AREAS; i++) {
+        mmap_area_t* area = &mmap_manager.areas[i];
+        if (area->used && area->space == space &&
+            address >= area->start && address - area->start < area->length) {
+            return area;
+        }
+    }
+    return NULL;
+}
+
+// Première plage libre de `length` octets dans la fenêtre des projections
+static uint32_t find_free_range(address_space_t* space, uint32_t length) {
+    uint32_t start = MMAP_BASE;
+    while (start <= MMAP_END - length) {
+        bool moved = false;
+
+        for (uint32_t i = 0; i < MMAP_MAX_AREAS; i++) {
+            mmap_area_t* area = &mmap_manager.areas[i];
+            if (area->used && area->space == space &&
+                start < area->start + area->length && area->start < start + length) {
+                start = area->start + area->length;
+                moved = true;
+            }
+        }
+        if (moved) continue;
+
+        // Pages déjà occupées par d'autres allocations
+        for (uint32_t address = start; address < start + length; address += PAGE_SIZE) {
+            uint32_t* pte = get_pte(space, address);
+            if (pte && *pte) {
+                start = address + PAGE_SIZE;
+                moved = true;
+                break;
+            }
+        }
+        if (!moved) return start;
+    }
+    return 0;
+}
+
+// Récolter le bit Dirty posé par le processeur sur les PTE d'une zone partagée
+static void collect_dirty(mmap_area_t* area) {
+    if (!(area->flags & MAP_SHARED) || !(area->prot & PROT_WRITE)) return;
+
+    for (uint32_t address = area->start; address < area->start + area->length; address += PAGE_SIZE) {
+        uint32_t* pte = get_pte(area->space, address);
+        if (!pte || !(*pte & PAGE_PRESENT) || !(*pte & PAGE_DIRTY)) continue;
+
+        page_t* page = find_page(area->mapping, (area->offset + address - area->start) / PAGE_SIZE);
+        if (page) page->dirty = true;
+        *pte &= ~PAGE_DIRTY;
+        invalidate_page(address);
+    }
+}
+
+// Réécrire les pages modifiées d'un fichier (NULL = tous les fichiers projetés)
+static bool writeback_mapping(mapping_t* mapping) {
+    bool success = true;
+    for (uint32_t i = 0; i < MMAP_MAX_AREAS; i++) {
+        mmap_area_t* area = &mmap_manager.areas[i];
+        if (area->used && (!mapping || area->mapping == mapping)) collect_dirty(area);
+    }
+    for (uint32_t i = 0; i < mmap_manager.page_count; i++) {
+        page_t* page = &mmap_manager.pages[i];
+        if (page->mapping && page->dirty && (!mapping || page->mapping == mapping)) {
+            success &= writeback_page(page);
+        }
+    }
+    return success;
+}
+
+// Projeter `length` octets du fichier ouvert `fd` à partir de `offset` (multiple de PAGE_SIZE).
+// Le descripteur peut être fermé ensuite: la zone garde sa propre référence sur l'inode.
+void* mmap_file(address_space_t* space, int fd, uint32_t offset, uint32_t length, uint32_t prot, uint32_t flags) {
+    if (!space || !length || (offset & (PAGE_SIZE - 1))) return NULL;
+    if (!(flags & MAP_SHARED) == !(flags & MAP_PRIVATE)) return NULL;
+    if (length > MMAP_END - MMAP_BASE) return NULL;
+    length = (length + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+
+    mmap_area_t* area = NULL;
+    for (uint32_t i = 0; i < MMAP_MAX_AREAS; i++) {
+        if (!mmap_manager.areas[i].used) {
+            area = &mmap_manager.areas[i];
+            break;
+        }
+    }
+    if (!area) return NULL;
+
+    uint32_t start = find_free_range(space, length);
+    if (!start) return NULL;
+
+    uint8_t** copies = NULL;
+    if ((flags & MAP_PRIVATE) && (prot & PROT_WRITE)) {
+        copies = (uint8_t**)kmalloc(length / PAGE_SIZE * sizeof(uint8_t*));
+        if (!copies) return NULL;
+        memset(copies, 0, length / PAGE_SIZE * sizeof(uint8_t*));
+    }
+
+    mapping_t* mapping = vfs_get_mapping(fd);
+    if (!mapping) {
+        kfree(copies);
+        return NULL;
+    }
+
+    // Réserver les PTE (non présentes): vmalloc() et les autres projections passeront à côté
+    for (uint32_t address = start; address < start + length; address += PAGE_SIZE) {
+        if (!map_page(space, address, 0, PTE_MMAP_AREA)) {
+            for (uint32_t undo = start; undo < address; undo += PAGE_SIZE) {
+                unmap_page(space, undo);
+            }
+            mapping->ops->put(mapping);
+            kfree(copies);
+            return NULL;
+        }
+    }
+
+    area->space = space;
+    area->start = start;
+    area->length = length;
+    area->mapping = mapping;
+    area->offset = offset;
+    area->prot = prot;
+    area->flags = flags;
+    area->copies = copies;
+    area->used = true;
+    mmap_manager.stats.areas++;
+    return (void*)start;
+}
+
+// Copie privée de `page` pour une zone MAP_PRIVATE
+static bool map_private_copy(mmap_area_t* area, uint32_t address, const uint8_t* data) {
+    uint8_t* copy = (uint8_t*)kmalloc_aligned(PAGE_SIZE, PAGE_SIZE);
+    if (!copy) return false;
+    memcpy(copy, data, PAGE_SIZE);
+
+    uint32_t physical = virt_to_phys(copy);
+    if (!physical || !map_page(area->space, address, physical,
+                               PAGE_PRESENT | PAGE_WRITE | PAGE_USER | PTE_MMAP_AREA | PTE_MMAP_PRIVATE)) {
+        kfree(copy);
+        return false;
+    }
+    area->copies[(address - area->start) / PAGE_SIZE] = copy;
+    mmap_manager.stats.copies++;
+    return true;
+}
+
+// Appelé par le gestionnaire de faute de page; false si l'adresse n'appartient à aucune zone
+bool mmap_handle_fault(uint32_t address, uint32_t error_code) {
+    address_space_t* space = get_current_space();
+    mmap_area_t* area = find_area(space, address);
+    if (!area) return false;
+
+    bool write = error_code & PAGE_FAULT_WRITE;
+    if (write && !(area->prot & PROT_WRITE)) return false;
+
+    uint32_t page_address = address & ~(PAGE_SIZE - 1);
+    uint32_t index = (area->offset + page_address - area->start) / PAGE_SIZE;
+    uint32_t* pte = get_pte(space, page_address);
+    mmap_manager.stats.faults++;
+
+    // Écriture sur une page du cache projetée en lecture seule: copie à l'écriture
+    if (pte && (*pte & PAGE_PRESENT)) {
+        if (!write || !(area->flags & MAP_PRIVATE) || (*pte & PTE_MMAP_PRIVATE)) return false;
+
+        page_t* page = find_page(area->mapping, index);
+        if (!page || !map_private_copy(area, page_address, page->data)) return false;
+        page_put(page);
+        invalidate_page(page_address);
+        return true;
+    }
+
+    page_t* page = page_get(area->mapping, index);
+    if (!page) return false;
+
+    if (write && (area->flags & MAP_PRIVATE)) {
+        bool mapped = map_private_copy(area, page_address, page->data);
+        page_put(page);
+        if (mapped) invalidate_page(page_address);
+        return mapped;
+    }
+
+    uint32_t flags = PAGE_PRESENT | PAGE_USER | PTE_MMAP_AREA;
+    if ((area->flags & MAP_SHARED) && (area->prot & PROT_WRITE)) flags |= PAGE_WRITE;
+    uint32_t physical = virt_to_phys(page->data);
+    if (!physical || !map_page(space, page_address, physical, flags)) {
+        page_put(page);
+        return false;
+    }
+    invalidate_page(page_address);
+    return true;
+}
+
+// Réécrire les pages modifiées de la zone qui contient `address`
+bool msync_file(address_space_t* space, void* address) {
+    mmap_area_t* area = find_area(space, (uint32_t)address);
+    if (!area) return false;
+    return writeback_mapping(area->mapping);
+}
+
+static void unmap_area(mmap_area_t* area) {
+    collect_dirty(area);
+
+    for (uint32_t address = area->start; address < area->start + area->length; address += PAGE_SIZE) {
+        uint32_t* pte = get_pte(area->space, address);
+        if (pte && (*pte & PAGE_PRESENT)) {
+            if (*pte & PTE_MMAP_PRIVATE) {
+                kfree(area->copies[(address - area->start) / PAGE_SIZE]);
+            } else {
+                page_put(find_page(area->mapping, (area->offset + address - area->start) / PAGE_SIZE));
+            }
+        }
+        unmap_page(area->space, address);
+        invalidate_page(address);
+    }
+
+    kfree(area->copies);
+    area->copies = NULL;
+    area->used = false;
+    mmap_manager.stats.areas--;
+
+    // Dernière zone du fichier: réécrire et libérer ses pages avant de rendre l'inode.
+    // Une page encore référencée (envoi sendfile en cours) est libérée par son dernier page_put().
+    for (uint32_t i = 0; i < MMAP_MAX_AREAS; i++) {
+        if (mmap_manager.areas[i].used && mmap_manager.areas[i].mapping == area->mapping) {
+            area->mapping->ops->put(area->mapping);
+            return;
+        }
+    }
+
+    for (uint32_t i = 0; i < mmap_manager.page_count && area->mapping->page_count > 0; i++) {
+        page_t* page = &mmap_manager.pages[i];
+        if (page->mapping != area->mapping) continue;
+
+        writeback_page(page);
+        if (page->refcount == 0) {
+            release_page(page);
+        } else {
+            page->orphan = true;
+        }
+    }
+    area->mapping->ops->put(area->mapping);
+}
+
+// Supprimer la zone qui commence à `address`
+bool munmap_file(address_space_t* space, void* address) {
+    mmap_area_t* area = find_area(space, (uint32_t)address);
+    if (!area || area->start != (uint32_t)address) return false;
+    unmap_area(area);
+    return true;
+}
+
+// Fin d'un processus: supprimer toutes ses zones
+void mmap_release_space(address_space_t* space) {
+    for (uint32_t i = 0; i < MMAP_MAX_AREAS; i++) {
+        mmap_area_t* area = &mmap_manager.areas[i];
+        if (area->used && area->space == space) unmap_area(area);
+    }
+}
+
+// Écriture par le système de fichiers: garder les pages résidentes cohérentes avec le fichier
+void page_cache_write(mapping_t* mapping, uint32_t offset, const void* data, uint32_t size) {
+    if (mapping->page_count == 0) return;
+
+    uint32_t done = 0;
+    while (done < size) {
+        uint32_t position = offset + done;
+        uint32_t page_offset = position % PAGE_SIZE;
+        uint32_t chunk = PAGE_SIZE - page_offset;
+        if (chunk > size - done) chunk = size - done;
+
+        page_t* page = find_page(mapping, position / PAGE_SIZE);
+        if (page) {
+            memcpy(page->data + page_offset, (const uint8_t*)data + done, chunk);
+            if (page->length < page_offset + chunk) page->length = page_offset + chunk;
+        }
+        done += chunk;
+    }
+}
+
+// Le système de fichiers va recycler l'inode qui porte `mapping`: réécrire et oublier ses
+// pages, pour qu'un autre fichier placé dans le même inode ne les retrouve pas.
+// Faux si l'une d'elles est encore référencée ou ne peut être réécrite: l'inode doit rester.
+bool page_cache_invalidate(mapping_t* mapping) {
+    if (mapping->page_count == 0) return true;
+
+    for (uint32_t i = 0; i < mmap_manager.page_count; i++) {
+        page_t* page = &mmap_manager.pages[i];
+        if (page->mapping == mapping && page->refcount > 0) return false;
+    }
+    for (uint32_t i = 0; i < mmap_manager.page_count && mapping->page_count > 0; i++) {
+        page_t* page = &mmap_manager.pages[i];
+        if (page->mapping != mapping) continue;
+        if (!writeback_page(page)) return false;
+        release_page(page);
+    }
+    return true;
+}
+
+// Référence sur une page du cache, pour l'envoyer sans copie (sendfile); à rendre par
+// page_cache_put() une fois la transmission terminée
+page_t* page_cache_get(mapping_t* mapping, uint32_t index) {
+    return page_get(mapping, index);
+}
+
+// Contenu de la page et nombre d'octets valides
+const uint8_t* page_cache_data(page_t* page, uint32_t* length) {
+    if (length) *length = page->length;
+    return page->data;
+}
+
+void page_cache_put(page_t* page) {
+    page_put(page);
+}
+
+// Rendre la référence prise par vfs_get_mapping()
+void mapping_put(mapping_t* mapping) {
+    if (mapping) mapping->ops->put(mapping);
+}
+
+void mmap_get_stats(mmap_stats_t* stats) {
+    if (stats) {
+        memcpy(stats, &mmap_manager.stats, sizeof(mmap_stats_t));
+    }
+}
+
+static void mmap_writeback(void* data) {
+    (void)data;
+    if (mmap_manager.stats.areas > 0) {
+        writeback_mapping(NULL);
+    }
+}
+
+void init_mmap() {
+    memset(&mmap_manager, 0, sizeof(mmap_manager_t));
+    create_callback("mmap-writeback", MMAP_WRITEBACK_INTERVAL, mmap_writeback, NULL);
+}
@@ -0,0 +1,140 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+// Table des points de montage: arbre des composants de chemin ("/", "home", "user"...).
+// Un noeud porte le montage attaché à son chemin; la recherche descend composant par
+// composant et garde le montage le plus profond rencontré (plus long préfixe), donc
+// "/home" l'emporte sur "/" quel que soit l'ordre des montages, et "/home2" ne
+// correspond pas à "/home".
+
+typedef struct mount_node {
+    char* name;
+    uint32_t length;
+    // Montage attaché à ce chemin, NULL pour un simple noeud intermédiaire
+    void* mount;
+    struct mount_node* parent;
+    struct mount_node* children;
+    struct mount_node* next;
+} mount_node_t;
+
+typedef struct {
+    mount_node_t root;
+    uint32_t count;
+} mount_table_t;
+
+// Composant suivant de `path`: saute les '/' et renvoie sa longueur
+static const char* next_component(const char* path, uint32_t* length) {
+    while (*path == '/') path++;
+    const char* end = path;
+    while (*end && *end != '/') end++;
+    *length = end - path;
+    return path;
+}
+
+static mount_node_t* find_child(mount_node_t* node, const char* name, uint32_t length) {
+    for (mount_node_t* child = node->children; child; child = child->next) {
+        if (child->length == length && memcmp(child->name, name, length) == 0) {
+            return child;
+        }
+    }
+    return NULL;
+}
+
+mount_table_t* mount_table_create() {
+    mount_table_t* table = (mount_table_t*)kmalloc(sizeof(mount_table_t));
+    if (!table) return NULL;
+    memset(table, 0, sizeof(mount_table_t));
+    return table;
+}
+
+// Attacher `mount` à `path`; false si le chemin est déjà un point de montage
+bool mount_table_add(mount_table_t* table, const char* path, void* mount) {
+    if (!table || !path || !mount) return false;
+
+    mount_node_t* node = &table->root;
+    uint32_t length;
+    const char* name = next_component(path, &length);
+    while (length) {
+        mount_node_t* child = find_child(node, name, length);
+        if (!child) {
+            child = (mount_node_t*)kmalloc(sizeof(mount_node_t));
+            if (!child) return false;
+            memset(child, 0, sizeof(mount_node_t));
+            child->name = (char*)kmalloc(length);
+            if (!child->name) {
+                kfree(child);
+                return false;
+            }
+            memcpy(child->name, name, length);
+            child->length = length;
+            child->parent = node;
+            child->next = node->children;
+            node->children = child;
+        }
+        node = child;
+        name = next_component(name + length, &length);
+    }
+
+    if (node->mount) return false;
+    node->mount = mount;
+    table->count++;
+    return true;
+}
+
+// Détacher le montage de `path`; renvoie ce montage (NULL si `path` n'est pas monté)
+void* mount_table_remove(mount_table_t* table, const char* path) {
+    if (!table || !path) return NULL;
+
+    mount_node_t* node = &table->root;
+    uint32_t length;
+    const char* name = next_component(path, &length);
+    while (length && node) {
+        node = find_child(node, name, length);
+        name = next_component(name + length, &length);
+    }
+    if (!node || !node->mount) return NULL;
+
+    void* mount = node->mount;
+    node->mount = NULL;
+    table->count--;
+
+    // Élaguer les noeuds devenus inutiles
+    while (node != &table->root && !node->mount && !node->children) {
+        mount_node_t* parent = node->parent;
+        mount_node_t** link = &parent->children;
+        while (*link != node) link = &(*link)->next;
+        *link = node->next;
+        kfree(node->name);
+        kfree(node);
+        node = parent;
+    }
+    return mount;
+}
+
+// Montage du plus long préfixe de `path`. `relative` reçoit la suite du chemin sous
+// ce montage, commençant par '/' ("/" pour la racine du montage).
+void* mount_table_lookup(mount_table_t* table, const char* path, const char** relative) {
+    if (!table || !path) return NULL;
+
+    mount_node_t* node = &table->root;
+    void* best = node->mount;
+    const char* best_rest = path;
+
+    uint32_t length;
+    const char* name = next_component(path, &length);
+    while (length) {
+        node = find_child(node, name, length);
+        if (!node) break;
+        if (node->mount) {
+            best = node->mount;
+            best_rest = name + length;
+        }
+        name = next_component(name + length, &length);
+    }
+
+    if (best && relative) {
+        *relative = *best_rest ? best_rest : "/";
+    }
+    return best;
+}
@@ -69,6 +69,12 @@ typedef struct {
 
 static network_manager_t network_manager;
 
+// Déclarations externes (lib/checksum.c)
+extern uint32_t checksum_partial(const void* data, uint32_t length, uint32_t sum);
+extern uint32_t checksum_copy(void* dest, const void* source, uint32_t length, uint32_t sum);
+extern uint32_t checksum_pseudo_header(uint32_t source_ip, uint32_t dest_ip, uint8_t protocol, uint16_t length, uint32_t sum);
+extern uint16_t checksum_fold(uint32_t sum);
+
 void init_network_manager() {
     memset(&network_manager, 0, sizeof(network_manager_t));
     network_manager.next_socket_id = 1;
@@ -76,35 +82,23 @@ void init_network_manager() {
     network_manager.packet_buffer_size = 64;
 }
 
+// Les champs checksum sont remis à zéro avant la somme: l'appelant y range le résultat
 uint16_t calculate_ip_checksum(ip_header_t* header) {
-    uint32_t sum = 0;
-    uint16_t* ptr = (uint16_t*)header;
-    for (int i = 0; i < sizeof(ip_header_t) / 2; i++) {
-        sum += ptr[i];
-    }
-    while (sum >> 16) {
-        sum = (sum & 0xFFFF) + (sum >> 16);
-    }
-    return ~sum;
+    header->header_checksum = 0;
+    return checksum_fold(checksum_partial(header, sizeof(ip_header_t), 0));
 }
 
-uint16_t calculate_tcp_checksum(tcp_header_t* header, uint8_t* data, uint16_t data_length) {
-    uint32_t sum = 0;
-    uint16_t* ptr = (uint16_t*)header;
-    for (int i = 0; i < sizeof(tcp_header_t) / 2; i++) {
-        sum += ptr[i];
-    }
-    ptr = (uint16_t*)data;
-    for (int i = 0; i < data_length / 2; i++) {
-        sum += ptr[i];
-    }
-    if (data_length % 2) {
-        sum += data[data_length - 1];
-    }
-    while (sum >> 16) {
-        sum = (sum & 0xFFFF) + (sum >> 16);
-    }
-    return ~sum;
+// Checksum TCP à partir de la somme déjà calculée de la charge, pseudo-en-tête compris
+static uint16_t tcp_checksum(tcp_header_t* header, uint32_t source_ip, uint32_t dest_ip,
+                             uint32_t payload_sum, uint32_t payload_length) {
+    header->checksum = 0;
+    uint32_t sum = checksum_pseudo_header(source_ip, dest_ip, 6, sizeof(tcp_header_t) + payload_length, payload_sum);
+    return checksum_fold(checksum_partial(header, sizeof(tcp_header_t), sum));
+}
+
+uint16_t calculate_tcp_checksum(tcp_header_t* header, uint32_t source_ip, uint32_t dest_ip,
+                                uint8_t* data, uint16_t data_length) {
+    return tcp_checksum(header, source_ip, dest_ip, data ? checksum_partial(data, data_length, 0) : 0, data ? data_length : 0);
 }
 
 uint32_t create_socket(uint32_t local_ip, uint16_t local_port) {
@@ -157,13 +151,14 @@ bool send_data(uint32_t socket_id, const uint8_t* data, uint32_t length) {
                 tcp_header->dest_port = socket->remote_port;
                 tcp_header->sequence_number = socket->sequence_number;
                 tcp_header->acknowledgment_number = socket->acknowledgment_number;
-                tcp_header->data_offset = sizeof(tcp_header_t) / 4;
+                tcp_header->data_offset = (sizeof(tcp_header_t) / 4) << 4;
                 tcp_header->flags = 0x18;
                 tcp_header->window_size = socket->window_size;
                 tcp_header->urgent_pointer = 0;
 
-                memcpy(packet->data + sizeof(tcp_header_t), data + offset, segment_size);
-                tcp_header->checksum = calculate_tcp_checksum(tcp_header, packet->data + sizeof(tcp_header_t), segment_size);
+                // Copie et somme de la charge en un seul passage
+                uint32_t payload_sum = checksum_copy(packet->data + sizeof(tcp_header_t), data + offset, segment_size, 0);
+                tcp_header->checksum = tcp_checksum(tcp_header, socket->local_ip, socket->remote_ip, payload_sum, segment_size);
 
                 ip_header_t* ip_header = (ip_header_t*)(packet->data - sizeof(ip_header_t));
                 ip_header->version_ihl = 0x45;
@@ -251,11 +246,11 @@ void handle_tcp_packet(packet_t* packet) {
                     ack_tcp_header->dest_port = tcp_header->source_port;
                     ack_tcp_header->sequence_number = socket->sequence_number;
                     ack_tcp_header->acknowledgment_number = socket->acknowledgment_number;
-                    ack_tcp_header->data_offset = sizeof(tcp_header_t) / 4;
+                    ack_tcp_header->data_offset = (sizeof(tcp_header_t) / 4) << 4;
                     ack_tcp_header->flags = 0x10;
                     ack_tcp_header->window_size = socket->window_size;
                     ack_tcp_header->urgent_pointer = 0;
-                    ack_tcp_header->checksum = calculate_tcp_checksum(ack_tcp_header, NULL, 0);
+                    ack_tcp_header->checksum = calculate_tcp_checksum(ack_tcp_header, socket->local_ip, packet->source_ip, NULL, 0);
 
                     ip_header_t* ack_ip_header = (ip_header_t*)(ack_packet->data - sizeof(ip_header_t));
                     ack_ip_header->version_ihl = 0x45;
@@ -0,0 +1,438 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define PCI_CONFIG_ADDRESS 0xCF8
+#define PCI_CONFIG_DATA 0xCFC
+#define PCI_MAX_BUSES 256
+#define PCI_MAX_SLOTS 32
+#define PCI_MAX_FUNCTIONS 8
+#define PCI_MAX_BARS 6
+#define PCI_DRIVER_HASH_SIZE 64
+
+#define PCI_VENDOR_ID 0x00
+#define PCI_DEVICE_ID 0x02
+#define PCI_COMMAND 0x04
+#define PCI_REVISION 0x08
+#define PCI_PROG_IF 0x09
+#define PCI_SUBCLASS 0x0A
+#define PCI_CLASS 0x0B
+#define PCI_HEADER_TYPE 0x0E
+#define PCI_BAR0 0x10
+#define PCI_SECONDARY_BUS 0x19
+#define PCI_INTERRUPT_LINE 0x3C
+
+#define PCI_HEADER_NORMAL 0x00
+#define PCI_HEADER_BRIDGE 0x01
+#define PCI_HEADER_MULTIFUNCTION 0x80
+
+#define PCI_COMMAND_IO 0x1
+#define PCI_COMMAND_MEMORY 0x2
+#define PCI_COMMAND_MASTER 0x4
+
+#define PCI_BAR_IO 0x1
+#define PCI_BAR_TYPE_64 0x4
+#define PCI_BAR_PREFETCH 0x8
+
+// Fenêtres d'adresses attribuables aux BAR non programmés par le firmware
+#define PCI_IO_WINDOW_START 0x1000
+#define PCI_IO_WINDOW_END 0x10000
+#define PCI_MMIO_WINDOW_START 0xE0000000
+#define PCI_MMIO_WINDOW_END 0xFEC00000
+
+#define RESOURCE_TYPE_IO 1
+#define RESOURCE_TYPE_MEMORY 2
+
+typedef enum {
+    DEVICE_TYPE_CHAR,
+    DEVICE_TYPE_BLOCK,
+    DEVICE_TYPE_NETWORK,
+    DEVICE_TYPE_DISPLAY,
+    DEVICE_TYPE_SOUND,
+    DEVICE_TYPE_INPUT
+} device_type_t;
+
+typedef enum {
+    DEVICE_STATE_READY,
+    DEVICE_STATE_BUSY,
+    DEVICE_STATE_ERROR,
+    DEVICE_STATE_OFFLINE
+} device_state_t;
+
+typedef struct {
+    uint32_t id;
+    char name[32];
+    device_type_t type;
+    device_state_t state;
+    void* driver;
+    void* data;
+    uint32_t irq;
+    uint8_t dma_channel;
+} device_t;
+
+typedef struct {
+    char name[32];
+    device_type_t type;
+    bool (*init)(device_t* device);
+    void (*deinit)(device_t* device);
+    int (*read)(device_t* device, void* buffer, size_t size, size_t offset);
+    int (*write)(device_t* device, const void* buffer, size_t size, size_t offset);
+    int (*ioctl)(device_t* device, uint32_t request, void* arg);
+} driver_t;
+
+typedef struct {
+    uint8_t bus;
+    uint8_t slot;
+    uint8_t function;
+} pci_address_t;
+
+typedef struct {
+    uint32_t base;
+    uint32_t size;
+    bool is_io;
+    bool prefetchable;
+    void* mapping;
+} pci_bar_t;
+
+typedef struct pci_device {
+    pci_address_t address;
+    uint16_t vendor_id;
+    uint16_t device_id;
+    uint8_t class_code;
+    uint8_t subclass;
+    uint8_t prog_if;
+    uint8_t revision;
+    uint8_t header_type;
+    uint8_t irq;
+    pci_bar_t bars[PCI_MAX_BARS];
+    uint32_t bound_device_id;
+    struct pci_device* next;
+} pci_device_t;
+
+typedef struct pci_driver_entry {
+    uint32_t key;
+    const driver_t* driver;
+    struct pci_driver_entry* next;
+} pci_driver_entry_t;
+
+typedef struct {
+    pci_device_t* devices;
+    pci_device_t* last_device;
+    uint32_t device_count;
+    // Correspondance vendor:device puis classe:sous-classe -> pilote
+    pci_driver_entry_t* id_drivers[PCI_DRIVER_HASH_SIZE];
+    pci_driver_entry_t* class_drivers[PCI_DRIVER_HASH_SIZE];
+    uint32_t scanned_buses[PCI_MAX_BUSES / 32];
+} pci_bus_t;
+
+static pci_bus_t pci_bus;
+
+extern void* ioremap(uint32_t physical_addr, uint32_t size, bool write_combining);
+extern void iounmap(void* ptr);
+
+static inline void outl(uint16_t port, uint32_t value) {
+    asm volatile("outl %0, %1" : : "a"(value), "Nd"(port));
+}
+
+static inline uint32_t inl(uint16_t port) {
+    uint32_t value;
+    asm volatile("inl %1, %0" : "=a"(value) : "Nd"(port));
+    return value;
+}
+
+static uint32_t pci_config_address(const pci_address_t* addr, uint8_t offset) {
+    return 0x80000000 | ((uint32_t)addr->bus << 16) | ((uint32_t)addr->slot << 11) |
+           ((uint32_t)addr->function << 8) | (offset & 0xFC);
+}
+
+uint32_t pci_config_read32(const pci_address_t* addr, uint8_t offset) {
+    outl(PCI_CONFIG_ADDRESS, pci_config_address(addr, offset));
+    return inl(PCI_CONFIG_DATA);
+}
+
+uint16_t pci_config_read16(const pci_address_t* addr, uint8_t offset) {
+    return (uint16_t)(pci_config_read32(addr, offset) >> ((offset & 2) * 8));
+}
+
+uint8_t pci_config_read8(const pci_address_t* addr, uint8_t offset) {
+    return (uint8_t)(pci_config_read32(addr, offset) >> ((offset & 3) * 8));
+}
+
+void pci_config_write32(const pci_address_t* addr, uint8_t offset, uint32_t value) {
+    outl(PCI_CONFIG_ADDRESS, pci_config_address(addr, offset));
+    outl(PCI_CONFIG_DATA, value);
+}
+
+void pci_config_write16(const pci_address_t* addr, uint8_t offset, uint16_t value) {
+    uint32_t shift = (offset & 2) * 8;
+    uint32_t old = pci_config_read32(addr, offset);
+    pci_config_write32(addr, offset, (old & ~(0xFFFF << shift)) | ((uint32_t)value << shift));
+}
+
+// Mesurer les BAR: écrire des 1, relire le masque, restaurer la valeur d'origine
+static void pci_size_bars(pci_device_t* dev, uint32_t count) {
+    pci_address_t* addr = &dev->address;
+    uint16_t command = pci_config_read16(addr, PCI_COMMAND);
+    pci_config_write16(addr, PCI_COMMAND, command & ~(PCI_COMMAND_IO | PCI_COMMAND_MEMORY));
+
+    for (uint32_t i = 0; i < count; i++) {
+        uint8_t offset = PCI_BAR0 + i * 4;
+        uint32_t original = pci_config_read32(addr, offset);
+        pci_config_write32(addr, offset, 0xFFFFFFFF);
+        uint32_t mask = pci_config_read32(addr, offset);
+        pci_config_write32(addr, offset, original);
+
+        if (mask == 0 || mask == 0xFFFFFFFF) continue;
+
+        pci_bar_t* bar = &dev->bars[i];
+        if (original & PCI_BAR_IO) {
+            uint32_t io_mask = mask & ~0x3;
+            if (!(io_mask & 0xFFFF0000)) io_mask |= 0xFFFF0000;
+            bar->is_io = true;
+            bar->base = original & ~0x3;
+            bar->size = ~io_mask + 1;
+            continue;
+        }
+
+        bar->base = original & ~0xF;
+        bar->size = ~(mask & ~0xF) + 1;
+        bar->prefetchable = (original & PCI_BAR_PREFETCH) != 0;
+
+        if (original & PCI_BAR_TYPE_64) {
+            // Partie haute: un BAR placé au-delà de 4 Go est inaccessible en 32 bits
+            uint32_t high = pci_config_read32(addr, offset + 4);
+            if (high != 0) {
+                bar->base = 0;
+                bar->size = 0;
+            }
+            i++;
+        }
+    }
+
+    pci_config_write16(addr, PCI_COMMAND, command);
+}
+
+// Réserver les plages déjà programmées, attribuer celles laissées à zéro
+static void pci_assign_bars(pci_device_t* dev, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        pci_bar_t* bar = &dev->bars[i];
+        if (bar->size == 0) continue;
+
+        uint32_t type = bar->is_io ? RESOURCE_TYPE_IO : RESOURCE_TYPE_MEMORY;
+        if (bar->base != 0) {
+            claim_resource(type, bar->base, bar->size);
+            continue;
+        }
+
+        uint32_t base;
+        if (!allocate_resource_aligned(type, bar->size, bar->size, &base)) continue;
+
+        uint8_t offset = PCI_BAR0 + i * 4;
+        uint32_t flags = pci_config_read32(&dev->address, offset) & (bar->is_io ? 0x3 : 0xF);
+        pci_config_write32(&dev->address, offset, base | flags);
+        bar->base = base;
+    }
+}
+
+static void pci_scan_bus(uint8_t bus);
+
+static void pci_scan_function(const pci_address_t* addr) {
+    uint32_t id = pci_config_read32(addr, PCI_VENDOR_ID);
+    if ((id & 0xFFFF) == 0xFFFF) return;
+
+    pci_device_t* dev = (pci_device_t*)kmalloc(sizeof(pci_device_t));
+    if (!dev) return;
+    memset(dev, 0, sizeof(pci_device_t));
+
+    dev->address = *addr;
+    dev->vendor_id = id & 0xFFFF;
+    dev->device_id = id >> 16;
+    dev->class_code = pci_config_read8(addr, PCI_CLASS);
+    dev->subclass = pci_config_read8(addr, PCI_SUBCLASS);
+    dev->prog_if = pci_config_read8(addr, PCI_PROG_IF);
+    dev->revision = pci_config_read8(addr, PCI_REVISION);
+    dev->header_type = pci_config_read8(addr, PCI_HEADER_TYPE);
+    dev->irq = pci_config_read8(addr, PCI_INTERRUPT_LINE);
+
+    uint32_t bar_count = 0;
+    if ((dev->header_type & 0x7F) == PCI_HEADER_NORMAL) {
+        bar_count = 6;
+    } else if ((dev->header_type & 0x7F) == PCI_HEADER_BRIDGE) {
+        bar_count = 2;
+    }
+    pci_size_bars(dev, bar_count);
+    pci_assign_bars(dev, bar_count);
+
+    if (pci_bus.last_device) {
+        pci_bus.last_device->next = dev;
+    } else {
+        pci_bus.devices = dev;
+    }
+    pci_bus.last_device = dev;
+    pci_bus.device_count++;
+
+    // Pont PCI-PCI: descendre sur le bus secondaire
+    if ((dev->header_type & 0x7F) == PCI_HEADER_BRIDGE) {
+        pci_scan_bus(pci_config_read8(addr, PCI_SECONDARY_BUS));
+    }
+}
+
+static void pci_scan_bus(uint8_t bus) {
+    if (pci_bus.scanned_buses[bus / 32] & (1u << (bus % 32))) return;
+    pci_bus.scanned_buses[bus / 32] |= 1u << (bus % 32);
+
+    for (uint32_t slot = 0; slot < PCI_MAX_SLOTS; slot++) {
+        pci_address_t addr = { bus, slot, 0 };
+        if (pci_config_read16(&addr, PCI_VENDOR_ID) == 0xFFFF) continue;
+
+        uint32_t functions = (pci_config_read8(&addr, PCI_HEADER_TYPE) & PCI_HEADER_MULTIFUNCTION) ? PCI_MAX_FUNCTIONS : 1;
+        for (uint32_t function = 0; function < functions; function++) {
+            addr.function = function;
+            pci_scan_function(&addr);
+        }
+    }
+}
+
+// Parcourir l'espace de configuration depuis le(s) pont(s) hôte(s)
+void init_pci() {
+    memset(&pci_bus, 0, sizeof(pci_bus_t));
+
+    register_resource(PCI_IO_WINDOW_START, PCI_IO_WINDOW_END, RESOURCE_TYPE_IO);
+    register_resource(PCI_MMIO_WINDOW_START, PCI_MMIO_WINDOW_END, RESOURCE_TYPE_MEMORY);
+
+    pci_address_t host = { 0, 0, 0 };
+    if (pci_config_read8(&host, PCI_HEADER_TYPE) & PCI_HEADER_MULTIFUNCTION) {
+        // Plusieurs contrôleurs hôtes: la fonction N gère le bus N
+        for (uint32_t function = 0; function < PCI_MAX_FUNCTIONS; function++) {
+            host.function = function;
+            if (pci_config_read16(&host, PCI_VENDOR_ID) == 0xFFFF) continue;
+            pci_scan_bus(function);
+        }
+    } else {
+        pci_scan_bus(0);
+    }
+}
+
+static uint32_t pci_hash(uint32_t key) {
+    key ^= key >> 16;
+    key *= 0x45D9F3B;
+    key ^= key >> 16;
+    return key & (PCI_DRIVER_HASH_SIZE - 1);
+}
+
+static bool pci_add_driver_entry(pci_driver_entry_t** table, uint32_t key, const driver_t* driver) {
+    pci_driver_entry_t* entry = (pci_driver_entry_t*)kmalloc(sizeof(pci_driver_entry_t));
+    if (!entry) return false;
+
+    uint32_t bucket = pci_hash(key);
+    entry->key = key;
+    entry->driver = driver;
+    entry->next = table[bucket];
+    table[bucket] = entry;
+    return true;
+}
+
+static const driver_t* pci_lookup_driver(pci_driver_entry_t** table, uint32_t key) {
+    for (pci_driver_entry_t* entry = table[pci_hash(key)]; entry; entry = entry->next) {
+        if (entry->key == key) return entry->driver;
+    }
+    return NULL;
+}
+
+bool pci_register_driver(uint16_t vendor_id, uint16_t device_id, const driver_t* driver) {
+    return pci_add_driver_entry(pci_bus.id_drivers, ((uint32_t)vendor_id << 16) | device_id, driver);
+}
+
+bool pci_register_class_driver(uint8_t class_code, uint8_t subclass, const driver_t* driver) {
+    return pci_add_driver_entry(pci_bus.class_drivers, ((uint32_t)class_code << 8) | subclass, driver);
+}
+
+// L'identifiant exact l'emporte sur un pilote générique de classe
+static const driver_t* pci_match_driver(const pci_device_t* dev) {
+    const driver_t* driver = pci_lookup_driver(pci_bus.id_drivers,
+                                               ((uint32_t)dev->vendor_id << 16) | dev->device_id);
+    if (driver) return driver;
+    return pci_lookup_driver(pci_bus.class_drivers, ((uint32_t)dev->class_code << 8) | dev->subclass);
+}
+
+// Créer un device_t pour chaque fonction PCI reconnue par un pilote enregistré
+void pci_bind_drivers() {
+    for (pci_device_t* dev = pci_bus.devices; dev; dev = dev->next) {
+        if (dev->bound_device_id) continue;
+
+        const driver_t* driver = pci_match_driver(dev);
+        if (!driver) continue;
+
+        device_t device;
+        memset(&device, 0, sizeof(device_t));
+        device.id = allocate_device_id();
+        strncpy(device.name, driver->name, sizeof(device.name) - 1);
+        device.type = driver->type;
+        device.driver = (void*)driver;
+        device.data = dev;
+        device.irq = dev->irq;
+        device.dma_channel = 0xFF;
+
+        if (register_device(&device)) {
+            dev->bound_device_id = device.id;
+        }
+    }
+}
+
+// Activer le décodage des BAR et le bus mastering (DMA)
+void pci_enable_device(pci_device_t* dev) {
+    uint16_t command = pci_config_read16(&dev->address, PCI_COMMAND);
+    command |= PCI_COMMAND_IO | PCI_COMMAND_MEMORY | PCI_COMMAND_MASTER;
+    pci_config_write16(&dev->address, PCI_COMMAND, command);
+}
+
+uint32_t pci_bar_address(pci_device_t* dev, uint32_t bar) {
+    return bar < PCI_MAX_BARS ? dev->bars[bar].base : 0;
+}
+
+uint32_t pci_bar_size(pci_device_t* dev, uint32_t bar) {
+    return bar < PCI_MAX_BARS ? dev->bars[bar].size : 0;
+}
+
+bool pci_bar_is_io(pci_device_t* dev, uint32_t bar) {
+    return bar < PCI_MAX_BARS && dev->bars[bar].is_io;
+}
+
+bool pci_bar_is_prefetchable(pci_device_t* dev, uint32_t bar) {
+    return bar < PCI_MAX_BARS && dev->bars[bar].prefetchable;
+}
+
+// Projeter un BAR mémoire dans le noyau; les BAR préchargeables (framebuffer)
+// sont projetés en write-combining, les registres en non-cachable.
+void* pci_map_bar(pci_device_t* dev, uint32_t bar) {
+    if (bar >= PCI_MAX_BARS) return NULL;
+
+    pci_bar_t* entry = &dev->bars[bar];
+    if (entry->is_io || entry->size == 0 || entry->base == 0) return NULL;
+
+    if (!entry->mapping) {
+        entry->mapping = ioremap(entry->base, entry->size, entry->prefetchable);
+    }
+    return entry->mapping;
+}
+
+// Défaire la projection d'un BAR (échec d'initialisation ou retrait du pilote)
+void pci_unmap_bar(pci_device_t* dev, uint32_t bar) {
+    if (bar >= PCI_MAX_BARS || !dev->bars[bar].mapping) return;
+
+    iounmap(dev->bars[bar].mapping);
+    dev->bars[bar].mapping = NULL;
+}
+
+pci_device_t* pci_find_device(uint16_t vendor_id, uint16_t device_id, uint32_t index) {
+    for (pci_device_t* dev = pci_bus.devices; dev; dev = dev->next) {
+        if (dev->vendor_id == vendor_id && dev->device_id == device_id && index-- == 0) {
+            return dev;
+        }
+    }
+    return NULL;
+}
+
+uint32_t pci_device_count() {
+    return pci_bus.device_count;
+}
@@ -26,6 +26,7 @@ typedef struct {
     uint32_t id;
     char name[32];
     uint32_t page_directory;
+    void* fd_table;
     thread_t threads[MAX_THREADS_PER_PROCESS];
     uint32_t thread_count;
     uint32_t priority;
@@ -43,6 +44,13 @@ typedef struct {
 
 static process_manager_t process_manager;
 
+// Déclarations externes (lib/mmap.c, lib/fd_table.c, lib/vfs.c)
+extern void mmap_release_space(void* space);
+extern void* fd_table_create();
+extern void fd_table_destroy(void* table, void (*close_object)(void* object));
+extern void* get_kernel_fd_table();
+extern void vfs_release_file(void* object);
+
 void init_process_manager() {
     memset(&process_manager, 0, sizeof(process_manager_t));
     process_manager.next_process_id = 1;
@@ -58,6 +66,7 @@ uint32_t create_process(const char* name, uint32_t priority) {
     process->id = process_id;
     strncpy(process->name, name, sizeof(process->name) - 1);
     process->page_directory = create_address_space();
+    process->fd_table = fd_table_create();
     process->thread_count = 0;
     process->priority = priority;
     process->active = true;
@@ -74,6 +83,9 @@ void terminate_process(uint32_t process_id) {
                     kfree((void*)process->threads[j].stack);
                 }
             }
+            fd_table_destroy(process->fd_table, vfs_release_file);
+            process->fd_table = NULL;
+            mmap_release_space((void*)process->page_directory);
             destroy_address_space(process->page_directory);
             process->active = false;
             break;
@@ -81,6 +93,14 @@ void terminate_process(uint32_t process_id) {
     }
 }
 
+// Descripteurs de fichiers du processus courant (table du noyau hors de tout processus)
+void* current_fd_table() {
+    if (process_manager.process_count == 0) return get_kernel_fd_table();
+    process_t* process = &process_manager.processes[process_manager.current_process];
+    if (!process->active || !process->fd_table) return get_kernel_fd_table();
+    return process->fd_table;
+}
+
 uint32_t create_thread(uint32_t process_id, void* entry_point, uint32_t priority) {
     for (uint32_t i = 0; i < process_manager.process_count; i++) {
         if (process_manager.processes[i].id == process_id) {
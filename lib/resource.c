@@ -0,0 +1,344 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+// Gestionnaire de ressources pour les périphériques (ports I/O, MMIO, IRQ, DMA)
+// et pour la fenêtre virtuelle des projections ioremap.
+// Chaque type possède deux arbres AVL indexés par adresse de début:
+//  - les plages libres, augmentées de la plus grande longueur du sous-arbre,
+//  - les plages allouées, pour retrouver une allocation en O(log n).
+// Les bornes sont inclusives en interne (`last`) pour couvrir tout l'espace 32 bits.
+
+#define RESOURCE_TYPE_IO 1
+#define RESOURCE_TYPE_MEMORY 2
+#define RESOURCE_TYPE_IRQ 3
+#define RESOURCE_TYPE_DMA 4
+#define RESOURCE_TYPE_VIRTUAL 5
+#define RESOURCE_TYPE_COUNT 6
+
+typedef struct resource_node {
+    uint32_t start;
+    uint32_t last;
+    uint32_t max_length;
+    int32_t height;
+    struct resource_node* left;
+    struct resource_node* right;
+} resource_node_t;
+
+typedef struct {
+    resource_node_t* free_ranges;
+    resource_node_t* used_ranges;
+} resource_space_t;
+
+static resource_space_t resource_spaces[RESOURCE_TYPE_COUNT];
+
+static resource_space_t* get_resource_space(uint32_t type) {
+    if (type == 0 || type >= RESOURCE_TYPE_COUNT) return NULL;
+    return &resource_spaces[type];
+}
+
+// Longueur - 1 pour éviter le débordement d'une plage couvrant 4 Go
+static uint32_t range_span(const resource_node_t* node) {
+    return node->last - node->start;
+}
+
+static int32_t node_height(const resource_node_t* node) {
+    return node ? node->height : 0;
+}
+
+static uint32_t node_max(const resource_node_t* node) {
+    return node ? node->max_length : 0;
+}
+
+static void node_update(resource_node_t* node) {
+    int32_t left = node_height(node->left);
+    int32_t right = node_height(node->right);
+    node->height = (left > right ? left : right) + 1;
+
+    uint32_t max = range_span(node);
+    if (node_max(node->left) > max) max = node_max(node->left);
+    if (node_max(node->right) > max) max = node_max(node->right);
+    node->max_length = max;
+}
+
+static resource_node_t* rotate_right(resource_node_t* node) {
+    resource_node_t* pivot = node->left;
+    node->left = pivot->right;
+    pivot->right = node;
+    node_update(node);
+    node_update(pivot);
+    return pivot;
+}
+
+static resource_node_t* rotate_left(resource_node_t* node) {
+    resource_node_t* pivot = node->right;
+    node->right = pivot->left;
+    pivot->left = node;
+    node_update(node);
+    node_update(pivot);
+    return pivot;
+}
+
+static resource_node_t* rebalance(resource_node_t* node) {
+    node_update(node);
+    int32_t balance = node_height(node->left) - node_height(node->right);
+
+    if (balance > 1) {
+        if (node_height(node->left->left) < node_height(node->left->right)) {
+            node->left = rotate_left(node->left);
+        }
+        return rotate_right(node);
+    }
+    if (balance < -1) {
+        if (node_height(node->right->right) < node_height(node->right->left)) {
+            node->right = rotate_right(node->right);
+        }
+        return rotate_left(node);
+    }
+    return node;
+}
+
+static resource_node_t* tree_insert(resource_node_t* root, resource_node_t* node) {
+    if (!root) {
+        node->left = node->right = NULL;
+        node_update(node);
+        return node;
+    }
+
+    if (node->start < root->start) {
+        root->left = tree_insert(root->left, node);
+    } else {
+        root->right = tree_insert(root->right, node);
+    }
+    return rebalance(root);
+}
+
+static resource_node_t* tree_remove_min(resource_node_t* root, resource_node_t** min) {
+    if (!root->left) {
+        *min = root;
+        return root->right;
+    }
+    root->left = tree_remove_min(root->left, min);
+    return rebalance(root);
+}
+
+// Détacher le noeud commençant à `start` (sans le libérer)
+static resource_node_t* tree_remove(resource_node_t* root, uint32_t start, resource_node_t** removed) {
+    if (!root) return NULL;
+
+    if (start < root->start) {
+        root->left = tree_remove(root->left, start, removed);
+    } else if (start > root->start) {
+        root->right = tree_remove(root->right, start, removed);
+    } else {
+        *removed = root;
+        if (!root->left) return root->right;
+        if (!root->right) return root->left;
+
+        resource_node_t* successor;
+        resource_node_t* right = tree_remove_min(root->right, &successor);
+        successor->left = root->left;
+        successor->right = right;
+        return rebalance(successor);
+    }
+    return rebalance(root);
+}
+
+static resource_node_t* tree_find(resource_node_t* root, uint32_t start) {
+    while (root && root->start != start) {
+        root = start < root->start ? root->left : root->right;
+    }
+    return root;
+}
+
+// Plage dont le début est le plus grand <= address
+static resource_node_t* tree_floor(resource_node_t* root, uint32_t address) {
+    resource_node_t* best = NULL;
+    while (root) {
+        if (root->start <= address) {
+            best = root;
+            root = root->right;
+        } else {
+            root = root->left;
+        }
+    }
+    return best;
+}
+
+static uint32_t align_up(uint32_t value, uint32_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// Vrai si [start, last] peut contenir `size` octets alignés; renvoie l'adresse choisie
+static bool range_fits(const resource_node_t* node, uint32_t size, uint32_t alignment, uint32_t* base) {
+    uint32_t aligned = align_up(node->start, alignment);
+    if (aligned < node->start || aligned > node->last) return false;
+    if (node->last - aligned < size - 1) return false;
+    *base = aligned;
+    return true;
+}
+
+// Premier ajustement par adresse croissante; les sous-arbres trop petits sont élagués
+static resource_node_t* tree_first_fit(resource_node_t* root, uint32_t size, uint32_t alignment, uint32_t* base) {
+    if (!root || root->max_length < size - 1) return NULL;
+
+    resource_node_t* found = tree_first_fit(root->left, size, alignment, base);
+    if (found) return found;
+
+    if (range_fits(root, size, alignment, base)) return root;
+
+    return tree_first_fit(root->right, size, alignment, base);
+}
+
+static resource_node_t* new_node(uint32_t start, uint32_t last) {
+    resource_node_t* node = (resource_node_t*)kmalloc(sizeof(resource_node_t));
+    if (!node) return NULL;
+    memset(node, 0, sizeof(resource_node_t));
+    node->start = start;
+    node->last = last;
+    return node;
+}
+
+// Rendre une plage à l'ensemble libre en fusionnant avec ses voisines. `spare` (un nœud
+// déjà détaché, ou NULL) sert à la plage fusionnée à défaut d'un voisin: rendre une
+// allocation n'alloue donc jamais de mémoire.
+static void insert_free_range(resource_space_t* space, uint32_t start, uint32_t last, resource_node_t* spare) {
+    resource_node_t* removed;
+
+    resource_node_t* previous = start > 0 ? tree_floor(space->free_ranges, start - 1) : NULL;
+    if (previous && previous->last != 0xFFFFFFFF && previous->last + 1 == start) {
+        start = previous->start;
+        space->free_ranges = tree_remove(space->free_ranges, previous->start, &removed);
+        if (spare) kfree(spare);
+        spare = removed;
+    }
+
+    resource_node_t* next = last < 0xFFFFFFFF ? tree_find(space->free_ranges, last + 1) : NULL;
+    if (next) {
+        last = next->last;
+        space->free_ranges = tree_remove(space->free_ranges, next->start, &removed);
+        if (spare) kfree(spare);
+        spare = removed;
+    }
+
+    resource_node_t* node = spare ? spare : new_node(start, last);
+    if (!node) return;
+    node->start = start;
+    node->last = last;
+    space->free_ranges = tree_insert(space->free_ranges, node);
+}
+
+// Découper la plage libre `node` pour en extraire [base, base + size - 1].
+// Les nœuds nécessaires sont alloués avant de toucher aux arbres: en cas d'échec,
+// la plage libre reste intacte.
+static bool carve_range(resource_space_t* space, resource_node_t* node, uint32_t base, uint32_t size) {
+    uint32_t start = node->start;
+    uint32_t last = node->last;
+    uint32_t used_last = base + size - 1;
+
+    resource_node_t* used = new_node(base, used_last);
+    if (!used) return false;
+
+    // Le nœud libre d'origine garde la partie avant `base`, ou à défaut celle après
+    resource_node_t* split = NULL;
+    if (base > start && used_last < last) {
+        split = new_node(used_last + 1, last);
+        if (!split) {
+            kfree(used);
+            return false;
+        }
+    }
+
+    resource_node_t* removed;
+    space->free_ranges = tree_remove(space->free_ranges, start, &removed);
+
+    if (base > start) {
+        removed->last = base - 1;
+        space->free_ranges = tree_insert(space->free_ranges, removed);
+        if (split) space->free_ranges = tree_insert(space->free_ranges, split);
+    } else if (used_last < last) {
+        removed->start = used_last + 1;
+        space->free_ranges = tree_insert(space->free_ranges, removed);
+    } else {
+        kfree(removed);
+    }
+
+    space->used_ranges = tree_insert(space->used_ranges, used);
+    return true;
+}
+
+// `end` est exclusif; end == 0 désigne la fin de l'espace 32 bits
+void register_resource(uint32_t start, uint32_t end, uint32_t type) {
+    resource_space_t* space = get_resource_space(type);
+    if (!space || end - 1 < start) return;
+    insert_free_range(space, start, end - 1, NULL);
+}
+
+bool allocate_resource_aligned(uint32_t type, uint32_t size, uint32_t alignment, uint32_t* start) {
+    resource_space_t* space = get_resource_space(type);
+    if (!space || !start || size == 0) return false;
+    if (alignment == 0) alignment = 1;
+    if (alignment & (alignment - 1)) return false;
+
+    uint32_t base;
+    resource_node_t* node = tree_first_fit(space->free_ranges, size, alignment, &base);
+    if (!node || !carve_range(space, node, base, size)) return false;
+
+    *start = base;
+    return true;
+}
+
+bool allocate_resource(uint32_t type, uint32_t size, uint32_t* start) {
+    return allocate_resource_aligned(type, size, 1, start);
+}
+
+// Réserver une plage précise (ex: BAR déjà programmé par le firmware)
+bool claim_resource(uint32_t type, uint32_t start, uint32_t size) {
+    resource_space_t* space = get_resource_space(type);
+    if (!space || size == 0) return false;
+
+    resource_node_t* node = tree_floor(space->free_ranges, start);
+    if (!node || node->last < start || node->last - start < size - 1) return false;
+
+    return carve_range(space, node, start, size);
+}
+
+bool free_resource_type(uint32_t type, uint32_t start) {
+    resource_space_t* space = get_resource_space(type);
+    if (!space) return false;
+
+    resource_node_t* removed = NULL;
+    space->used_ranges = tree_remove(space->used_ranges, start, &removed);
+    if (!removed) return false;
+
+    insert_free_range(space, removed->start, removed->last, removed);
+    return true;
+}
+
+void free_resource(uint32_t start) {
+    for (uint32_t type = 1; type < RESOURCE_TYPE_COUNT; type++) {
+        if (free_resource_type(type, start)) break;
+    }
+}
+
+// Retrouver l'allocation qui contient `address`
+bool find_resource(uint32_t type, uint32_t address, uint32_t* start, uint32_t* size) {
+    resource_space_t* space = get_resource_space(type);
+    if (!space) return false;
+
+    resource_node_t* node = tree_floor(space->used_ranges, address);
+    if (!node || node->last < address) return false;
+
+    if (start) *start = node->start;
+    if (size) *size = node->last - node->start + 1;
+    return true;
+}
+
+bool is_resource_free(uint32_t type, uint32_t start, uint32_t size) {
+    resource_space_t* space = get_resource_space(type);
+    if (!space || size == 0) return false;
+
+    resource_node_t* node = tree_floor(space->free_ranges, start);
+    return node && node->last >= start && node->last - start >= size - 1;
+}
+
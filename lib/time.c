@@ -1,253 +1,481 @@
 #include <stdint.h>
 #include <stdbool.h>
-
-#define MAX_TIMERS 32
-#define MAX_ALARMS 16
-#define MAX_CALLBACKS 64
-
-typedef struct {
+#include <string.h>
+
+// Roue temporelle hiérarchique (à la manière des "timer wheels" de Linux).
+// Minuteurs, alarmes et callbacks périodiques sont tous des time_event_t
+// rangés dans un emplacement de la roue selon leur échéance:
+//  - niveau 0: 256 emplacements d'un tick,
+//  - niveaux 1 à 4: 64 emplacements chacun, 64 fois plus larges que le niveau précédent.
+// Quand le niveau 0 fait un tour, l'emplacement courant du niveau 1 est redistribué
+// ("cascade") vers le bas. Insertion et annulation sont en O(1), et update_time()
+// ne touche que les événements qui expirent.
+
+#define TIME_TICK_US 1000
+#define WHEEL_ROOT_BITS 8
+#define WHEEL_LEVEL_BITS 6
+#define WHEEL_ROOT_SIZE (1 << WHEEL_ROOT_BITS)
+#define WHEEL_LEVEL_SIZE (1 << WHEEL_LEVEL_BITS)
+#define WHEEL_ROOT_MASK (WHEEL_ROOT_SIZE - 1)
+#define WHEEL_LEVEL_MASK (WHEEL_LEVEL_SIZE - 1)
+#define WHEEL_LEVELS 4
+#define WHEEL_MAX_DELTA 0xFFFFFFFFull
+#define TIME_EVENT_INITIAL_CAPACITY 64
+#define TIME_NO_DEADLINE 0xFFFFFFFFFFFFFFFFull
+#define WHEEL_ROOT_LEVEL 0xFF
+#define WHEEL_EXPIRING 0xFE
+
+#define TIME_EVENT_TIMER 1
+#define TIME_EVENT_ALARM 2
+#define TIME_EVENT_CALLBACK 3
+
+typedef struct time_event {
     uint32_t id;
+    uint8_t kind;
     char name[64];
     uint64_t start_time;
     uint64_t duration;
+    uint64_t expires;
     bool running;
     bool repeating;
     void (*callback)(void*);
     void* user_data;
-} timer_t;
-
-typedef struct {
-    uint32_t id;
-    char name[64];
-    uint64_t time;
-    bool enabled;
-    void (*callback)(void*);
-    void* user_data;
-} alarm_t;
+    // Chaînage dans l'emplacement de la roue (pprev permet le retrait en O(1))
+    struct time_event* next;
+    struct time_event** pprev;
+    uint8_t level;
+    uint8_t slot;
+} time_event_t;
 
 typedef struct {
-    uint32_t id;
-    char name[64];
-    uint64_t interval;
-    uint64_t last_time;
-    bool running;
-    void (*callback)(void*);
-    void* user_data;
-} callback_t;
-
-typedef struct {
-    uint64_t frequency;
-    uint64_t start_time;
-    timer_t timers[MAX_TIMERS];
-    uint32_t timer_count;
-    alarm_t alarms[MAX_ALARMS];
-    uint32_t alarm_count;
-    callback_t callbacks[MAX_CALLBACKS];
-    uint32_t callback_count;
+    uint64_t tick;
+    time_event_t* root[WHEEL_ROOT_SIZE];
+    time_event_t* levels[WHEEL_LEVELS][WHEEL_LEVEL_SIZE];
+    time_event_t* expiring;
+    // Occupation des emplacements, pour sauter les ticks vides
+    uint32_t root_bitmap[WHEEL_ROOT_SIZE / 32];
+    uint32_t level_bitmap[WHEEL_LEVELS][WHEEL_LEVEL_SIZE / 32];
+    // Table id -> événement, agrandie à la demande
+    time_event_t** events;
+    uint32_t* free_ids;
+    uint32_t event_capacity;
+    uint32_t event_count;
+    uint32_t free_count;
+    uint32_t armed_count;
 } time_t;
 
 static time_t time;
 
+// Déclarations externes (lib/clock.c, lib/div64.c)
+extern uint64_t clock_read_us();
+extern uint64_t div64_u32(uint64_t dividend, uint32_t divisor, uint32_t* remainder);
+
 void init_time() {
     memset(&time, 0, sizeof(time_t));
-    time.frequency = get_frequency();
-    time.start_time = get_ticks();
+    time.tick = div64_u32(clock_read_us(), TIME_TICK_US, NULL);
 }
 
+// Temps depuis le démarrage en µs (TSC, conversion par mult/shift dans lib/clock.c)
 uint64_t get_current_time() {
-    return (get_ticks() - time.start_time) * 1000000 / time.frequency;
+    return clock_read_us();
 }
 
 uint64_t get_current_time_ms() {
-    return get_current_time() / 1000;
+    return div64_u32(get_current_time(), 1000, NULL);
 }
 
 uint64_t get_current_time_us() {
     return get_current_time();
 }
 
+static uint32_t level_shift(uint32_t level) {
+    return WHEEL_ROOT_BITS + level * WHEEL_LEVEL_BITS;
+}
+
+static void wheel_add(time_event_t* event) {
+    // Une échéance déjà passée est traitée au prochain tick
+    if (event->expires < time.tick) event->expires = time.tick;
+    if (event->expires - time.tick > WHEEL_MAX_DELTA) event->expires = time.tick + WHEEL_MAX_DELTA;
+
+    uint64_t delta = event->expires - time.tick;
+    time_event_t** head;
+
+    if (delta < WHEEL_ROOT_SIZE) {
+        event->level = WHEEL_ROOT_LEVEL;
+        event->slot = event->expires & WHEEL_ROOT_MASK;
+        head = &time.root[event->slot];
+        time.root_bitmap[event->slot / 32] |= 1u << (event->slot % 32);
+    } else {
+        uint32_t level = 0;
+        while (level < WHEEL_LEVELS - 1 && delta >= (1ull << level_shift(level + 1))) {
+            level++;
+        }
+        event->level = level;
+        event->slot = (event->expires >> level_shift(level)) & WHEEL_LEVEL_MASK;
+        head = &time.levels[level][event->slot];
+        time.level_bitmap[level][event->slot / 32] |= 1u << (event->slot % 32);
+    }
+
+    event->next = *head;
+    if (event->next) event->next->pprev = &event->next;
+    event->pprev = head;
+    *head = event;
+    time.armed_count++;
+}
+
+static void wheel_remove(time_event_t* event) {
+    if (!event->pprev) return;
+
+    *event->pprev = event->next;
+    if (event->next) event->next->pprev = event->pprev;
+
+    if (event->level == WHEEL_EXPIRING) {
+        // Déjà retiré de la roue, en attente dans run_tick()
+    } else if (event->level == WHEEL_ROOT_LEVEL) {
+        if (!time.root[event->slot]) {
+            time.root_bitmap[event->slot / 32] &= ~(1u << (event->slot % 32));
+        }
+    } else if (!time.levels[event->level][event->slot]) {
+        time.level_bitmap[event->level][event->slot / 32] &= ~(1u << (event->slot % 32));
+    }
+
+    event->next = NULL;
+    event->pprev = NULL;
+    time.armed_count--;
+}
+
+// Redistribuer un emplacement d'un niveau supérieur; renvoie son index
+static uint32_t wheel_cascade(uint32_t level) {
+    uint32_t slot = (time.tick >> level_shift(level)) & WHEEL_LEVEL_MASK;
+    time_event_t* event = time.levels[level][slot];
+
+    time.levels[level][slot] = NULL;
+    time.level_bitmap[level][slot / 32] &= ~(1u << (slot % 32));
+
+    while (event) {
+        time_event_t* next = event->next;
+        event->pprev = NULL;
+        time.armed_count--;
+        wheel_add(event);
+        event = next;
+    }
+    return slot;
+}
+
+// Premier emplacement occupé du niveau 0 dans [from, WHEEL_ROOT_SIZE)
+static int32_t next_root_slot(uint32_t from) {
+    for (uint32_t word = from / 32; word < WHEEL_ROOT_SIZE / 32; word++) {
+        uint32_t bits = time.root_bitmap[word];
+        if (word == from / 32) bits &= ~0u << (from % 32);
+        if (bits) return word * 32 + __builtin_ctz(bits);
+    }
+    return -1;
+}
+
+static void arm_event(time_event_t* event, uint64_t deadline_us) {
+    wheel_remove(event);
+    // Arrondi supérieur: un événement ne se déclenche jamais en avance
+    event->expires = div64_u32(deadline_us + TIME_TICK_US - 1, TIME_TICK_US, NULL);
+    event->running = true;
+    wheel_add(event);
+}
+
+static void disarm_event(time_event_t* event) {
+    wheel_remove(event);
+    event->running = false;
+}
+
+static bool grow_events() {
+    uint32_t capacity = time.event_capacity ? time.event_capacity * 2 : TIME_EVENT_INITIAL_CAPACITY;
+    time_event_t** events = (time_event_t**)kmalloc(capacity * sizeof(time_event_t*));
+    uint32_t* free_ids = (uint32_t*)kmalloc(capacity * sizeof(uint32_t));
+    if (!events || !free_ids) {
+        kfree(events);
+        kfree(free_ids);
+        return false;
+    }
+
+    memset(events, 0, capacity * sizeof(time_event_t*));
+    if (time.events) {
+        memcpy(events, time.events, time.event_capacity * sizeof(time_event_t*));
+        memcpy(free_ids, time.free_ids, time.free_count * sizeof(uint32_t));
+        kfree(time.events);
+        kfree(time.free_ids);
+    }
+
+    time.events = events;
+    time.free_ids = free_ids;
+    time.event_capacity = capacity;
+    return true;
+}
+
+static time_event_t* create_event(uint8_t kind, const char* name,
+                                  void (*callback)(void*), void* user_data) {
+    if (time.free_count == 0 && time.event_count >= time.event_capacity && !grow_events()) {
+        return NULL;
+    }
+
+    time_event_t* event = (time_event_t*)kmalloc(sizeof(time_event_t));
+    if (!event) return NULL;
+    memset(event, 0, sizeof(time_event_t));
+
+    // Réutiliser les identifiants libérés, sinon prendre le suivant
+    uint32_t index = time.free_count ? time.free_ids[--time.free_count] : time.event_count++;
+    time.events[index] = event;
+
+    event->id = index + 1;
+    event->kind = kind;
+    if (name) strncpy(event->name, name, sizeof(event->name) - 1);
+    event->callback = callback;
+    event->user_data = user_data;
+    return event;
+}
+
+static time_event_t* get_event(uint32_t id, uint8_t kind) {
+    if (id == 0 || id > time.event_count) return NULL;
+    time_event_t* event = time.events[id - 1];
+    return event && event->kind == kind ? event : NULL;
+}
+
+static void destroy_event(uint32_t id, uint8_t kind) {
+    time_event_t* event = get_event(id, kind);
+    if (!event) return;
+
+    wheel_remove(event);
+    time.events[id - 1] = NULL;
+    time.free_ids[time.free_count++] = id - 1;
+    kfree(event);
+}
+
 uint32_t create_timer(const char* name, uint64_t duration, bool repeating,
                      void (*callback)(void*), void* user_data) {
-    if (time.timer_count >= MAX_TIMERS) return 0;
+    time_event_t* timer = create_event(TIME_EVENT_TIMER, name, callback, user_data);
+    if (!timer) return 0;
 
-    timer_t* timer = &time.timers[time.timer_count++];
-    timer->id = time.timer_count;
-    strncpy(timer->name, name, sizeof(timer->name) - 1);
     timer->start_time = get_current_time();
     timer->duration = duration;
-    timer->running = true;
     timer->repeating = repeating;
-    timer->callback = callback;
-    timer->user_data = user_data;
+    arm_event(timer, timer->start_time + duration);
 
     return timer->id;
 }
 
 void destroy_timer(uint32_t timer_id) {
-    if (timer_id > 0 && timer_id <= time.timer_count) {
-        time.timers[timer_id - 1] = time.timers[--time.timer_count];
-    }
+    destroy_event(timer_id, TIME_EVENT_TIMER);
 }
 
 void start_timer(uint32_t timer_id) {
-    if (timer_id > 0 && timer_id <= time.timer_count) {
-        time.timers[timer_id - 1].running = true;
-        time.timers[timer_id - 1].start_time = get_current_time();
+    time_event_t* timer = get_event(timer_id, TIME_EVENT_TIMER);
+    if (timer) {
+        timer->start_time = get_current_time();
+        arm_event(timer, timer->start_time + timer->duration);
     }
 }
 
 void stop_timer(uint32_t timer_id) {
-    if (timer_id > 0 && timer_id <= time.timer_count) {
-        time.timers[timer_id - 1].running = false;
+    time_event_t* timer = get_event(timer_id, TIME_EVENT_TIMER);
+    if (timer) {
+        disarm_event(timer);
     }
 }
 
 void reset_timer(uint32_t timer_id) {
-    if (timer_id > 0 && timer_id <= time.timer_count) {
-        time.timers[timer_id - 1].start_time = get_current_time();
+    time_event_t* timer = get_event(timer_id, TIME_EVENT_TIMER);
+    if (timer) {
+        timer->start_time = get_current_time();
+        if (timer->running) {
+            arm_event(timer, timer->start_time + timer->duration);
+        }
     }
 }
 
 bool is_timer_running(uint32_t timer_id) {
-    return timer_id > 0 && timer_id <= time.timer_count && time.timers[timer_id - 1].running;
+    time_event_t* timer = get_event(timer_id, TIME_EVENT_TIMER);
+    return timer && timer->running;
 }
 
 uint64_t get_timer_elapsed(uint32_t timer_id) {
-    if (timer_id > 0 && timer_id <= time.timer_count) {
-        return get_current_time() - time.timers[timer_id - 1].start_time;
+    time_event_t* timer = get_event(timer_id, TIME_EVENT_TIMER);
+    if (timer) {
+        return get_current_time() - timer->start_time;
     }
     return 0;
 }
 
 uint64_t get_timer_remaining(uint32_t timer_id) {
-    if (timer_id > 0 && timer_id <= time.timer_count) {
-        timer_t* timer = &time.timers[timer_id - 1];
-        if (timer->running) {
-            uint64_t elapsed = get_current_time() - timer->start_time;
-            return elapsed < timer->duration ? timer->duration - elapsed : 0;
-        }
+    time_event_t* timer = get_event(timer_id, TIME_EVENT_TIMER);
+    if (timer && timer->running) {
+        uint64_t elapsed = get_current_time() - timer->start_time;
+        return elapsed < timer->duration ? timer->duration - elapsed : 0;
     }
     return 0;
 }
 
-uint32_t create_alarm(const char* name, uint64_t time,
+uint32_t create_alarm(const char* name, uint64_t alarm_time,
                      void (*callback)(void*), void* user_data) {
-    if (time.alarm_count >= MAX_ALARMS) return 0;
+    time_event_t* alarm = create_event(TIME_EVENT_ALARM, name, callback, user_data);
+    if (!alarm) return 0;
 
-    alarm_t* alarm = &time.alarms[time.alarm_count++];
-    alarm->id = time.alarm_count;
-    strncpy(alarm->name, name, sizeof(alarm->name) - 1);
-    alarm->time = time;
-    alarm->enabled = true;
-    alarm->callback = callback;
-    alarm->user_data = user_data;
+    alarm->start_time = alarm_time;
+    arm_event(alarm, alarm_time);
 
     return alarm->id;
 }
 
 void destroy_alarm(uint32_t alarm_id) {
-    if (alarm_id > 0 && alarm_id <= time.alarm_count) {
-        time.alarms[alarm_id - 1] = time.alarms[--time.alarm_count];
-    }
+    destroy_event(alarm_id, TIME_EVENT_ALARM);
 }
 
 void enable_alarm(uint32_t alarm_id) {
-    if (alarm_id > 0 && alarm_id <= time.alarm_count) {
-        time.alarms[alarm_id - 1].enabled = true;
+    time_event_t* alarm = get_event(alarm_id, TIME_EVENT_ALARM);
+    if (alarm) {
+        arm_event(alarm, alarm->start_time);
     }
 }
 
 void disable_alarm(uint32_t alarm_id) {
-    if (alarm_id > 0 && alarm_id <= time.alarm_count) {
-        time.alarms[alarm_id - 1].enabled = false;
+    time_event_t* alarm = get_event(alarm_id, TIME_EVENT_ALARM);
+    if (alarm) {
+        disarm_event(alarm);
     }
 }
 
 bool is_alarm_enabled(uint32_t alarm_id) {
-    return alarm_id > 0 && alarm_id <= time.alarm_count && time.alarms[alarm_id - 1].enabled;
+    time_event_t* alarm = get_event(alarm_id, TIME_EVENT_ALARM);
+    return alarm && alarm->running;
 }
 
 uint32_t create_callback(const char* name, uint64_t interval,
                         void (*callback)(void*), void* user_data) {
-    if (time.callback_count >= MAX_CALLBACKS) return 0;
+    time_event_t* cb = create_event(TIME_EVENT_CALLBACK, name, callback, user_data);
+    if (!cb) return 0;
 
-    callback_t* cb = &time.callbacks[time.callback_count++];
-    cb->id = time.callback_count;
-    strncpy(cb->name, name, sizeof(cb->name) - 1);
-    cb->interval = interval;
-    cb->last_time = get_current_time();
-    cb->running = true;
-    cb->callback = callback;
-    cb->user_data = user_data;
+    cb->start_time = get_current_time();
+    cb->duration = interval;
+    cb->repeating = true;
+    arm_event(cb, cb->start_time + interval);
 
     return cb->id;
 }
 
 void destroy_callback(uint32_t callback_id) {
-    if (callback_id > 0 && callback_id <= time.callback_count) {
-        time.callbacks[callback_id - 1] = time.callbacks[--time.callback_count];
-    }
+    destroy_event(callback_id, TIME_EVENT_CALLBACK);
 }
 
 void start_callback(uint32_t callback_id) {
-    if (callback_id > 0 && callback_id <= time.callback_count) {
-        time.callbacks[callback_id - 1].running = true;
-        time.callbacks[callback_id - 1].last_time = get_current_time();
+    time_event_t* cb = get_event(callback_id, TIME_EVENT_CALLBACK);
+    if (cb) {
+        cb->start_time = get_current_time();
+        arm_event(cb, cb->start_time + cb->duration);
     }
 }
 
 void stop_callback(uint32_t callback_id) {
-    if (callback_id > 0 && callback_id <= time.callback_count) {
-        time.callbacks[callback_id - 1].running = false;
+    time_event_t* cb = get_event(callback_id, TIME_EVENT_CALLBACK);
+    if (cb) {
+        disarm_event(cb);
     }
 }
 
 bool is_callback_running(uint32_t callback_id) {
-    return callback_id > 0 && callback_id <= time.callback_count && time.callbacks[callback_id - 1].running;
+    time_event_t* cb = get_event(callback_id, TIME_EVENT_CALLBACK);
+    return cb && cb->running;
+}
+
+static void expire_event(time_event_t* event, uint64_t current_time) {
+    event->running = false;
+
+    if (event->repeating) {
+        // Période suivante calée sur l'échéance précédente (pas de dérive),
+        // sauf si on a pris trop de retard
+        uint64_t next = event->start_time + event->duration;
+        if (next + event->duration <= current_time) next = current_time;
+        event->start_time = next;
+        arm_event(event, next + event->duration);
+    }
+
+    // Le callback peut détruire l'événement: ne plus y toucher ensuite
+    if (event->callback) {
+        event->callback(event->user_data);
+    }
+}
+
+// Exécuter les événements du tick courant puis avancer d'un tick
+static void run_tick(uint64_t current_time) {
+    uint32_t slot = time.tick & WHEEL_ROOT_MASK;
+
+    if (slot == 0) {
+        for (uint32_t level = 0; level < WHEEL_LEVELS && wheel_cascade(level) == 0; level++) {
+        }
+    }
+
+    // Déplacer l'emplacement dans une liste d'attente: un callback peut réarmer
+    // ou détruire n'importe quel événement, y compris ceux qui restent à traiter
+    time.expiring = time.root[slot];
+    if (time.expiring) time.expiring->pprev = &time.expiring;
+    for (time_event_t* event = time.expiring; event; event = event->next) {
+        event->level = WHEEL_EXPIRING;
+    }
+    time.root[slot] = NULL;
+    time.root_bitmap[slot / 32] &= ~(1u << (slot % 32));
+    time.tick++;
+
+    while (time.expiring) {
+        time_event_t* event = time.expiring;
+        wheel_remove(event);
+        expire_event(event, current_time);
+    }
 }
 
 void update_time() {
     uint64_t current_time = get_current_time();
+    uint64_t now = div64_u32(current_time, TIME_TICK_US, NULL);
 
-    for (uint32_t i = 0; i < time.timer_count; i++) {
-        timer_t* timer = &time.timers[i];
-        if (timer->running) {
-            uint64_t elapsed = current_time - timer->start_time;
-            if (elapsed >= timer->duration) {
-                if (timer->callback) {
-                    timer->callback(timer->user_data);
-                }
-                if (timer->repeating) {
-                    timer->start_time = current_time;
-                } else {
-                    timer->running = false;
-                }
-            }
-        }
+    while (time.tick <= now) {
+        run_tick(current_time);
+
+        // Sauter les ticks vides jusqu'au prochain emplacement occupé ou au prochain tour
+        if ((time.tick & WHEEL_ROOT_MASK) == 0) continue;
+        int32_t slot = next_root_slot(time.tick & WHEEL_ROOT_MASK);
+        uint64_t target = slot >= 0 ? (time.tick & ~(uint64_t)WHEEL_ROOT_MASK) + slot
+                                    : (time.tick | WHEEL_ROOT_MASK) + 1;
+        time.tick = target < now + 1 ? target : now + 1;
     }
+}
 
-    for (uint32_t i = 0; i < time.alarm_count; i++) {
-        alarm_t* alarm = &time.alarms[i];
-        if (alarm->enabled && current_time >= alarm->time) {
-            if (alarm->callback) {
-                alarm->callback(alarm->user_data);
-            }
-            alarm->enabled = false;
+// Prochaine échéance (µs) à laquelle update_time() aura du travail.
+// Pour les niveaux supérieurs, c'est l'instant de la cascade: une borne inférieure sûre.
+uint64_t time_next_deadline() {
+    if (time.armed_count == 0) return TIME_NO_DEADLINE;
+
+    uint32_t index = time.tick & WHEEL_ROOT_MASK;
+    int32_t slot = next_root_slot(index);
+    if (slot >= 0) {
+        return ((time.tick & ~(uint64_t)WHEEL_ROOT_MASK) + slot) * TIME_TICK_US;
+    }
+
+    // Emplacements du niveau 0 déjà dépassés: ils appartiennent au tour suivant
+    uint64_t deadline = TIME_NO_DEADLINE;
+    for (uint32_t word = 0; word < WHEEL_ROOT_SIZE / 32; word++) {
+        if (time.root_bitmap[word]) {
+            deadline = ((time.tick | WHEEL_ROOT_MASK) + 1) * TIME_TICK_US;
+            break;
         }
     }
 
-    for (uint32_t i = 0; i < time.callback_count; i++) {
-        callback_t* cb = &time.callbacks[i];
-        if (cb->running) {
-            uint64_t elapsed = current_time - cb->last_time;
-            if (elapsed >= cb->interval) {
-                if (cb->callback) {
-                    cb->callback(cb->user_data);
-                }
-                cb->last_time = current_time;
+    // Niveaux supérieurs: instant de la cascade du prochain emplacement occupé
+    for (uint32_t level = 0; level < WHEEL_LEVELS; level++) {
+        uint32_t shift = level_shift(level);
+        for (uint32_t step = 1; step <= WHEEL_LEVEL_SIZE; step++) {
+            uint64_t start = ((time.tick >> shift) + step) << shift;
+            uint32_t candidate = (start >> shift) & WHEEL_LEVEL_MASK;
+            if (time.level_bitmap[level][candidate / 32] & (1u << (candidate % 32))) {
+                if (start * TIME_TICK_US < deadline) deadline = start * TIME_TICK_US;
+                break;
             }
         }
     }
+    return deadline;
 }
 
 void sleep(uint64_t milliseconds) {
@@ -262,4 +490,4 @@ void sleep_us(uint64_t microseconds) {
     while (get_current_time_us() - start_time < microseconds) {
         asm volatile("pause");
     }
-} 
\ No newline at end of file
+}
\ No newline at end of file
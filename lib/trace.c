@@ -0,0 +1,301 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+// Traçage des latences d'E/S. Chaque étape instrumentée (opération VFS, parcours de
+// chemin, lecture d'inode, bloc d'indirection, bloc de données, E/S du périphérique)
+// est mesurée au TSC:
+//   uint64_t start = trace_begin();
+//   ...
+//   trace_end(TRACE_FS_INODE_READ, device_id, start, ino);
+// La mesure est rangée dans l'anneau du processeur courant et comptée dans un
+// histogramme log2 par type d'opération et par périphérique. Rien n'est verrouillé:
+// une place de l'anneau est réservée par incrément atomique, et un numéro de séquence
+// écrit en dernier permet au lecteur d'écarter un enregistrement en cours d'écriture.
+// Désactivé (par défaut, voir trace_enable()), trace_begin() renvoie 0 et trace_end() ne
+// fait rien.
+
+#define TRACE_MAX_CPUS 4
+#define TRACE_RING_SIZE 4096
+#define TRACE_BUCKETS 40
+#define TRACE_MAX_DEVICES 8
+#define TRACE_NO_DEVICE 0xFFFFFFFF
+
+typedef enum {
+    TRACE_VFS_OPEN,
+    TRACE_VFS_READ,
+    TRACE_VFS_WRITE,
+    TRACE_VFS_FSYNC,
+    TRACE_FS_PATH_WALK,
+    TRACE_FS_INODE_READ,
+    TRACE_FS_INDIRECT_READ,
+    TRACE_FS_DATA_READ,
+    TRACE_BLOCK_READ,
+    TRACE_BLOCK_WRITE,
+    TRACE_EVENT_COUNT
+} trace_event_t;
+
+typedef struct {
+    // Numéro d'écriture + 1, publié en dernier; 0 pour une place jamais écrite
+    uint32_t sequence;
+    uint16_t event;
+    uint16_t cpu;
+    uint64_t timestamp;
+    // Durée en cycles, saturée à 32 bits
+    uint32_t cycles;
+    uint32_t device;
+    uint32_t arg;
+} trace_record_t;
+
+typedef struct {
+    trace_record_t records[TRACE_RING_SIZE];
+    uint32_t head;
+    // Compteurs 32 bits: l'incrément atomique reste une seule instruction sur i386
+    uint32_t histogram[TRACE_EVENT_COUNT][TRACE_BUCKETS];
+    uint32_t device_histogram[TRACE_MAX_DEVICES][TRACE_EVENT_COUNT][TRACE_BUCKETS];
+} trace_cpu_t;
+
+typedef struct {
+    bool enabled;
+    trace_cpu_t* cpus[TRACE_MAX_CPUS];
+    // Identifiant de périphérique de chaque colonne de device_histogram, attribué à la première mesure
+    uint32_t devices[TRACE_MAX_DEVICES];
+} trace_t;
+
+static trace_t trace;
+
+static const char* trace_event_names[TRACE_EVENT_COUNT] = {
+    "vfs_open",
+    "vfs_read",
+    "vfs_write",
+    "vfs_fsync",
+    "path_walk",
+    "inode_read",
+    "indirect_read",
+    "data_read",
+    "block_read",
+    "block_write"
+};
+
+// Déclarations externes (lib/clock.c, lib/div64.c, kernel/kernel.c)
+extern uint64_t get_ticks();
+extern uint64_t get_frequency();
+extern uint64_t div64_u32(uint64_t dividend, uint32_t divisor, uint32_t* remainder);
+extern uint64_t div64_u64(uint64_t dividend, uint64_t divisor);
+extern void print(const char* str);
+
+// Un seul processeur est démarré pour l'instant
+static inline uint32_t current_cpu() {
+    return 0;
+}
+
+static uint32_t bucket_of(uint64_t cycles) {
+    if (cycles == 0) return 0;
+    uint32_t bucket = 63 - __builtin_clzll(cycles);
+    return bucket < TRACE_BUCKETS ? bucket : TRACE_BUCKETS - 1;
+}
+
+// Colonne de `device` dans les histogrammes par périphérique, -1 si elles sont toutes prises
+static int device_slot(uint32_t device) {
+    for (uint32_t i = 0; i < TRACE_MAX_DEVICES; i++) {
+        uint32_t current = __atomic_load_n(&trace.devices[i], __ATOMIC_ACQUIRE);
+        if (current == device) return i;
+        if (current == TRACE_NO_DEVICE) {
+            uint32_t expected = TRACE_NO_DEVICE;
+            if (__atomic_compare_exchange_n(&trace.devices[i], &expected, device, false,
+                                            __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE) || expected == device) {
+                return i;
+            }
+        }
+    }
+    return -1;
+}
+
+uint64_t trace_begin() {
+    return trace.enabled ? get_ticks() : 0;
+}
+
+void trace_end(trace_event_t event, uint32_t device, uint64_t start, uint32_t arg) {
+    if (!start || event >= TRACE_EVENT_COUNT) return;
+
+    uint32_t cpu_id = current_cpu();
+    trace_cpu_t* cpu = trace.cpus[cpu_id];
+    if (!cpu) return;
+
+    uint64_t cycles = get_ticks() - start;
+    uint32_t bucket = bucket_of(cycles);
+    __atomic_fetch_add(&cpu->histogram[event][bucket], 1, __ATOMIC_RELAXED);
+    if (device != TRACE_NO_DEVICE) {
+        int slot = device_slot(device);
+        if (slot >= 0) __atomic_fetch_add(&cpu->device_histogram[slot][event][bucket], 1, __ATOMIC_RELAXED);
+    }
+
+    // Une interruption tracée pendant l'écriture prend simplement la place suivante
+    uint32_t index = __atomic_fetch_add(&cpu->head, 1, __ATOMIC_RELAXED);
+    trace_record_t* record = &cpu->records[index % TRACE_RING_SIZE];
+    __atomic_store_n(&record->sequence, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    record->event = event;
+    record->cpu = cpu_id;
+    record->timestamp = start;
+    record->cycles = cycles > 0xFFFFFFFF ? 0xFFFFFFFF : (uint32_t)cycles;
+    record->device = device;
+    record->arg = arg;
+    __atomic_store_n(&record->sequence, index + 1, __ATOMIC_RELEASE);
+}
+
+void trace_enable(bool enabled) {
+    trace.enabled = enabled && trace.cpus[0];
+}
+
+void trace_reset() {
+    for (uint32_t i = 0; i < TRACE_MAX_CPUS; i++) {
+        if (trace.cpus[i]) memset(trace.cpus[i], 0, sizeof(trace_cpu_t));
+    }
+    for (uint32_t i = 0; i < TRACE_MAX_DEVICES; i++) {
+        trace.devices[i] = TRACE_NO_DEVICE;
+    }
+}
+
+// Copier les enregistrements du processeur `cpu` écrits depuis *cursor (au plus `max`).
+// Ceux que l'anneau a déjà écrasés sont sautés; *cursor avance pour l'appel suivant.
+uint32_t trace_read(uint32_t cpu, uint32_t* cursor, trace_record_t* out, uint32_t max) {
+    if (cpu >= TRACE_MAX_CPUS || !trace.cpus[cpu] || !cursor || !out) return 0;
+
+    trace_cpu_t* buffer = trace.cpus[cpu];
+    uint32_t head = __atomic_load_n(&buffer->head, __ATOMIC_ACQUIRE);
+    uint32_t index = *cursor;
+    if (head - index > TRACE_RING_SIZE) index = head - TRACE_RING_SIZE;
+
+    uint32_t count = 0;
+    while (index != head && count < max) {
+        trace_record_t* record = &buffer->records[index % TRACE_RING_SIZE];
+        uint32_t sequence = __atomic_load_n(&record->sequence, __ATOMIC_ACQUIRE);
+        if (sequence != index + 1) {
+            // Déjà écrasé par un tour suivant: sauter; sinon encore en cours d'écriture
+            if ((int32_t)(sequence - (index + 1)) > 0) {
+                index++;
+                continue;
+            }
+            break;
+        }
+        out[count] = *record;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        // Réécrit pendant la copie: l'enregistrement est perdu
+        if (__atomic_load_n(&record->sequence, __ATOMIC_RELAXED) == index + 1) count++;
+        index++;
+    }
+    *cursor = index;
+    return count;
+}
+
+// Histogramme de `event`, tous processeurs confondus, pour un périphérique ou pour tous
+// (TRACE_NO_DEVICE). buckets[i] compte les durées de [2^i, 2^(i+1)) cycles.
+bool trace_get_histogram(trace_event_t event, uint32_t device, uint64_t buckets[TRACE_BUCKETS]) {
+    if (event >= TRACE_EVENT_COUNT || !buckets) return false;
+
+    int slot = -1;
+    if (device != TRACE_NO_DEVICE) {
+        for (uint32_t i = 0; i < TRACE_MAX_DEVICES; i++) {
+            if (trace.devices[i] == device) slot = i;
+        }
+        if (slot < 0) return false;
+    }
+
+    memset(buckets, 0, TRACE_BUCKETS * sizeof(uint64_t));
+    for (uint32_t cpu = 0; cpu < TRACE_MAX_CPUS; cpu++) {
+        trace_cpu_t* buffer = trace.cpus[cpu];
+        if (!buffer) continue;
+        const uint32_t* source = slot < 0 ? buffer->histogram[event] : buffer->device_histogram[slot][event];
+        for (uint32_t i = 0; i < TRACE_BUCKETS; i++) {
+            buckets[i] += source[i];
+        }
+    }
+    return true;
+}
+
+// Durée en ns du début de la tranche `bucket`. `scale` vaut 2^32 ns par cycle: 2^bucket * 1e9
+// déborderait au-delà de la tranche 34, et la division 64 bits n'est pas disponible
+uint64_t trace_bucket_ns(uint32_t bucket) {
+    uint64_t frequency = get_frequency();
+    if (!frequency || bucket >= TRACE_BUCKETS) return 0;
+    uint64_t scale = div64_u64(1000000000ull << 32, frequency);
+    return bucket >= 32 ? scale << (bucket - 32) : scale >> (32 - bucket);
+}
+
+static void print_number(uint64_t value) {
+    char digits[21];
+    uint32_t length = 0;
+    do {
+        uint32_t digit;
+        value = div64_u32(value, 10, &digit);
+        digits[length++] = '0' + digit;
+    } while (value);
+
+    char text[21];
+    for (uint32_t i = 0; i < length; i++) {
+        text[i] = digits[length - 1 - i];
+    }
+    text[length] = '\0';
+    print(text);
+}
+
+static void dump_histogram(const char* name, const uint64_t buckets[TRACE_BUCKETS]) {
+    uint64_t total = 0;
+    uint64_t peak = 0;
+    for (uint32_t i = 0; i < TRACE_BUCKETS; i++) {
+        total += buckets[i];
+        if (buckets[i] > peak) peak = buckets[i];
+    }
+    if (!total) return;
+
+    print(name);
+    print(": ");
+    print_number(total);
+    print(" ops\n");
+
+    for (uint32_t i = 0; i < TRACE_BUCKETS; i++) {
+        if (!buckets[i]) continue;
+        print("  >= ");
+        print_number(trace_bucket_ns(i));
+        print(" ns: ");
+        print_number(buckets[i]);
+        print(" ");
+        uint32_t bar = (uint32_t)div64_u64(buckets[i] * 32, peak);
+        for (uint32_t j = 0; j < bar; j++) print("#");
+        print("\n");
+    }
+}
+
+// Afficher sur la console les histogrammes non vides, globaux puis par périphérique
+void trace_dump() {
+    uint64_t buckets[TRACE_BUCKETS];
+
+    for (uint32_t event = 0; event < TRACE_EVENT_COUNT; event++) {
+        trace_get_histogram(event, TRACE_NO_DEVICE, buckets);
+        dump_histogram(trace_event_names[event], buckets);
+    }
+
+    for (uint32_t i = 0; i < TRACE_MAX_DEVICES; i++) {
+        if (trace.devices[i] == TRACE_NO_DEVICE) continue;
+        print("device ");
+        print_number(trace.devices[i]);
+        print("\n");
+        for (uint32_t event = 0; event < TRACE_EVENT_COUNT; event++) {
+            if (trace_get_histogram(event, trace.devices[i], buckets)) {
+                dump_histogram(trace_event_names[event], buckets);
+            }
+        }
+    }
+}
+
+void init_trace() {
+    memset(&trace, 0, sizeof(trace_t));
+    for (uint32_t i = 0; i < TRACE_MAX_DEVICES; i++) {
+        trace.devices[i] = TRACE_NO_DEVICE;
+    }
+
+    trace.cpus[0] = (trace_cpu_t*)kmalloc(sizeof(trace_cpu_t));
+    if (!trace.cpus[0]) return;
+    memset(trace.cpus[0], 0, sizeof(trace_cpu_t));
+}
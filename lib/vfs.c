@@ -0,0 +1,329 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+// Couche VFS: chaque système de fichiers s'enregistre une fois avec ses tables
+// d'opérations (superblock, inode, fichier). Ils partagent alors la table des montages
+// (lib/mount.c), les descripteurs du processus (lib/fd_table.c) et le cache de pages
+// des projections (lib/mmap.c); les systèmes sur disque partagent en plus le cache de
+// blocs et le cache de dentries.
+
+#define VFS_MAX_FILESYSTEMS 8
+#define VFS_MAX_MOUNTS 32
+#define VFS_NAME_LENGTH 16
+#define TRACE_NO_DEVICE 0xFFFFFFFF
+
+// Points de traçage (lib/trace.c)
+typedef enum {
+    TRACE_VFS_OPEN,
+    TRACE_VFS_READ,
+    TRACE_VFS_WRITE,
+    TRACE_VFS_FSYNC,
+    TRACE_FS_PATH_WALK,
+    TRACE_FS_INODE_READ,
+    TRACE_FS_INDIRECT_READ,
+    TRACE_FS_DATA_READ,
+    TRACE_BLOCK_READ,
+    TRACE_BLOCK_WRITE,
+    TRACE_EVENT_COUNT
+} trace_event_t;
+
+// Fichier projetable (lib/mmap.c)
+typedef struct mapping mapping_t;
+
+typedef struct {
+    // Monter `device` ("" pour le disque principal) sur `path`; renvoie l'état du montage
+    void* (*mount)(const char* path, const char* device);
+    void (*unmount)(void* mount);
+    bool (*sync)(void* mount);
+} vfs_super_operations_t;
+
+typedef struct {
+    // `path` est relatif au montage et commence par '/'
+    void* (*open)(void* mount, const char* path, uint32_t flags);
+    void* (*opendir)(void* mount, const char* path);
+    // Copier `source` vers `target` en partageant les blocs (copie sur écriture)
+    int (*reflink)(void* mount, const char* source, const char* target);
+} vfs_inode_operations_t;
+
+typedef struct {
+    int32_t (*read)(void* file, void* buffer, uint32_t size);
+    int32_t (*write)(void* file, const void* buffer, uint32_t size);
+    int (*fsync)(void* file);
+    void (*release)(void* file);
+    // Identité du fichier dans le cache de pages, avec une référence; NULL s'il ne se projette pas
+    mapping_t* (*mapping)(void* file);
+    // Position de lecture et d'écriture du fichier (sendfile depuis une position donnée)
+    uint32_t (*tell)(void* file);
+    void (*seek)(void* file, uint32_t position);
+    // Répertoires ouverts par opendir: lots d'entrées dirent_t (lib/filesystem.c)
+    int32_t (*readdir)(void* dir, void* buffer, uint32_t size);
+    // Position de reprise d'un listage, propre au système de fichiers
+    uint32_t (*telldir)(void* dir);
+    void (*seekdir)(void* dir, uint32_t position);
+    void (*closedir)(void* dir);
+} vfs_file_operations_t;
+
+typedef struct {
+    char name[VFS_NAME_LENGTH];
+    const vfs_super_operations_t* super_ops;
+    const vfs_inode_operations_t* inode_ops;
+    const vfs_file_operations_t* file_ops;
+} vfs_filesystem_t;
+
+typedef struct {
+    vfs_filesystem_t* type;
+    void* private;
+    // Descripteurs ouverts sur ce montage: il ne peut pas être démonté avant leur fermeture
+    uint32_t open_count;
+    bool used;
+} vfs_mount_t;
+
+// Objet rangé dans la table des descripteurs
+typedef struct {
+    vfs_mount_t* mount;
+    void* private;
+    bool directory;
+} vfs_file_t;
+
+typedef struct {
+    vfs_filesystem_t filesystems[VFS_MAX_FILESYSTEMS];
+    uint32_t filesystem_count;
+    vfs_mount_t mounts[VFS_MAX_MOUNTS];
+    void* mount_table;
+} vfs_t;
+
+static vfs_t vfs;
+
+// Déclarations externes (lib/mount.c, lib/fd_table.c, lib/process.c, lib/trace.c)
+extern void* mount_table_create();
+extern bool mount_table_add(void* table, const char* path, void* mount);
+extern void* mount_table_remove(void* table, const char* path);
+extern void* mount_table_lookup(void* table, const char* path, const char** relative);
+extern int fd_alloc(void* table, void* object);
+extern void* fd_get(void* table, int fd);
+extern void* fd_release(void* table, int fd);
+extern void* current_fd_table();
+extern uint64_t trace_begin();
+extern void trace_end(trace_event_t event, uint32_t device, uint64_t start, uint32_t arg);
+
+void vfs_release_file(void* object);
+
+void init_vfs() {
+    memset(&vfs, 0, sizeof(vfs_t));
+    vfs.mount_table = mount_table_create();
+}
+
+bool vfs_register_filesystem(const char* name, const vfs_super_operations_t* super_ops,
+                             const vfs_inode_operations_t* inode_ops, const vfs_file_operations_t* file_ops) {
+    if (vfs.filesystem_count >= VFS_MAX_FILESYSTEMS || !super_ops || !inode_ops || !file_ops) return false;
+
+    vfs_filesystem_t* type = &vfs.filesystems[vfs.filesystem_count++];
+    strncpy(type->name, name, VFS_NAME_LENGTH - 1);
+    type->super_ops = super_ops;
+    type->inode_ops = inode_ops;
+    type->file_ops = file_ops;
+    return true;
+}
+
+static vfs_filesystem_t* find_filesystem(const char* name) {
+    for (uint32_t i = 0; i < vfs.filesystem_count; i++) {
+        if (strcmp(vfs.filesystems[i].name, name) == 0) {
+            return &vfs.filesystems[i];
+        }
+    }
+    return NULL;
+}
+
+bool vfs_mount(const char* path, const char* type, const char* device) {
+    vfs_filesystem_t* filesystem = find_filesystem(type);
+    if (!filesystem || !vfs.mount_table) return false;
+
+    vfs_mount_t* mount = NULL;
+    for (uint32_t i = 0; i < VFS_MAX_MOUNTS; i++) {
+        if (!vfs.mounts[i].used) {
+            mount = &vfs.mounts[i];
+            break;
+        }
+    }
+    if (!mount) return false;
+
+    void* private = filesystem->super_ops->mount(path, device ? device : "");
+    if (!private) return false;
+
+    mount->type = filesystem;
+    mount->private = private;
+    mount->open_count = 0;
+    if (!mount_table_add(vfs.mount_table, path, mount)) {
+        filesystem->super_ops->unmount(private);
+        return false;
+    }
+    mount->used = true;
+    return true;
+}
+
+bool vfs_unmount(const char* path) {
+    const char* relative;
+    vfs_mount_t* mount = (vfs_mount_t*)mount_table_lookup(vfs.mount_table, path, &relative);
+    if (!mount || strcmp(relative, "/") != 0 || mount->open_count) return false;
+
+    mount_table_remove(vfs.mount_table, path);
+    mount->type->super_ops->unmount(mount->private);
+    mount->used = false;
+    return true;
+}
+
+// Valider sur disque tous les montages qui le prennent en charge
+bool vfs_sync() {
+    bool success = true;
+    for (uint32_t i = 0; i < VFS_MAX_MOUNTS; i++) {
+        vfs_mount_t* mount = &vfs.mounts[i];
+        if (mount->used && mount->type->super_ops->sync) {
+            success &= mount->type->super_ops->sync(mount->private);
+        }
+    }
+    return success;
+}
+
+// Ouvrir `path` sur son montage et lui attribuer un descripteur du processus courant
+static int open_object(const char* path, uint32_t flags, bool directory) {
+    const char* relative;
+    vfs_mount_t* mount = (vfs_mount_t*)mount_table_lookup(vfs.mount_table, path, &relative);
+    if (!mount) return -1;
+
+    const vfs_inode_operations_t* ops = mount->type->inode_ops;
+    if (directory ? !ops->opendir : !ops->open) return -1;
+
+    vfs_file_t* file = (vfs_file_t*)kmalloc(sizeof(vfs_file_t));
+    if (!file) return -1;
+    file->mount = mount;
+    file->directory = directory;
+    file->private = directory ? ops->opendir(mount->private, relative) : ops->open(mount->private, relative, flags);
+    if (!file->private) {
+        kfree(file);
+        return -1;
+    }
+
+    mount->open_count++;
+    int fd = fd_alloc(current_fd_table(), file);
+    if (fd < 0) {
+        vfs_release_file(file);
+        return -1;
+    }
+    return fd;
+}
+
+int vfs_open(const char* path, uint32_t flags) {
+    uint64_t start = trace_begin();
+    int fd = open_object(path, flags, false);
+    trace_end(TRACE_VFS_OPEN, TRACE_NO_DEVICE, start, fd);
+    return fd;
+}
+
+int vfs_opendir(const char* path) {
+    return open_object(path, 0, true);
+}
+
+// Fermer un objet déjà retiré de sa table (aussi appelé à la fin d'un processus)
+void vfs_release_file(void* object) {
+    vfs_file_t* file = (vfs_file_t*)object;
+    const vfs_file_operations_t* ops = file->mount->type->file_ops;
+    if (file->directory) {
+        if (ops->closedir) ops->closedir(file->private);
+    } else if (ops->release) {
+        ops->release(file->private);
+    }
+    file->mount->open_count--;
+    kfree(file);
+}
+
+void vfs_close(int fd) {
+    void* file = fd_release(current_fd_table(), fd);
+    if (file) vfs_release_file(file);
+}
+
+static vfs_file_t* get_file(int fd, bool directory) {
+    vfs_file_t* file = (vfs_file_t*)fd_get(current_fd_table(), fd);
+    if (!file || file->directory != directory) return NULL;
+    return file;
+}
+
+int32_t vfs_read(int fd, void* buffer, uint32_t size) {
+    vfs_file_t* file = get_file(fd, false);
+    if (!file || !file->mount->type->file_ops->read) return -1;
+    uint64_t start = trace_begin();
+    int32_t result = file->mount->type->file_ops->read(file->private, buffer, size);
+    trace_end(TRACE_VFS_READ, TRACE_NO_DEVICE, start, size);
+    return result;
+}
+
+int32_t vfs_write(int fd, const void* buffer, uint32_t size) {
+    vfs_file_t* file = get_file(fd, false);
+    if (!file || !file->mount->type->file_ops->write) return -1;
+    uint64_t start = trace_begin();
+    int32_t result = file->mount->type->file_ops->write(file->private, buffer, size);
+    trace_end(TRACE_VFS_WRITE, TRACE_NO_DEVICE, start, size);
+    return result;
+}
+
+// Position courante du fichier, 0 si le système de fichiers ne la donne pas
+uint32_t vfs_tell(int fd) {
+    vfs_file_t* file = get_file(fd, false);
+    if (!file || !file->mount->type->file_ops->tell) return 0;
+    return file->mount->type->file_ops->tell(file->private);
+}
+
+bool vfs_seek(int fd, uint32_t position) {
+    vfs_file_t* file = get_file(fd, false);
+    if (!file || !file->mount->type->file_ops->seek) return false;
+    file->mount->type->file_ops->seek(file->private, position);
+    return true;
+}
+
+int vfs_fsync(int fd) {
+    vfs_file_t* file = get_file(fd, false);
+    if (!file) return -1;
+    if (!file->mount->type->file_ops->fsync) return 0;
+    uint64_t start = trace_begin();
+    int result = file->mount->type->file_ops->fsync(file->private);
+    trace_end(TRACE_VFS_FSYNC, TRACE_NO_DEVICE, start, fd);
+    return result;
+}
+
+int32_t vfs_readdir(int fd, void* buffer, uint32_t size) {
+    vfs_file_t* file = get_file(fd, true);
+    if (!file || !file->mount->type->file_ops->readdir) return -1;
+    return file->mount->type->file_ops->readdir(file->private, buffer, size);
+}
+
+uint32_t vfs_telldir(int fd) {
+    vfs_file_t* file = get_file(fd, true);
+    if (!file || !file->mount->type->file_ops->telldir) return 0;
+    return file->mount->type->file_ops->telldir(file->private);
+}
+
+bool vfs_seekdir(int fd, uint32_t position) {
+    vfs_file_t* file = get_file(fd, true);
+    if (!file || !file->mount->type->file_ops->seekdir) return false;
+    file->mount->type->file_ops->seekdir(file->private, position);
+    return true;
+}
+
+// Copie de `source` vers `target` sans recopier les données: les deux fichiers partagent
+// leurs blocs jusqu'à la première modification. Possible seulement au sein d'un même
+// montage dont le système de fichiers le permet; sinon -1, et l'appelant copie lui-même.
+int vfs_reflink(const char* source, const char* target) {
+    const char* source_relative;
+    const char* target_relative;
+    vfs_mount_t* mount = (vfs_mount_t*)mount_table_lookup(vfs.mount_table, source, &source_relative);
+    if (!mount || !mount->type->inode_ops->reflink) return -1;
+    if (mount_table_lookup(vfs.mount_table, target, &target_relative) != mount) return -1;
+    return mount->type->inode_ops->reflink(mount->private, source_relative, target_relative);
+}
+
+// Fichier de `fd` dans le cache de pages, avec une référence (lib/mmap.c)
+mapping_t* vfs_get_mapping(int fd) {
+    vfs_file_t* file = get_file(fd, false);
+    if (!file || !file->mount->type->file_ops->mapping) return NULL;
+    return file->mount->type->file_ops->mapping(file->private);
+}
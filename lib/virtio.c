@@ -0,0 +1,377 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define PAGE_SIZE 4096
+
+// Registres de l'interface virtio-pci legacy (BAR0, espace I/O)
+#define VIRTIO_PCI_HOST_FEATURES 0x00
+#define VIRTIO_PCI_GUEST_FEATURES 0x04
+#define VIRTIO_PCI_QUEUE_PFN 0x08
+#define VIRTIO_PCI_QUEUE_SIZE 0x0C
+#define VIRTIO_PCI_QUEUE_SELECT 0x0E
+#define VIRTIO_PCI_QUEUE_NOTIFY 0x10
+#define VIRTIO_PCI_STATUS 0x12
+#define VIRTIO_PCI_ISR 0x13
+#define VIRTIO_PCI_CONFIG 0x14
+
+#define VIRTIO_STATUS_ACKNOWLEDGE 0x01
+#define VIRTIO_STATUS_DRIVER 0x02
+#define VIRTIO_STATUS_DRIVER_OK 0x04
+#define VIRTIO_STATUS_FEATURES_OK 0x08
+#define VIRTIO_STATUS_FAILED 0x80
+
+#define VIRTIO_RING_F_EVENT_IDX (1u << 29)
+
+#define VRING_DESC_F_NEXT 0x1
+#define VRING_DESC_F_WRITE 0x2
+#define VRING_AVAIL_F_NO_INTERRUPT 0x1
+#define VRING_USED_F_NO_NOTIFY 0x1
+
+#define VIRTQ_MAX_SIZE 256
+
+typedef struct {
+    uint64_t addr;
+    uint32_t len;
+    uint16_t flags;
+    uint16_t next;
+} __attribute__((packed)) vring_desc_t;
+
+typedef struct {
+    uint16_t flags;
+    uint16_t idx;
+    uint16_t ring[];
+} __attribute__((packed)) vring_avail_t;
+
+typedef struct {
+    uint32_t id;
+    uint32_t len;
+} __attribute__((packed)) vring_used_elem_t;
+
+typedef struct {
+    uint16_t flags;
+    uint16_t idx;
+    vring_used_elem_t ring[];
+} __attribute__((packed)) vring_used_t;
+
+typedef struct {
+    void* buffer;
+    uint32_t length;
+    bool device_writes;
+} virtq_buffer_t;
+
+typedef struct virtqueue {
+    uint16_t index;
+    uint16_t size;
+    uint16_t io_base;
+    bool event_idx;
+    vring_desc_t* desc;
+    vring_avail_t* avail;
+    vring_used_t* used;
+    void* ring_memory;
+    uint16_t free_head;
+    uint16_t num_free;
+    uint16_t last_used_idx;
+    uint16_t avail_idx;
+    uint16_t kicked_avail_idx;
+    void* cookies[VIRTQ_MAX_SIZE];
+} virtqueue_t;
+
+typedef struct virtio_device {
+    uint16_t io_base;
+    uint32_t irq;
+    uint32_t features;
+} virtio_device_t;
+
+static inline void outw(uint16_t port, uint16_t value) {
+    asm volatile("outw %0, %1" : : "a"(value), "Nd"(port));
+}
+
+static inline uint16_t inw(uint16_t port) {
+    uint16_t value;
+    asm volatile("inw %1, %0" : "=a"(value) : "Nd"(port));
+    return value;
+}
+
+static inline void outl(uint16_t port, uint32_t value) {
+    asm volatile("outl %0, %1" : : "a"(value), "Nd"(port));
+}
+
+static inline uint32_t inl(uint16_t port) {
+    uint32_t value;
+    asm volatile("inl %1, %0" : "=a"(value) : "Nd"(port));
+    return value;
+}
+
+static inline void virtio_mb() {
+    asm volatile("lock; addl $0, (%%esp)" : : : "memory");
+}
+
+uint8_t virtio_get_status(virtio_device_t* vdev) {
+    return inb(vdev->io_base + VIRTIO_PCI_STATUS);
+}
+
+void virtio_set_status(virtio_device_t* vdev, uint8_t status) {
+    outb(vdev->io_base + VIRTIO_PCI_STATUS, status);
+}
+
+void virtio_add_status(virtio_device_t* vdev, uint8_t status) {
+    virtio_set_status(vdev, virtio_get_status(vdev) | status);
+}
+
+// Réinitialiser le périphérique puis annoncer le pilote
+virtio_device_t* virtio_open(uint16_t io_base, uint32_t irq) {
+    virtio_device_t* vdev = (virtio_device_t*)kmalloc(sizeof(virtio_device_t));
+    if (!vdev) {
+        return NULL;
+    }
+
+    vdev->io_base = io_base;
+    vdev->irq = irq;
+    vdev->features = 0;
+
+    virtio_set_status(vdev, 0);
+    virtio_add_status(vdev, VIRTIO_STATUS_ACKNOWLEDGE);
+    virtio_add_status(vdev, VIRTIO_STATUS_DRIVER);
+    return vdev;
+}
+
+void virtio_close(virtio_device_t* vdev) {
+    if (!vdev) return;
+    virtio_set_status(vdev, 0);
+    kfree(vdev);
+}
+
+// Négocier les fonctionnalités: on ne garde que celles que l'hôte propose
+uint32_t virtio_negotiate_features(virtio_device_t* vdev, uint32_t wanted) {
+    uint32_t host = inl(vdev->io_base + VIRTIO_PCI_HOST_FEATURES);
+    vdev->features = host & wanted;
+    outl(vdev->io_base + VIRTIO_PCI_GUEST_FEATURES, vdev->features);
+    return vdev->features;
+}
+
+bool virtio_has_feature(virtio_device_t* vdev, uint32_t feature) {
+    return (vdev->features & feature) != 0;
+}
+
+uint8_t virtio_config_read8(virtio_device_t* vdev, uint32_t offset) {
+    return inb(vdev->io_base + VIRTIO_PCI_CONFIG + offset);
+}
+
+uint16_t virtio_config_read16(virtio_device_t* vdev, uint32_t offset) {
+    return inw(vdev->io_base + VIRTIO_PCI_CONFIG + offset);
+}
+
+uint32_t virtio_config_read32(virtio_device_t* vdev, uint32_t offset) {
+    return inl(vdev->io_base + VIRTIO_PCI_CONFIG + offset);
+}
+
+// Lire le registre ISR acquitte l'interruption
+uint8_t virtio_read_isr(virtio_device_t* vdev) {
+    return inb(vdev->io_base + VIRTIO_PCI_ISR);
+}
+
+// Champs placés juste après chaque anneau: calculés depuis le début de la structure, sans
+// prendre l'adresse d'un membre packed
+static uint16_t* vring_used_event(virtqueue_t* vq) {
+    return (uint16_t*)((uint8_t*)vq->avail + sizeof(vring_avail_t) + vq->size * sizeof(uint16_t));
+}
+
+static uint16_t* vring_avail_event(virtqueue_t* vq) {
+    return (uint16_t*)((uint8_t*)vq->used + sizeof(vring_used_t) + vq->size * sizeof(vring_used_elem_t));
+}
+
+// Vrai si new_idx vient de franchir event_idx depuis old_idx
+static bool vring_need_event(uint16_t event_idx, uint16_t new_idx, uint16_t old_idx) {
+    return (uint16_t)(new_idx - event_idx - 1) < (uint16_t)(new_idx - old_idx);
+}
+
+virtqueue_t* virtq_create(virtio_device_t* vdev, uint16_t index) {
+    outw(vdev->io_base + VIRTIO_PCI_QUEUE_SELECT, index);
+    uint16_t size = inw(vdev->io_base + VIRTIO_PCI_QUEUE_SIZE);
+    if (size == 0 || size > VIRTQ_MAX_SIZE) {
+        return NULL;
+    }
+
+    virtqueue_t* vq = (virtqueue_t*)kmalloc(sizeof(virtqueue_t));
+    if (!vq) {
+        return NULL;
+    }
+    memset(vq, 0, sizeof(virtqueue_t));
+
+    // Disposition legacy: descripteurs + anneau avail, puis anneau used aligné sur une page
+    uint32_t avail_end = size * sizeof(vring_desc_t) + sizeof(uint16_t) * (3 + size);
+    uint32_t used_offset = (avail_end + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+    uint32_t used_size = sizeof(uint16_t) * 3 + sizeof(vring_used_elem_t) * size;
+    uint32_t total = used_offset + ((used_size + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1));
+
+    uint8_t* memory = (uint8_t*)kmalloc_aligned(total, PAGE_SIZE);
+    if (!memory) {
+        kfree(vq);
+        return NULL;
+    }
+    memset(memory, 0, total);
+
+    vq->index = index;
+    vq->size = size;
+    vq->io_base = vdev->io_base;
+    vq->event_idx = virtio_has_feature(vdev, VIRTIO_RING_F_EVENT_IDX);
+    vq->ring_memory = memory;
+    vq->desc = (vring_desc_t*)memory;
+    vq->avail = (vring_avail_t*)(memory + size * sizeof(vring_desc_t));
+    vq->used = (vring_used_t*)(memory + used_offset);
+
+    // Chaîner tous les descripteurs dans la liste libre
+    for (uint16_t i = 0; i < size - 1; i++) {
+        vq->desc[i].next = i + 1;
+    }
+    vq->free_head = 0;
+    vq->num_free = size;
+
+    outl(vdev->io_base + VIRTIO_PCI_QUEUE_PFN, virt_to_phys(memory) / PAGE_SIZE);
+    return vq;
+}
+
+void virtq_destroy(virtio_device_t* vdev, virtqueue_t* vq) {
+    outw(vdev->io_base + VIRTIO_PCI_QUEUE_SELECT, vq->index);
+    outl(vdev->io_base + VIRTIO_PCI_QUEUE_PFN, 0);
+    kfree(vq->ring_memory);
+    kfree(vq);
+}
+
+// Ajouter une chaîne de tampons. Les tampons sont découpés aux frontières de page
+// car un tampon contigu en virtuel ne l'est pas forcément en physique.
+bool virtq_add(virtqueue_t* vq, const virtq_buffer_t* buffers, uint32_t count, void* cookie) {
+    uint32_t needed = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t start = (uint32_t)buffers[i].buffer;
+        uint32_t end = start + buffers[i].length;
+        needed += ((end - 1) / PAGE_SIZE) - (start / PAGE_SIZE) + 1;
+    }
+
+    if (needed == 0 || needed > vq->num_free) {
+        return false;
+    }
+
+    uint16_t head = vq->free_head;
+    uint16_t current = head;
+    uint16_t last = head;
+
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t addr = (uint32_t)buffers[i].buffer;
+        uint32_t remaining = buffers[i].length;
+
+        while (remaining > 0) {
+            uint32_t chunk = PAGE_SIZE - (addr & (PAGE_SIZE - 1));
+            if (chunk > remaining) chunk = remaining;
+
+            vring_desc_t* desc = &vq->desc[current];
+            desc->addr = virt_to_phys((void*)addr);
+            desc->len = chunk;
+            desc->flags = VRING_DESC_F_NEXT | (buffers[i].device_writes ? VRING_DESC_F_WRITE : 0);
+
+            last = current;
+            current = desc->next;
+            addr += chunk;
+            remaining -= chunk;
+        }
+    }
+
+    vq->desc[last].flags &= ~VRING_DESC_F_NEXT;
+    vq->free_head = current;
+    vq->num_free -= needed;
+    vq->cookies[head] = cookie;
+
+    // Publier la tête de chaîne sans encore notifier le périphérique
+    vq->avail->ring[vq->avail_idx % vq->size] = head;
+    vq->avail_idx++;
+    return true;
+}
+
+// Notifier le périphérique, sauf s'il a indiqué (event idx) qu'il n'en a pas besoin
+void virtq_kick(virtqueue_t* vq) {
+    virtio_mb();
+    uint16_t old_idx = vq->kicked_avail_idx;
+    uint16_t new_idx = vq->avail_idx;
+    vq->avail->idx = new_idx;
+    vq->kicked_avail_idx = new_idx;
+    virtio_mb();
+
+    bool notify;
+    if (vq->event_idx) {
+        notify = vring_need_event(*vring_avail_event(vq), new_idx, old_idx);
+    } else {
+        notify = !(vq->used->flags & VRING_USED_F_NO_NOTIFY);
+    }
+
+    if (notify) {
+        outw(vq->io_base + VIRTIO_PCI_QUEUE_NOTIFY, vq->index);
+    }
+}
+
+bool virtq_has_used(virtqueue_t* vq) {
+    virtio_mb();
+    return vq->last_used_idx != vq->used->idx;
+}
+
+// Récupérer un tampon terminé et rendre ses descripteurs à la liste libre
+void* virtq_get_used(virtqueue_t* vq, uint32_t* length) {
+    if (!virtq_has_used(vq)) {
+        return NULL;
+    }
+
+    vring_used_elem_t* elem = &vq->used->ring[vq->last_used_idx % vq->size];
+    uint16_t head = (uint16_t)elem->id;
+    if (length) *length = elem->len;
+    vq->last_used_idx++;
+
+    void* cookie = vq->cookies[head];
+    vq->cookies[head] = NULL;
+
+    uint16_t current = head;
+    uint16_t freed = 1;
+    while (vq->desc[current].flags & VRING_DESC_F_NEXT) {
+        current = vq->desc[current].next;
+        freed++;
+    }
+    vq->desc[current].next = vq->free_head;
+    vq->free_head = head;
+    vq->num_free += freed;
+
+    return cookie;
+}
+
+// Demander une interruption seulement quand `pending` tampons de plus seront terminés
+void virtq_enable_cb_delayed(virtqueue_t* vq, uint16_t pending) {
+    if (vq->event_idx) {
+        *vring_used_event(vq) = vq->last_used_idx + (pending ? pending - 1 : 0);
+    } else {
+        vq->avail->flags &= ~VRING_AVAIL_F_NO_INTERRUPT;
+    }
+    virtio_mb();
+}
+
+void virtq_enable_cb(virtqueue_t* vq) {
+    virtq_enable_cb_delayed(vq, 1);
+}
+
+void virtq_disable_cb(virtqueue_t* vq) {
+    if (vq->event_idx) {
+        // Placer l'événement le plus loin possible de l'index courant
+        *vring_used_event(vq) = vq->last_used_idx - 1;
+    } else {
+        vq->avail->flags |= VRING_AVAIL_F_NO_INTERRUPT;
+    }
+}
+
+uint16_t virtq_free_count(virtqueue_t* vq) {
+    return vq->num_free;
+}
+
+void virtio_driver_ok(virtio_device_t* vdev) {
+    virtio_add_status(vdev, VIRTIO_STATUS_DRIVER_OK);
+}
+
+void virtio_fail(virtio_device_t* vdev) {
+    virtio_add_status(vdev, VIRTIO_STATUS_FAILED);
+}
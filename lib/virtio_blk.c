@@ -0,0 +1,499 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define PAGE_SIZE 4096
+#define SECTOR_SIZE 512
+
+#define VIRTIO_VENDOR_ID 0x1AF4
+#define VIRTIO_BLK_DEVICE_ID 0x1001
+#define VIRTIO_BLK_MAX_DEVICES 8
+
+#define VIRTIO_BLK_F_SEG_MAX (1u << 2)
+#define VIRTIO_BLK_F_RO (1u << 5)
+#define VIRTIO_BLK_F_BLK_SIZE (1u << 6)
+#define VIRTIO_BLK_F_FLUSH (1u << 9)
+#define VIRTIO_RING_F_EVENT_IDX (1u << 29)
+
+// Champs de la configuration spécifique virtio-blk
+#define VIRTIO_BLK_CONFIG_CAPACITY 0
+#define VIRTIO_BLK_CONFIG_SEG_MAX 12
+#define VIRTIO_BLK_CONFIG_BLK_SIZE 20
+
+#define VIRTIO_BLK_T_IN 0
+#define VIRTIO_BLK_T_OUT 1
+#define VIRTIO_BLK_T_FLUSH 4
+
+#define VIRTIO_BLK_S_OK 0
+
+#define VIRTIO_BLK_MAX_TRANSFER 65536
+#define VIRTIO_BLK_MAX_REQUESTS 64
+
+#define BLOCK_IOCTL_GET_CAPACITY 0x4201
+#define BLOCK_IOCTL_GET_BLOCK_SIZE 0x4202
+#define BLOCK_IOCTL_FLUSH 0x4203
+#define BLOCK_IOCTL_SUBMIT_READS 0x4204
+#define BLOCK_IOCTL_POLL 0x4205
+
+typedef enum {
+    DEVICE_TYPE_CHAR,
+    DEVICE_TYPE_BLOCK,
+    DEVICE_TYPE_NETWORK,
+    DEVICE_TYPE_DISPLAY,
+    DEVICE_TYPE_SOUND,
+    DEVICE_TYPE_INPUT
+} device_type_t;
+
+typedef enum {
+    DEVICE_STATE_READY,
+    DEVICE_STATE_BUSY,
+    DEVICE_STATE_ERROR,
+    DEVICE_STATE_OFFLINE
+} device_state_t;
+
+typedef struct {
+    uint32_t id;
+    char name[32];
+    device_type_t type;
+    device_state_t state;
+    void* driver;
+    void* data;
+    uint32_t irq;
+    uint8_t dma_channel;
+} device_t;
+
+typedef struct {
+    char name[32];
+    device_type_t type;
+    bool (*init)(device_t* device);
+    void (*deinit)(device_t* device);
+    int (*read)(device_t* device, void* buffer, size_t size, size_t offset);
+    int (*write)(device_t* device, const void* buffer, size_t size, size_t offset);
+    int (*ioctl)(device_t* device, uint32_t request, void* arg);
+} driver_t;
+
+typedef struct pci_device pci_device_t;
+
+typedef struct virtio_device virtio_device_t;
+typedef struct virtqueue virtqueue_t;
+
+typedef struct {
+    void* buffer;
+    uint32_t length;
+    bool device_writes;
+} virtq_buffer_t;
+
+// Déclarations externes (lib/pci.c)
+extern uint32_t pci_bar_address(pci_device_t* dev, uint32_t bar);
+extern bool pci_bar_is_io(pci_device_t* dev, uint32_t bar);
+
+// Déclarations externes (lib/virtio.c)
+extern virtio_device_t* virtio_open(uint16_t io_base, uint32_t irq);
+extern void virtio_close(virtio_device_t* vdev);
+extern uint32_t virtio_negotiate_features(virtio_device_t* vdev, uint32_t wanted);
+extern uint32_t virtio_config_read32(virtio_device_t* vdev, uint32_t offset);
+extern uint8_t virtio_read_isr(virtio_device_t* vdev);
+extern virtqueue_t* virtq_create(virtio_device_t* vdev, uint16_t index);
+extern void virtq_destroy(virtio_device_t* vdev, virtqueue_t* vq);
+extern bool virtq_add(virtqueue_t* vq, const virtq_buffer_t* buffers, uint32_t count, void* cookie);
+extern void virtq_kick(virtqueue_t* vq);
+extern void* virtq_get_used(virtqueue_t* vq, uint32_t* length);
+extern void virtq_enable_cb(virtqueue_t* vq);
+extern void virtq_enable_cb_delayed(virtqueue_t* vq, uint16_t pending);
+
+typedef struct {
+    uint32_t type;
+    uint32_t reserved;
+    uint64_t sector;
+} __attribute__((packed)) virtio_blk_header_t;
+
+typedef struct {
+    virtio_blk_header_t header;
+    uint8_t status;
+    bool in_use;
+    void (*complete)(void* context, bool success);
+    void* context;
+} virtio_blk_request_t;
+
+typedef struct {
+    virtio_device_t* vdev;
+    virtqueue_t* vq;
+    uint64_t capacity;
+    uint32_t block_size;
+    uint32_t max_transfer;
+    bool read_only;
+    bool can_flush;
+    virtio_blk_request_t requests[VIRTIO_BLK_MAX_REQUESTS];
+    uint32_t inflight;
+} virtio_blk_t;
+
+// Lecture asynchrone: `complete` est appelé depuis l'IRQ du périphérique
+typedef struct {
+    uint64_t offset;
+    void* buffer;
+    uint32_t size;
+    void (*complete)(void* context, bool success);
+    void* context;
+} block_request_t;
+
+typedef struct {
+    block_request_t* requests;
+    uint32_t count;
+} block_batch_t;
+
+// Suivi d'un transfert synchrone découpé en plusieurs requêtes
+typedef struct {
+    uint32_t completed;
+    bool failed;
+} virtio_blk_wait_t;
+
+static bool virtio_blk_init(device_t* device);
+static void virtio_blk_deinit(device_t* device);
+static int virtio_blk_read(device_t* device, void* buffer, size_t size, size_t offset);
+static int virtio_blk_write(device_t* device, const void* buffer, size_t size, size_t offset);
+static int virtio_blk_ioctl(device_t* device, uint32_t request, void* arg);
+
+static uint32_t virtio_blk_count = 0;
+
+static const driver_t virtio_blk_driver = {
+    "virtio-blk",
+    DEVICE_TYPE_BLOCK,
+    virtio_blk_init,
+    virtio_blk_deinit,
+    virtio_blk_read,
+    virtio_blk_write,
+    virtio_blk_ioctl
+};
+
+static virtio_blk_request_t* virtio_blk_alloc_request(virtio_blk_t* blk) {
+    for (uint32_t i = 0; i < VIRTIO_BLK_MAX_REQUESTS; i++) {
+        if (!blk->requests[i].in_use) {
+            blk->requests[i].in_use = true;
+            return &blk->requests[i];
+        }
+    }
+    return NULL;
+}
+
+// Traiter les requêtes terminées (appelé depuis l'IRQ ou en attente active)
+static void virtio_blk_reap(virtio_blk_t* blk) {
+    uint32_t flags = irq_save();
+    virtio_blk_request_t* request;
+    while ((request = (virtio_blk_request_t*)virtq_get_used(blk->vq, NULL)) != NULL) {
+        blk->inflight--;
+        request->in_use = false;
+        if (request->complete) {
+            request->complete(request->context, request->status == VIRTIO_BLK_S_OK);
+        }
+    }
+    irq_restore(flags);
+}
+
+static void virtio_blk_irq(void* data) {
+    virtio_blk_t* blk = (virtio_blk_t*)data;
+    virtio_read_isr(blk->vdev);
+    virtio_blk_reap(blk);
+}
+
+// Mettre une requête dans la file sans notifier le périphérique
+static bool virtio_blk_queue(virtio_blk_t* blk, uint32_t type, uint64_t sector,
+                             void* buffer, uint32_t length,
+                             void (*complete)(void*, bool), void* context) {
+    virtio_blk_request_t* request = virtio_blk_alloc_request(blk);
+    if (!request) {
+        return false;
+    }
+
+    request->header.type = type;
+    request->header.reserved = 0;
+    request->header.sector = sector;
+    request->status = 0xFF;
+    request->complete = complete;
+    request->context = context;
+
+    virtq_buffer_t buffers[3];
+    uint32_t count = 0;
+    buffers[count].buffer = &request->header;
+    buffers[count].length = sizeof(virtio_blk_header_t);
+    buffers[count++].device_writes = false;
+    if (length) {
+        buffers[count].buffer = buffer;
+        buffers[count].length = length;
+        buffers[count++].device_writes = (type == VIRTIO_BLK_T_IN);
+    }
+    buffers[count].buffer = &request->status;
+    buffers[count].length = 1;
+    buffers[count++].device_writes = true;
+
+    uint32_t flags = irq_save();
+    bool queued = virtq_add(blk->vq, buffers, count, request);
+    if (queued) {
+        blk->inflight++;
+    }
+    irq_restore(flags);
+
+    if (!queued) {
+        request->in_use = false;
+    }
+    return queued;
+}
+
+static void virtio_blk_sync_complete(void* context, bool success) {
+    virtio_blk_wait_t* wait = (virtio_blk_wait_t*)context;
+    wait->completed++;
+    if (!success) wait->failed = true;
+}
+
+// Transfert aligné sur les secteurs: on garde autant de requêtes en vol
+// que la file le permet et on ne notifie qu'une fois par lot.
+static bool virtio_blk_transfer(virtio_blk_t* blk, uint32_t type, uint8_t* buffer,
+                                uint32_t size, uint64_t sector) {
+    virtio_blk_wait_t wait = { 0, false };
+    uint32_t submitted = 0;
+    uint32_t done = 0;
+
+    while (done < size || wait.completed < submitted) {
+        bool queued_any = false;
+        while (done < size) {
+            uint32_t chunk = size - done;
+            if (chunk > blk->max_transfer) chunk = blk->max_transfer;
+
+            if (!virtio_blk_queue(blk, type, sector + done / SECTOR_SIZE,
+                                  buffer + done, chunk, virtio_blk_sync_complete, &wait)) {
+                break;
+            }
+            submitted++;
+            done += chunk;
+            queued_any = true;
+        }
+
+        if (queued_any) {
+            // Une seule interruption quand tout le lot est terminé
+            virtq_enable_cb_delayed(blk->vq, submitted - wait.completed);
+            virtq_kick(blk->vq);
+        } else if (wait.completed == submitted) {
+            // File pleine de requêtes d'autres appelants: attendre qu'elle se libère
+            virtio_blk_reap(blk);
+            asm volatile("pause");
+            continue;
+        }
+
+        uint32_t completed = wait.completed;
+        while (wait.completed == completed && completed < submitted) {
+            virtio_blk_reap(blk);
+            asm volatile("pause");
+        }
+    }
+
+    return !wait.failed;
+}
+
+static bool virtio_blk_check_range(virtio_blk_t* blk, size_t size, size_t offset) {
+    uint64_t end = (uint64_t)offset + size;
+    return end <= blk->capacity * SECTOR_SIZE;
+}
+
+static int virtio_blk_read(device_t* device, void* buffer, size_t size, size_t offset) {
+    virtio_blk_t* blk = (virtio_blk_t*)device->data;
+    if (!blk || !virtio_blk_check_range(blk, size, offset)) return -1;
+    if (size == 0) return 0;
+
+    if (offset % SECTOR_SIZE == 0 && size % SECTOR_SIZE == 0) {
+        return virtio_blk_transfer(blk, VIRTIO_BLK_T_IN, (uint8_t*)buffer, size,
+                                   offset / SECTOR_SIZE) ? (int)size : -1;
+    }
+
+    // Accès non aligné: passer par un tampon couvrant les secteurs concernés
+    uint32_t first = offset / SECTOR_SIZE;
+    uint32_t last = (offset + size + SECTOR_SIZE - 1) / SECTOR_SIZE;
+    uint32_t span = (last - first) * SECTOR_SIZE;
+    uint8_t* bounce = (uint8_t*)kmalloc(span);
+    if (!bounce) return -1;
+
+    bool ok = virtio_blk_transfer(blk, VIRTIO_BLK_T_IN, bounce, span, first);
+    if (ok) {
+        memcpy(buffer, bounce + offset % SECTOR_SIZE, size);
+    }
+    kfree(bounce);
+    return ok ? (int)size : -1;
+}
+
+static int virtio_blk_write(device_t* device, const void* buffer, size_t size, size_t offset) {
+    virtio_blk_t* blk = (virtio_blk_t*)device->data;
+    if (!blk || blk->read_only || !virtio_blk_check_range(blk, size, offset)) return -1;
+    if (size == 0) return 0;
+
+    if (offset % SECTOR_SIZE == 0 && size % SECTOR_SIZE == 0) {
+        return virtio_blk_transfer(blk, VIRTIO_BLK_T_OUT, (uint8_t*)buffer, size,
+                                   offset / SECTOR_SIZE) ? (int)size : -1;
+    }
+
+    // Lecture-modification-écriture des secteurs partiellement couverts
+    uint32_t first = offset / SECTOR_SIZE;
+    uint32_t last = (offset + size + SECTOR_SIZE - 1) / SECTOR_SIZE;
+    uint32_t span = (last - first) * SECTOR_SIZE;
+    uint8_t* bounce = (uint8_t*)kmalloc(span);
+    if (!bounce) return -1;
+
+    bool ok = virtio_blk_transfer(blk, VIRTIO_BLK_T_IN, bounce, span, first);
+    if (ok) {
+        memcpy(bounce + offset % SECTOR_SIZE, buffer, size);
+        ok = virtio_blk_transfer(blk, VIRTIO_BLK_T_OUT, bounce, span, first);
+    }
+    kfree(bounce);
+    return ok ? (int)size : -1;
+}
+
+static bool virtio_blk_flush(virtio_blk_t* blk) {
+    if (!blk->can_flush) return true;
+
+    virtio_blk_wait_t wait = { 0, false };
+    if (!virtio_blk_queue(blk, VIRTIO_BLK_T_FLUSH, 0, NULL, 0, virtio_blk_sync_complete, &wait)) {
+        return false;
+    }
+    virtq_enable_cb(blk->vq);
+    virtq_kick(blk->vq);
+
+    while (wait.completed == 0) {
+        virtio_blk_reap(blk);
+        asm volatile("pause");
+    }
+    return !wait.failed;
+}
+
+// Mettre en file un lot de lectures et ne notifier qu'une fois; renvoie le nombre de requêtes acceptées.
+// L'appelant traite lui-même celles qui restent (file pleine, accès non aligné).
+static int virtio_blk_submit_reads(virtio_blk_t* blk, block_batch_t* batch) {
+    if (!batch || !batch->requests) return -1;
+
+    uint32_t queued = 0;
+    while (queued < batch->count) {
+        block_request_t* request = &batch->requests[queued];
+        if (!request->complete ||
+            request->offset % SECTOR_SIZE || request->size % SECTOR_SIZE ||
+            request->size > blk->max_transfer ||
+            !virtio_blk_check_range(blk, request->size, request->offset)) {
+            break;
+        }
+
+        if (!virtio_blk_queue(blk, VIRTIO_BLK_T_IN, request->offset / SECTOR_SIZE,
+                              request->buffer, request->size, request->complete, request->context)) {
+            break;
+        }
+        queued++;
+    }
+
+    if (queued) {
+        virtq_enable_cb(blk->vq);
+        virtq_kick(blk->vq);
+    }
+    return queued;
+}
+
+static int virtio_blk_ioctl(device_t* device, uint32_t request, void* arg) {
+    virtio_blk_t* blk = (virtio_blk_t*)device->data;
+    if (!blk) return -1;
+
+    switch (request) {
+        case BLOCK_IOCTL_GET_CAPACITY:
+            if (!arg) return -1;
+            *(uint64_t*)arg = blk->capacity * SECTOR_SIZE;
+            return 0;
+        case BLOCK_IOCTL_GET_BLOCK_SIZE:
+            if (!arg) return -1;
+            *(uint32_t*)arg = blk->block_size;
+            return 0;
+        case BLOCK_IOCTL_FLUSH:
+            return virtio_blk_flush(blk) ? 0 : -1;
+        case BLOCK_IOCTL_SUBMIT_READS:
+            return virtio_blk_submit_reads(blk, (block_batch_t*)arg);
+        case BLOCK_IOCTL_POLL:
+            // Pour qui attend une lecture asynchrone avec les interruptions masquées
+            virtio_blk_reap(blk);
+            return 0;
+        default:
+            return -1;
+    }
+}
+
+static bool virtio_blk_init(device_t* device) {
+    pci_device_t* pci = (pci_device_t*)device->data;
+    if (!pci || virtio_blk_count >= VIRTIO_BLK_MAX_DEVICES) return false;
+
+    uint32_t bar0 = pci_bar_address(pci, 0);
+    if (!pci_bar_is_io(pci, 0) || bar0 == 0) {
+        // Seule l'interface legacy (BAR0 en espace I/O) est gérée
+        return false;
+    }
+    pci_enable_device(pci);
+
+    virtio_blk_t* blk = (virtio_blk_t*)kmalloc(sizeof(virtio_blk_t));
+    if (!blk) return false;
+    memset(blk, 0, sizeof(virtio_blk_t));
+
+    blk->vdev = virtio_open(bar0, device->irq);
+    if (!blk->vdev) {
+        kfree(blk);
+        return false;
+    }
+
+    uint32_t features = virtio_negotiate_features(blk->vdev,
+        VIRTIO_RING_F_EVENT_IDX | VIRTIO_BLK_F_SEG_MAX | VIRTIO_BLK_F_RO |
+        VIRTIO_BLK_F_BLK_SIZE | VIRTIO_BLK_F_FLUSH);
+
+    blk->capacity = (uint64_t)virtio_config_read32(blk->vdev, VIRTIO_BLK_CONFIG_CAPACITY) |
+                    ((uint64_t)virtio_config_read32(blk->vdev, VIRTIO_BLK_CONFIG_CAPACITY + 4) << 32);
+    blk->block_size = (features & VIRTIO_BLK_F_BLK_SIZE) ?
+                      virtio_config_read32(blk->vdev, VIRTIO_BLK_CONFIG_BLK_SIZE) : SECTOR_SIZE;
+    blk->read_only = (features & VIRTIO_BLK_F_RO) != 0;
+    blk->can_flush = (features & VIRTIO_BLK_F_FLUSH) != 0;
+
+    // Chaque page du tampon consomme un segment
+    blk->max_transfer = VIRTIO_BLK_MAX_TRANSFER;
+    if (features & VIRTIO_BLK_F_SEG_MAX) {
+        uint32_t seg_max = virtio_config_read32(blk->vdev, VIRTIO_BLK_CONFIG_SEG_MAX);
+        if (seg_max > 1 && (seg_max - 1) * PAGE_SIZE < blk->max_transfer) {
+            blk->max_transfer = (seg_max - 1) * PAGE_SIZE;
+        }
+    }
+
+    blk->vq = virtq_create(blk->vdev, 0);
+    if (!blk->vq) {
+        virtio_fail(blk->vdev);
+        virtio_close(blk->vdev);
+        kfree(blk);
+        return false;
+    }
+
+    register_irq_handler(device->irq, virtio_blk_irq, blk);
+    virtio_driver_ok(blk->vdev);
+
+    // vda, vdb, ... dans l'ordre de découverte sur le bus
+    strcpy(device->name, "vda");
+    device->name[2] = 'a' + virtio_blk_count++;
+    device->data = blk;
+    return true;
+}
+
+static void virtio_blk_deinit(device_t* device) {
+    virtio_blk_t* blk = (virtio_blk_t*)device->data;
+    if (!blk) return;
+
+    while (blk->inflight) {
+        virtio_blk_reap(blk);
+        asm volatile("pause");
+    }
+
+    unregister_irq_handler(device->irq, virtio_blk_irq, blk);
+    virtio_set_status(blk->vdev, 0);
+    virtq_destroy(blk->vdev, blk->vq);
+    virtio_close(blk->vdev);
+    kfree(blk);
+    device->data = NULL;
+}
+
+// Les contrôleurs virtio-blk sont liés par pci_bind_drivers() au démarrage
+void init_virtio_blk() {
+    register_driver(&virtio_blk_driver);
+    pci_register_driver(VIRTIO_VENDOR_ID, VIRTIO_BLK_DEVICE_ID, &virtio_blk_driver);
+}
\ No newline at end of file
@@ -0,0 +1,456 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define VIRTIO_VENDOR_ID 0x1AF4
+#define VIRTIO_NET_DEVICE_ID 0x1000
+#define VIRTIO_NET_MAX_DEVICES 4
+
+#define VIRTIO_NET_F_MAC (1u << 5)
+#define VIRTIO_NET_F_STATUS (1u << 16)
+#define VIRTIO_RING_F_EVENT_IDX (1u << 29)
+
+#define VIRTIO_NET_CONFIG_MAC 0
+#define VIRTIO_NET_CONFIG_STATUS 6
+#define VIRTIO_NET_S_LINK_UP 1
+
+#define VIRTIO_NET_RX_QUEUE 0
+#define VIRTIO_NET_TX_QUEUE 1
+#define VIRTIO_NET_RX_BUFFERS 64
+#define VIRTIO_NET_TX_BUFFERS 64
+#define VIRTIO_NET_MAX_FRAME 1514
+#define VIRTIO_NET_MAX_FRAGMENTS 4
+
+#define NET_IOCTL_GET_MAC 0x4E01
+#define NET_IOCTL_GET_LINK 0x4E02
+#define NET_IOCTL_SEND_FRAGMENTS 0x4E03
+
+typedef enum {
+    DEVICE_TYPE_CHAR,
+    DEVICE_TYPE_BLOCK,
+    DEVICE_TYPE_NETWORK,
+    DEVICE_TYPE_DISPLAY,
+    DEVICE_TYPE_SOUND,
+    DEVICE_TYPE_INPUT
+} device_type_t;
+
+typedef enum {
+    DEVICE_STATE_READY,
+    DEVICE_STATE_BUSY,
+    DEVICE_STATE_ERROR,
+    DEVICE_STATE_OFFLINE
+} device_state_t;
+
+typedef struct {
+    uint32_t id;
+    char name[32];
+    device_type_t type;
+    device_state_t state;
+    void* driver;
+    void* data;
+    uint32_t irq;
+    uint8_t dma_channel;
+} device_t;
+
+typedef struct {
+    char name[32];
+    device_type_t type;
+    bool (*init)(device_t* device);
+    void (*deinit)(device_t* device);
+    int (*read)(device_t* device, void* buffer, size_t size, size_t offset);
+    int (*write)(device_t* device, const void* buffer, size_t size, size_t offset);
+    int (*ioctl)(device_t* device, uint32_t request, void* arg);
+} driver_t;
+
+typedef struct pci_device pci_device_t;
+
+typedef struct virtio_device virtio_device_t;
+typedef struct virtqueue virtqueue_t;
+
+typedef struct {
+    void* buffer;
+    uint32_t length;
+    bool device_writes;
+} virtq_buffer_t;
+
+// Déclarations externes (lib/pci.c)
+extern uint32_t pci_bar_address(pci_device_t* dev, uint32_t bar);
+extern bool pci_bar_is_io(pci_device_t* dev, uint32_t bar);
+
+// Déclarations externes (lib/virtio.c)
+extern virtio_device_t* virtio_open(uint16_t io_base, uint32_t irq);
+extern void virtio_close(virtio_device_t* vdev);
+extern uint32_t virtio_negotiate_features(virtio_device_t* vdev, uint32_t wanted);
+extern uint8_t virtio_config_read8(virtio_device_t* vdev, uint32_t offset);
+extern uint16_t virtio_config_read16(virtio_device_t* vdev, uint32_t offset);
+extern uint8_t virtio_read_isr(virtio_device_t* vdev);
+extern virtqueue_t* virtq_create(virtio_device_t* vdev, uint16_t index);
+extern void virtq_destroy(virtio_device_t* vdev, virtqueue_t* vq);
+extern bool virtq_add(virtqueue_t* vq, const virtq_buffer_t* buffers, uint32_t count, void* cookie);
+extern void virtq_kick(virtqueue_t* vq);
+extern void* virtq_get_used(virtqueue_t* vq, uint32_t* length);
+extern bool virtq_has_used(virtqueue_t* vq);
+extern void virtq_enable_cb(virtqueue_t* vq);
+
+typedef struct {
+    uint8_t flags;
+    uint8_t gso_type;
+    uint16_t hdr_len;
+    uint16_t gso_size;
+    uint16_t csum_start;
+    uint16_t csum_offset;
+} __attribute__((packed)) virtio_net_header_t;
+
+typedef struct {
+    virtio_net_header_t header;
+    uint8_t frame[VIRTIO_NET_MAX_FRAME];
+    uint32_t length;
+    bool in_use;
+} virtio_net_buffer_t;
+
+// Trame envoyée sans copie: les morceaux doivent rester valides jusqu'à l'appel de `done`
+typedef struct {
+    const void* data;
+    uint32_t length;
+} net_fragment_t;
+
+typedef struct {
+    const net_fragment_t* fragments;
+    uint32_t count;
+    void (*done)(void* context);
+    void* context;
+} net_frame_t;
+
+typedef struct {
+    virtio_net_header_t header;
+    void (*done)(void* context);
+    void* context;
+    bool in_use;
+} virtio_net_fragment_slot_t;
+
+typedef struct {
+    virtio_device_t* vdev;
+    virtqueue_t* rx;
+    virtqueue_t* tx;
+    uint8_t mac[6];
+    bool has_status;
+    virtio_net_buffer_t* rx_buffers;
+    virtio_net_buffer_t* tx_buffers;
+    // Envois par morceaux: seul l'en-tête virtio est propre au pilote
+    virtio_net_fragment_slot_t fragment_slots[VIRTIO_NET_TX_BUFFERS];
+    // Chaînes encore dans la file d'envoi
+    uint32_t tx_pending;
+    // Trames reçues en attente de lecture (file circulaire)
+    virtio_net_buffer_t* ready[VIRTIO_NET_RX_BUFFERS];
+    uint32_t ready_head;
+    uint32_t ready_count;
+} virtio_net_t;
+
+static bool virtio_net_init(device_t* device);
+static void virtio_net_deinit(device_t* device);
+static int virtio_net_read(device_t* device, void* buffer, size_t size, size_t offset);
+static int virtio_net_write(device_t* device, const void* buffer, size_t size, size_t offset);
+static int virtio_net_ioctl(device_t* device, uint32_t request, void* arg);
+
+static uint32_t virtio_net_count = 0;
+
+static const driver_t virtio_net_driver = {
+    "virtio-net",
+    DEVICE_TYPE_NETWORK,
+    virtio_net_init,
+    virtio_net_deinit,
+    virtio_net_read,
+    virtio_net_write,
+    virtio_net_ioctl
+};
+
+static bool virtio_net_post_rx(virtio_net_t* net, virtio_net_buffer_t* buffer) {
+    virtq_buffer_t buffers[2] = {
+        { &buffer->header, sizeof(virtio_net_header_t), true },
+        { buffer->frame, VIRTIO_NET_MAX_FRAME, true }
+    };
+    buffer->length = 0;
+    return virtq_add(net->rx, buffers, 2, buffer);
+}
+
+// Déplacer les trames reçues vers la file des trames prêtes
+static void virtio_net_reap_rx(virtio_net_t* net) {
+    uint32_t flags = irq_save();
+    virtio_net_buffer_t* buffer;
+    uint32_t length;
+    while ((buffer = (virtio_net_buffer_t*)virtq_get_used(net->rx, &length)) != NULL) {
+        buffer->length = length > sizeof(virtio_net_header_t) ? length - sizeof(virtio_net_header_t) : 0;
+        net->ready[(net->ready_head + net->ready_count) % VIRTIO_NET_RX_BUFFERS] = buffer;
+        net->ready_count++;
+    }
+    irq_restore(flags);
+}
+
+// Tampons envoyés: récupérés par l'interruption, et par les envois quand la file est pleine.
+// `done` est donc appelé depuis l'interruption, comme les fins de requête de virtio-blk
+static void virtio_net_reap_tx(virtio_net_t* net) {
+    uint32_t flags = irq_save();
+    void* cookie;
+    while ((cookie = virtq_get_used(net->tx, NULL)) != NULL) {
+        net->tx_pending--;
+        virtio_net_fragment_slot_t* slot = (virtio_net_fragment_slot_t*)cookie;
+        if (slot >= net->fragment_slots && slot < net->fragment_slots + VIRTIO_NET_TX_BUFFERS) {
+            if (slot->done) slot->done(slot->context);
+            slot->in_use = false;
+        } else {
+            ((virtio_net_buffer_t*)cookie)->in_use = false;
+        }
+    }
+    irq_restore(flags);
+}
+
+static void virtio_net_irq(void* data) {
+    virtio_net_t* net = (virtio_net_t*)data;
+    virtio_read_isr(net->vdev);
+
+    // Avec VIRTIO_F_EVENT_IDX, used_event doit avancer après chaque récolte, sinon le
+    // périphérique n'interrompt plus. Un tampon terminé entre la récolte et le réarmement
+    // n'a pas interrompu: revérifier les deux files après avoir réarmé.
+    do {
+        virtio_net_reap_rx(net);
+        virtio_net_reap_tx(net);
+        virtq_enable_cb(net->rx);
+        virtq_enable_cb(net->tx);
+    } while (virtq_has_used(net->rx) || virtq_has_used(net->tx));
+}
+
+// Retourner la prochaine trame reçue, 0 si aucune n'est disponible
+static int virtio_net_read(device_t* device, void* buffer, size_t size, size_t offset) {
+    // Une interface réseau n'a pas de position: chaque appel livre une trame entière
+    (void)offset;
+    virtio_net_t* net = (virtio_net_t*)device->data;
+    if (!net) return -1;
+
+    virtio_net_reap_rx(net);
+
+    uint32_t flags = irq_save();
+    if (net->ready_count == 0) {
+        irq_restore(flags);
+        return 0;
+    }
+    virtio_net_buffer_t* rx = net->ready[net->ready_head];
+    net->ready_head = (net->ready_head + 1) % VIRTIO_NET_RX_BUFFERS;
+    net->ready_count--;
+    irq_restore(flags);
+
+    uint32_t length = rx->length;
+    if (length > size) length = size;
+    memcpy(buffer, rx->frame, length);
+
+    flags = irq_save();
+    virtio_net_post_rx(net, rx);
+    irq_restore(flags);
+    virtq_kick(net->rx);
+
+    return (int)length;
+}
+
+static int virtio_net_write(device_t* device, const void* buffer, size_t size, size_t offset) {
+    (void)offset;
+    virtio_net_t* net = (virtio_net_t*)device->data;
+    if (!net || size == 0 || size > VIRTIO_NET_MAX_FRAME) return -1;
+
+    virtio_net_buffer_t* tx = NULL;
+    while (!tx) {
+        virtio_net_reap_tx(net);
+        for (uint32_t i = 0; i < VIRTIO_NET_TX_BUFFERS; i++) {
+            if (!net->tx_buffers[i].in_use) {
+                tx = &net->tx_buffers[i];
+                break;
+            }
+        }
+        if (!tx) asm volatile("pause");
+    }
+
+    memset(&tx->header, 0, sizeof(virtio_net_header_t));
+    memcpy(tx->frame, buffer, size);
+    tx->length = size;
+    tx->in_use = true;
+
+    virtq_buffer_t buffers[2] = {
+        { &tx->header, sizeof(virtio_net_header_t), false },
+        { tx->frame, size, false }
+    };
+
+    uint32_t flags = irq_save();
+    bool queued = virtq_add(net->tx, buffers, 2, tx);
+    if (queued) net->tx_pending++;
+    irq_restore(flags);
+    if (!queued) {
+        tx->in_use = false;
+        return -1;
+    }
+
+    virtq_kick(net->tx);
+    return (int)size;
+}
+
+// Envoyer une trame en chaînant directement ses morceaux (en-têtes, pages du cache) dans
+// la file: aucune copie, `done` est appelé quand le périphérique a fini de les lire
+static int virtio_net_send_fragments(virtio_net_t* net, const net_frame_t* frame) {
+    if (!frame->fragments || frame->count == 0 || frame->count > VIRTIO_NET_MAX_FRAGMENTS) return -1;
+
+    virtq_buffer_t buffers[VIRTIO_NET_MAX_FRAGMENTS + 1];
+    uint32_t size = 0;
+    for (uint32_t i = 0; i < frame->count; i++) {
+        buffers[i + 1].buffer = (void*)frame->fragments[i].data;
+        buffers[i + 1].length = frame->fragments[i].length;
+        buffers[i + 1].device_writes = false;
+        size += frame->fragments[i].length;
+    }
+    if (size == 0 || size > VIRTIO_NET_MAX_FRAME) return -1;
+
+    // Attendre un emplacement et assez de descripteurs, tant que des envois sont en cours
+    virtio_net_fragment_slot_t* slot = NULL;
+    while (true) {
+        virtio_net_reap_tx(net);
+        if (!slot) {
+            for (uint32_t i = 0; i < VIRTIO_NET_TX_BUFFERS; i++) {
+                if (!net->fragment_slots[i].in_use) {
+                    slot = &net->fragment_slots[i];
+                    break;
+                }
+            }
+        }
+
+        if (slot) {
+            memset(&slot->header, 0, sizeof(virtio_net_header_t));
+            slot->done = frame->done;
+            slot->context = frame->context;
+            slot->in_use = true;
+            buffers[0].buffer = &slot->header;
+            buffers[0].length = sizeof(virtio_net_header_t);
+            buffers[0].device_writes = false;
+
+            uint32_t flags = irq_save();
+            bool queued = virtq_add(net->tx, buffers, frame->count + 1, slot);
+            if (queued) net->tx_pending++;
+            irq_restore(flags);
+            if (queued) break;
+            slot->in_use = false;
+        }
+
+        if (net->tx_pending == 0) return -1;
+        asm volatile("pause");
+    }
+
+    virtq_kick(net->tx);
+    return (int)size;
+}
+
+static int virtio_net_ioctl(device_t* device, uint32_t request, void* arg) {
+    virtio_net_t* net = (virtio_net_t*)device->data;
+    if (!net || !arg) return -1;
+
+    switch (request) {
+        case NET_IOCTL_GET_MAC:
+            memcpy(arg, net->mac, 6);
+            return 0;
+        case NET_IOCTL_GET_LINK:
+            *(bool*)arg = !net->has_status ||
+                          (virtio_config_read16(net->vdev, VIRTIO_NET_CONFIG_STATUS) & VIRTIO_NET_S_LINK_UP);
+            return 0;
+        case NET_IOCTL_SEND_FRAGMENTS:
+            return virtio_net_send_fragments(net, (const net_frame_t*)arg);
+        default:
+            return -1;
+    }
+}
+
+static void virtio_net_free(virtio_net_t* net) {
+    // Rendre les morceaux des envois qui ne se termineront plus
+    for (uint32_t i = 0; i < VIRTIO_NET_TX_BUFFERS; i++) {
+        virtio_net_fragment_slot_t* slot = &net->fragment_slots[i];
+        if (slot->in_use && slot->done) slot->done(slot->context);
+    }
+    if (net->rx) virtq_destroy(net->vdev, net->rx);
+    if (net->tx) virtq_destroy(net->vdev, net->tx);
+    kfree(net->rx_buffers);
+    kfree(net->tx_buffers);
+    virtio_close(net->vdev);
+    kfree(net);
+}
+
+static bool virtio_net_init(device_t* device) {
+    pci_device_t* pci = (pci_device_t*)device->data;
+    if (!pci || virtio_net_count >= VIRTIO_NET_MAX_DEVICES) return false;
+
+    uint32_t bar0 = pci_bar_address(pci, 0);
+    if (!pci_bar_is_io(pci, 0) || bar0 == 0) {
+        return false;
+    }
+    pci_enable_device(pci);
+
+    virtio_net_t* net = (virtio_net_t*)kmalloc(sizeof(virtio_net_t));
+    if (!net) return false;
+    memset(net, 0, sizeof(virtio_net_t));
+
+    net->vdev = virtio_open(bar0, device->irq);
+    if (!net->vdev) {
+        kfree(net);
+        return false;
+    }
+
+    uint32_t features = virtio_negotiate_features(net->vdev,
+        VIRTIO_RING_F_EVENT_IDX | VIRTIO_NET_F_MAC | VIRTIO_NET_F_STATUS);
+    net->has_status = (features & VIRTIO_NET_F_STATUS) != 0;
+
+    if (features & VIRTIO_NET_F_MAC) {
+        for (uint32_t i = 0; i < 6; i++) {
+            net->mac[i] = virtio_config_read8(net->vdev, VIRTIO_NET_CONFIG_MAC + i);
+        }
+    } else {
+        // Adresse administrée localement
+        uint8_t mac[6] = { 0x52, 0x54, 0x00, 0x12, 0x34, (uint8_t)device->id };
+        memcpy(net->mac, mac, 6);
+    }
+
+    net->rx = virtq_create(net->vdev, VIRTIO_NET_RX_QUEUE);
+    net->tx = virtq_create(net->vdev, VIRTIO_NET_TX_QUEUE);
+    net->rx_buffers = (virtio_net_buffer_t*)kmalloc(VIRTIO_NET_RX_BUFFERS * sizeof(virtio_net_buffer_t));
+    net->tx_buffers = (virtio_net_buffer_t*)kmalloc(VIRTIO_NET_TX_BUFFERS * sizeof(virtio_net_buffer_t));
+    if (!net->rx || !net->tx || !net->rx_buffers || !net->tx_buffers) {
+        virtio_fail(net->vdev);
+        virtio_net_free(net);
+        return false;
+    }
+    memset(net->tx_buffers, 0, VIRTIO_NET_TX_BUFFERS * sizeof(virtio_net_buffer_t));
+
+    // Pré-remplir la file de réception, la notification part en un seul kick
+    for (uint32_t i = 0; i < VIRTIO_NET_RX_BUFFERS; i++) {
+        if (!virtio_net_post_rx(net, &net->rx_buffers[i])) break;
+    }
+
+    virtq_enable_cb(net->rx);
+    virtq_enable_cb(net->tx);
+
+    register_irq_handler(device->irq, virtio_net_irq, net);
+    virtio_driver_ok(net->vdev);
+    virtq_kick(net->rx);
+
+    strcpy(device->name, "eth0");
+    device->name[3] = '0' + virtio_net_count++;
+    device->data = net;
+    return true;
+}
+
+static void virtio_net_deinit(device_t* device) {
+    virtio_net_t* net = (virtio_net_t*)device->data;
+    if (!net) return;
+
+    unregister_irq_handler(device->irq, virtio_net_irq, net);
+    virtio_set_status(net->vdev, 0);
+    virtio_net_free(net);
+    device->data = NULL;
+}
+
+// Les cartes virtio-net sont liées par pci_bind_drivers() au démarrage
+void init_virtio_net() {
+    register_driver(&virtio_net_driver);
+    pci_register_driver(VIRTIO_VENDOR_ID, VIRTIO_NET_DEVICE_ID, &virtio_net_driver);
+}
\ No newline at end of file
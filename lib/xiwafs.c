@@ -0,0 +1,506 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+// xiwafs: système de fichiers en lecture seule pour les ressources du système, construit
+// sur l'hôte par tools/mkxiwafs. Le contenu des fichiers est découpé en blocs de
+// 2^block_log octets compressés en LZ4 (ou gardés tels quels s'ils ne gagnent rien). Les
+// métadonnées tiennent en une seule zone non compressée, chargée au montage:
+//   [superbloc][blocs de données][inodes][entrées de dossiers][fins de blocs][noms]
+// Les entrées d'un dossier sont contiguës et triées par nom: une recherche est une
+// dichotomie. Les blocs décompressés restent dans un petit cache partagé par les montages.
+
+#define XIWAFS_MAGIC 0x53465758 // "XWFS"
+#define XIWAFS_VERSION 1
+#define XIWAFS_MIN_BLOCK_LOG 12
+#define XIWAFS_MAX_BLOCK_LOG 17
+#define XIWAFS_DEVICE_BLOCK 4096
+#define XIWAFS_CACHE_BLOCKS 8
+#define XIWAFS_ROOT 0
+#define XIWAFS_TYPE_FILE 1
+#define XIWAFS_TYPE_DIRECTORY 2
+// Fin de bloc: bit de poids fort pour un bloc stocké sans compression
+#define XIWAFS_BLOCK_RAW 0x80000000
+#define XIWAFS_BLOCK_END 0x7FFFFFFF
+#define O_CREAT 0x40
+#define O_TRUNC 0x200
+#define DIRENT_TYPE_FILE 1
+#define DIRENT_TYPE_DIRECTORY 2
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t block_log;
+    uint32_t inode_count;
+    uint32_t entry_count;
+    uint32_t block_count;
+    uint32_t names_size;
+    uint32_t metadata_offset;
+    uint32_t metadata_size;
+    uint32_t image_size;
+    uint32_t reserved[7];
+} xiwafs_super_t;
+
+typedef struct {
+    uint16_t type;
+    uint16_t reserved;
+    uint32_t size;
+    // Fichier: premier indice dans la table des fins de blocs; dossier: première entrée
+    uint32_t start;
+    // Nombre de blocs, ou d'entrées
+    uint32_t count;
+    // Fichier: position du premier bloc dans l'image, les suivants sont à la suite
+    uint32_t data;
+} xiwafs_inode_t;
+
+typedef struct {
+    uint32_t inode;
+    // Position du nom dans la table des noms (sans '\0')
+    uint32_t name;
+    uint16_t name_length;
+    uint16_t reserved;
+} xiwafs_entry_t;
+
+typedef struct {
+    uint32_t device_id;
+    uint32_t block_size;
+    xiwafs_super_t super;
+    uint8_t* metadata;
+    xiwafs_inode_t* inodes;
+    xiwafs_entry_t* entries;
+    // Fin de chaque bloc, relative au premier bloc du fichier
+    uint32_t* blocks;
+    const char* names;
+    // Bloc compressé lu du disque avant décompression
+    uint8_t* scratch;
+} xiwafs_mount_t;
+
+typedef struct {
+    xiwafs_mount_t* mount;
+    uint32_t inode;
+    uint32_t position;
+} xiwafs_file_t;
+
+typedef struct {
+    xiwafs_mount_t* mount;
+    uint32_t inode;
+    uint32_t block;
+    uint32_t length;
+    uint32_t capacity;
+    uint32_t last_used;
+    uint8_t* data;
+} xiwafs_cached_block_t;
+
+// Entrée d'un lot renvoyé par readdir (même format que lib/filesystem.c)
+typedef struct {
+    uint32_t inode;
+    uint16_t rec_len;
+    uint8_t type;
+    uint8_t name_len;
+    char name[];
+} dirent_t;
+
+typedef struct {
+    uint32_t id;
+    char name[32];
+} device_t;
+
+// Tables d'opérations de la couche VFS (lib/vfs.c)
+typedef struct mapping mapping_t;
+
+typedef struct {
+    void* (*mount)(const char* path, const char* device);
+    void (*unmount)(void* mount);
+    bool (*sync)(void* mount);
+} vfs_super_operations_t;
+
+typedef struct {
+    void* (*open)(void* mount, const char* path, uint32_t flags);
+    void* (*opendir)(void* mount, const char* path);
+    int (*reflink)(void* mount, const char* source, const char* target);
+} vfs_inode_operations_t;
+
+typedef struct {
+    int32_t (*read)(void* file, void* buffer, uint32_t size);
+    int32_t (*write)(void* file, const void* buffer, uint32_t size);
+    int (*fsync)(void* file);
+    void (*release)(void* file);
+    mapping_t* (*mapping)(void* file);
+    uint32_t (*tell)(void* file);
+    void (*seek)(void* file, uint32_t position);
+    int32_t (*readdir)(void* dir, void* buffer, uint32_t size);
+    uint32_t (*telldir)(void* dir);
+    void (*seekdir)(void* dir, uint32_t position);
+    void (*closedir)(void* dir);
+} vfs_file_operations_t;
+
+static xiwafs_cached_block_t block_cache[XIWAFS_CACHE_BLOCKS];
+static uint32_t block_clock;
+
+// Déclarations externes (lib/device_manager.c, lib/buffer_cache.c, lib/vfs.c)
+extern device_t* find_device_by_name(const char* name);
+extern bool bcache_read_bytes(uint32_t device, uint32_t block_size, uint64_t offset, void* out, uint32_t size);
+extern void bcache_invalidate(uint32_t device);
+extern bool vfs_register_filesystem(const char* name, const vfs_super_operations_t* super_ops,
+                                    const vfs_inode_operations_t* inode_ops, const vfs_file_operations_t* file_ops);
+
+// Décompresser un bloc LZ4 (format bloc, sans en-tête de trame). Chaque longueur et
+// chaque distance est vérifiée: une image corrompue donne -1, jamais un débordement.
+static int32_t lz4_decompress(const uint8_t* source, uint32_t source_size, uint8_t* dest, uint32_t capacity) {
+    const uint8_t* ip = source;
+    const uint8_t* source_end = source + source_size;
+    uint8_t* op = dest;
+    uint8_t* dest_end = dest + capacity;
+
+    while (ip < source_end) {
+        uint8_t token = *ip++;
+
+        uint32_t literals = token >> 4;
+        if (literals == 15) {
+            uint8_t extra;
+            do {
+                if (ip >= source_end) return -1;
+                extra = *ip++;
+                literals += extra;
+            } while (extra == 255);
+        }
+        if (literals > (uint32_t)(source_end - ip) || literals > (uint32_t)(dest_end - op)) return -1;
+        memcpy(op, ip, literals);
+        ip += literals;
+        op += literals;
+
+        // La dernière séquence ne contient que des littéraux
+        if (ip == source_end) break;
+
+        if (source_end - ip < 2) return -1;
+        uint32_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (uint32_t)(op - dest)) return -1;
+
+        uint32_t match = (token & 15) + 4;
+        if ((token & 15) == 15) {
+            uint8_t extra;
+            do {
+                if (ip >= source_end) return -1;
+                extra = *ip++;
+                match += extra;
+            } while (extra == 255);
+        }
+        if (match > (uint32_t)(dest_end - op)) return -1;
+
+        // Une copie qui se chevauche répète le motif: octet par octet
+        const uint8_t* ref = op - offset;
+        if (offset >= match) {
+            memcpy(op, ref, match);
+            op += match;
+        } else {
+            while (match--) *op++ = *ref++;
+        }
+    }
+    return (int32_t)(op - dest);
+}
+
+// Vérifier que toutes les références de la zone de métadonnées restent dans ses tables
+static bool validate_metadata(xiwafs_mount_t* mount) {
+    xiwafs_super_t* super = &mount->super;
+    if (super->inode_count == 0 || mount->inodes[XIWAFS_ROOT].type != XIWAFS_TYPE_DIRECTORY) return false;
+
+    for (uint32_t i = 0; i < super->inode_count; i++) {
+        xiwafs_inode_t* inode = &mount->inodes[i];
+        if (inode->type == XIWAFS_TYPE_DIRECTORY) {
+            if (inode->start > super->entry_count || inode->count > super->entry_count - inode->start) return false;
+        } else if (inode->type == XIWAFS_TYPE_FILE) {
+            if (inode->start > super->block_count || inode->count > super->block_count - inode->start) return false;
+            if (inode->count != ((uint64_t)inode->size + mount->block_size - 1) >> super->block_log) return false;
+            if (inode->count && (uint64_t)inode->data + (mount->blocks[inode->start + inode->count - 1] & XIWAFS_BLOCK_END) >
+                                    super->metadata_offset) {
+                return false;
+            }
+        } else {
+            return false;
+        }
+    }
+
+    for (uint32_t i = 0; i < super->entry_count; i++) {
+        xiwafs_entry_t* entry = &mount->entries[i];
+        if (entry->inode >= super->inode_count || entry->name > super->names_size ||
+            entry->name_length > super->names_size - entry->name || entry->name_length == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void* xiwafs_mount(const char* path, const char* device) {
+    // Le point de montage est tenu par la couche VFS
+    (void)path;
+    device_t* dev = (device && device[0]) ? find_device_by_name(device) : NULL;
+    if (!dev) return NULL;
+
+    xiwafs_mount_t* mount = (xiwafs_mount_t*)kmalloc(sizeof(xiwafs_mount_t));
+    if (!mount) return NULL;
+    memset(mount, 0, sizeof(xiwafs_mount_t));
+    mount->device_id = dev->id;
+
+    xiwafs_super_t* super = &mount->super;
+    if (!bcache_read_bytes(mount->device_id, XIWAFS_DEVICE_BLOCK, 0, super, sizeof(xiwafs_super_t)) ||
+        super->magic != XIWAFS_MAGIC || super->version != XIWAFS_VERSION ||
+        super->block_log < XIWAFS_MIN_BLOCK_LOG || super->block_log > XIWAFS_MAX_BLOCK_LOG) {
+        kfree(mount);
+        return NULL;
+    }
+    mount->block_size = 1u << super->block_log;
+
+    // Tailles des tables bornées avant de les additionner
+    uint64_t expected = (uint64_t)super->inode_count * sizeof(xiwafs_inode_t) +
+                        (uint64_t)super->entry_count * sizeof(xiwafs_entry_t) +
+                        (uint64_t)super->block_count * sizeof(uint32_t) + super->names_size;
+    if (expected != super->metadata_size || super->metadata_offset < sizeof(xiwafs_super_t)) {
+        kfree(mount);
+        return NULL;
+    }
+
+    mount->metadata = (uint8_t*)kmalloc(super->metadata_size);
+    mount->scratch = (uint8_t*)kmalloc(mount->block_size);
+    if (!mount->metadata || !mount->scratch ||
+        !bcache_read_bytes(mount->device_id, XIWAFS_DEVICE_BLOCK, super->metadata_offset, mount->metadata, super->metadata_size)) {
+        kfree(mount->metadata);
+        kfree(mount->scratch);
+        kfree(mount);
+        return NULL;
+    }
+
+    uint8_t* table = mount->metadata;
+    mount->inodes = (xiwafs_inode_t*)table;
+    table += super->inode_count * sizeof(xiwafs_inode_t);
+    mount->entries = (xiwafs_entry_t*)table;
+    table += super->entry_count * sizeof(xiwafs_entry_t);
+    mount->blocks = (uint32_t*)table;
+    table += super->block_count * sizeof(uint32_t);
+    mount->names = (const char*)table;
+
+    if (!validate_metadata(mount)) {
+        kfree(mount->metadata);
+        kfree(mount->scratch);
+        kfree(mount);
+        return NULL;
+    }
+    return mount;
+}
+
+static void xiwafs_unmount(void* private) {
+    xiwafs_mount_t* mount = (xiwafs_mount_t*)private;
+    for (uint32_t i = 0; i < XIWAFS_CACHE_BLOCKS; i++) {
+        if (block_cache[i].mount == mount) block_cache[i].mount = NULL;
+    }
+    bcache_invalidate(mount->device_id);
+    kfree(mount->metadata);
+    kfree(mount->scratch);
+    kfree(mount);
+}
+
+// Entrée `name` du dossier `dir`, par dichotomie; -1 si absente
+static int32_t find_entry(xiwafs_mount_t* mount, xiwafs_inode_t* dir, const char* name, uint32_t length) {
+    uint32_t low = dir->start;
+    uint32_t high = dir->start + dir->count;
+    while (low < high) {
+        uint32_t middle = low + (high - low) / 2;
+        xiwafs_entry_t* entry = &mount->entries[middle];
+        uint32_t common = length < entry->name_length ? length : entry->name_length;
+        int cmp = memcmp(name, mount->names + entry->name, common);
+        if (cmp == 0) cmp = (int)length - (int)entry->name_length;
+        if (cmp == 0) return middle;
+        if (cmp < 0) high = middle;
+        else low = middle + 1;
+    }
+    return -1;
+}
+
+// Inode désigné par `path` (relatif au montage), -1 s'il n'existe pas
+static int32_t lookup_path(xiwafs_mount_t* mount, const char* path) {
+    uint32_t current = XIWAFS_ROOT;
+    const char* component = path;
+
+    for (;;) {
+        while (*component == '/') component++;
+        if (*component == '\0') return current;
+
+        const char* end = component;
+        while (*end && *end != '/') end++;
+
+        xiwafs_inode_t* dir = &mount->inodes[current];
+        if (dir->type != XIWAFS_TYPE_DIRECTORY) return -1;
+        int32_t index = find_entry(mount, dir, component, end - component);
+        if (index < 0) return -1;
+        current = mount->entries[index].inode;
+        component = end;
+    }
+}
+
+// Bloc `block` de l'inode, décompressé, depuis le cache ou le disque
+static xiwafs_cached_block_t* get_block(xiwafs_mount_t* mount, uint32_t ino, uint32_t block) {
+    xiwafs_cached_block_t* victim = &block_cache[0];
+    for (uint32_t i = 0; i < XIWAFS_CACHE_BLOCKS; i++) {
+        xiwafs_cached_block_t* cached = &block_cache[i];
+        if (cached->mount == mount && cached->inode == ino && cached->block == block) {
+            cached->last_used = ++block_clock;
+            return cached;
+        }
+        if (!cached->mount || (victim->mount && cached->last_used < victim->last_used)) victim = cached;
+    }
+
+    if (victim->capacity < mount->block_size) {
+        uint8_t* data = (uint8_t*)kmalloc(mount->block_size);
+        if (!data) return NULL;
+        kfree(victim->data);
+        victim->data = data;
+        victim->capacity = mount->block_size;
+    }
+    victim->mount = NULL;
+
+    xiwafs_inode_t* inode = &mount->inodes[ino];
+    uint32_t start = block ? mount->blocks[inode->start + block - 1] & XIWAFS_BLOCK_END : 0;
+    uint32_t end = mount->blocks[inode->start + block];
+    uint32_t stored = (end & XIWAFS_BLOCK_END) - start;
+    uint32_t length = inode->size - (block << mount->super.block_log);
+    if (length > mount->block_size) length = mount->block_size;
+
+    if (end & XIWAFS_BLOCK_RAW) {
+        if (stored != length ||
+            !bcache_read_bytes(mount->device_id, XIWAFS_DEVICE_BLOCK, inode->data + start, victim->data, length)) {
+            return NULL;
+        }
+    } else {
+        if (stored > mount->block_size ||
+            !bcache_read_bytes(mount->device_id, XIWAFS_DEVICE_BLOCK, inode->data + start, mount->scratch, stored) ||
+            lz4_decompress(mount->scratch, stored, victim->data, length) != (int32_t)length) {
+            return NULL;
+        }
+    }
+
+    victim->mount = mount;
+    victim->inode = ino;
+    victim->block = block;
+    victim->length = length;
+    victim->last_used = ++block_clock;
+    return victim;
+}
+
+static void* xiwafs_open(void* private, const char* path, uint32_t flags) {
+    xiwafs_mount_t* mount = (xiwafs_mount_t*)private;
+    if (flags & (O_CREAT | O_TRUNC)) return NULL;
+
+    int32_t ino = lookup_path(mount, path);
+    if (ino < 0 || mount->inodes[ino].type != XIWAFS_TYPE_FILE) return NULL;
+
+    xiwafs_file_t* file = (xiwafs_file_t*)kmalloc(sizeof(xiwafs_file_t));
+    if (!file) return NULL;
+    file->mount = mount;
+    file->inode = ino;
+    file->position = 0;
+    return file;
+}
+
+static void xiwafs_release(void* object) {
+    kfree(object);
+}
+
+static int32_t xiwafs_read(void* object, void* buffer, uint32_t size) {
+    xiwafs_file_t* file = (xiwafs_file_t*)object;
+    xiwafs_mount_t* mount = file->mount;
+    xiwafs_inode_t* inode = &mount->inodes[file->inode];
+
+    if (file->position >= inode->size) return 0;
+    if (size > inode->size - file->position) size = inode->size - file->position;
+
+    uint32_t done = 0;
+    while (done < size) {
+        uint32_t block = file->position >> mount->super.block_log;
+        uint32_t within = file->position & (mount->block_size - 1);
+        xiwafs_cached_block_t* cached = get_block(mount, file->inode, block);
+        if (!cached) return done ? (int32_t)done : -1;
+
+        uint32_t chunk = cached->length - within;
+        if (chunk > size - done) chunk = size - done;
+        memcpy((uint8_t*)buffer + done, cached->data + within, chunk);
+        done += chunk;
+        file->position += chunk;
+    }
+    return (int32_t)done;
+}
+
+static void* xiwafs_opendir(void* private, const char* path) {
+    xiwafs_mount_t* mount = (xiwafs_mount_t*)private;
+    int32_t ino = lookup_path(mount, path);
+    if (ino < 0 || mount->inodes[ino].type != XIWAFS_TYPE_DIRECTORY) return NULL;
+
+    // Même objet qu'un fichier ouvert: la position compte les entrées déjà rendues
+    xiwafs_file_t* dir = (xiwafs_file_t*)kmalloc(sizeof(xiwafs_file_t));
+    if (!dir) return NULL;
+    dir->mount = mount;
+    dir->inode = ino;
+    dir->position = 0;
+    return dir;
+}
+
+// Remplir `buffer` d'entrées dirent_t; 0 à la fin du dossier, -1 si l'entrée suivante ne tient pas
+static int32_t xiwafs_readdir(void* object, void* buffer, uint32_t size) {
+    xiwafs_file_t* dir = (xiwafs_file_t*)object;
+    xiwafs_mount_t* mount = dir->mount;
+    xiwafs_inode_t* inode = &mount->inodes[dir->inode];
+
+    uint32_t filled = 0;
+    while (dir->position < inode->count) {
+        xiwafs_entry_t* entry = &mount->entries[inode->start + dir->position];
+        uint32_t name_len = entry->name_length > 255 ? 255 : entry->name_length;
+        uint32_t length = (sizeof(dirent_t) + name_len + 1 + 3) & ~3u;
+        if (filled + length > size) return filled ? (int32_t)filled : -1;
+
+        dirent_t* out = (dirent_t*)((uint8_t*)buffer + filled);
+        out->inode = entry->inode;
+        out->rec_len = length;
+        out->type = mount->inodes[entry->inode].type == XIWAFS_TYPE_DIRECTORY ? DIRENT_TYPE_DIRECTORY : DIRENT_TYPE_FILE;
+        out->name_len = name_len;
+        memcpy(out->name, mount->names + entry->name, name_len);
+        out->name[name_len] = '\0';
+        filled += length;
+        dir->position++;
+    }
+    return (int32_t)filled;
+}
+
+static uint32_t xiwafs_telldir(void* object) {
+    return ((xiwafs_file_t*)object)->position;
+}
+
+static void xiwafs_seekdir(void* object, uint32_t position) {
+    ((xiwafs_file_t*)object)->position = position;
+}
+
+static const vfs_super_operations_t xiwafs_super_operations = {
+    .mount = xiwafs_mount,
+    .unmount = xiwafs_unmount,
+};
+
+static const vfs_inode_operations_t xiwafs_inode_operations = {
+    .open = xiwafs_open,
+    .opendir = xiwafs_opendir,
+};
+
+static const vfs_file_operations_t xiwafs_file_operations = {
+    .read = xiwafs_read,
+    .release = xiwafs_release,
+    // Fichiers et répertoires partagent xiwafs_file_t et sa position
+    .tell = xiwafs_telldir,
+    .seek = xiwafs_seekdir,
+    .readdir = xiwafs_readdir,
+    .telldir = xiwafs_telldir,
+    .seekdir = xiwafs_seekdir,
+    .closedir = xiwafs_release,
+};
+
+void init_xiwafs() {
+    memset(block_cache, 0, sizeof(block_cache));
+    block_clock = 0;
+    vfs_register_filesystem("xiwafs", &xiwafs_super_operations, &xiwafs_inode_operations, &xiwafs_file_operations);
+}
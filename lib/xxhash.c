@@ -0,0 +1,97 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+// xxHash64: hachage rapide (non cryptographique) du contenu des blocs, pour repérer les
+// données identiques (déduplication de tmpfs). Quatre accumulateurs indépendants
+// traitent 32 octets par tour; le résultat est identique à la référence xxh64.
+
+#define XXH_PRIME64_1 0x9E3779B185EBCA87ull
+#define XXH_PRIME64_2 0xC2B2AE3D27D4EB4Full
+#define XXH_PRIME64_3 0x165667B19E3779F9ull
+#define XXH_PRIME64_4 0x85EBCA77C2B2AE63ull
+#define XXH_PRIME64_5 0x27D4EB2F165667C5ull
+
+static inline uint64_t rotl64(uint64_t value, uint32_t shift) {
+    return (value << shift) | (value >> (64 - shift));
+}
+
+// Lectures non alignées, en petit-boutiste comme la référence
+static inline uint64_t read64(const uint8_t* p) {
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline uint32_t read32(const uint8_t* p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline uint64_t xxh64_round(uint64_t acc, uint64_t input) {
+    acc += input * XXH_PRIME64_2;
+    acc = rotl64(acc, 31);
+    return acc * XXH_PRIME64_1;
+}
+
+static inline uint64_t xxh64_merge(uint64_t acc, uint64_t value) {
+    acc ^= xxh64_round(0, value);
+    return acc * XXH_PRIME64_1 + XXH_PRIME64_4;
+}
+
+uint64_t xxh64(const void* data, uint32_t length, uint64_t seed) {
+    const uint8_t* p = (const uint8_t*)data;
+    const uint8_t* end = p + length;
+    uint64_t hash;
+
+    if (length >= 32) {
+        uint64_t v1 = seed + XXH_PRIME64_1 + XXH_PRIME64_2;
+        uint64_t v2 = seed + XXH_PRIME64_2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - XXH_PRIME64_1;
+
+        const uint8_t* limit = end - 32;
+        do {
+            v1 = xxh64_round(v1, read64(p));
+            v2 = xxh64_round(v2, read64(p + 8));
+            v3 = xxh64_round(v3, read64(p + 16));
+            v4 = xxh64_round(v4, read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+
+        hash = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+        hash = xxh64_merge(hash, v1);
+        hash = xxh64_merge(hash, v2);
+        hash = xxh64_merge(hash, v3);
+        hash = xxh64_merge(hash, v4);
+    } else {
+        hash = seed + XXH_PRIME64_5;
+    }
+
+    hash += length;
+
+    while (p + 8 <= end) {
+        hash ^= xxh64_round(0, read64(p));
+        hash = rotl64(hash, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+        p += 8;
+    }
+    if (p + 4 <= end) {
+        hash ^= (uint64_t)read32(p) * XXH_PRIME64_1;
+        hash = rotl64(hash, 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+        p += 4;
+    }
+    while (p < end) {
+        hash ^= (*p) * XXH_PRIME64_5;
+        hash = rotl64(hash, 11) * XXH_PRIME64_1;
+        p++;
+    }
+
+    // Mélange final
+    hash ^= hash >> 33;
+    hash *= XXH_PRIME64_2;
+    hash ^= hash >> 29;
+    hash *= XXH_PRIME64_3;
+    hash ^= hash >> 32;
+    return hash;
+}
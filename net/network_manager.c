@@ -2,12 +2,28 @@
 #include <stdbool.h>
 #include <string.h>
 
-#define MAX_SOCKETS 256
+// Identifiant de socket: génération de l'emplacement au-dessus de son indice
+#define MAX_SOCKETS 16384
+#define SOCKET_SLOT_BITS 14
+#define SOCKET_GENERATION_LIMIT (1u << (32 - SOCKET_SLOT_BITS))
+#define CONNECTION_BUCKETS 16384
+#define LISTEN_BUCKETS 256
+#define TCP_ACCEPT_BACKLOG 128
 #define MAX_PACKET_SIZE 1500
 #define TCP_PORT_RANGE 65535
 #define TCP_WINDOW_SIZE 65535
 #define TCP_MAX_SEGMENT_SIZE 1460
 #define TCP_TIMEOUT 5000
+// États TCP (socket->state)
+#define TCP_STATE_CLOSED 0
+#define TCP_STATE_LISTEN 1
+#define TCP_STATE_SYN_RECEIVED 2
+#define TCP_STATE_ESTABLISHED 4
+#define TCP_STATE_CLOSE_WAIT 5
+#define PAGE_SIZE 4096
+#define NET_IOCTL_SEND_FRAGMENTS 0x4E03
+// Un segment (<= TCP_MAX_SEGMENT_SIZE) chevauche au plus deux pages
+#define SENDFILE_MAX_PAGES 2
 
 typedef struct {
     uint8_t version_ihl;
@@ -43,7 +59,7 @@ typedef struct {
     uint16_t dest_port;
 } packet_t;
 
-typedef struct {
+typedef struct tcp_socket {
     uint32_t id;
     uint32_t local_ip;
     uint32_t remote_ip;
@@ -60,12 +76,97 @@ typedef struct {
     uint16_t send_buffer_size;
     uint16_t send_buffer_used;
     uint32_t last_activity;
+    uint32_t generation;
+    bool in_use;
+    // Présent dans la table des connexions (4-uplet connu) ou dans celle des sockets en écoute
+    bool hashed;
+    bool listening;
+    struct tcp_socket* hash_next;
+    // Connexion reçue pas encore acceptée: socket en écoute et suivante dans sa file
+    struct tcp_socket* listener;
+    struct tcp_socket* accept_next;
+    // Socket en écoute: connexions reçues, dans l'ordre d'arrivée
+    struct tcp_socket* accept_head;
+    struct tcp_socket* accept_tail;
+    uint32_t accept_count;
 } tcp_socket_t;
 
+typedef enum {
+    DEVICE_TYPE_CHAR,
+    DEVICE_TYPE_BLOCK,
+    DEVICE_TYPE_NETWORK,
+    DEVICE_TYPE_DISPLAY,
+    DEVICE_TYPE_SOUND,
+    DEVICE_TYPE_INPUT
+} device_type_t;
+
+typedef enum {
+    DEVICE_STATE_READY,
+    DEVICE_STATE_BUSY,
+    DEVICE_STATE_ERROR,
+    DEVICE_STATE_OFFLINE
+} device_state_t;
+
+typedef struct {
+    uint32_t id;
+    char name[32];
+    device_type_t type;
+    device_state_t state;
+    void* driver;
+    void* data;
+    uint32_t irq;
+    uint8_t dma_channel;
+} device_t;
+
+// Morceau d'une trame envoyée sans copie (lib/virtio_net.c)
+typedef struct {
+    const void* data;
+    uint32_t length;
+} net_fragment_t;
+
+typedef struct {
+    const net_fragment_t* fragments;
+    uint32_t count;
+    void (*done)(void* context);
+    void* context;
+} net_frame_t;
+
+typedef struct mapping mapping_t;
+typedef struct page page_t;
+
+// Un appel à sendfile: la référence sur la projection du fichier est gardée tant qu'un
+// segment pointe dans ses pages, et rendue par le dernier segment transmis
+typedef struct {
+    mapping_t* mapping;
+    // Segments en vol, plus un tant que sendfile() en ajoute
+    uint32_t references;
+} sendfile_transfer_t;
+
+// Segment de sendfile en vol: ses en-têtes et les pages qu'il référence vivent jusqu'à
+// la fin de la transmission
+typedef struct {
+    uint8_t headers[sizeof(ip_header_t) + sizeof(tcp_header_t)];
+    sendfile_transfer_t* transfer;
+    page_t* pages[SENDFILE_MAX_PAGES];
+    uint32_t page_count;
+    // Copie des données quand le fichier n'est pas dans le cache de pages
+    uint8_t* bounce;
+} sendfile_segment_t;
+
+// Les sockets ne bougent jamais de leur emplacement: les tables de hachage les chaînent
+// directement, et l'identifiant donne l'emplacement sans recherche
 typedef struct {
     tcp_socket_t sockets[MAX_SOCKETS];
     uint32_t socket_count;
-    uint32_t next_socket_id;
+    // Pile des emplacements libres
+    uint32_t free_slots[MAX_SOCKETS];
+    uint32_t free_count;
+    // Connexions par (ip locale, port local, ip distante, port distant)
+    tcp_socket_t* connections[CONNECTION_BUCKETS];
+    // Sockets en écoute par (ip locale, port local); ip 0 pour toutes les adresses
+    tcp_socket_t* listeners[LISTEN_BUCKETS];
+    // Graine tirée au démarrage: un pair ne peut pas viser un seul seau
+    uint32_t hash_secret;
     uint32_t local_ip;
     uint32_t netmask;
     uint32_t gateway;
@@ -74,74 +175,235 @@ typedef struct {
 
 network_manager_t network_manager;
 
+// Déclarations externes (lib/clock.c, lib/checksum.c)
+extern uint64_t get_ticks();
+extern uint32_t checksum_partial(const void* data, uint32_t length, uint32_t sum);
+extern uint32_t checksum_copy(void* dest, const void* source, uint32_t length, uint32_t sum);
+extern uint32_t checksum_block_add(uint32_t sum, uint32_t block_sum, uint32_t offset);
+extern uint32_t checksum_pseudo_header(uint32_t source_ip, uint32_t dest_ip, uint8_t protocol, uint16_t length, uint32_t sum);
+extern uint16_t checksum_fold(uint32_t sum);
+extern uint16_t checksum_update16(uint16_t check, uint16_t old_value, uint16_t new_value);
+
+// Déclarations externes (lib/device_manager.c)
+extern device_t* find_device_by_type(device_type_t type);
+extern int write_device(device_t* device, const void* buffer, size_t size, size_t offset);
+extern int ioctl_device(device_t* device, uint32_t request, void* arg);
+
+// Déclarations externes (lib/vfs.c, lib/mmap.c)
+extern mapping_t* vfs_get_mapping(int fd);
+extern int32_t vfs_read(int fd, void* buffer, uint32_t size);
+extern uint32_t vfs_tell(int fd);
+extern bool vfs_seek(int fd, uint32_t position);
+extern page_t* page_cache_get(mapping_t* mapping, uint32_t index);
+extern const uint8_t* page_cache_data(page_t* page, uint32_t* length);
+extern void page_cache_put(page_t* page);
+extern void mapping_put(mapping_t* mapping);
+
+void send_packet(packet_t* packet);
+
 void init_network_manager() {
     memset(&network_manager, 0, sizeof(network_manager_t));
-    network_manager.next_socket_id = 1;
+    // Emplacements distribués dans l'ordre croissant
+    for (uint32_t i = 0; i < MAX_SOCKETS; i++) {
+        network_manager.free_slots[i] = MAX_SOCKETS - 1 - i;
+    }
+    network_manager.free_count = MAX_SOCKETS;
+    uint64_t ticks = get_ticks();
+    network_manager.hash_secret = (uint32_t)ticks ^ (uint32_t)(ticks >> 32);
 }
 
-uint16_t calculate_ip_checksum(ip_header_t* header) {
-    uint32_t sum = 0;
-    uint16_t* ptr = (uint16_t*)header;
-    uint16_t header_size = (header->version_ihl & 0x0F) * 4;
+static inline uint32_t hash_mix(uint32_t hash) {
+    hash ^= hash >> 16;
+    hash *= 0x85EBCA6B;
+    hash ^= hash >> 13;
+    hash *= 0xC2B2AE35;
+    hash ^= hash >> 16;
+    return hash;
+}
 
-    // Calculer la somme des mots de 16 bits
-    for (uint16_t i = 0; i < header_size / 2; i++) {
-        sum += ptr[i];
+static uint32_t connection_hash(uint32_t local_ip, uint16_t local_port, uint32_t remote_ip, uint16_t remote_port) {
+    uint32_t hash = hash_mix(local_ip ^ network_manager.hash_secret);
+    hash = hash_mix(hash ^ remote_ip);
+    hash = hash_mix(hash ^ (((uint32_t)local_port << 16) | remote_port));
+    return hash & (CONNECTION_BUCKETS - 1);
+}
+
+static uint32_t listen_hash(uint32_t local_ip, uint16_t local_port) {
+    return hash_mix(local_ip ^ local_port ^ network_manager.hash_secret) & (LISTEN_BUCKETS - 1);
+}
+
+static tcp_socket_t* find_socket(uint32_t socket_id) {
+    tcp_socket_t* socket = &network_manager.sockets[socket_id & (MAX_SOCKETS - 1)];
+    if (!socket->in_use || socket->id != socket_id) {
+        return NULL;
     }
+    return socket;
+}
 
-    // Ajouter les retenues
-    while (sum >> 16) {
-        sum = (sum & 0xFFFF) + (sum >> 16);
+static tcp_socket_t* lookup_connection(uint32_t local_ip, uint16_t local_port, uint32_t remote_ip, uint16_t remote_port) {
+    tcp_socket_t* socket = network_manager.connections[connection_hash(local_ip, local_port, remote_ip, remote_port)];
+    while (socket) {
+        if (socket->local_port == local_port && socket->remote_port == remote_port &&
+            socket->local_ip == local_ip && socket->remote_ip == remote_ip) {
+            return socket;
+        }
+        socket = socket->hash_next;
     }
+    return NULL;
+}
 
-    // Complément à 1
-    return ~sum;
+// Socket en écoute sur (local_ip, local_port), sinon sur le port pour toutes les adresses
+static tcp_socket_t* lookup_listener(uint32_t local_ip, uint16_t local_port) {
+    tcp_socket_t* any = NULL;
+    tcp_socket_t* socket = network_manager.listeners[listen_hash(local_ip, local_port)];
+    while (socket) {
+        if (socket->local_port == local_port && socket->local_ip == local_ip) {
+            return socket;
+        }
+        socket = socket->hash_next;
+    }
+
+    socket = network_manager.listeners[listen_hash(0, local_port)];
+    while (socket) {
+        if (socket->local_port == local_port && socket->local_ip == 0) {
+            any = socket;
+            break;
+        }
+        socket = socket->hash_next;
+    }
+    return any;
 }
 
-uint16_t calculate_tcp_checksum(tcp_header_t* header, uint8_t* data, uint16_t data_length) {
-    uint32_t sum = 0;
-    uint16_t* ptr = (uint16_t*)header;
-    uint16_t header_size = (header->data_offset >> 4) * 4;
+static tcp_socket_t** socket_bucket(tcp_socket_t* socket) {
+    if (socket->listening) {
+        return &network_manager.listeners[listen_hash(socket->local_ip, socket->local_port)];
+    }
+    return &network_manager.connections[connection_hash(socket->local_ip, socket->local_port,
+                                                        socket->remote_ip, socket->remote_port)];
+}
 
-    // Pseudo-header
-    sum += (network_manager.local_ip >> 16) & 0xFFFF;
-    sum += network_manager.local_ip & 0xFFFF;
-    sum += (header->dest_port >> 16) & 0xFFFF;
-    sum += header->dest_port & 0xFFFF;
-    sum += header_size + data_length;
-    sum += 6; // TCP protocol
+// Ranger le socket sous sa clé actuelle; elle ne doit plus changer tant qu'il y est
+static void hash_socket(tcp_socket_t* socket) {
+    tcp_socket_t** bucket = socket_bucket(socket);
+    socket->hash_next = *bucket;
+    *bucket = socket;
+    socket->hashed = true;
+}
 
-    // TCP header
-    for (uint16_t i = 0; i < header_size / 2; i++) {
-        sum += ptr[i];
+static void unhash_socket(tcp_socket_t* socket) {
+    tcp_socket_t** link = socket_bucket(socket);
+    while (*link != socket) {
+        link = &(*link)->hash_next;
     }
+    *link = socket->hash_next;
+    socket->hashed = false;
+}
 
-    // TCP data
-    ptr = (uint16_t*)data;
-    for (uint16_t i = 0; i < data_length / 2; i++) {
-        sum += ptr[i];
+// Prendre un emplacement libre; la génération change à chaque usage, donc l'identifiant
+// d'un socket fermé ne désigne jamais son successeur
+static tcp_socket_t* alloc_socket() {
+    if (network_manager.free_count == 0) {
+        return NULL;
     }
 
-    if (data_length % 2) {
-        sum += ((uint16_t)data[data_length - 1]) << 8;
+    uint32_t slot = network_manager.free_slots[--network_manager.free_count];
+    tcp_socket_t* socket = &network_manager.sockets[slot];
+    uint32_t generation = socket->generation + 1;
+    if (generation >= SOCKET_GENERATION_LIMIT) {
+        generation = 1;
     }
 
-    // Ajouter les retenues
-    while (sum >> 16) {
-        sum = (sum & 0xFFFF) + (sum >> 16);
+    memset(socket, 0, sizeof(tcp_socket_t));
+    socket->generation = generation;
+    socket->id = (generation << SOCKET_SLOT_BITS) | slot;
+    socket->in_use = true;
+    network_manager.socket_count++;
+    return socket;
+}
+
+// Retirer une connexion de la file d'attente de son socket en écoute
+static void dequeue_connection(tcp_socket_t* socket) {
+    tcp_socket_t* listener = socket->listener;
+    tcp_socket_t* previous = NULL;
+    tcp_socket_t** link = &listener->accept_head;
+    while (*link != socket) {
+        previous = *link;
+        link = &(*link)->accept_next;
+    }
+    *link = socket->accept_next;
+    if (listener->accept_tail == socket) {
+        listener->accept_tail = previous;
+    }
+    listener->accept_count--;
+    socket->listener = NULL;
+    socket->accept_next = NULL;
+}
+
+static void release_socket(tcp_socket_t* socket) {
+    if (socket->hashed) {
+        unhash_socket(socket);
+    }
+    if (socket->listener) {
+        dequeue_connection(socket);
+    }
+
+    // Les connexions jamais acceptées disparaissent avec leur socket en écoute
+    while (socket->accept_head) {
+        tcp_socket_t* pending = socket->accept_head;
+        dequeue_connection(pending);
+        release_socket(pending);
+    }
+
+    if (socket->receive_buffer) {
+        kfree(socket->receive_buffer);
+    }
+    if (socket->send_buffer) {
+        kfree(socket->send_buffer);
+    }
+
+    socket->in_use = false;
+    network_manager.free_slots[network_manager.free_count++] = socket->id & (MAX_SOCKETS - 1);
+    network_manager.socket_count--;
+}
+
+// Le champ checksum est remis à zéro avant la somme: l'appelant y range le résultat
+uint16_t calculate_ip_checksum(ip_header_t* header) {
+    header->header_checksum = 0;
+    return checksum_fold(checksum_partial(header, (header->version_ihl & 0x0F) * 4, 0));
+}
+
+// Checksum TCP à partir de la somme déjà calculée de la charge
+static uint16_t tcp_checksum(tcp_header_t* header, uint32_t source_ip, uint32_t dest_ip,
+                             uint32_t payload_sum, uint32_t payload_length) {
+    uint16_t header_size = (header->data_offset >> 4) * 4;
+    header->checksum = 0;
+    uint32_t sum = checksum_pseudo_header(source_ip, dest_ip, 6, header_size + payload_length, payload_sum);
+    return checksum_fold(checksum_partial(header, header_size, sum));
+}
+
+// Checksum TCP d'une charge répartie en plusieurs morceaux (pages du cache)
+static uint16_t tcp_checksum_fragments(tcp_header_t* header, uint32_t source_ip, uint32_t dest_ip,
+                                       const net_fragment_t* fragments, uint32_t count) {
+    uint32_t sum = 0;
+    uint32_t offset = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        sum = checksum_block_add(sum, checksum_partial(fragments[i].data, fragments[i].length, 0), offset);
+        offset += fragments[i].length;
     }
+    return tcp_checksum(header, source_ip, dest_ip, sum, offset);
+}
 
-    // Complément à 1
-    return ~sum;
+uint16_t calculate_tcp_checksum(tcp_header_t* header, uint32_t source_ip, uint32_t dest_ip,
+                                uint8_t* data, uint16_t data_length) {
+    return tcp_checksum(header, source_ip, dest_ip, data ? checksum_partial(data, data_length, 0) : 0, data ? data_length : 0);
 }
 
 uint32_t create_socket() {
-    if (network_manager.socket_count >= MAX_SOCKETS) {
+    tcp_socket_t* socket = alloc_socket();
+    if (!socket) {
         return 0;
     }
 
-    tcp_socket_t* socket = &network_manager.sockets[network_manager.socket_count++];
-    socket->id = network_manager.next_socket_id++;
     socket->local_ip = network_manager.local_ip;
     socket->remote_ip = 0;
     socket->local_port = 0;
@@ -149,7 +411,7 @@ uint32_t create_socket() {
     socket->sequence_number = 0;
     socket->acknowledgment_number = 0;
     socket->window_size = TCP_WINDOW_SIZE;
-    socket->state = 0; // CLOSED
+    socket->state = TCP_STATE_CLOSED;
     socket->receive_buffer = kmalloc(TCP_WINDOW_SIZE);
     socket->receive_buffer_size = TCP_WINDOW_SIZE;
     socket->receive_buffer_used = 0;
@@ -162,36 +424,51 @@ uint32_t create_socket() {
 }
 
 void close_socket(uint32_t socket_id) {
-    for (uint32_t i = 0; i < network_manager.socket_count; i++) {
-        if (network_manager.sockets[i].id == socket_id) {
-            tcp_socket_t* socket = &network_manager.sockets[i];
+    tcp_socket_t* socket = find_socket(socket_id);
+    if (socket) {
+        release_socket(socket);
+    }
+}
 
-            if (socket->receive_buffer) {
-                kfree(socket->receive_buffer);
-            }
-            if (socket->send_buffer) {
-                kfree(socket->send_buffer);
-            }
+// Mettre un socket fermé en écoute sur `port` (de son adresse locale, ou de toutes si 0)
+bool listen_socket(uint32_t socket_id, uint16_t port) {
+    tcp_socket_t* socket = find_socket(socket_id);
+    if (!socket || socket->state != TCP_STATE_CLOSED || socket->hashed) {
+        return false;
+    }
 
-            memmove(&network_manager.sockets[i],
-                    &network_manager.sockets[i + 1],
-                    (network_manager.socket_count - i - 1) * sizeof(tcp_socket_t));
-            network_manager.socket_count--;
-            break;
-        }
+    tcp_socket_t* existing = lookup_listener(socket->local_ip, port);
+    if (existing && existing->local_ip == socket->local_ip) {
+        return false;
     }
+
+    socket->local_port = port;
+    socket->listening = true;
+    socket->state = TCP_STATE_LISTEN;
+    hash_socket(socket);
+    return true;
 }
 
-bool send_data(uint32_t socket_id, const uint8_t* data, uint16_t length) {
-    tcp_socket_t* socket = NULL;
-    for (uint32_t i = 0; i < network_manager.socket_count; i++) {
-        if (network_manager.sockets[i].id == socket_id) {
-            socket = &network_manager.sockets[i];
-            break;
+// Plus ancienne connexion établie reçue par un socket en écoute; 0 s'il n'y en a pas
+uint32_t accept_socket(uint32_t socket_id) {
+    tcp_socket_t* listener = find_socket(socket_id);
+    if (!listener || !listener->listening) {
+        return 0;
+    }
+
+    for (tcp_socket_t* socket = listener->accept_head; socket; socket = socket->accept_next) {
+        if (socket->state == TCP_STATE_ESTABLISHED) {
+            dequeue_connection(socket);
+            return socket->id;
         }
     }
+    return 0;
+}
+
+bool send_data(uint32_t socket_id, const uint8_t* data, uint16_t length) {
+    tcp_socket_t* socket = find_socket(socket_id);
 
-    if (!socket || socket->state != 1) {
+    if (!socket || socket->state != TCP_STATE_ESTABLISHED) {
         return false;
     }
 
@@ -208,8 +485,27 @@ bool send_data(uint32_t socket_id, const uint8_t* data, uint16_t length) {
     uint16_t remaining = socket->send_buffer_used;
     uint16_t offset = 0;
 
+    // En-tête IP commun à tous les segments: seule la longueur change, et son checksum
+    // suit par mise à jour incrémentale
+    ip_header_t ip_header;
+    ip_header.version_ihl = 0x45;
+    ip_header.tos = 0;
+    ip_header.total_length = sizeof(ip_header_t) + sizeof(tcp_header_t) + TCP_MAX_SEGMENT_SIZE;
+    ip_header.identification = 0;
+    ip_header.flags_fragment_offset = 0;
+    ip_header.ttl = 64;
+    ip_header.protocol = 6; // TCP
+    ip_header.source_ip = socket->local_ip;
+    ip_header.dest_ip = socket->remote_ip;
+    ip_header.header_checksum = calculate_ip_checksum(&ip_header);
+
     while (remaining > 0) {
         uint16_t segment_size = (remaining > TCP_MAX_SEGMENT_SIZE) ? TCP_MAX_SEGMENT_SIZE : remaining;
+        packet_t packet;
+
+        // Copier la charge dans le paquet en calculant sa somme au passage
+        uint32_t payload_sum = checksum_copy(packet.data + sizeof(ip_header_t) + sizeof(tcp_header_t),
+                                             socket->send_buffer + offset, segment_size, 0);
 
         // Créer l'en-tête TCP
         tcp_header_t tcp_header;
@@ -223,32 +519,18 @@ bool send_data(uint32_t socket_id, const uint8_t* data, uint16_t length) {
         tcp_header.urgent_pointer = 0;
 
         // Calculer le checksum
-        tcp_header.checksum = calculate_tcp_checksum(&tcp_header,
-                                                   socket->send_buffer + offset,
-                                                   segment_size);
-
-        // Créer l'en-tête IP
-        ip_header_t ip_header;
-        ip_header.version_ihl = 0x45;
-        ip_header.tos = 0;
-        ip_header.total_length = sizeof(ip_header_t) + sizeof(tcp_header_t) + segment_size;
-        ip_header.identification = 0;
-        ip_header.flags_fragment_offset = 0;
-        ip_header.ttl = 64;
-        ip_header.protocol = 6; // TCP
-        ip_header.source_ip = socket->local_ip;
-        ip_header.dest_ip = socket->remote_ip;
+        tcp_header.checksum = tcp_checksum(&tcp_header, socket->local_ip, socket->remote_ip, payload_sum, segment_size);
 
-        // Calculer le checksum
-        ip_header.header_checksum = calculate_ip_checksum(&ip_header);
+        // Ajuster la longueur IP (dernier segment)
+        uint16_t total_length = sizeof(ip_header_t) + sizeof(tcp_header_t) + segment_size;
+        if (ip_header.total_length != total_length) {
+            ip_header.header_checksum = checksum_update16(ip_header.header_checksum, ip_header.total_length, total_length);
+            ip_header.total_length = total_length;
+        }
 
         // Envoyer le paquet
-        packet_t packet;
         memcpy(packet.data, &ip_header, sizeof(ip_header_t));
         memcpy(packet.data + sizeof(ip_header_t), &tcp_header, sizeof(tcp_header_t));
-        memcpy(packet.data + sizeof(ip_header_t) + sizeof(tcp_header_t),
-               socket->send_buffer + offset,
-               segment_size);
         packet.length = sizeof(ip_header_t) + sizeof(tcp_header_t) + segment_size;
         packet.source_ip = socket->local_ip;
         packet.dest_ip = socket->remote_ip;
@@ -269,15 +551,9 @@ bool send_data(uint32_t socket_id, const uint8_t* data, uint16_t length) {
 }
 
 bool receive_data(uint32_t socket_id, uint8_t* data, uint16_t* length) {
-    tcp_socket_t* socket = NULL;
-    for (uint32_t i = 0; i < network_manager.socket_count; i++) {
-        if (network_manager.sockets[i].id == socket_id) {
-            socket = &network_manager.sockets[i];
-            break;
-        }
-    }
+    tcp_socket_t* socket = find_socket(socket_id);
 
-    if (!socket || socket->state != 1) {
+    if (!socket || socket->state != TCP_STATE_ESTABLISHED) {
         return false;
     }
 
@@ -303,6 +579,205 @@ bool receive_data(uint32_t socket_id, uint8_t* data, uint16_t* length) {
     return true;
 }
 
+// La fin de transmission arrive depuis l'interruption de la carte (lib/virtio_net.c), ou
+// tout de suite pour une trame recopiée: compteur atomique
+static void sendfile_transfer_put(sendfile_transfer_t* transfer) {
+    if (!transfer || __atomic_sub_fetch(&transfer->references, 1, __ATOMIC_ACQ_REL)) return;
+    mapping_put(transfer->mapping);
+    kfree(transfer);
+}
+
+static void sendfile_segment_done(void* context) {
+    sendfile_segment_t* segment = (sendfile_segment_t*)context;
+    for (uint32_t i = 0; i < segment->page_count; i++) {
+        page_cache_put(segment->pages[i]);
+    }
+    sendfile_transfer_put(segment->transfer);
+    kfree(segment->bounce);
+    kfree(segment);
+}
+
+// Construire les en-têtes IP/TCP du segment dans son propre tampon, à côté de la charge
+static void build_segment_headers(tcp_socket_t* socket, sendfile_segment_t* segment,
+                                  const net_fragment_t* payload, uint32_t count, uint16_t length) {
+    ip_header_t* ip_header = (ip_header_t*)segment->headers;
+    tcp_header_t* tcp_header = (tcp_header_t*)(segment->headers + sizeof(ip_header_t));
+
+    tcp_header->source_port = socket->local_port;
+    tcp_header->dest_port = socket->remote_port;
+    tcp_header->sequence_number = socket->sequence_number;
+    tcp_header->acknowledgment_number = socket->acknowledgment_number;
+    tcp_header->data_offset = 5 << 4;
+    tcp_header->flags = 0x18; // ACK, PSH
+    tcp_header->window_size = socket->window_size;
+    tcp_header->urgent_pointer = 0;
+    tcp_header->checksum = tcp_checksum_fragments(tcp_header, socket->local_ip, socket->remote_ip, payload, count);
+
+    ip_header->version_ihl = 0x45;
+    ip_header->tos = 0;
+    ip_header->total_length = sizeof(ip_header_t) + sizeof(tcp_header_t) + length;
+    ip_header->identification = 0;
+    ip_header->flags_fragment_offset = 0;
+    ip_header->ttl = 64;
+    ip_header->protocol = 6; // TCP
+    ip_header->source_ip = socket->local_ip;
+    ip_header->dest_ip = socket->remote_ip;
+    ip_header->header_checksum = calculate_ip_checksum(ip_header);
+}
+
+// Chaîner en-têtes et charge dans la file d'envoi de la carte. Un pilote sans envoi par
+// morceaux reçoit une trame recopiée dans un packet_t.
+static bool transmit_segment(tcp_socket_t* socket, sendfile_segment_t* segment,
+                             const net_fragment_t* payload, uint32_t count) {
+    device_t* device = find_device_by_type(DEVICE_TYPE_NETWORK);
+    if (!device) return false;
+
+    net_fragment_t fragments[SENDFILE_MAX_PAGES + 1];
+    fragments[0].data = segment->headers;
+    fragments[0].length = sizeof(segment->headers);
+    for (uint32_t i = 0; i < count; i++) {
+        fragments[i + 1] = payload[i];
+    }
+
+    net_frame_t frame = { fragments, count + 1, sendfile_segment_done, segment };
+    if (ioctl_device(device, NET_IOCTL_SEND_FRAGMENTS, &frame) >= 0) {
+        return true;
+    }
+
+    packet_t packet;
+    packet.length = 0;
+    for (uint32_t i = 0; i < count + 1; i++) {
+        memcpy(packet.data + packet.length, fragments[i].data, fragments[i].length);
+        packet.length += fragments[i].length;
+    }
+    packet.source_ip = socket->local_ip;
+    packet.dest_ip = socket->remote_ip;
+    packet.source_port = socket->local_port;
+    packet.dest_port = socket->remote_port;
+    send_packet(&packet);
+    sendfile_segment_done(segment);
+    return true;
+}
+
+// Envoyer `count` octets du fichier `fd` à partir de `*offset`, sans passer par un tampon
+// utilisateur: les segments pointent directement dans les pages du cache. Les systèmes de
+// fichiers sans projection (ext2, tmpfs) sont lus avec une seule copie. Comme sous Linux,
+// `*offset` avance et la position du fichier reste inchangée; sans `offset`, l'envoi part de
+// la position du fichier et la fait avancer. Renvoie le nombre d'octets envoyés (0 en fin de
+// fichier), -1 si le socket n'est pas connecté ou si le fichier ne peut pas être positionné.
+int32_t sendfile(int fd, uint32_t socket_id, uint32_t* offset, uint32_t count) {
+    tcp_socket_t* socket = find_socket(socket_id);
+
+    if (!socket || socket->state != TCP_STATE_ESTABLISHED) {
+        return -1;
+    }
+
+    // Les lectures avec copie suivent la position du fichier: la placer sur `*offset`
+    uint32_t position = vfs_tell(fd);
+    uint32_t start = offset ? *offset : position;
+    if (!vfs_seek(fd, start)) {
+        return -1;
+    }
+
+    mapping_t* mapping = vfs_get_mapping(fd);
+    sendfile_transfer_t* transfer = NULL;
+    if (mapping) {
+        transfer = (sendfile_transfer_t*)kmalloc(sizeof(sendfile_transfer_t));
+        if (!transfer) {
+            mapping_put(mapping);
+            vfs_seek(fd, position);
+            return 0;
+        }
+        transfer->mapping = mapping;
+        transfer->references = 1;
+    }
+    uint32_t sent = 0;
+    bool end_of_file = false;
+
+    while (sent < count && !end_of_file) {
+        uint32_t segment_size = (count - sent > TCP_MAX_SEGMENT_SIZE) ? TCP_MAX_SEGMENT_SIZE : count - sent;
+
+        sendfile_segment_t* segment = (sendfile_segment_t*)kmalloc(sizeof(sendfile_segment_t));
+        if (!segment) break;
+        memset(segment, 0, sizeof(sendfile_segment_t));
+        if (transfer) {
+            __atomic_add_fetch(&transfer->references, 1, __ATOMIC_ACQ_REL);
+            segment->transfer = transfer;
+        }
+
+        net_fragment_t payload[SENDFILE_MAX_PAGES];
+        uint32_t fragment_count = 0;
+        uint32_t length = 0;
+
+        if (mapping) {
+            while (length < segment_size && fragment_count < SENDFILE_MAX_PAGES) {
+                uint32_t position = start + sent + length;
+                page_t* page = page_cache_get(mapping, position / PAGE_SIZE);
+                if (!page) {
+                    end_of_file = true;
+                    break;
+                }
+
+                uint32_t valid;
+                const uint8_t* data = page_cache_data(page, &valid);
+                uint32_t page_offset = position % PAGE_SIZE;
+                if (page_offset >= valid) {
+                    page_cache_put(page);
+                    end_of_file = true;
+                    break;
+                }
+
+                uint32_t chunk = valid - page_offset;
+                if (chunk > segment_size - length) chunk = segment_size - length;
+                segment->pages[segment->page_count++] = page;
+                payload[fragment_count].data = data + page_offset;
+                payload[fragment_count].length = chunk;
+                fragment_count++;
+                length += chunk;
+
+                // La page qui contient la fin du fichier n'est pas pleine
+                if (valid < PAGE_SIZE && page_offset + chunk == valid) {
+                    end_of_file = true;
+                    break;
+                }
+            }
+        } else {
+            segment->bounce = (uint8_t*)kmalloc(segment_size);
+            int32_t read = segment->bounce ? vfs_read(fd, segment->bounce, segment_size) : -1;
+            if (read > 0) {
+                payload[0].data = segment->bounce;
+                payload[0].length = read;
+                fragment_count = 1;
+                length = read;
+            }
+            if (read < (int32_t)segment_size) end_of_file = true;
+        }
+
+        if (length == 0) {
+            sendfile_segment_done(segment);
+            break;
+        }
+
+        build_segment_headers(socket, segment, payload, fragment_count, length);
+        if (!transmit_segment(socket, segment, payload, fragment_count)) {
+            sendfile_segment_done(segment);
+            break;
+        }
+
+        socket->sequence_number += length;
+        sent += length;
+    }
+
+    sendfile_transfer_put(transfer);
+    if (offset) {
+        *offset = start + sent;
+        vfs_seek(fd, position);
+    } else {
+        vfs_seek(fd, start + sent);
+    }
+    return (int32_t)sent;
+}
+
 void handle_tcp_packet(packet_t* packet) {
     ip_header_t* ip_header = (ip_header_t*)packet->data;
     tcp_header_t* tcp_header = (tcp_header_t*)(packet->data + sizeof(ip_header_t));
@@ -310,21 +785,17 @@ void handle_tcp_packet(packet_t* packet) {
     uint16_t tcp_data_length = packet->length - sizeof(ip_header_t) - sizeof(tcp_header_t);
 
     // Trouver le socket correspondant
-    tcp_socket_t* socket = NULL;
-    for (uint32_t i = 0; i < network_manager.socket_count; i++) {
-        if (network_manager.sockets[i].local_port == tcp_header->dest_port &&
-            network_manager.sockets[i].remote_port == tcp_header->source_port &&
-            network_manager.sockets[i].local_ip == ip_header->dest_ip &&
-            network_manager.sockets[i].remote_ip == ip_header->source_ip) {
-            socket = &network_manager.sockets[i];
-            break;
-        }
-    }
+    tcp_socket_t* socket = lookup_connection(ip_header->dest_ip, tcp_header->dest_port,
+                                             ip_header->source_ip, tcp_header->source_port);
 
     if (!socket) {
-        // Nouvelle connexion
-        if (tcp_header->flags & 0x02) { // SYN
-            socket = &network_manager.sockets[network_manager.socket_count++];
+        // Nouvelle connexion, seulement vers un port en écoute
+        tcp_socket_t* listener = (tcp_header->flags & 0x02) ? lookup_listener(ip_header->dest_ip, tcp_header->dest_port) : NULL;
+        if (listener && listener->accept_count < TCP_ACCEPT_BACKLOG) { // SYN
+            socket = alloc_socket();
+            if (!socket) {
+                return;
+            }
             socket->local_ip = ip_header->dest_ip;
             socket->remote_ip = ip_header->source_ip;
             socket->local_port = tcp_header->dest_port;
@@ -332,13 +803,23 @@ void handle_tcp_packet(packet_t* packet) {
             socket->sequence_number = 0;
             socket->acknowledgment_number = tcp_header->sequence_number + 1;
             socket->window_size = TCP_WINDOW_SIZE;
-            socket->state = 1; // LISTEN
+            socket->state = TCP_STATE_LISTEN;
             socket->receive_buffer = kmalloc(TCP_WINDOW_SIZE);
             socket->receive_buffer_size = TCP_WINDOW_SIZE;
             socket->receive_buffer_used = 0;
             socket->send_buffer = kmalloc(TCP_WINDOW_SIZE);
             socket->send_buffer_size = TCP_WINDOW_SIZE;
             socket->send_buffer_used = 0;
+            hash_socket(socket);
+
+            socket->listener = listener;
+            if (listener->accept_tail) {
+                listener->accept_tail->accept_next = socket;
+            } else {
+                listener->accept_head = socket;
+            }
+            listener->accept_tail = socket;
+            listener->accept_count++;
 
             // Envoyer SYN-ACK
             packet_t response;
@@ -360,34 +841,34 @@ void handle_tcp_packet(packet_t* packet) {
             response_tcp->dest_port = socket->remote_port;
             response_tcp->sequence_number = socket->sequence_number;
             response_tcp->acknowledgment_number = socket->acknowledgment_number;
-            response_tcp->data_offset = sizeof(tcp_header_t) / 4;
+            response_tcp->data_offset = (sizeof(tcp_header_t) / 4) << 4;
             response_tcp->flags = 0x12; // SYN, ACK
             response_tcp->window_size = socket->window_size;
             response_tcp->urgent_pointer = 0;
-            response_tcp->checksum = calculate_tcp_checksum(response_tcp, NULL, 0);
+            response_tcp->checksum = calculate_tcp_checksum(response_tcp, socket->local_ip, socket->remote_ip, NULL, 0);
 
             send_packet(&response);
-            socket->state = 2; // SYN_RECEIVED
+            socket->state = TCP_STATE_SYN_RECEIVED;
         }
         return;
     }
 
     // Gérer les drapeaux TCP
     if (tcp_header->flags & 0x02) { // SYN
-        if (socket->state == 1) { // LISTEN
+        if (socket->state == TCP_STATE_LISTEN) {
             socket->acknowledgment_number = tcp_header->sequence_number + 1;
-            socket->state = 2; // SYN_RECEIVED
+            socket->state = TCP_STATE_SYN_RECEIVED;
         }
     } else if (tcp_header->flags & 0x10) { // ACK
-        if (socket->state == 2) { // SYN_RECEIVED
-            socket->state = 4; // ESTABLISHED
+        if (socket->state == TCP_STATE_SYN_RECEIVED) {
+            socket->state = TCP_STATE_ESTABLISHED;
         }
     } else if (tcp_header->flags & 0x01) { // FIN
-        socket->state = 5; // CLOSE_WAIT
+        socket->state = TCP_STATE_CLOSE_WAIT;
     }
 
     // Traiter les données
-    if (tcp_data_length > 0 && socket->state == 4) { // ESTABLISHED
+    if (tcp_data_length > 0 && socket->state == TCP_STATE_ESTABLISHED) {
         // Vérifier l'espace disponible dans le buffer de réception
         if (socket->receive_buffer_used + tcp_data_length <= socket->receive_buffer_size) {
             memcpy(socket->receive_buffer + socket->receive_buffer_used,
@@ -417,11 +898,11 @@ void handle_tcp_packet(packet_t* packet) {
         response_tcp->dest_port = socket->remote_port;
         response_tcp->sequence_number = socket->sequence_number;
         response_tcp->acknowledgment_number = socket->acknowledgment_number;
-        response_tcp->data_offset = sizeof(tcp_header_t) / 4;
+        response_tcp->data_offset = (sizeof(tcp_header_t) / 4) << 4;
         response_tcp->flags = 0x10; // ACK
         response_tcp->window_size = socket->window_size;
         response_tcp->urgent_pointer = 0;
-        response_tcp->checksum = calculate_tcp_checksum(response_tcp, NULL, 0);
+        response_tcp->checksum = calculate_tcp_checksum(response_tcp, socket->local_ip, socket->remote_ip, NULL, 0);
 
         send_packet(&response);
     }
@@ -0,0 +1,391 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+// Outil hôte: construire une image xiwafs (lecture seule, blocs compressés en LZ4) à
+// partir d'un dossier. Format décrit dans lib/xiwafs.c.
+//   mkxiwafs <dossier> <image> [block_log]
+
+#define XIWAFS_MAGIC 0x53465758 // "XWFS"
+#define XIWAFS_VERSION 1
+#define XIWAFS_DEFAULT_BLOCK_LOG 15
+#define XIWAFS_MIN_BLOCK_LOG 12
+#define XIWAFS_MAX_BLOCK_LOG 17
+#define XIWAFS_DEVICE_BLOCK 4096
+#define XIWAFS_TYPE_FILE 1
+#define XIWAFS_TYPE_DIRECTORY 2
+#define XIWAFS_BLOCK_RAW 0x80000000
+#define XIWAFS_BLOCK_END 0x7FFFFFFF
+#define MAX_NAME_LENGTH 255
+#define MAX_PATH 4096
+
+#define LZ4_HASH_LOG 12
+#define LZ4_MIN_MATCH 4
+#define LZ4_MAX_OFFSET 65535
+// Règles du format: les 5 derniers octets sont des littéraux, et aucune correspondance
+// ne commence dans les 12 derniers
+#define LZ4_LAST_LITERALS 5
+#define LZ4_MATCH_LIMIT 12
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t block_log;
+    uint32_t inode_count;
+    uint32_t entry_count;
+    uint32_t block_count;
+    uint32_t names_size;
+    uint32_t metadata_offset;
+    uint32_t metadata_size;
+    uint32_t image_size;
+    uint32_t reserved[7];
+} xiwafs_super_t;
+
+typedef struct {
+    uint16_t type;
+    uint16_t reserved;
+    uint32_t size;
+    uint32_t start;
+    uint32_t count;
+    uint32_t data;
+} xiwafs_inode_t;
+
+typedef struct {
+    uint32_t inode;
+    uint32_t name;
+    uint16_t name_length;
+    uint16_t reserved;
+} xiwafs_entry_t;
+
+// Tableau qui grandit par doublement
+typedef struct {
+    void* items;
+    size_t count;
+    size_t capacity;
+    size_t item_size;
+} Table;
+
+typedef struct {
+    FILE* image;
+    uint32_t offset;
+    uint32_t block_size;
+    uint32_t block_log;
+    Table inodes;
+    Table entries;
+    Table blocks;
+    Table names;
+    uint8_t* raw;
+    uint8_t* compressed;
+    uint64_t input_bytes;
+} Builder;
+
+static void* table_add(Table* table, size_t count) {
+    if (table->count + count > table->capacity) {
+        size_t capacity = table->capacity ? table->capacity : 64;
+        while (capacity < table->count + count) capacity *= 2;
+        void* items = realloc(table->items, capacity * table->item_size);
+        if (!items) {
+            fprintf(stderr, "mkxiwafs: mémoire insuffisante\n");
+            exit(1);
+        }
+        table->items = items;
+        table->capacity = capacity;
+    }
+    void* item = (char*)table->items + table->count * table->item_size;
+    memset(item, 0, count * table->item_size);
+    table->count += count;
+    return item;
+}
+
+static xiwafs_inode_t* inode_at(Builder* builder, uint32_t index) {
+    return (xiwafs_inode_t*)builder->inodes.items + index;
+}
+
+static uint32_t read32(const uint8_t* p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+// Longueur au-delà de 15 (littéraux) ou de 19 (correspondance): octets de 255 puis le reste
+static uint8_t* write_length(uint8_t* op, uint8_t* end, size_t length) {
+    while (length >= 255) {
+        if (op >= end) return NULL;
+        *op++ = 255;
+        length -= 255;
+    }
+    if (op >= end) return NULL;
+    *op++ = (uint8_t)length;
+    return op;
+}
+
+// Une séquence: littéraux [anchor, anchor + literals) puis une correspondance (match_length 0: aucune)
+static uint8_t* write_sequence(uint8_t* op, uint8_t* end, const uint8_t* anchor, size_t literals,
+                               uint32_t offset, size_t match_length) {
+    if (op >= end) return NULL;
+    uint8_t* token = op++;
+    *token = (uint8_t)((literals >= 15 ? 15 : literals) << 4);
+    if (literals >= 15 && !(op = write_length(op, end, literals - 15))) return NULL;
+    if ((size_t)(end - op) < literals) return NULL;
+    memcpy(op, anchor, literals);
+    op += literals;
+
+    if (!match_length) return op;
+    if (end - op < 2) return NULL;
+    *op++ = offset & 0xFF;
+    *op++ = offset >> 8;
+    size_t extra = match_length - LZ4_MIN_MATCH;
+    *token |= extra >= 15 ? 15 : extra;
+    if (extra >= 15 && !(op = write_length(op, end, extra - 15))) return NULL;
+    return op;
+}
+
+// Compression LZ4 gloutonne (format bloc); 0 si le résultat ne tient pas dans `capacity`
+static size_t lz4_compress(const uint8_t* source, size_t size, uint8_t* dest, size_t capacity) {
+    static uint32_t table[1 << LZ4_HASH_LOG];
+    memset(table, 0, sizeof(table));
+
+    uint8_t* op = dest;
+    uint8_t* end = dest + capacity;
+    size_t anchor = 0;
+    size_t ip = 0;
+
+    if (size > LZ4_MATCH_LIMIT) {
+        size_t limit = size - LZ4_MATCH_LIMIT;
+        size_t match_end = size - LZ4_LAST_LITERALS;
+        while (ip < limit) {
+            uint32_t sequence = read32(source + ip);
+            uint32_t hash = (sequence * 2654435761u) >> (32 - LZ4_HASH_LOG);
+            // Positions rangées + 1: 0 marque une case vide
+            size_t candidate = table[hash];
+            table[hash] = (uint32_t)ip + 1;
+
+            if (!candidate || ip - (candidate - 1) > LZ4_MAX_OFFSET || read32(source + candidate - 1) != sequence) {
+                ip++;
+                continue;
+            }
+            size_t ref = candidate - 1;
+            size_t length = LZ4_MIN_MATCH;
+            while (ip + length < match_end && source[ref + length] == source[ip + length]) length++;
+
+            op = write_sequence(op, end, source + anchor, ip - anchor, (uint32_t)(ip - ref), length);
+            if (!op) return 0;
+            ip += length;
+            anchor = ip;
+        }
+    }
+
+    op = write_sequence(op, end, source + anchor, size - anchor, 0, 0);
+    return op ? (size_t)(op - dest) : 0;
+}
+
+// Compresser et écrire le contenu de `path` dans l'image, bloc par bloc
+static int add_file_data(Builder* builder, uint32_t index, const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "mkxiwafs: impossible de lire %s\n", path);
+        return -1;
+    }
+
+    xiwafs_inode_t* inode = inode_at(builder, index);
+    inode->start = builder->blocks.count;
+    inode->data = builder->offset;
+
+    uint32_t stored = 0;
+    uint64_t size = 0;
+    size_t length;
+    while ((length = fread(builder->raw, 1, builder->block_size, file)) > 0) {
+        // Un bloc qui ne gagne rien reste tel quel
+        size_t packed = lz4_compress(builder->raw, length, builder->compressed, length - 1);
+        const uint8_t* data = packed ? builder->compressed : builder->raw;
+        size_t written = packed ? packed : length;
+
+        if ((uint64_t)stored + written > XIWAFS_BLOCK_END || fwrite(data, 1, written, builder->image) != written) {
+            fprintf(stderr, "mkxiwafs: %s trop grand ou écriture impossible\n", path);
+            fclose(file);
+            return -1;
+        }
+        stored += written;
+        size += length;
+
+        uint32_t* end = (uint32_t*)table_add(&builder->blocks, 1);
+        *end = stored | (packed ? 0 : XIWAFS_BLOCK_RAW);
+        if (length < builder->block_size) break;
+    }
+    fclose(file);
+
+    if (size > 0xFFFFFFFF) {
+        fprintf(stderr, "mkxiwafs: %s dépasse 4 Go\n", path);
+        return -1;
+    }
+    inode = inode_at(builder, index);
+    inode->size = (uint32_t)size;
+    inode->count = builder->blocks.count - inode->start;
+    builder->offset += stored;
+    builder->input_bytes += size;
+    return 0;
+}
+
+static int compare_names(const void* a, const void* b) {
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+// Ajouter le dossier `path`, déjà créé comme inode `index`: ses entrées, triées et
+// contiguës, d'abord, puis le contenu de chaque enfant
+static int add_directory(Builder* builder, uint32_t index, const char* path) {
+    DIR* dir = opendir(path);
+    if (!dir) {
+        fprintf(stderr, "mkxiwafs: impossible d'ouvrir %s\n", path);
+        return -1;
+    }
+
+    char** names = NULL;
+    size_t name_count = 0;
+    struct dirent* dirent;
+    while ((dirent = readdir(dir))) {
+        if (strcmp(dirent->d_name, ".") == 0 || strcmp(dirent->d_name, "..") == 0) continue;
+        if (strlen(dirent->d_name) > MAX_NAME_LENGTH) {
+            fprintf(stderr, "mkxiwafs: nom trop long ignoré: %s\n", dirent->d_name);
+            continue;
+        }
+        names = (char**)realloc(names, (name_count + 1) * sizeof(char*));
+        names[name_count++] = strdup(dirent->d_name);
+    }
+    closedir(dir);
+    qsort(names, name_count, sizeof(char*), compare_names);
+
+    // Chemins et types des enfants retenus (liens et fichiers spéciaux ignorés)
+    char** paths = (char**)calloc(name_count ? name_count : 1, sizeof(char*));
+    uint32_t* children = (uint32_t*)calloc(name_count ? name_count : 1, sizeof(uint32_t));
+    uint32_t first_entry = builder->entries.count;
+    uint32_t kept = 0;
+    int result = 0;
+
+    for (size_t i = 0; i < name_count; i++) {
+        char child_path[MAX_PATH];
+        struct stat st;
+        snprintf(child_path, sizeof(child_path), "%s/%s", path, names[i]);
+        if (lstat(child_path, &st) < 0 || (!S_ISREG(st.st_mode) && !S_ISDIR(st.st_mode))) continue;
+
+        uint32_t child = builder->inodes.count;
+        xiwafs_inode_t* inode = (xiwafs_inode_t*)table_add(&builder->inodes, 1);
+        inode->type = S_ISDIR(st.st_mode) ? XIWAFS_TYPE_DIRECTORY : XIWAFS_TYPE_FILE;
+
+        size_t name_length = strlen(names[i]);
+        xiwafs_entry_t* entry = (xiwafs_entry_t*)table_add(&builder->entries, 1);
+        entry->inode = child;
+        entry->name = builder->names.count;
+        entry->name_length = (uint16_t)name_length;
+        memcpy(table_add(&builder->names, name_length), names[i], name_length);
+
+        paths[kept] = strdup(child_path);
+        children[kept] = child;
+        kept++;
+    }
+
+    xiwafs_inode_t* inode = inode_at(builder, index);
+    inode->start = first_entry;
+    inode->count = kept;
+    inode->size = kept;
+
+    for (uint32_t i = 0; i < kept && result == 0; i++) {
+        if (inode_at(builder, children[i])->type == XIWAFS_TYPE_DIRECTORY) {
+            result = add_directory(builder, children[i], paths[i]);
+        } else {
+            result = add_file_data(builder, children[i], paths[i]);
+        }
+    }
+
+    for (uint32_t i = 0; i < kept; i++) free(paths[i]);
+    for (size_t i = 0; i < name_count; i++) free(names[i]);
+    free(paths);
+    free(children);
+    free(names);
+    return result;
+}
+
+static int write_table(Builder* builder, Table* table) {
+    size_t size = table->count * table->item_size;
+    if (size && fwrite(table->items, 1, size, builder->image) != size) return -1;
+    builder->offset += size;
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3 || argc > 4) {
+        fprintf(stderr, "Usage: %s <dossier> <image> [block_log]\n", argv[0]);
+        return 1;
+    }
+
+    Builder builder;
+    memset(&builder, 0, sizeof(Builder));
+    builder.block_log = argc == 4 ? (uint32_t)atoi(argv[3]) : XIWAFS_DEFAULT_BLOCK_LOG;
+    if (builder.block_log < XIWAFS_MIN_BLOCK_LOG || builder.block_log > XIWAFS_MAX_BLOCK_LOG) {
+        fprintf(stderr, "mkxiwafs: block_log entre %d et %d\n", XIWAFS_MIN_BLOCK_LOG, XIWAFS_MAX_BLOCK_LOG);
+        return 1;
+    }
+    builder.block_size = 1u << builder.block_log;
+    builder.inodes.item_size = sizeof(xiwafs_inode_t);
+    builder.entries.item_size = sizeof(xiwafs_entry_t);
+    builder.blocks.item_size = sizeof(uint32_t);
+    builder.names.item_size = 1;
+    builder.raw = (uint8_t*)malloc(builder.block_size);
+    builder.compressed = (uint8_t*)malloc(builder.block_size);
+
+    builder.image = fopen(argv[2], "wb");
+    if (!builder.image || !builder.raw || !builder.compressed) {
+        fprintf(stderr, "mkxiwafs: impossible de créer %s\n", argv[2]);
+        return 1;
+    }
+
+    // Superbloc écrit en dernier, quand toutes les tailles sont connues
+    xiwafs_super_t super;
+    memset(&super, 0, sizeof(super));
+    fwrite(&super, 1, sizeof(super), builder.image);
+    builder.offset = sizeof(super);
+
+    xiwafs_inode_t* root = (xiwafs_inode_t*)table_add(&builder.inodes, 1);
+    root->type = XIWAFS_TYPE_DIRECTORY;
+    if (add_directory(&builder, 0, argv[1]) < 0) {
+        fclose(builder.image);
+        remove(argv[2]);
+        return 1;
+    }
+
+    super.magic = XIWAFS_MAGIC;
+    super.version = XIWAFS_VERSION;
+    super.block_log = builder.block_log;
+    super.inode_count = builder.inodes.count;
+    super.entry_count = builder.entries.count;
+    super.block_count = builder.blocks.count;
+    super.names_size = builder.names.count;
+    super.metadata_offset = builder.offset;
+    if (write_table(&builder, &builder.inodes) < 0 || write_table(&builder, &builder.entries) < 0 ||
+        write_table(&builder, &builder.blocks) < 0 || write_table(&builder, &builder.names) < 0) {
+        fprintf(stderr, "mkxiwafs: écriture impossible\n");
+        fclose(builder.image);
+        remove(argv[2]);
+        return 1;
+    }
+    super.metadata_size = builder.offset - super.metadata_offset;
+
+    // Le noyau lit l'image par blocs de périphérique entiers
+    static const uint8_t zeros[XIWAFS_DEVICE_BLOCK];
+    uint32_t padding = (XIWAFS_DEVICE_BLOCK - builder.offset % XIWAFS_DEVICE_BLOCK) % XIWAFS_DEVICE_BLOCK;
+    fwrite(zeros, 1, padding, builder.image);
+    super.image_size = builder.offset + padding;
+
+    fseek(builder.image, 0, SEEK_SET);
+    fwrite(&super, 1, sizeof(super), builder.image);
+    if (fclose(builder.image) != 0) {
+        fprintf(stderr, "mkxiwafs: écriture impossible\n");
+        return 1;
+    }
+
+    printf("%s: %u inodes, %llu octets -> %u octets (blocs de %u)\n", argv[2], super.inode_count,
+           (unsigned long long)builder.input_bytes, super.image_size, builder.block_size);
+    return 0;
+}